@@ -0,0 +1,45 @@
+const soundengine = require('../')
+
+// Measures the cost of dispatching an event to native listeners.
+// Run with: node benchmark/emit.js [iterations]
+
+const iterations = parseInt(process.argv[2], 10) || 1000000
+
+// An output only engine is enough, the stream is not needed for emitting
+var engine = new soundengine.engine({inputDevice: -1})
+
+function measure(name, listenerCount, args) {
+    engine.removeAllListeners('recording_progress')
+    var calls = 0
+    for (var i = 0; i < listenerCount; ++i) {
+        engine.on('recording_progress', () => { ++calls })
+    }
+
+    // Warm up
+    for (var i = 0; i < 10000; ++i) engine.emit.apply(engine, args)
+
+    var start = process.hrtime()
+    for (var i = 0; i < iterations; ++i) engine.emit.apply(engine, args)
+    var elapsed = process.hrtime(start)
+    var ns = (elapsed[0] * 1e9 + elapsed[1]) / iterations
+
+    console.log(`${name}: ${ns.toFixed(1)} ns per emit (${listenerCount} listeners)`)
+    return calls
+}
+
+measure('no listeners', 0, ['recording_progress', 0, 1])
+measure('one listener', 1, ['recording_progress', 0, 1])
+measure('ten listeners', 10, ['recording_progress', 0, 1])
+measure('unknown event', 0, ['not_an_event', 0, 1])
+
+// Listeners that remove themselves while being emitted
+engine.removeAllListeners('recording_progress')
+var start = process.hrtime()
+for (var i = 0; i < iterations / 10; ++i) {
+    engine.once('recording_progress', () => {})
+    engine.emit('recording_progress', 0, 1)
+}
+var elapsed = process.hrtime(start)
+console.log(`once listener: ${((elapsed[0] * 1e9 + elapsed[1]) / (iterations / 10)).toFixed(1)} ns per add and emit`)
+
+process.exit(0)
@@ -4,7 +4,30 @@
 			"target_name": "soundengine",
 			"sources": [
 				"src/SoundEngine.cpp",
+				"src/Events.cpp",
 				"src/WindowFunction.cpp",
+				"src/BufferPool.cpp",
+				"src/AudioBlock.cpp",
+				"src/RingBuffer.cpp",
+				"src/Stft.cpp",
+				"src/Meter.cpp",
+				"src/FftPlanCache.cpp",
+				"src/SampleArena.cpp",
+				"src/DiskRecorder.cpp",
+				"src/MappedWave.cpp",
+				"src/SampleFormat.cpp",
+				"src/WaveFile.cpp",
+				"src/Resampler.cpp",
+				"src/Slac.cpp",
+				"src/Biquad.cpp",
+				"src/DspGraph.cpp",
+				"src/Equalizer.cpp",
+				"src/Convolver.cpp",
+				"src/ToneGenerator.cpp",
+				"src/Timeline.cpp",
+				"src/ClipMixer.cpp",
+				"src/VectorMath.cpp",
+				"src/Telemetry.cpp",
 				"third_party/readerwriterqueue/readerwriterqueue.h"
 			],
 			"include_dirs": [
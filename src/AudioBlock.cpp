@@ -0,0 +1,141 @@
+#include "AudioBlock.h"
+
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+int Sound::AudioBlock::strideFor(int frames) {
+	int floatsPerLine = AUDIO_BLOCK_ALIGNMENT / sizeof(float);
+	return ((frames + floatsPerLine - 1) / floatsPerLine) * floatsPerLine;
+}
+
+int Sound::AudioBlock::sizeFor(int frames, int channels) {
+	return strideFor(frames) * (channels > 0 ? channels : 1);
+}
+
+Sound::AudioBlock::AudioBlock(float* data, int frames, int channels):
+	_data(data), _frames(frames), _channels(channels > 0 ? channels : 1)
+{
+	_stride = strideFor(frames);
+}
+
+float* Sound::AudioBlock::data() const {
+	return _data;
+}
+
+int Sound::AudioBlock::frames() const {
+	return _frames;
+}
+
+int Sound::AudioBlock::channels() const {
+	return _channels;
+}
+
+int Sound::AudioBlock::stride() const {
+	return _stride;
+}
+
+void Sound::AudioBlock::clear() {
+	memset(_data, 0, sizeof(float) * (size_t)_stride * _channels);
+}
+
+void Sound::AudioBlock::deinterleave(const float* samples, int frames, int sourceChannels) {
+	if (samples == NULL || frames <= 0) {
+		clear();
+		return;
+	}
+	if (frames > _frames) frames = _frames;
+
+	if (sourceChannels == 1) {
+		// Mono feeds every channel
+		for (int c = 0; c < _channels; ++c) {
+			memcpy(channel(c), samples, sizeof(float) * frames);
+		}
+	} else if (sourceChannels == 2 && _channels >= 2) {
+		float* left = channel(0);
+		float* right = channel(1);
+		int i = 0;
+#if defined(__SSE__)
+		for (; i + 4 <= frames; i += 4) {
+			// l0 r0 l1 r1 | l2 r2 l3 r3
+			__m128 a = _mm_loadu_ps(samples + 2 * i);
+			__m128 b = _mm_loadu_ps(samples + 2 * i + 4);
+			_mm_store_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_store_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+#endif
+		for (; i < frames; ++i) {
+			left[i] = samples[2 * i];
+			right[i] = samples[2 * i + 1];
+		}
+		for (int c = 2; c < _channels; ++c) {
+			memset(channel(c), 0, sizeof(float) * frames);
+		}
+	} else {
+		for (int c = 0; c < _channels; ++c) {
+			float* dst = channel(c);
+			if (c >= sourceChannels) {
+				memset(dst, 0, sizeof(float) * frames);
+				continue;
+			}
+			const float* src = samples + c;
+			for (int i = 0; i < frames; ++i) {
+				dst[i] = src[(size_t)i * sourceChannels];
+			}
+		}
+	}
+
+	// Silence the rest of a short block
+	if (frames < _frames) {
+		for (int c = 0; c < _channels; ++c) {
+			memset(channel(c) + frames, 0, sizeof(float) * (_frames - frames));
+		}
+	}
+}
+
+void Sound::AudioBlock::interleave(float* samples, int frames, int targetChannels) const {
+	if (frames > _frames) frames = _frames;
+
+	if (targetChannels == 1) {
+		memcpy(samples, channel(0), sizeof(float) * frames);
+	} else if (targetChannels == 2 && _channels <= 2) {
+		// A mono block is played on both channels
+		const float* left = channel(0);
+		const float* right = channel(_channels - 1);
+		int i = 0;
+#if defined(__SSE__)
+		for (; i + 4 <= frames; i += 4) {
+			__m128 l = _mm_load_ps(left + i);
+			__m128 r = _mm_load_ps(right + i);
+			_mm_storeu_ps(samples + 2 * i, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(samples + 2 * i + 4, _mm_unpackhi_ps(l, r));
+		}
+#endif
+		for (; i < frames; ++i) {
+			samples[2 * i] = left[i];
+			samples[2 * i + 1] = right[i];
+		}
+	} else {
+		for (int c = 0; c < targetChannels; ++c) {
+			float* dst = samples + c;
+			if (c >= _channels && _channels != 1) {
+				for (int i = 0; i < frames; ++i) dst[(size_t)i * targetChannels] = 0.0f;
+				continue;
+			}
+			const float* src = channel(_channels == 1 ? 0 : c);
+			for (int i = 0; i < frames; ++i) {
+				dst[(size_t)i * targetChannels] = src[i];
+			}
+		}
+	}
+}
+
+void Sound::AudioBlock::scale(float gain) {
+	// The padding between the channels is scaled as well, so this is one unit stride loop
+	int count = _stride * _channels;
+	for (int i = 0; i < count; ++i) {
+		_data[i] *= gain;
+	}
+}
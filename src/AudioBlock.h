@@ -0,0 +1,81 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_AUDIO_BLOCK_H
+#define SOUND_AUDIO_BLOCK_H
+
+#include <stddef.h>
+
+// Every channel starts on a cache line (the blocks of the buffer pool are aligned the same way)
+#define AUDIO_BLOCK_ALIGNMENT 64
+
+namespace Sound {
+
+	/**
+	 * A block of frames x channels samples in planar layout.
+	 *
+	 * The block does not own its memory, it is a view on a block of the buffer pool.
+	 * Every channel is a contiguous, aligned array, so per channel kernels (metering,
+	 * gain, mixdown) run over unit stride memory. Samples are only interleaved at the
+	 * device and file boundaries with deinterleave() and interleave().
+	 */
+	class AudioBlock {
+	public:
+		/** The distance between two channels in floats (frames rounded up to a cache line). */
+		static int strideFor(int frames);
+
+		/** The number of floats a block of frames x channels occupies. */
+		static int sizeFor(int frames, int channels);
+
+		AudioBlock(float* data, int frames, int channels);
+
+		/** The start of the block memory. */
+		float* data() const;
+
+		int frames() const;
+		int channels() const;
+
+		/** The distance between two channels in floats. */
+		int stride() const;
+
+		/** The samples of a channel. */
+		inline float* channel(int c) const {
+			return _data + (size_t)c * _stride;
+		}
+
+		/** Silences the block. */
+		void clear();
+
+		/**
+		 * Splits interleaved samples into the channels.
+		 *
+		 * A mono source is copied into every channel, channels the source does not have
+		 * stay silent and additional source channels are dropped.
+		 *
+		 * @param samples        The interleaved samples (NULL silences the block).
+		 * @param frames         The number of source frames (the rest of the block is silenced).
+		 * @param sourceChannels The number of interleaved source channels.
+		 */
+		void deinterleave(const float* samples, int frames, int sourceChannels);
+
+		/**
+		 * Interleaves the channels into a buffer with the same channel mapping as deinterleave().
+		 *
+		 * @param samples        Receives frames x targetChannels samples.
+		 * @param frames         The number of frames.
+		 * @param targetChannels The number of interleaved target channels.
+		 */
+		void interleave(float* samples, int frames, int targetChannels) const;
+
+		/** Multiplies every sample with a gain. */
+		void scale(float gain);
+	private:
+		float* _data;
+		int _frames;
+		int _channels;
+		int _stride;
+	};
+}
+
+#endif
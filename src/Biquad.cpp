@@ -0,0 +1,152 @@
+#include "Biquad.h"
+
+#include <math.h>
+
+static const char* names[] = {
+	"lowpass",
+	"highpass",
+	"bandpass",
+	"notch",
+	"peak",
+	"lowshelf",
+	"highshelf",
+	"allpass"
+};
+
+const char* Sound::biquadTypeName(BiquadType type) {
+	return names[type];
+}
+
+bool Sound::parseBiquadType(std::string name, BiquadType* type) {
+	for (int i = 0; i <= BiquadAllpass; ++i) {
+		if (name == names[i]) {
+			*type = (BiquadType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+Sound::BiquadCoefficients Sound::BiquadCoefficients::design(BiquadType type, double sampleRate, double frequency, double q, double gain) {
+	// Keep the corner away from dc and nyquist where the designs degenerate
+	if (frequency < 1.0) frequency = 1.0;
+	if (frequency > 0.49 * sampleRate) frequency = 0.49 * sampleRate;
+	if (q < 0.01) q = 0.01;
+
+	double A = pow(10.0, gain / 40.0);
+	double w0 = 2.0 * M_PI * frequency / sampleRate;
+	double cosw = cos(w0);
+	double alpha = sin(w0) / (2.0 * q);
+	double shelf = 2.0 * sqrt(A) * alpha;
+
+	double b0, b1, b2, a0, a1, a2;
+	switch (type) {
+		case BiquadLowpass:
+			b0 = (1.0 - cosw) / 2.0;
+			b1 = 1.0 - cosw;
+			b2 = (1.0 - cosw) / 2.0;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosw;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadHighpass:
+			b0 = (1.0 + cosw) / 2.0;
+			b1 = -(1.0 + cosw);
+			b2 = (1.0 + cosw) / 2.0;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosw;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadBandpass:
+			// Constant 0 dB peak gain
+			b0 = alpha;
+			b1 = 0.0;
+			b2 = -alpha;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosw;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadNotch:
+			b0 = 1.0;
+			b1 = -2.0 * cosw;
+			b2 = 1.0;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosw;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadPeak:
+			b0 = 1.0 + alpha * A;
+			b1 = -2.0 * cosw;
+			b2 = 1.0 - alpha * A;
+			a0 = 1.0 + alpha / A;
+			a1 = -2.0 * cosw;
+			a2 = 1.0 - alpha / A;
+			break;
+		case BiquadLowShelf:
+			b0 = A * ((A + 1.0) - (A - 1.0) * cosw + shelf);
+			b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw);
+			b2 = A * ((A + 1.0) - (A - 1.0) * cosw - shelf);
+			a0 = (A + 1.0) + (A - 1.0) * cosw + shelf;
+			a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cosw);
+			a2 = (A + 1.0) + (A - 1.0) * cosw - shelf;
+			break;
+		case BiquadHighShelf:
+			b0 = A * ((A + 1.0) + (A - 1.0) * cosw + shelf);
+			b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw);
+			b2 = A * ((A + 1.0) + (A - 1.0) * cosw - shelf);
+			a0 = (A + 1.0) - (A - 1.0) * cosw + shelf;
+			a1 = 2.0 * ((A - 1.0) - (A + 1.0) * cosw);
+			a2 = (A + 1.0) - (A - 1.0) * cosw - shelf;
+			break;
+		case BiquadAllpass:
+		default:
+			b0 = 1.0 - alpha;
+			b1 = -2.0 * cosw;
+			b2 = 1.0 + alpha;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosw;
+			a2 = 1.0 - alpha;
+			break;
+	}
+
+	BiquadCoefficients coefficients;
+	coefficients.b0 = (float)(b0 / a0);
+	coefficients.b1 = (float)(b1 / a0);
+	coefficients.b2 = (float)(b2 / a0);
+	coefficients.a1 = (float)(a1 / a0);
+	coefficients.a2 = (float)(a2 / a0);
+	return coefficients;
+}
+
+Sound::BiquadCoefficients Sound::BiquadCoefficients::identity() {
+	BiquadCoefficients coefficients;
+	coefficients.b0 = 1.0f;
+	coefficients.b1 = 0.0f;
+	coefficients.b2 = 0.0f;
+	coefficients.a1 = 0.0f;
+	coefficients.a2 = 0.0f;
+	return coefficients;
+}
+
+void Sound::BiquadState::reset() {
+	z1 = 0.0f;
+	z2 = 0.0f;
+}
+
+void Sound::BiquadState::process(const BiquadCoefficients& coefficients, const float* in, float* out, int frames) {
+	float b0 = coefficients.b0, b1 = coefficients.b1, b2 = coefficients.b2;
+	float a1 = coefficients.a1, a2 = coefficients.a2;
+	float s1 = z1, s2 = z2;
+	for (int i = 0; i < frames; ++i) {
+		float x = in[i];
+		float y = b0 * x + s1;
+		s1 = b1 * x - a1 * y + s2;
+		s2 = b2 * x - a2 * y;
+		out[i] = y;
+	}
+	// Flush denormals when the signal decays into silence
+	if (fabsf(s1) < 1e-20f) s1 = 0.0f;
+	if (fabsf(s2) < 1e-20f) s2 = 0.0f;
+	z1 = s1;
+	z2 = s2;
+}
@@ -0,0 +1,70 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_BIQUAD_H
+#define SOUND_BIQUAD_H
+
+#include <string>
+
+namespace Sound {
+
+	/**
+	 * The filter shapes of the audio eq cookbook (Robert Bristow-Johnson).
+	 */
+	enum BiquadType {
+		BiquadLowpass,
+		BiquadHighpass,
+		BiquadBandpass,
+		BiquadNotch,
+		BiquadPeak,
+		BiquadLowShelf,
+		BiquadHighShelf,
+		BiquadAllpass
+	};
+
+	/** The name used in the js api (lowpass, highpass, bandpass, notch, peak, lowshelf, highshelf or allpass). */
+	const char* biquadTypeName(BiquadType type);
+
+	/**
+	 * Parses a filter name of the js api.
+	 *
+	 * @return false if the name is unknown.
+	 */
+	bool parseBiquadType(std::string name, BiquadType* type);
+
+	/**
+	 * The coefficients of a biquad normalized to a0 = 1.
+	 */
+	struct BiquadCoefficients {
+		float b0, b1, b2, a1, a2;
+
+		/**
+		 * Designs a filter.
+		 *
+		 * @param type       The filter shape.
+		 * @param sampleRate The sample rate of the filtered signal.
+		 * @param frequency  The corner or center frequency in Hz (clamped below nyquist).
+		 * @param q          The quality (the bandwidth of bandpass, notch and peak, the slope of the shelves).
+		 * @param gain       The gain of peak and shelf filters in dB.
+		 */
+		static BiquadCoefficients design(BiquadType type, double sampleRate, double frequency, double q, double gain);
+
+		/** A filter that passes the signal unchanged. */
+		static BiquadCoefficients identity();
+	};
+
+	/**
+	 * The state of one channel in transposed direct form II.
+	 */
+	struct BiquadState {
+		float z1, z2;
+
+		void reset();
+
+		/** Filters frames samples (in and out may be the same). */
+		void process(const BiquadCoefficients& coefficients, const float* in, float* out, int frames);
+	};
+}
+
+#endif
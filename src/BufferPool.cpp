@@ -0,0 +1,94 @@
+#include "BufferPool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Blocks start on cache line boundaries so that neighbouring blocks never share a line
+#define BUFFER_POOL_ALIGNMENT 64
+
+Sound::BufferPool::BufferPool(int blockSize, int blockCount): _blockSize(blockSize), _blockCount(blockCount) {
+	int floatsPerLine = BUFFER_POOL_ALIGNMENT / sizeof(float);
+	stride = ((blockSize + floatsPerLine - 1) / floatsPerLine) * floatsPerLine;
+
+	void* memory = NULL;
+	if (posix_memalign(&memory, BUFFER_POOL_ALIGNMENT, (size_t)stride * blockCount * sizeof(float)) != 0) {
+		memory = NULL;
+		_blockCount = 0;
+	}
+	slab = (float*)memory;
+	if (slab != NULL) {
+		memset(slab, 0, (size_t)stride * blockCount * sizeof(float));
+	}
+
+	// Chain all blocks into the free list
+	next = new std::atomic<int>[_blockCount > 0 ? _blockCount : 1];
+	for (int i = 0; i < _blockCount; ++i) {
+		next[i].store(i + 1 < _blockCount ? i + 1 : -1, std::memory_order_relaxed);
+	}
+	head.store(_blockCount > 0 ? 1 : 0, std::memory_order_relaxed);
+
+	_available.store(_blockCount);
+	_minAvailable.store(_blockCount);
+	_exhausted.store(0);
+}
+
+Sound::BufferPool::~BufferPool() {
+	free(slab);
+	delete[] next;
+}
+
+float* Sound::BufferPool::acquire() {
+	uint64_t oldHead = head.load(std::memory_order_acquire);
+	uint64_t newHead;
+	int idx;
+	do {
+		idx = (int)(oldHead & 0xffffffff) - 1;
+		if (idx < 0) {
+			_exhausted.fetch_add(1, std::memory_order_relaxed);
+			return NULL;
+		}
+		uint64_t tag = (oldHead >> 32) + 1;
+		newHead = (tag << 32) | (uint64_t)(next[idx].load(std::memory_order_relaxed) + 1);
+	} while (!head.compare_exchange_weak(oldHead, newHead, std::memory_order_acq_rel, std::memory_order_acquire));
+
+	int available = _available.fetch_sub(1, std::memory_order_relaxed) - 1;
+	int minAvailable = _minAvailable.load(std::memory_order_relaxed);
+	while (available < minAvailable && !_minAvailable.compare_exchange_weak(minAvailable, available, std::memory_order_relaxed));
+
+	return slab + (size_t)idx * stride;
+}
+
+void Sound::BufferPool::release(float* block) {
+	if (block == NULL) return;
+	int idx = (int)((block - slab) / stride);
+
+	uint64_t oldHead = head.load(std::memory_order_acquire);
+	uint64_t newHead;
+	do {
+		next[idx].store((int)(oldHead & 0xffffffff) - 1, std::memory_order_relaxed);
+		uint64_t tag = (oldHead >> 32) + 1;
+		newHead = (tag << 32) | (uint64_t)(idx + 1);
+	} while (!head.compare_exchange_weak(oldHead, newHead, std::memory_order_acq_rel, std::memory_order_acquire));
+
+	_available.fetch_add(1, std::memory_order_relaxed);
+}
+
+int Sound::BufferPool::blockSize() const {
+	return _blockSize;
+}
+
+int Sound::BufferPool::capacity() const {
+	return _blockCount;
+}
+
+int Sound::BufferPool::available() const {
+	return _available.load(std::memory_order_relaxed);
+}
+
+int Sound::BufferPool::minAvailable() const {
+	return _minAvailable.load(std::memory_order_relaxed);
+}
+
+unsigned int Sound::BufferPool::exhausted() const {
+	return _exhausted.load(std::memory_order_relaxed);
+}
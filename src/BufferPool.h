@@ -0,0 +1,78 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_BUFFER_POOL_H
+#define SOUND_BUFFER_POOL_H
+
+#include <atomic>
+#include <stdint.h>
+
+namespace Sound {
+
+	/**
+	 * A fixed set of equally sized sample blocks that are allocated once.
+	 *
+	 * acquire() and release() never touch the heap and never lock, so blocks can be
+	 * taken in the PortAudio callback, passed through the buffer queues and handed
+	 * back from either thread.
+	 */
+	class BufferPool {
+	public:
+		BufferPool(int blockSize, int blockCount);
+		~BufferPool();
+
+		/**
+		 * Takes a block from the pool.
+		 *
+		 * @return The block or NULL if the pool is exhausted.
+		 */
+		float* acquire();
+
+		/**
+		 * Hands a block that was taken with acquire() back to the pool.
+		 *
+		 * @param block The block.
+		 */
+		void release(float* block);
+
+		/** The number of floats per block. */
+		int blockSize() const;
+
+		/** The total number of blocks. */
+		int capacity() const;
+
+		/** The number of blocks that are currently free. */
+		int available() const;
+
+		/** The lowest number of free blocks seen since the pool was created. */
+		int minAvailable() const;
+
+		/** How often acquire() failed because all blocks were in use. */
+		unsigned int exhausted() const;
+	private:
+		/** The number of floats per block. */
+		int _blockSize;
+
+		/** The number of blocks. */
+		int _blockCount;
+
+		/** The distance between two blocks in floats (blockSize rounded up to a cache line). */
+		int stride;
+
+		/** One allocation that holds all blocks. */
+		float* slab;
+
+		/** The index of the next free block for every block (-1 terminates the list). */
+		std::atomic<int>* next;
+
+		/** The first free block index + 1 in the low and an ABA tag in the high 32 bits. */
+		std::atomic<uint64_t> head;
+
+		std::atomic<int> _available;
+		std::atomic<int> _minAvailable;
+		std::atomic<unsigned int> _exhausted;
+	};
+}
+
+#endif
@@ -0,0 +1,357 @@
+#include "ClipMixer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <uv.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// The samples of a clip are read in chunks of this many frames
+#define CLIP_READ_FRAMES 16384
+
+static float* allocAligned(size_t count) {
+	void* memory = NULL;
+	if (posix_memalign(&memory, AUDIO_BLOCK_ALIGNMENT, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+		return NULL;
+	}
+	memset(memory, 0, sizeof(float) * (count > 0 ? count : 1));
+	return (float*)memory;
+}
+
+/**
+ * Adds src with a linear gain ramp to dst (dst[i] += src[i] * (gain + step * i)).
+ */
+static void mixRamp(float* dst, const float* src, float gain, float step, int count) {
+	int i = 0;
+#if defined(__SSE__)
+	__m128 g = _mm_setr_ps(gain, gain + step, gain + 2 * step, gain + 3 * step);
+	__m128 g4 = _mm_set1_ps(4 * step);
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(src + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(x, g)));
+		g = _mm_add_ps(g, g4);
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] += src[i] * (gain + step * i);
+	}
+}
+
+Sound::Clip::Clip(const SampleSource* source, int channels, std::string file): _file(file) {
+	_channels = channels > 0 ? channels : 1;
+	_frames = source->size() / _channels;
+	// Every channel starts on a cache line like the channels of the blocks
+	int64_t line = AUDIO_BLOCK_ALIGNMENT / sizeof(float);
+	stride = ((_frames + line - 1) / line) * line;
+	data = allocAligned((size_t)stride * _channels);
+	if (data == NULL) {
+		_frames = 0;
+		stride = 0;
+		return;
+	}
+
+	// Deinterleave the source chunk by chunk
+	std::vector<float> samples((size_t)CLIP_READ_FRAMES * _channels);
+	for (int64_t frame = 0; frame < _frames; frame += CLIP_READ_FRAMES) {
+		int64_t read = source->read(frame * _channels, samples.data(), (int64_t)CLIP_READ_FRAMES * _channels) / _channels;
+		for (int c = 0; c < _channels; ++c) {
+			float* dst = data + (size_t)c * stride + frame;
+			for (int64_t i = 0; i < read; ++i) {
+				dst[i] = samples[(size_t)i * _channels + c];
+			}
+		}
+		if (read < CLIP_READ_FRAMES) break;
+	}
+}
+
+Sound::Clip::~Clip() {
+	free(data);
+}
+
+int Sound::Clip::channels() const {
+	return _channels;
+}
+
+int64_t Sound::Clip::frames() const {
+	return _frames;
+}
+
+const std::string& Sound::Clip::file() const {
+	return _file;
+}
+
+size_t Sound::Clip::memory() const {
+	return sizeof(float) * (size_t)stride * _channels;
+}
+
+bool Sound::Clip::isLoaded() const {
+	return data != NULL;
+}
+
+Sound::ClipMixer::ClipMixer(): nextClipId(0), nextVoiceId(0) {
+	resetStats();
+}
+
+Sound::ClipMixer::~ClipMixer() {
+	for (size_t i = 0; i < clips.size(); ++i) {
+		delete clips[i];
+	}
+}
+
+int Sound::ClipMixer::addClip(Clip* clip) {
+	clips.push_back(clip);
+	ids.push_back(nextClipId++);
+	return ids.back();
+}
+
+bool Sound::ClipMixer::replaceClip(int id, Clip* clip) {
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (ids[i] != id) continue;
+		for (size_t v = 0; v < voices.size(); ++v) {
+			if (voices[v].clip == clips[i]) voices.erase(voices.begin() + v--);
+		}
+		delete clips[i];
+		clips[i] = clip;
+		return true;
+	}
+	return false;
+}
+
+bool Sound::ClipMixer::removeClip(int id) {
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (ids[i] != id) continue;
+		for (size_t v = 0; v < voices.size(); ++v) {
+			if (voices[v].clip == clips[i]) voices.erase(voices.begin() + v--);
+		}
+		delete clips[i];
+		clips.erase(clips.begin() + i);
+		ids.erase(ids.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+Sound::Clip* Sound::ClipMixer::clip(int id) const {
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (ids[i] == id) return clips[i];
+	}
+	return NULL;
+}
+
+std::vector<int> Sound::ClipMixer::clipIds() const {
+	return ids;
+}
+
+int Sound::ClipMixer::play(int clipId, const ClipVoiceOptions& options) {
+	Clip* source = clip(clipId);
+	if (source == NULL) return -1;
+
+	Voice voice;
+	voice.id = nextVoiceId++;
+	if (nextVoiceId < 0) nextVoiceId = 0;
+	voice.clip = source;
+	voice.options = options;
+
+	// A loop needs at least one frame, otherwise the clip plays once
+	int64_t frames = source->frames();
+	if (voice.options.loopEnd <= 0 || voice.options.loopEnd > frames) voice.options.loopEnd = frames;
+	if (voice.options.loopStart < 0) voice.options.loopStart = 0;
+	if (voice.options.loopStart >= voice.options.loopEnd) voice.options.loop = false;
+	voice.position = options.offset > 0 ? options.offset : 0;
+
+	voice.gains[0] = voice.gains[1] = 0.0f;
+	voice.targets[0] = voice.targets[1] = 0.0f;
+	voice.rampFrames = 0;
+	voice.stopFrame = INT64_MAX;
+	voice.stopping = false;
+	voice.started = false;
+	voices.push_back(voice);
+	if ((int)voices.size() > _stats.peakVoices) _stats.peakVoices = (int)voices.size();
+	return voice.id;
+}
+
+bool Sound::ClipMixer::setGain(int id, float gain) {
+	for (size_t v = 0; v < voices.size(); ++v) {
+		if (voices[v].id != id) continue;
+		voices[v].options.gain = gain;
+		return true;
+	}
+	return false;
+}
+
+bool Sound::ClipMixer::setPan(int id, float pan) {
+	for (size_t v = 0; v < voices.size(); ++v) {
+		if (voices[v].id != id) continue;
+		voices[v].options.pan = pan;
+		return true;
+	}
+	return false;
+}
+
+bool Sound::ClipMixer::stop(int id, int64_t frame) {
+	for (size_t v = 0; v < voices.size(); ++v) {
+		if (voices[v].id != id) continue;
+		if (frame < voices[v].stopFrame) voices[v].stopFrame = frame;
+		return true;
+	}
+	return false;
+}
+
+void Sound::ClipMixer::clearVoices() {
+	voices.clear();
+}
+
+void Sound::ClipMixer::render(const AudioBlock& block, int64_t position) {
+	_finished.clear();
+	if (voices.empty()) return;
+
+	uint64_t begin = uv_hrtime();
+	int frames = block.frames();
+	int64_t end = position + frames;
+	int mixed = 0;
+
+	size_t kept = 0;
+	for (size_t v = 0; v < voices.size(); ++v) {
+		Voice& voice = voices[v];
+		bool alive = true;
+		if (voice.stopFrame <= voice.options.start) {
+			// Stopped before it started
+			alive = false;
+		} else if (voice.options.start < end) {
+			// Gain and pan changes are ramped, a voice starts right at its gain
+			if (voice.stopping == false) {
+				float targets[2];
+				_targets(voice, block.channels(), targets);
+				if (voice.started == false) {
+					voice.gains[0] = voice.targets[0] = targets[0];
+					voice.gains[1] = voice.targets[1] = targets[1];
+				} else if (targets[0] != voice.targets[0] || targets[1] != voice.targets[1]) {
+					voice.targets[0] = targets[0];
+					voice.targets[1] = targets[1];
+					voice.rampFrames = CLIP_RAMP_FRAMES;
+				}
+			}
+			voice.started = true;
+			int from = voice.options.start > position ? (int)(voice.options.start - position) : 0;
+			alive = _renderVoice(voice, block, position, from, frames);
+			++mixed;
+		}
+		if (alive) {
+			if (kept != v) voices[kept] = voice;
+			++kept;
+		} else {
+			_finished.push_back(voice.id);
+		}
+	}
+	voices.resize(kept);
+
+	_stats.blocks++;
+	_stats.voiceBlocks += mixed;
+	_stats.renderTime += uv_hrtime() - begin;
+}
+
+const std::vector<int>& Sound::ClipMixer::finished() const {
+	return _finished;
+}
+
+Sound::ClipMixerStats Sound::ClipMixer::stats() const {
+	ClipMixerStats result = _stats;
+	result.voices = (int)voices.size();
+	return result;
+}
+
+void Sound::ClipMixer::resetStats() {
+	_stats.voices = 0;
+	_stats.peakVoices = (int)voices.size();
+	_stats.blocks = 0;
+	_stats.voiceBlocks = 0;
+	_stats.renderTime = 0;
+}
+
+void Sound::ClipMixer::_targets(const Voice& voice, int outputs, float* targets) {
+	float gain = voice.options.gain;
+	float pan = voice.options.pan < -1.0f ? -1.0f : (voice.options.pan > 1.0f ? 1.0f : voice.options.pan);
+	if (outputs != 2) {
+		// Panning needs a stereo output
+		targets[0] = targets[1] = gain;
+	} else if (voice.clip->channels() == 1) {
+		// Equal power, so a mono clip keeps its loudness across the field
+		double angle = (pan + 1.0) * M_PI / 4.0;
+		targets[0] = gain * (float)cos(angle);
+		targets[1] = gain * (float)sin(angle);
+	} else {
+		// Balance, the other side keeps its full level
+		targets[0] = gain * (pan > 0.0f ? 1.0f - pan : 1.0f);
+		targets[1] = gain * (pan < 0.0f ? 1.0f + pan : 1.0f);
+	}
+}
+
+bool Sound::ClipMixer::_renderVoice(Voice& voice, const AudioBlock& block, int64_t position, int from, int to) {
+	Clip* clip = voice.clip;
+	int outputs = block.channels();
+	int i = from;
+	while (i < to) {
+		int64_t now = position + i;
+		if (voice.stopping == false && now >= voice.stopFrame) {
+			// Fade out from the current gains
+			voice.stopping = true;
+			voice.targets[0] = voice.targets[1] = 0.0f;
+			voice.rampFrames = CLIP_RAMP_FRAMES;
+		}
+		if (voice.stopping && voice.rampFrames == 0) return false;
+
+		int64_t end = voice.options.loop ? voice.options.loopEnd : clip->frames();
+		if (voice.position >= end) {
+			if (voice.options.loop == false) return false;
+			voice.position = voice.options.loopStart;
+			continue;
+		}
+
+		// Mix up to the next stop, ramp end, loop end or block end
+		int count = to - i;
+		if (voice.stopping == false && voice.stopFrame - now < count) count = (int)(voice.stopFrame - now);
+		if (voice.rampFrames > 0 && voice.rampFrames < count) count = voice.rampFrames;
+		if (end - voice.position < count) count = (int)(end - voice.position);
+
+		float steps[2] = {0.0f, 0.0f};
+		if (voice.rampFrames > 0) {
+			steps[0] = (voice.targets[0] - voice.gains[0]) / voice.rampFrames;
+			steps[1] = (voice.targets[1] - voice.gains[1]) / voice.rampFrames;
+		}
+		if (outputs == 1 && clip->channels() > 1) {
+			// A mono output gets the average of the clip channels
+			float scale = 1.0f / clip->channels();
+			for (int source = 0; source < clip->channels(); ++source) {
+				mixRamp(block.channel(0) + i, clip->channel(source) + voice.position, voice.gains[0] * scale, steps[0] * scale, count);
+			}
+		} else {
+			for (int c = 0; c < outputs; ++c) {
+				int source = clip->channels() == 1 ? 0 : c;
+				if (source >= clip->channels()) continue;
+				int k = outputs == 2 ? c : 0;
+				mixRamp(block.channel(c) + i, clip->channel(source) + voice.position, voice.gains[k], steps[k], count);
+			}
+		}
+
+		if (voice.rampFrames > 0) {
+			voice.rampFrames -= count;
+			if (voice.rampFrames == 0) {
+				voice.gains[0] = voice.targets[0];
+				voice.gains[1] = voice.targets[1];
+			} else {
+				voice.gains[0] += steps[0] * count;
+				voice.gains[1] += steps[1] * count;
+			}
+		}
+		voice.position += count;
+		i += count;
+	}
+
+	// Report the end in the block it happened in
+	if (voice.stopping && voice.rampFrames == 0) return false;
+	if (voice.options.loop == false && voice.position >= clip->frames()) return false;
+	return true;
+}
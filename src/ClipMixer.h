@@ -0,0 +1,188 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_CLIP_MIXER_H
+#define SOUND_CLIP_MIXER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "AudioBlock.h"
+#include "SampleSource.h"
+
+// The frames gain and pan changes are ramped over (and a stopped voice fades out in)
+#define CLIP_RAMP_FRAMES 64
+
+namespace Sound {
+
+	/**
+	 * A sound that is loaded once and played by any number of voices.
+	 *
+	 * The samples are kept planar (one aligned array per channel), so voices mix a
+	 * channel with one unit stride multiply-accumulate.
+	 */
+	class Clip {
+	public:
+		/**
+		 * Copies a source into memory (check isLoaded() afterwards).
+		 *
+		 * @param source   The interleaved samples (at the rate of the engine).
+		 * @param channels The channels of the source.
+		 * @param file     The file the source was loaded from.
+		 */
+		Clip(const SampleSource* source, int channels, std::string file);
+		~Clip();
+
+		int channels() const;
+		int64_t frames() const;
+		const std::string& file() const;
+
+		/** The samples of a channel. */
+		inline const float* channel(int c) const {
+			return data + (size_t)c * stride;
+		}
+
+		/** The bytes the samples occupy. */
+		size_t memory() const;
+
+		/** False if there was not enough memory for the samples (the clip has no frames then). */
+		bool isLoaded() const;
+	private:
+		int _channels;
+		int64_t _frames;
+		int64_t stride;
+		std::string _file;
+		float* data;
+	};
+
+	/**
+	 * How a voice plays a clip.
+	 */
+	struct ClipVoiceOptions {
+		float gain;
+		// -1 (left) .. 1 (right), mono clips are panned with equal power, others are balanced
+		float pan;
+		bool loop;
+		// The loop in frames of the clip (loopEnd <= 0 loops to the end)
+		int64_t loopStart;
+		int64_t loopEnd;
+		// The frame of the clip the voice starts with
+		int64_t offset;
+		// The stream frame the voice starts at
+		int64_t start;
+	};
+
+	/**
+	 * The cost of the voices since the statistics were reset.
+	 */
+	struct ClipMixerStats {
+		int voices;
+		int peakVoices;
+		// The rendered blocks and the sum of the voices that were mixed into them
+		uint64_t blocks;
+		uint64_t voiceBlocks;
+		// The time spent mixing in ns
+		uint64_t renderTime;
+	};
+
+	/**
+	 * Holds the loaded clips and mixes their voices into the blocks.
+	 *
+	 * Voices start on a stream frame, have a gain and a pan that are ramped when they
+	 * change, can loop a part of the clip and fade out when they are stopped. The
+	 * channels are summed with a sse multiply-accumulate that also applies the ramps.
+	 * Channel n of a clip is mixed into output n (a mono clip into every output), a mono
+	 * output gets the average of the clip channels and clip channels without an output
+	 * are dropped.
+	 */
+	class ClipMixer {
+	public:
+		ClipMixer();
+		~ClipMixer();
+
+		/**
+		 * Takes over a clip.
+		 *
+		 * @return The id of the clip.
+		 */
+		int addClip(Clip* clip);
+
+		/** Replaces the samples of a clip (its voices are stopped). */
+		bool replaceClip(int id, Clip* clip);
+
+		/** Deletes a clip and stops its voices at once. */
+		bool removeClip(int id);
+
+		/** The clip with an id or NULL. */
+		Clip* clip(int id) const;
+
+		/** The ids of the loaded clips. */
+		std::vector<int> clipIds() const;
+
+		/**
+		 * Starts a voice.
+		 *
+		 * @return The id of the voice or -1 if there is no such clip.
+		 */
+		int play(int clipId, const ClipVoiceOptions& options);
+
+		/** Changes the gain of a voice (ramped). */
+		bool setGain(int id, float gain);
+
+		/** Changes the pan of a voice (ramped). */
+		bool setPan(int id, float pan);
+
+		/** Fades a voice out from a stream frame on (or from the next block if it already passed). */
+		bool stop(int id, int64_t frame);
+
+		/** Ends every voice at once without reporting them as finished. */
+		void clearVoices();
+
+		/**
+		 * Adds the voices to a block.
+		 *
+		 * @param block    The block.
+		 * @param position The stream frame of the first frame of the block.
+		 */
+		void render(const AudioBlock& block, int64_t position);
+
+		/** The voices that ended during the last render(). */
+		const std::vector<int>& finished() const;
+
+		ClipMixerStats stats() const;
+		void resetStats();
+	private:
+		struct Voice {
+			int id;
+			Clip* clip;
+			ClipVoiceOptions options;
+			// The next frame of the clip
+			int64_t position;
+			// The gains of the left (or only) and the right output now and where the ramp goes
+			float gains[2];
+			float targets[2];
+			int rampFrames;
+			// The stream frame the fade out starts (INT64_MAX until stop() is called)
+			int64_t stopFrame;
+			bool stopping;
+			bool started;
+		};
+
+		/** The gains for the output channels of a block. */
+		static void _targets(const Voice& voice, int outputs, float* targets);
+		/** Mixes frames [from, to) of a block, returns false when the voice ended. */
+		bool _renderVoice(Voice& voice, const AudioBlock& block, int64_t position, int from, int to);
+
+		std::vector<Clip*> clips;
+		std::vector<int> ids;
+		int nextClipId;
+		std::vector<Voice> voices;
+		int nextVoiceId;
+		std::vector<int> _finished;
+		ClipMixerStats _stats;
+	};
+}
+
+#endif
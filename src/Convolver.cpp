@@ -0,0 +1,259 @@
+#include "Convolver.h"
+#include "FftPlanCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// The minimum number of partitions a worker thread gets
+#define CONVOLVER_PARTITIONS_PER_THREAD 16
+
+static float* allocAligned(size_t count) {
+	void* memory = NULL;
+	if (posix_memalign(&memory, AUDIO_BLOCK_ALIGNMENT, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+		return NULL;
+	}
+	memset(memory, 0, sizeof(float) * (count > 0 ? count : 1));
+	return (float*)memory;
+}
+
+/**
+ * Adds the complex product of x and h to acc (split real and imaginary parts, count is a multiple of 4).
+ */
+static void multiplyAccumulate(const float* xRe, const float* xIm, const float* hRe, const float* hIm, float* accRe, float* accIm, int count) {
+	int k = 0;
+#if defined(__SSE__)
+	for (; k < count; k += 4) {
+		__m128 xr = _mm_load_ps(xRe + k);
+		__m128 xi = _mm_load_ps(xIm + k);
+		__m128 hr = _mm_load_ps(hRe + k);
+		__m128 hi = _mm_load_ps(hIm + k);
+		__m128 re = _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi));
+		__m128 im = _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr));
+		_mm_store_ps(accRe + k, _mm_add_ps(_mm_load_ps(accRe + k), re));
+		_mm_store_ps(accIm + k, _mm_add_ps(_mm_load_ps(accIm + k), im));
+	}
+#endif
+	for (; k < count; ++k) {
+		accRe[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+		accIm[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+	}
+}
+
+Sound::Convolver::Convolver(int blockFrames, int channels, const SampleSource* impulse, int impulseChannels):
+	blockFrames(blockFrames), _mix(1.0f), head(0), stopping(false)
+{
+	_channels = channels > 0 ? channels : 1;
+	if (impulseChannels < 1) impulseChannels = 1;
+	fftSize = 2 * blockFrames;
+	bins = blockFrames + 1;
+	paddedBins = ((bins + 3) / 4) * 4;
+
+	int64_t impulseFrames = impulse->size() / impulseChannels;
+	_partitions = (int)((impulseFrames + blockFrames - 1) / blockFrames);
+	if (_partitions < 1) _partitions = 1;
+
+	// Map the channels to the channels of the response
+	responses.resize(_channels);
+	for (int c = 0; c < _channels; ++c) {
+		responses[c] = impulseChannels == 1 ? 0 : (c < impulseChannels ? c : -1);
+	}
+	int responseCount = impulseChannels < _channels ? impulseChannels : _channels;
+
+	fftIn = (double*)fftw_malloc(sizeof(double) * fftSize);
+	fftOut = (double*)fftw_malloc(sizeof(double) * fftSize);
+	spectrum = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * bins);
+	forward = FftPlanCache::get(fftSize, FftForward);
+	backward = FftPlanCache::get(fftSize, FftBackward);
+
+	// Transform every partition of the response zero padded to the transform size
+	size_t partitionSize = (size_t)_partitions * paddedBins;
+	responseRe = allocAligned(responseCount * partitionSize);
+	responseIm = allocAligned(responseCount * partitionSize);
+	std::vector<float> samples((size_t)blockFrames * impulseChannels);
+	for (int p = 0; p < _partitions; ++p) {
+		int64_t read = impulse->read((int64_t)p * blockFrames * impulseChannels, samples.data(), (int64_t)blockFrames * impulseChannels);
+		int frames = (int)(read / impulseChannels);
+		for (int r = 0; r < responseCount; ++r) {
+			for (int i = 0; i < fftSize; ++i) {
+				fftIn[i] = i < frames ? samples[(size_t)i * impulseChannels + r] : 0.0;
+			}
+			fftw_execute_dft_r2c(forward, fftIn, spectrum);
+			float* re = responseRe + r * partitionSize + (size_t)p * paddedBins;
+			float* im = responseIm + r * partitionSize + (size_t)p * paddedBins;
+			for (int k = 0; k < bins; ++k) {
+				re[k] = (float)spectrum[k][0];
+				im[k] = (float)spectrum[k][1];
+			}
+		}
+	}
+
+	historyRe = allocAligned(_channels * partitionSize);
+	historyIm = allocAligned(_channels * partitionSize);
+	previous = allocAligned((size_t)_channels * blockFrames);
+
+	// Long responses share the multiply-accumulate, the calling thread is the first worker
+	int threadCount = (int)std::thread::hardware_concurrency();
+	if (threadCount > CONVOLVER_MAX_THREADS) threadCount = CONVOLVER_MAX_THREADS;
+	if (threadCount > _partitions / CONVOLVER_PARTITIONS_PER_THREAD) threadCount = _partitions / CONVOLVER_PARTITIONS_PER_THREAD;
+	if (_partitions * responseCount < CONVOLVER_PARALLEL_PARTITIONS || threadCount < 1) threadCount = 1;
+
+	uv_sem_init(&done, 0);
+	for (int t = 0; t < threadCount; ++t) {
+		Worker* worker = new Worker;
+		worker->convolver = this;
+		worker->first = (int)((int64_t)_partitions * t / threadCount);
+		worker->last = (int)((int64_t)_partitions * (t + 1) / threadCount);
+		worker->re = allocAligned((size_t)_channels * paddedBins);
+		worker->im = allocAligned((size_t)_channels * paddedBins);
+		if (t > 0) {
+			uv_sem_init(&worker->start, 0);
+			uv_thread_create(&worker->thread, _run, worker);
+		}
+		workers.push_back(worker);
+	}
+}
+
+Sound::Convolver::~Convolver() {
+	// Stop the worker threads
+	stopping = true;
+	for (size_t t = 1; t < workers.size(); ++t) {
+		uv_sem_post(&workers[t]->start);
+		uv_thread_join(&workers[t]->thread);
+		uv_sem_destroy(&workers[t]->start);
+	}
+	for (size_t t = 0; t < workers.size(); ++t) {
+		free(workers[t]->re);
+		free(workers[t]->im);
+		delete workers[t];
+	}
+	uv_sem_destroy(&done);
+
+	free(responseRe);
+	free(responseIm);
+	free(historyRe);
+	free(historyIm);
+	free(previous);
+	fftw_free(fftIn);
+	fftw_free(fftOut);
+	fftw_free(spectrum);
+}
+
+void Sound::Convolver::process(const AudioBlock& block) {
+	int frames = block.frames() < blockFrames ? block.frames() : blockFrames;
+	int channels = block.channels() < _channels ? block.channels() : _channels;
+	size_t partitionSize = (size_t)_partitions * paddedBins;
+
+	// Transform the last and the new block of every channel into the newest slot
+	head = head + 1 == _partitions ? 0 : head + 1;
+	for (int c = 0; c < channels; ++c) {
+		if (responses[c] < 0) continue;
+		float* x = block.channel(c);
+		float* last = previous + (size_t)c * blockFrames;
+		for (int i = 0; i < blockFrames; ++i) fftIn[i] = last[i];
+		for (int i = 0; i < frames; ++i) fftIn[blockFrames + i] = x[i];
+		for (int i = frames; i < blockFrames; ++i) fftIn[blockFrames + i] = 0.0;
+		for (int i = 0; i < blockFrames; ++i) last[i] = (float)fftIn[blockFrames + i];
+
+		fftw_execute_dft_r2c(forward, fftIn, spectrum);
+		float* re = historyRe + c * partitionSize + (size_t)head * paddedBins;
+		float* im = historyIm + c * partitionSize + (size_t)head * paddedBins;
+		for (int k = 0; k < bins; ++k) {
+			re[k] = (float)spectrum[k][0];
+			im[k] = (float)spectrum[k][1];
+		}
+	}
+
+	// Multiply the history with the partitions on all workers
+	for (size_t t = 1; t < workers.size(); ++t) {
+		uv_sem_post(&workers[t]->start);
+	}
+	_accumulate(workers[0]);
+	for (size_t t = 1; t < workers.size(); ++t) {
+		uv_sem_wait(&done);
+	}
+
+	// Sum the partial spectra and transform back, the second half is the convolved block
+	double scale = 1.0 / fftSize;
+	for (int c = 0; c < channels; ++c) {
+		if (responses[c] < 0) continue;
+		for (int k = 0; k < bins; ++k) {
+			double re = 0.0, im = 0.0;
+			for (size_t t = 0; t < workers.size(); ++t) {
+				re += workers[t]->re[(size_t)c * paddedBins + k];
+				im += workers[t]->im[(size_t)c * paddedBins + k];
+			}
+			spectrum[k][0] = re;
+			spectrum[k][1] = im;
+		}
+		fftw_execute_dft_c2r(backward, spectrum, fftOut);
+
+		float* x = block.channel(c);
+		for (int i = 0; i < frames; ++i) {
+			float wet = (float)(fftOut[blockFrames + i] * scale);
+			x[i] = x[i] * (1.0f - _mix) + wet * _mix;
+		}
+	}
+}
+
+void Sound::Convolver::setMix(float mix) {
+	_mix = mix < 0.0f ? 0.0f : (mix > 1.0f ? 1.0f : mix);
+}
+
+float Sound::Convolver::mix() const {
+	return _mix;
+}
+
+int Sound::Convolver::partitions() const {
+	return _partitions;
+}
+
+int Sound::Convolver::threads() const {
+	return (int)workers.size();
+}
+
+void Sound::Convolver::reset() {
+	size_t partitionSize = (size_t)_partitions * paddedBins;
+	memset(historyRe, 0, sizeof(float) * _channels * partitionSize);
+	memset(historyIm, 0, sizeof(float) * _channels * partitionSize);
+	memset(previous, 0, sizeof(float) * _channels * blockFrames);
+}
+
+void Sound::Convolver::_run(void* arg) {
+	Worker* worker = (Worker*)arg;
+	Convolver* convolver = worker->convolver;
+	while (true) {
+		uv_sem_wait(&worker->start);
+		if (convolver->stopping) break;
+		convolver->_accumulate(worker);
+		uv_sem_post(&convolver->done);
+	}
+}
+
+void Sound::Convolver::_accumulate(Worker* worker) {
+	size_t partitionSize = (size_t)_partitions * paddedBins;
+	memset(worker->re, 0, sizeof(float) * _channels * paddedBins);
+	memset(worker->im, 0, sizeof(float) * _channels * paddedBins);
+
+	for (int c = 0; c < _channels; ++c) {
+		int r = responses[c];
+		if (r < 0) continue;
+		float* accRe = worker->re + (size_t)c * paddedBins;
+		float* accIm = worker->im + (size_t)c * paddedBins;
+		for (int p = worker->first; p < worker->last; ++p) {
+			// Partition p is applied to the block from p blocks ago
+			int slot = head - p;
+			if (slot < 0) slot += _partitions;
+			multiplyAccumulate(
+				historyRe + c * partitionSize + (size_t)slot * paddedBins,
+				historyIm + c * partitionSize + (size_t)slot * paddedBins,
+				responseRe + r * partitionSize + (size_t)p * paddedBins,
+				responseIm + r * partitionSize + (size_t)p * paddedBins,
+				accRe, accIm, paddedBins);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_CONVOLVER_H
+#define SOUND_CONVOLVER_H
+
+#include <stdint.h>
+#include <vector>
+#include <uv.h>
+#include <fftw3.h>
+
+#include "AudioBlock.h"
+#include "SampleSource.h"
+
+// Impulse responses with at least this many partitions (all channels) share the work with threads
+#define CONVOLVER_PARALLEL_PARTITIONS 64
+// The maximum number of threads including the calling one
+#define CONVOLVER_MAX_THREADS 4
+
+namespace Sound {
+
+	/**
+	 * Convolves blocks with a long impulse response (uniformly partitioned overlap-save).
+	 *
+	 * The impulse response is cut into partitions of one block that are transformed once.
+	 * Every block is transformed into a delay line of spectra and multiplied with all
+	 * partitions, so the output of a block is ready when the block is processed and the
+	 * convolution adds no latency beyond the block size. The multiply-accumulate of long
+	 * responses is split by partitions across worker threads.
+	 */
+	class Convolver {
+	public:
+		/**
+		 * @param blockFrames     The number of frames per block (the partition size).
+		 * @param channels        The number of channels of the blocks.
+		 * @param impulse         The interleaved impulse response.
+		 * @param impulseChannels The channels of the impulse response. A mono response is applied
+		 *                        to every channel, otherwise channel c uses response channel c and
+		 *                        channels without a response pass unchanged.
+		 */
+		Convolver(int blockFrames, int channels, const SampleSource* impulse, int impulseChannels);
+		~Convolver();
+
+		/** Convolves a block in place (js thread). */
+		void process(const AudioBlock& block);
+
+		/** The share of the convolved signal (0..1, the rest is the dry input). */
+		void setMix(float mix);
+		float mix() const;
+
+		/** The number of partitions per channel. */
+		int partitions() const;
+
+		/** The number of threads that share the multiply-accumulate (including the calling one). */
+		int threads() const;
+
+		/** Forgets the input history. */
+		void reset();
+	private:
+		struct Worker {
+			Convolver* convolver;
+			// The partitions [first, last) this worker accumulates
+			int first;
+			int last;
+			// The partial spectra of every channel (channels x paddedBins)
+			float* re;
+			float* im;
+			uv_thread_t thread;
+			uv_sem_t start;
+		};
+
+		static void _run(void* arg);
+		void _accumulate(Worker* worker);
+
+		int blockFrames;
+		int _channels;
+		int fftSize;
+		int bins;
+		// The bins rounded up to a multiple of four for the sse kernel
+		int paddedBins;
+		int _partitions;
+		float _mix;
+
+		// The response channel of every channel (-1 passes the channel unchanged)
+		std::vector<int> responses;
+		// The transformed partitions as [response][partition][bin] (aligned)
+		float* responseRe;
+		float* responseIm;
+		// The spectra of the last blocks as [channel][slot][bin] (ring of partitions slots)
+		float* historyRe;
+		float* historyIm;
+		// The slot of the newest spectrum
+		int head;
+		// The last block of every channel (the first half of the next transform)
+		float* previous;
+
+		fftw_plan forward;
+		fftw_plan backward;
+		double* fftIn;
+		fftw_complex* spectrum;
+		double* fftOut;
+
+		std::vector<Worker*> workers;
+		uv_sem_t done;
+		bool stopping;
+	};
+}
+
+#endif
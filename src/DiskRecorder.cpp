@@ -0,0 +1,115 @@
+#include "DiskRecorder.h"
+
+#include <stdlib.h>
+
+// Writes are done in chunks of 1 MB
+#define DISK_RECORDER_CHUNK_BYTES (1 << 20)
+// The alignment of the chunks (the samples of a wave file start on a multiple of it)
+#define DISK_RECORDER_ALIGNMENT 4096
+// The ring can hold this many seconds of audio before samples are dropped
+#define DISK_RECORDER_BUFFER_SECONDS 4
+
+using namespace std;
+
+Sound::DiskRecorder::DiskRecorder(string file, int sampleRate, int channels, SampleFormat format) {
+	_samplesWritten.store(0);
+	_samplesDropped.store(0);
+	failed.store(false);
+
+	// The chunks are page aligned like the data offset of the file, so every full chunk is an aligned write
+	chunkSamples = DISK_RECORDER_CHUNK_BYTES / sizeof(float);
+	void* memory = NULL;
+	if (posix_memalign(&memory, DISK_RECORDER_ALIGNMENT, DISK_RECORDER_CHUNK_BYTES) != 0) memory = NULL;
+	chunk = (float*)memory;
+
+	int ringSamples = sampleRate * channels * DISK_RECORDER_BUFFER_SECONDS;
+	ring = new RingBuffer(ringSamples > 2 * chunkSamples ? ringSamples : 2 * chunkSamples);
+
+	WaveFormat waveFormat = { format, channels, sampleRate, 0 };
+	// The writer starts with an empty but valid file
+	writer = new WaveWriter(file, waveFormat);
+	if (writer->isOpen() == false || chunk == NULL) {
+		running.store(false);
+		return;
+	}
+
+	running.store(true);
+	uv_sem_init(&pending, 0);
+	uv_thread_create(&thread, _run, this);
+}
+
+Sound::DiskRecorder::~DiskRecorder() {
+	if (running.load()) {
+		// Let the writer thread drain the ring
+		running.store(false);
+		uv_sem_post(&pending);
+		uv_thread_join(&thread);
+		uv_sem_destroy(&pending);
+	}
+	if (writer->finish() == false) {
+		failed.store(true);
+	}
+	delete writer;
+	free(chunk);
+	delete ring;
+}
+
+bool Sound::DiskRecorder::isOpen() const {
+	return writer->isOpen() && chunk != NULL;
+}
+
+void Sound::DiskRecorder::write(const float* samples, int count) {
+	if (running.load(std::memory_order_relaxed) == false) return;
+	int queued = ring->write(samples, count);
+	_samplesWritten.fetch_add(queued, std::memory_order_relaxed);
+	if (queued < count) {
+		_samplesDropped.fetch_add(count - queued, std::memory_order_relaxed);
+	}
+	// Only wake up the writer when a full chunk is waiting
+	if (ring->readable() >= chunkSamples) {
+		uv_sem_post(&pending);
+	}
+}
+
+int64_t Sound::DiskRecorder::samplesWritten() const {
+	return _samplesWritten.load();
+}
+
+int64_t Sound::DiskRecorder::samplesDropped() const {
+	return _samplesDropped.load();
+}
+
+bool Sound::DiskRecorder::hasFailed() const {
+	return failed.load();
+}
+
+void Sound::DiskRecorder::_run(void* arg) {
+	DiskRecorder* recorder = (DiskRecorder*)arg;
+	while (true) {
+		uv_sem_wait(&recorder->pending);
+		bool stopping = recorder->running.load() == false;
+
+		while (recorder->ring->readable() >= recorder->chunkSamples) {
+			recorder->_writeChunk(recorder->chunkSamples);
+		}
+		if (stopping) {
+			// Write the rest of the recording
+			int rest = recorder->ring->readable();
+			if (rest > 0) recorder->_writeChunk(rest);
+			break;
+		}
+	}
+}
+
+void Sound::DiskRecorder::_writeChunk(int count) {
+	count = ring->read(chunk, count);
+	if (writer->write(chunk, count) == false) {
+		failed.store(true);
+		return;
+	}
+
+	// Keep the header in sync so a crash still leaves a playable file
+	if (writer->updateHeader() == false) {
+		failed.store(true);
+	}
+}
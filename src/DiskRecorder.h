@@ -0,0 +1,79 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_DISK_RECORDER_H
+#define SOUND_DISK_RECORDER_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <uv.h>
+
+#include "RingBuffer.h"
+#include "WaveFile.h"
+
+namespace Sound {
+
+	/**
+	 * Streams a recording into a wave file on a background thread.
+	 *
+	 * Samples are handed over through a fixed size ring, so the memory footprint does
+	 * not grow with the length of the recording. The writer thread writes large page
+	 * aligned chunks and patches the header sizes after every chunk, so the file is a
+	 * valid wave file up to the last chunk even if the process dies. Recordings that
+	 * outgrow 4 GB are continued as RF64.
+	 */
+	class DiskRecorder {
+	public:
+		/**
+		 * @param file       The wave file to create.
+		 * @param sampleRate The sample rate of the recording.
+		 * @param channels   The number of interleaved channels.
+		 * @param format     The sample format of the file.
+		 */
+		DiskRecorder(std::string file, int sampleRate, int channels, SampleFormat format);
+
+		/** Flushes the remaining samples, finalizes the header and closes the file. */
+		~DiskRecorder();
+
+		/** If the file could be opened. */
+		bool isOpen() const;
+
+		/**
+		 * Queues samples for writing. This never blocks; samples that don't fit
+		 * into the ring are dropped and counted.
+		 */
+		void write(const float* samples, int count);
+
+		/** The number of samples that were queued. */
+		int64_t samplesWritten() const;
+
+		/** The number of samples that were dropped because the writer fell behind. */
+		int64_t samplesDropped() const;
+
+		/** If a write to the file failed. */
+		bool hasFailed() const;
+	private:
+		static void _run(void* arg);
+		void _writeChunk(int count);
+
+		/** Encodes the samples and keeps the header up to date. */
+		WaveWriter* writer;
+
+		/** The samples that wait for the writer thread. */
+		RingBuffer* ring;
+		/** The staging buffer for the samples taken from the ring. */
+		float* chunk;
+		int chunkSamples;
+
+		std::atomic<int64_t> _samplesWritten;
+		std::atomic<int64_t> _samplesDropped;
+		std::atomic<bool> failed;
+		std::atomic<bool> running;
+		uv_thread_t thread;
+		uv_sem_t pending;
+	};
+}
+
+#endif
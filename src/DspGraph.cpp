@@ -0,0 +1,656 @@
+#include "DspGraph.h"
+#include "Biquad.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+
+// The block indices of the two sources
+#define DSP_SOURCE_INPUT 0
+#define DSP_SOURCE_ENGINE 1
+#define DSP_FIRST_NODE 2
+// The delay line length when a delay node has no maxTime in ms
+#define DSP_DEFAULT_MAX_DELAY 1000
+
+static std::atomic<uint64_t> generations(0);
+
+static float* allocAligned(int count) {
+	void* memory = NULL;
+	if (posix_memalign(&memory, AUDIO_BLOCK_ALIGNMENT, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+		return NULL;
+	}
+	memset(memory, 0, sizeof(float) * (count > 0 ? count : 1));
+	return (float*)memory;
+}
+
+/**
+ * Multiplies with a gain that moves linearly from `from` to `to` over the block (in and out may be the same).
+ */
+static void rampGain(const float* in, float* out, int frames, float from, float to) {
+	if (from == to) {
+		for (int i = 0; i < frames; ++i) out[i] = in[i] * to;
+		return;
+	}
+	float step = (to - from) / frames;
+	for (int i = 0; i < frames; ++i) {
+		out[i] = in[i] * (from + step * (i + 1));
+	}
+}
+
+/**
+ * Like rampGain() but adds to out.
+ */
+static void mixGain(const float* in, float* out, int frames, float from, float to) {
+	if (from == to) {
+		for (int i = 0; i < frames; ++i) out[i] += in[i] * to;
+		return;
+	}
+	float step = (to - from) / frames;
+	for (int i = 0; i < frames; ++i) {
+		out[i] += in[i] * (from + step * (i + 1));
+	}
+}
+
+static float clamp(float value, float minimum, float maximum) {
+	return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+/**
+ * Properties that configure a node when it is built and can't be changed afterwards.
+ */
+static bool isBuildOption(const std::string& type, const std::string& name) {
+	return type == "delay" && name == "maxTime";
+}
+
+namespace Sound {
+
+	/**
+	 * The base of the nodes. A node renders its inputs into its own block.
+	 */
+	class DspNode {
+	public:
+		virtual ~DspNode() {}
+
+		/**
+		 * Sets the node up for inputs with these channel counts (js thread).
+		 *
+		 * @return The number of output channels or 0 if the inputs don't fit (error is set then).
+		 */
+		virtual int configure(const std::vector<int>& inputs, std::string* error) = 0;
+
+		/** The index of a parameter or -1. */
+		virtual int paramIndex(const std::string& name) const {
+			return -1;
+		}
+
+		virtual void setParam(int index, float value) {}
+
+		/** Takes over the parameters without ramping (after the initial values were set). */
+		virtual void settle() {}
+
+		virtual void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) = 0;
+	protected:
+		static bool singleInput(const std::vector<int>& inputs, const char* type, std::string* error) {
+			if (inputs.size() != 1) {
+				*error = std::string("a ") + type + " node takes exactly one input.";
+				return false;
+			}
+			return true;
+		}
+	};
+
+	class DspGainNode: public DspNode {
+	public:
+		DspGainNode(): gain(1.0f), target(1.0f) {}
+
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			return singleInput(inputs, "gain", error) ? inputs[0] : 0;
+		}
+
+		int paramIndex(const std::string& name) const {
+			return name == "gain" ? 0 : -1;
+		}
+
+		void setParam(int index, float value) {
+			target = value;
+		}
+
+		void settle() {
+			gain = target;
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			for (int c = 0; c < output.channels(); ++c) {
+				rampGain(inputs[0]->channel(c), output.channel(c), frames, gain, target);
+			}
+			gain = target;
+		}
+	private:
+		float gain;
+		float target;
+	};
+
+	class DspBiquadNode: public DspNode {
+	public:
+		DspBiquadNode(BiquadType type, int sampleRate): type(type), sampleRate(sampleRate) {
+			values[0] = 1000.0f;
+			values[1] = (float)M_SQRT1_2;
+			values[2] = 0.0f;
+			_design();
+		}
+
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			if (singleInput(inputs, "biquad", error) == false) return 0;
+			states.resize(inputs[0]);
+			for (size_t c = 0; c < states.size(); ++c) states[c].reset();
+			return inputs[0];
+		}
+
+		int paramIndex(const std::string& name) const {
+			if (name == "frequency") return 0;
+			if (name == "q") return 1;
+			if (name == "gain") return 2;
+			return -1;
+		}
+
+		void setParam(int index, float value) {
+			values[index] = value;
+			_design();
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			for (int c = 0; c < output.channels(); ++c) {
+				states[c].process(coefficients, inputs[0]->channel(c), output.channel(c), frames);
+			}
+		}
+	private:
+		void _design() {
+			coefficients = BiquadCoefficients::design(type, sampleRate, values[0], values[1], values[2]);
+		}
+
+		BiquadType type;
+		int sampleRate;
+		// frequency, q and gain
+		float values[3];
+		BiquadCoefficients coefficients;
+		std::vector<BiquadState> states;
+	};
+
+	class DspDelayNode: public DspNode {
+	public:
+		DspDelayNode(int sampleRate, double maxTime): sampleRate(sampleRate), writeIdx(0), feedback(0.0f), mix(0.5f) {
+			maxFrames = (int)(maxTime * sampleRate / 1000.0);
+			if (maxFrames < 1) maxFrames = 1;
+			length = maxFrames + 1;
+			setParam(0, 250.0f);
+		}
+
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			if (singleInput(inputs, "delay", error) == false) return 0;
+			lines.assign((size_t)length * inputs[0], 0.0f);
+			return inputs[0];
+		}
+
+		int paramIndex(const std::string& name) const {
+			if (name == "time") return 0;
+			if (name == "feedback") return 1;
+			if (name == "mix") return 2;
+			return -1;
+		}
+
+		void setParam(int index, float value) {
+			if (index == 0) {
+				delayFrames = (int)lround(value * sampleRate / 1000.0);
+				if (delayFrames < 1) delayFrames = 1;
+				if (delayFrames > maxFrames) delayFrames = maxFrames;
+			} else if (index == 1) {
+				feedback = clamp(value, 0.0f, 0.99f);
+			} else {
+				mix = clamp(value, 0.0f, 1.0f);
+			}
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			int pos = writeIdx;
+			for (int c = 0; c < output.channels(); ++c) {
+				const float* x = inputs[0]->channel(c);
+				float* y = output.channel(c);
+				float* line = lines.data() + (size_t)c * length;
+				pos = writeIdx;
+				for (int i = 0; i < frames; ++i) {
+					int readIdx = pos - delayFrames;
+					if (readIdx < 0) readIdx += length;
+					float delayed = line[readIdx];
+					line[pos] = x[i] + delayed * feedback;
+					y[i] = x[i] * (1.0f - mix) + delayed * mix;
+					if (++pos == length) pos = 0;
+				}
+			}
+			writeIdx = pos;
+		}
+	private:
+		int sampleRate;
+		int maxFrames;
+		int length;
+		// One delay line of length samples per channel
+		std::vector<float> lines;
+		int writeIdx;
+		int delayFrames;
+		float feedback;
+		float mix;
+	};
+
+	/**
+	 * Sums the inputs with a gain each. A mono input feeds every channel.
+	 */
+	class DspMixerNode: public DspNode {
+	public:
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			if (inputs.empty()) {
+				*error = "a mixer node needs at least one input.";
+				return 0;
+			}
+			gains.assign(inputs.size(), 1.0f);
+			targets.assign(inputs.size(), 1.0f);
+			int channels = 0;
+			for (size_t i = 0; i < inputs.size(); ++i) {
+				if (inputs[i] > channels) channels = inputs[i];
+			}
+			return channels;
+		}
+
+		int paramIndex(const std::string& name) const {
+			// gain0, gain1, ... in the order of the connections
+			if (name.compare(0, 4, "gain") != 0 || name.size() == 4) return -1;
+			int index = 0;
+			for (size_t i = 4; i < name.size(); ++i) {
+				if (name[i] < '0' || name[i] > '9') return -1;
+				index = index * 10 + (name[i] - '0');
+				if (index >= (int)targets.size()) return -1;
+			}
+			return index;
+		}
+
+		void setParam(int index, float value) {
+			targets[index] = value;
+		}
+
+		void settle() {
+			gains = targets;
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			for (int c = 0; c < output.channels(); ++c) {
+				memset(output.channel(c), 0, sizeof(float) * frames);
+			}
+			for (size_t i = 0; i < inputs.size(); ++i) {
+				const AudioBlock* input = inputs[i];
+				for (int c = 0; c < output.channels(); ++c) {
+					if (input->channels() != 1 && c >= input->channels()) break;
+					const float* src = input->channel(input->channels() == 1 ? 0 : c);
+					mixGain(src, output.channel(c), frames, gains[i], targets[i]);
+				}
+				gains[i] = targets[i];
+			}
+		}
+	private:
+		std::vector<float> gains;
+		std::vector<float> targets;
+	};
+
+	/**
+	 * Places a mono input in the stereo field (constant power) or balances a stereo input.
+	 */
+	class DspPanNode: public DspNode {
+	public:
+		DspPanNode(): pan(0.0f), target(0.0f), stereo(false) {}
+
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			if (singleInput(inputs, "pan", error) == false) return 0;
+			if (inputs[0] > 2) {
+				*error = "a pan node takes a mono or stereo input.";
+				return 0;
+			}
+			stereo = inputs[0] == 2;
+			return 2;
+		}
+
+		int paramIndex(const std::string& name) const {
+			return name == "pan" ? 0 : -1;
+		}
+
+		void setParam(int index, float value) {
+			target = clamp(value, -1.0f, 1.0f);
+		}
+
+		void settle() {
+			pan = target;
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			float left, right, leftTarget, rightTarget;
+			_gains(pan, &left, &right);
+			_gains(target, &leftTarget, &rightTarget);
+			rampGain(inputs[0]->channel(0), output.channel(0), frames, left, leftTarget);
+			rampGain(inputs[0]->channel(stereo ? 1 : 0), output.channel(1), frames, right, rightTarget);
+			pan = target;
+		}
+	private:
+		void _gains(float position, float* left, float* right) const {
+			if (stereo) {
+				*left = position <= 0.0f ? 1.0f : 1.0f - position;
+				*right = position >= 0.0f ? 1.0f : 1.0f + position;
+			} else {
+				double angle = (position + 1.0) * M_PI / 4.0;
+				*left = (float)cos(angle);
+				*right = (float)sin(angle);
+			}
+		}
+
+		float pan;
+		float target;
+		bool stereo;
+	};
+
+	/**
+	 * Picks channels of its input.
+	 */
+	class DspSplitterNode: public DspNode {
+	public:
+		DspSplitterNode(const std::vector<int>& channels): picks(channels) {}
+
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			if (singleInput(inputs, "splitter", error) == false) return 0;
+			if (picks.empty()) {
+				*error = "a splitter node needs the channels to pick.";
+				return 0;
+			}
+			for (size_t i = 0; i < picks.size(); ++i) {
+				if (picks[i] < 0 || picks[i] >= inputs[0]) {
+					*error = "the input has no channel " + std::to_string(picks[i]) + ".";
+					return 0;
+				}
+			}
+			return (int)picks.size();
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			for (size_t i = 0; i < picks.size(); ++i) {
+				memcpy(output.channel((int)i), inputs[0]->channel(picks[i]), sizeof(float) * frames);
+			}
+		}
+	private:
+		std::vector<int> picks;
+	};
+
+	/**
+	 * Stacks the channels of its inputs in the order of the connections.
+	 */
+	class DspMergerNode: public DspNode {
+	public:
+		int configure(const std::vector<int>& inputs, std::string* error) {
+			int channels = 0;
+			for (size_t i = 0; i < inputs.size(); ++i) channels += inputs[i];
+			if (channels == 0) *error = "a merger node needs at least one input.";
+			return channels;
+		}
+
+		void process(const std::vector<const AudioBlock*>& inputs, const AudioBlock& output, int frames) {
+			int channel = 0;
+			for (size_t i = 0; i < inputs.size(); ++i) {
+				for (int c = 0; c < inputs[i]->channels(); ++c) {
+					memcpy(output.channel(channel++), inputs[i]->channel(c), sizeof(float) * frames);
+				}
+			}
+		}
+	};
+}
+
+static Sound::DspNode* createNode(const Sound::DspNodeSpec& spec, int sampleRate, std::string* error) {
+	if (spec.type == "gain") return new Sound::DspGainNode();
+	if (spec.type == "mixer") return new Sound::DspMixerNode();
+	if (spec.type == "pan") return new Sound::DspPanNode();
+	if (spec.type == "splitter") return new Sound::DspSplitterNode(spec.channels);
+	if (spec.type == "merger") return new Sound::DspMergerNode();
+	if (spec.type == "biquad") {
+		Sound::BiquadType type = Sound::BiquadLowpass;
+		if (spec.filter.empty() == false && Sound::parseBiquadType(spec.filter, &type) == false) {
+			*error = "unknown filter " + spec.filter + ".";
+			return NULL;
+		}
+		return new Sound::DspBiquadNode(type, sampleRate);
+	}
+	if (spec.type == "delay") {
+		std::map<std::string, double>::const_iterator maxTime = spec.params.find("maxTime");
+		std::map<std::string, double>::const_iterator time = spec.params.find("time");
+		double length = DSP_DEFAULT_MAX_DELAY;
+		if (maxTime != spec.params.end()) {
+			length = maxTime->second;
+		} else if (time != spec.params.end() && time->second > length) {
+			length = time->second;
+		}
+		return new Sound::DspDelayNode(sampleRate, length);
+	}
+	*error = "unknown node type " + spec.type + ".";
+	return NULL;
+}
+
+Sound::DspGraph::DspGraph(int frames, int channels): frames(frames), channels(channels), _usesEngine(false) {
+	_generation = ++generations;
+	sink.node = NULL;
+	sink.memory = NULL;
+	sink.block = NULL;
+	silenceMemory = allocAligned(AudioBlock::sizeFor(frames, channels));
+	silence = new AudioBlock(silenceMemory, frames, channels);
+}
+
+Sound::DspGraph::~DspGraph() {
+	for (size_t i = 0; i < entries.size(); ++i) {
+		delete entries[i].node;
+		delete entries[i].block;
+		free(entries[i].memory);
+	}
+	delete sink.node;
+	delete sink.block;
+	free(sink.memory);
+	delete silence;
+	free(silenceMemory);
+}
+
+Sound::DspGraph* Sound::DspGraph::build(const DspGraphSpec& spec, int sampleRate, int frames, int channels, std::string* error) {
+	DspGraph* graph = new DspGraph(frames, channels);
+	int count = (int)spec.nodes.size();
+	if (count == 0) {
+		if (spec.connections.empty()) return graph;
+		*error = "A graph without nodes can't have connections.";
+		delete graph;
+		return NULL;
+	}
+
+	// Create the nodes in spec order (the entries are sorted when the connections are known)
+	std::map<std::string, int> ids;
+	for (int k = 0; k < count; ++k) {
+		const DspNodeSpec& nodeSpec = spec.nodes[k];
+		if (nodeSpec.id.empty() || nodeSpec.id == "input" || nodeSpec.id == "engine" || nodeSpec.id == "output") {
+			*error = "Invalid node id '" + nodeSpec.id + "' (input, engine and output are reserved).";
+			delete graph;
+			return NULL;
+		}
+		if (ids.count(nodeSpec.id) > 0) {
+			*error = "The node id " + nodeSpec.id + " is used twice.";
+			delete graph;
+			return NULL;
+		}
+		std::string reason;
+		Entry entry;
+		entry.id = nodeSpec.id;
+		entry.node = createNode(nodeSpec, sampleRate, &reason);
+		entry.memory = NULL;
+		entry.block = NULL;
+		if (entry.node == NULL) {
+			*error = "Node " + nodeSpec.id + ": " + reason;
+			delete graph;
+			return NULL;
+		}
+		graph->entries.push_back(entry);
+		ids[nodeSpec.id] = k;
+	}
+
+	// Resolve the connections into block indices
+	graph->sink.node = new DspMixerNode();
+	std::vector<std::vector<int> > successors(count);
+	std::vector<int> pending(count, 0);
+	for (size_t i = 0; i < spec.connections.size(); ++i) {
+		const std::string& from = spec.connections[i].first;
+		const std::string& to = spec.connections[i].second;
+
+		int source;
+		if (from == "input") {
+			source = DSP_SOURCE_INPUT;
+		} else if (from == "engine") {
+			source = DSP_SOURCE_ENGINE;
+			graph->_usesEngine = true;
+		} else if (ids.count(from) > 0) {
+			source = DSP_FIRST_NODE + ids[from];
+		} else {
+			*error = from == "output" ? "The output can't be connected to a node." : "Unknown node " + from + " in the connections.";
+			delete graph;
+			return NULL;
+		}
+
+		if (to == "output") {
+			graph->sink.inputs.push_back(source);
+		} else if (ids.count(to) > 0) {
+			int target = ids[to];
+			graph->entries[target].inputs.push_back(source);
+			if (source >= DSP_FIRST_NODE) {
+				successors[source - DSP_FIRST_NODE].push_back(target);
+				pending[target]++;
+			}
+		} else {
+			*error = (to == "input" || to == "engine") ? "The sources can't have inputs." : "Unknown node " + to + " in the connections.";
+			delete graph;
+			return NULL;
+		}
+	}
+
+	// Sort the nodes so every node runs after its inputs
+	std::vector<int> order;
+	for (int k = 0; k < count; ++k) {
+		if (graph->entries[k].inputs.empty()) {
+			*error = "Node " + graph->entries[k].id + " has no input.";
+			delete graph;
+			return NULL;
+		}
+		if (pending[k] == 0) order.push_back(k);
+	}
+	for (size_t i = 0; i < order.size(); ++i) {
+		const std::vector<int>& next = successors[order[i]];
+		for (size_t j = 0; j < next.size(); ++j) {
+			if (--pending[next[j]] == 0) order.push_back(next[j]);
+		}
+	}
+	if ((int)order.size() < count) {
+		*error = "The graph contains a cycle (use the feedback of a delay node instead).";
+		delete graph;
+		return NULL;
+	}
+	if (graph->sink.inputs.empty()) {
+		*error = "Nothing is connected to the output.";
+		delete graph;
+		return NULL;
+	}
+
+	// Configure the nodes in processing order, now the channels of their inputs are known
+	graph->blocks.assign(DSP_FIRST_NODE + count, graph->silence);
+	for (size_t i = 0; i <= order.size(); ++i) {
+		Entry& entry = i < order.size() ? graph->entries[order[i]] : graph->sink;
+		std::vector<int> inputChannels;
+		for (size_t j = 0; j < entry.inputs.size(); ++j) {
+			inputChannels.push_back(graph->blocks[entry.inputs[j]]->channels());
+		}
+		std::string reason;
+		int outputChannels = entry.node->configure(inputChannels, &reason);
+		if (outputChannels <= 0) {
+			*error = i < order.size() ? "Node " + entry.id + ": " + reason : "Output: " + reason;
+			delete graph;
+			return NULL;
+		}
+		entry.inputBlocks.assign(entry.inputs.size(), graph->silence);
+		entry.memory = allocAligned(AudioBlock::sizeFor(frames, outputChannels));
+		entry.block = new AudioBlock(entry.memory, frames, outputChannels);
+		if (i < order.size()) graph->blocks[DSP_FIRST_NODE + order[i]] = entry.block;
+	}
+
+	// Apply the initial parameters without ramping to them
+	for (int k = 0; k < count; ++k) {
+		const DspNodeSpec& nodeSpec = spec.nodes[k];
+		DspNode* node = graph->entries[k].node;
+		for (std::map<std::string, double>::const_iterator it = nodeSpec.params.begin(); it != nodeSpec.params.end(); ++it) {
+			if (isBuildOption(nodeSpec.type, it->first)) continue;
+			int param = node->paramIndex(it->first);
+			if (param < 0) {
+				*error = "Node " + nodeSpec.id + " has no parameter " + it->first + ".";
+				delete graph;
+				return NULL;
+			}
+			node->setParam(param, (float)it->second);
+		}
+		node->settle();
+	}
+	graph->sink.node->settle();
+
+	std::vector<Entry> sorted;
+	for (size_t i = 0; i < order.size(); ++i) {
+		sorted.push_back(graph->entries[order[i]]);
+	}
+	graph->entries.swap(sorted);
+	return graph;
+}
+
+uint64_t Sound::DspGraph::generation() const {
+	return _generation;
+}
+
+bool Sound::DspGraph::bypass() const {
+	return entries.empty();
+}
+
+bool Sound::DspGraph::usesEngine() const {
+	return _usesEngine;
+}
+
+int Sound::DspGraph::nodeIndex(const std::string& id) const {
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].id == id) return (int)i;
+	}
+	return -1;
+}
+
+int Sound::DspGraph::paramIndex(int node, const std::string& name) const {
+	if (node < 0 || node >= (int)entries.size()) return -1;
+	return entries[node].node->paramIndex(name);
+}
+
+void Sound::DspGraph::setParam(int node, int param, float value) {
+	entries[node].node->setParam(param, value);
+}
+
+void Sound::DspGraph::process(const AudioBlock* input, const AudioBlock* engine, int frames) {
+	if (frames > this->frames) frames = this->frames;
+	blocks[DSP_SOURCE_INPUT] = input != NULL ? input : silence;
+	blocks[DSP_SOURCE_ENGINE] = engine != NULL ? engine : silence;
+
+	for (size_t i = 0; i <= entries.size(); ++i) {
+		Entry& entry = i < entries.size() ? entries[i] : sink;
+		for (size_t j = 0; j < entry.inputs.size(); ++j) {
+			entry.inputBlocks[j] = blocks[entry.inputs[j]];
+		}
+		entry.node->process(entry.inputBlocks, *entry.block, frames);
+	}
+}
+
+const Sound::AudioBlock& Sound::DspGraph::output() const {
+	return *sink.block;
+}
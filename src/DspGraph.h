@@ -0,0 +1,139 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_DSP_GRAPH_H
+#define SOUND_DSP_GRAPH_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AudioBlock.h"
+
+namespace Sound {
+
+	class DspNode;
+
+	/**
+	 * A node as it is described in js.
+	 */
+	struct DspNodeSpec {
+		std::string id;
+		// gain, biquad, delay, mixer, pan, splitter or merger
+		std::string type;
+		// The shape of a biquad node
+		std::string filter;
+		// The input channels a splitter node picks
+		std::vector<int> channels;
+		// The numeric properties (parameters and build options like the maxTime of a delay)
+		std::map<std::string, double> params;
+	};
+
+	/**
+	 * A graph as it is described in js. The sources are called input (the device input)
+	 * and engine (the blocks that were processed on the js thread), the sink is called output.
+	 */
+	struct DspGraphSpec {
+		std::vector<DspNodeSpec> nodes;
+		// Pairs of node ids (from, to)
+		std::vector<std::pair<std::string, std::string> > connections;
+	};
+
+	/**
+	 * A parameter update that travels from the js thread to the stream callback.
+	 */
+	struct DspParamChange {
+		// The graph the indices belong to
+		uint64_t generation;
+		int node;
+		int param;
+		float value;
+	};
+
+	/**
+	 * A processing graph that renders blocks in the stream callback.
+	 *
+	 * The graph is built and validated on the js thread: the nodes are sorted so every node runs
+	 * after its inputs and all buffers are allocated, so process() neither allocates nor locks.
+	 * Afterwards only the thread that calls process() may change parameters.
+	 */
+	class DspGraph {
+	public:
+		/**
+		 * Builds a graph for blocks of frames x channels.
+		 *
+		 * @param spec       The description of the graph (without nodes the graph is bypassed).
+		 * @param sampleRate The sample rate of the stream.
+		 * @param frames     The maximum number of frames per block.
+		 * @param channels   The number of channels of both sources.
+		 * @param error      Receives the reason if the description is invalid.
+		 *
+		 * @return           The graph or NULL.
+		 */
+		static DspGraph* build(const DspGraphSpec& spec, int sampleRate, int frames, int channels, std::string* error);
+		~DspGraph();
+
+		/** Identifies the graph in parameter changes (unique for the process). */
+		uint64_t generation() const;
+
+		/** If the graph has no nodes and the engine output should be used as is. */
+		bool bypass() const;
+
+		/** If the engine source is connected (only then a missing engine block is an underflow). */
+		bool usesEngine() const;
+
+		/** The index of a node or -1. */
+		int nodeIndex(const std::string& id) const;
+
+		/** The index of a parameter of a node or -1. */
+		int paramIndex(int node, const std::string& name) const;
+
+		/** Changes a parameter (stream callback, gains and pans are ramped over the next block). */
+		void setParam(int node, int param, float value);
+
+		/**
+		 * Renders a block.
+		 *
+		 * @param input  The device input (NULL for silence).
+		 * @param engine The processed block of the js thread (NULL for silence).
+		 * @param frames The number of frames.
+		 */
+		void process(const AudioBlock* input, const AudioBlock* engine, int frames);
+
+		/** The block the last process() rendered. */
+		const AudioBlock& output() const;
+	private:
+		DspGraph(int frames, int channels);
+
+		struct Entry {
+			std::string id;
+			DspNode* node;
+			// Indices into blocks
+			std::vector<int> inputs;
+			// The input blocks of the current process() (preallocated)
+			std::vector<const AudioBlock*> inputBlocks;
+			// The block the node renders into
+			float* memory;
+			AudioBlock* block;
+		};
+
+		uint64_t _generation;
+		int frames;
+		int channels;
+		// The nodes in processing order
+		std::vector<Entry> entries;
+		// Mixes everything that is connected to the output
+		Entry sink;
+		// Every block a node can read: the input, the engine block and the outputs of the nodes in spec order
+		std::vector<const AudioBlock*> blocks;
+		bool _usesEngine;
+		// The sources when process() gets no block
+		float* silenceMemory;
+		AudioBlock* silence;
+	};
+}
+
+#endif
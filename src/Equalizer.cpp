@@ -0,0 +1,233 @@
+#include "Equalizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+static float* allocAligned(int count) {
+	void* memory = NULL;
+	if (posix_memalign(&memory, AUDIO_BLOCK_ALIGNMENT, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+		return NULL;
+	}
+	memset(memory, 0, sizeof(float) * (count > 0 ? count : 1));
+	return (float*)memory;
+}
+
+Sound::Equalizer::Equalizer(int sampleRate, int channels): sampleRate(sampleRate), steps(0) {
+	_channels = channels > 0 ? channels : 1;
+	lanes = ((_channels + 3) / 4) * 4;
+	z1 = allocAligned(0);
+	z2 = allocAligned(0);
+	pointers.resize(_channels);
+}
+
+Sound::Equalizer::~Equalizer() {
+	free(z1);
+	free(z2);
+}
+
+void Sound::Equalizer::setBands(const std::vector<EqBand>& bands, bool ramp) {
+	int sections = (int)bands.size();
+	int previous = (int)_bands.size();
+
+	if (sections != previous) {
+		// Keep the states of the sections that stay, added sections start from silence and a flat response
+		float* states1 = allocAligned(sections * lanes);
+		float* states2 = allocAligned(sections * lanes);
+		int kept = sections < previous ? sections : previous;
+		memcpy(states1, z1, sizeof(float) * kept * lanes);
+		memcpy(states2, z2, sizeof(float) * kept * lanes);
+		free(z1);
+		free(z2);
+		z1 = states1;
+		z2 = states2;
+
+		BiquadCoefficients flat = BiquadCoefficients::identity();
+		current.resize(sections * 5);
+		for (int s = kept; s < sections; ++s) {
+			float* c = current.data() + s * 5;
+			c[0] = flat.b0; c[1] = flat.b1; c[2] = flat.b2; c[3] = flat.a1; c[4] = flat.a2;
+		}
+	}
+
+	_bands = bands;
+	target.resize(sections * 5);
+	delta.resize(sections * 5);
+	for (int s = 0; s < sections; ++s) {
+		BiquadCoefficients coefficients = BiquadCoefficients::design(bands[s].type, sampleRate, bands[s].frequency, bands[s].q, bands[s].gain);
+		float* t = target.data() + s * 5;
+		t[0] = coefficients.b0; t[1] = coefficients.b1; t[2] = coefficients.b2; t[3] = coefficients.a1; t[4] = coefficients.a2;
+	}
+
+	if (ramp) {
+		// The stability region of (a1, a2) is a triangle, so every interpolated filter is stable as well
+		steps = EQ_RAMP_FRAMES / EQ_CHUNK_FRAMES;
+		for (size_t i = 0; i < target.size(); ++i) {
+			delta[i] = (target[i] - current[i]) / steps;
+		}
+	} else {
+		current = target;
+		steps = 0;
+	}
+}
+
+const std::vector<Sound::EqBand>& Sound::Equalizer::bands() const {
+	return _bands;
+}
+
+int Sound::Equalizer::channels() const {
+	return _channels;
+}
+
+void Sound::Equalizer::process(const AudioBlock& block) {
+	int channels = block.channels() < _channels ? block.channels() : _channels;
+	for (int c = 0; c < _channels; ++c) {
+		pointers[c] = c < channels ? block.channel(c) : NULL;
+	}
+	process(pointers.data(), block.frames());
+}
+
+void Sound::Equalizer::process(float* const* channels, int frames) {
+	if (_bands.empty()) return;
+
+	for (int offset = 0; offset < frames; offset += EQ_CHUNK_FRAMES) {
+		int n = frames - offset < EQ_CHUNK_FRAMES ? frames - offset : EQ_CHUNK_FRAMES;
+		_step();
+#if defined(__SSE__)
+		if (_channels >= 2) {
+			_processLanes(channels, offset, n);
+			continue;
+		}
+#endif
+		_processScalar(channels, offset, n);
+	}
+
+	// Flush denormals when the signal decays into silence
+	int count = (int)_bands.size() * lanes;
+	for (int i = 0; i < count; ++i) {
+		if (fabsf(z1[i]) < 1e-20f) z1[i] = 0.0f;
+		if (fabsf(z2[i]) < 1e-20f) z2[i] = 0.0f;
+	}
+}
+
+void Sound::Equalizer::reset() {
+	memset(z1, 0, sizeof(float) * _bands.size() * lanes);
+	memset(z2, 0, sizeof(float) * _bands.size() * lanes);
+}
+
+void Sound::Equalizer::_step() {
+	if (steps == 0) return;
+	if (--steps == 0) {
+		current = target;
+		return;
+	}
+	for (size_t i = 0; i < current.size(); ++i) {
+		current[i] += delta[i];
+	}
+}
+
+void Sound::Equalizer::_processScalar(float* const* channels, int offset, int frames) {
+	int sections = (int)_bands.size();
+	for (int c = 0; c < _channels; ++c) {
+		if (channels[c] == NULL) continue;
+		float* x = channels[c] + offset;
+		for (int s = 0; s < sections; ++s) {
+			const float* k = current.data() + s * 5;
+			float b0 = k[0], b1 = k[1], b2 = k[2], a1 = k[3], a2 = k[4];
+			float s1 = z1[s * lanes + c];
+			float s2 = z2[s * lanes + c];
+			for (int i = 0; i < frames; ++i) {
+				float in = x[i];
+				float y = b0 * in + s1;
+				s1 = b1 * in - a1 * y + s2;
+				s2 = b2 * in - a2 * y;
+				x[i] = y;
+			}
+			z1[s * lanes + c] = s1;
+			z2[s * lanes + c] = s2;
+		}
+	}
+}
+
+void Sound::Equalizer::_processLanes(float* const* channels, int offset, int frames) {
+#if defined(__SSE__)
+	int sections = (int)_bands.size();
+	// Lanes without a channel read silence and write into a scratch buffer
+	float silence[EQ_CHUNK_FRAMES] = {0};
+	float scratch[EQ_CHUNK_FRAMES];
+
+	for (int g = 0; g < lanes; g += 4) {
+		float* lane[4];
+		for (int l = 0; l < 4; ++l) {
+			int c = g + l;
+			lane[l] = (c < _channels && channels[c] != NULL) ? channels[c] + offset : NULL;
+		}
+
+		// Transpose the chunk into frames of four channels
+		__m128 x[EQ_CHUNK_FRAMES];
+		const float* src[4];
+		for (int l = 0; l < 4; ++l) src[l] = lane[l] != NULL ? lane[l] : silence;
+		int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			__m128 r0 = _mm_loadu_ps(src[0] + i);
+			__m128 r1 = _mm_loadu_ps(src[1] + i);
+			__m128 r2 = _mm_loadu_ps(src[2] + i);
+			__m128 r3 = _mm_loadu_ps(src[3] + i);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			x[i] = r0;
+			x[i + 1] = r1;
+			x[i + 2] = r2;
+			x[i + 3] = r3;
+		}
+		for (; i < frames; ++i) {
+			x[i] = _mm_setr_ps(src[0][i], src[1][i], src[2][i], src[3][i]);
+		}
+
+		// Every section filters the four lanes at once
+		for (int s = 0; s < sections; ++s) {
+			const float* k = current.data() + s * 5;
+			__m128 b0 = _mm_set1_ps(k[0]);
+			__m128 b1 = _mm_set1_ps(k[1]);
+			__m128 b2 = _mm_set1_ps(k[2]);
+			__m128 a1 = _mm_set1_ps(k[3]);
+			__m128 a2 = _mm_set1_ps(k[4]);
+			__m128 s1 = _mm_load_ps(z1 + s * lanes + g);
+			__m128 s2 = _mm_load_ps(z2 + s * lanes + g);
+			for (int j = 0; j < frames; ++j) {
+				__m128 in = x[j];
+				__m128 y = _mm_add_ps(_mm_mul_ps(b0, in), s1);
+				s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, in), _mm_mul_ps(a1, y)), s2);
+				s2 = _mm_sub_ps(_mm_mul_ps(b2, in), _mm_mul_ps(a2, y));
+				x[j] = y;
+			}
+			_mm_store_ps(z1 + s * lanes + g, s1);
+			_mm_store_ps(z2 + s * lanes + g, s2);
+		}
+
+		// Transpose back into the channels
+		float* dst[4];
+		for (int l = 0; l < 4; ++l) dst[l] = lane[l] != NULL ? lane[l] : scratch;
+		i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			__m128 r0 = x[i];
+			__m128 r1 = x[i + 1];
+			__m128 r2 = x[i + 2];
+			__m128 r3 = x[i + 3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(dst[0] + i, r0);
+			_mm_storeu_ps(dst[1] + i, r1);
+			_mm_storeu_ps(dst[2] + i, r2);
+			_mm_storeu_ps(dst[3] + i, r3);
+		}
+		for (; i < frames; ++i) {
+			float frame[4];
+			_mm_storeu_ps(frame, x[i]);
+			for (int l = 0; l < 4; ++l) dst[l][i] = frame[l];
+		}
+	}
+#endif
+}
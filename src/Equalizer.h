@@ -0,0 +1,92 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_EQUALIZER_H
+#define SOUND_EQUALIZER_H
+
+#include <vector>
+
+#include "AudioBlock.h"
+#include "Biquad.h"
+
+// The number of frames the coefficients are held between two interpolation steps
+#define EQ_CHUNK_FRAMES 16
+// The number of frames a coefficient change is interpolated over
+#define EQ_RAMP_FRAMES 512
+
+namespace Sound {
+
+	/**
+	 * One band of an equalizer.
+	 */
+	struct EqBand {
+		BiquadType type;
+		double frequency;
+		double q;
+		// The gain of peak and shelf bands in dB
+		double gain;
+	};
+
+	/**
+	 * A cascade of biquads that filters every channel with the same bands.
+	 *
+	 * With two or more channels four channels are filtered at once, each one in a lane of a
+	 * sse register (the blocks are transposed into frames of four channels on the fly). A mono
+	 * signal runs through a scalar transposed direct form II kernel. Coefficient changes are
+	 * interpolated over EQ_RAMP_FRAMES, so bands can be moved while audio runs without clicks.
+	 */
+	class Equalizer {
+	public:
+		Equalizer(int sampleRate, int channels);
+		~Equalizer();
+
+		/**
+		 * Replaces the bands.
+		 *
+		 * @param bands The new bands.
+		 * @param ramp  Interpolate from the current coefficients (bands that are added fade in from a flat
+		 *              response), otherwise the new coefficients are used from the next frame on.
+		 */
+		void setBands(const std::vector<EqBand>& bands, bool ramp = true);
+
+		const std::vector<EqBand>& bands() const;
+
+		int channels() const;
+
+		/** Filters a block in place. */
+		void process(const AudioBlock& block);
+
+		/** Filters planar channels in place. */
+		void process(float* const* channels, int frames);
+
+		/** Clears the filter states. */
+		void reset();
+	private:
+		/** Advances the coefficient interpolation by one chunk. */
+		void _step();
+		void _processScalar(float* const* channels, int offset, int frames);
+		void _processLanes(float* const* channels, int offset, int frames);
+
+		int sampleRate;
+		int _channels;
+		// The channels rounded up to a multiple of four (the lanes of the states)
+		int lanes;
+		std::vector<EqBand> _bands;
+
+		// Per section b0 b1 b2 a1 a2 the current, target and per step increment coefficients
+		std::vector<float> current;
+		std::vector<float> target;
+		std::vector<float> delta;
+		// The remaining interpolation steps
+		int steps;
+
+		// The states as [section][lane] (aligned)
+		float* z1;
+		float* z2;
+		// The channel pointers of process(block)
+		std::vector<float*> pointers;
+	};
+}
+
+#endif
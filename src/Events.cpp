@@ -0,0 +1,44 @@
+#include "Events.h"
+
+#include <string.h>
+
+static const char* names[Sound::EventTypeCount] = {
+	"data",
+	"info",
+	"fft",
+
+	"playback_started",
+	"playback_stopped",
+	"playback_paused",
+	"playback_progress",
+	"playback_finished",
+
+	"recording_loaded",
+	"recording_started",
+	"recording_stopped",
+	"recording_progress",
+	"recording_saved",
+	"recording_deleted",
+
+	"beep_started",
+	"beep_stopped",
+	"tone_started",
+	"tone_stopped",
+	"clip_ended",
+
+	"stats"
+};
+
+const char* Sound::eventName(EventType type) {
+	return names[type];
+}
+
+bool Sound::parseEventType(const char* name, EventType* type) {
+	for (int i = 0; i < EventTypeCount; ++i) {
+		if (strcmp(names[i], name) == 0) {
+			*type = (EventType)i;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,54 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_EVENTS_H
+#define SOUND_EVENTS_H
+
+namespace Sound {
+
+	/**
+	 * The events of the engine. The listeners are kept in a table indexed by
+	 * the type, so emitting never looks an event up by its name.
+	 */
+	enum EventType {
+		EventData = 0,
+		EventInfo,
+		EventFft,
+
+		EventPlaybackStarted,
+		EventPlaybackStopped,
+		EventPlaybackPaused,
+		EventPlaybackProgress,
+		EventPlaybackFinished,
+
+		EventRecordingLoaded,
+		EventRecordingStarted,
+		EventRecordingStopped,
+		EventRecordingProgress,
+		EventRecordingSaved,
+		EventRecordingDeleted,
+
+		EventBeepStarted,
+		EventBeepStopped,
+		EventToneStarted,
+		EventToneStopped,
+		EventClipEnded,
+
+		EventStats,
+
+		EventTypeCount
+	};
+
+	/** The name of an event as it is used in js. */
+	const char* eventName(EventType type);
+
+	/**
+	 * Looks up an event by its name.
+	 *
+	 * @return False for unknown names.
+	 */
+	bool parseEventType(const char* name, EventType* type);
+}
+
+#endif
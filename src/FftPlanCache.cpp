@@ -0,0 +1,101 @@
+#include "FftPlanCache.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+using namespace std;
+
+unsigned int Sound::FftPlanCache::flags = FFTW_MEASURE;
+
+static uv_mutex_t* createMutex() {
+	uv_mutex_t* mutex = new uv_mutex_t;
+	uv_mutex_init(mutex);
+	return mutex;
+}
+
+uv_mutex_t* Sound::FftPlanCache::mutex() {
+	static uv_mutex_t* _mutex = createMutex();
+	return _mutex;
+}
+
+map<Sound::FftPlanCache::PlanKey, fftw_plan>& Sound::FftPlanCache::plans() {
+	static map<PlanKey, fftw_plan> _plans;
+	return _plans;
+}
+
+fftw_plan Sound::FftPlanCache::get(int size, FftDirection direction) {
+	// The fftw planner is not thread safe so all planning goes through here
+	uv_mutex_lock(mutex());
+
+	// A plan made with other flags is not reused, so a new planner effort applies to every size
+	PlanKey key(size, (int)direction, flags);
+	map<PlanKey, fftw_plan>::iterator it = plans().find(key);
+	if (it != plans().end()) {
+		fftw_plan plan = it->second;
+		uv_mutex_unlock(mutex());
+		return plan;
+	}
+
+	// Measuring overwrites the buffers, so plan on scratch buffers with the alignment fftw_malloc guarantees
+	double* real = (double*)fftw_malloc(sizeof(double) * size);
+	fftw_complex* complex = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (size / 2 + 1));
+	fftw_plan plan;
+	if (direction == FftForward) {
+		plan = fftw_plan_dft_r2c_1d(size, real, complex, flags);
+	} else {
+		plan = fftw_plan_dft_c2r_1d(size, complex, real, flags);
+	}
+	fftw_free(real);
+	fftw_free(complex);
+
+	plans()[key] = plan;
+	saveWisdom();
+
+	uv_mutex_unlock(mutex());
+	return plan;
+}
+
+void Sound::FftPlanCache::loadWisdom() {
+	string file = wisdomFile();
+	if (file.empty()) return;
+	// A missing or unreadable file just means that we start measuring from scratch
+	fftw_import_wisdom_from_filename(file.c_str());
+}
+
+bool Sound::FftPlanCache::saveWisdom() {
+	string file = wisdomFile();
+	if (file.empty()) return false;
+
+	// Write to a temporary file first so a crash never leaves a truncated wisdom file behind
+	string tmpFile = file + ".tmp";
+	if (fftw_export_wisdom_to_filename(tmpFile.c_str()) == 0) {
+		remove(tmpFile.c_str());
+		return false;
+	}
+	return rename(tmpFile.c_str(), file.c_str()) == 0;
+}
+
+string Sound::FftPlanCache::wisdomFile() {
+	const char* file = getenv("SOUNDENGINE_FFTW_WISDOM");
+	if (file != NULL) return string(file);
+	const char* home = getenv("HOME");
+	if (home == NULL) return string();
+	return string(home) + "/.soundengine-fftw-wisdom";
+}
+
+void Sound::FftPlanCache::setPlannerFlags(unsigned int flags) {
+	uv_mutex_lock(mutex());
+	FftPlanCache::flags = flags;
+	uv_mutex_unlock(mutex());
+}
+
+unsigned int Sound::FftPlanCache::plannerFlags() {
+	return flags;
+}
+
+int Sound::FftPlanCache::size() {
+	uv_mutex_lock(mutex());
+	int count = (int)plans().size();
+	uv_mutex_unlock(mutex());
+	return count;
+}
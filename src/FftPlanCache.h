@@ -0,0 +1,79 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_FFT_PLAN_CACHE_H
+#define SOUND_FFT_PLAN_CACHE_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <tuple>
+#include <uv.h>
+#include <fftw3.h>
+
+namespace Sound {
+
+	/**
+	 * The direction of a real valued transform.
+	 */
+	enum FftDirection {
+		/** Real input to complex spectrum (r2c). */
+		FftForward,
+		/** Complex spectrum to real output (c2r). */
+		FftBackward
+	};
+
+	/**
+	 * A process wide cache of fftw plans keyed by size, direction and planner flags.
+	 *
+	 * Plans are created once and shared by every engine. They are meant to be run
+	 * with the new-array execute functions (fftw_execute_dft_r2c/c2r) on buffers
+	 * allocated with fftw_malloc. The fftw wisdom is loaded when the module is
+	 * initialised and saved whenever a new plan was created, so measuring only
+	 * happens once per size and machine.
+	 */
+	class FftPlanCache {
+	public:
+		/**
+		 * Returns the plan for a transform of `size` samples and creates it if needed.
+		 *
+		 * @param  size      The number of real samples.
+		 * @param  direction The direction of the transform.
+		 *
+		 * @return           The plan (owned by the cache).
+		 */
+		static fftw_plan get(int size, FftDirection direction);
+
+		/** Loads the wisdom file if it exists. */
+		static void loadWisdom();
+
+		/** Writes the accumulated wisdom to the wisdom file. */
+		static bool saveWisdom();
+
+		/**
+		 * The wisdom file is taken from SOUNDENGINE_FFTW_WISDOM or defaults
+		 * to ~/.soundengine-fftw-wisdom.
+		 */
+		static std::string wisdomFile();
+
+		/**
+		 * Sets the planner flags for plans that are requested from now on (e.g. FFTW_PATIENT).
+		 * Plans made with other flags stay cached for the code that still runs them.
+		 */
+		static void setPlannerFlags(unsigned int flags);
+		static unsigned int plannerFlags();
+
+		/** The number of cached plans. */
+		static int size();
+	private:
+		// size, direction and planner flags
+		typedef std::tuple<int, int, unsigned int> PlanKey;
+
+		static uv_mutex_t* mutex();
+		static std::map<PlanKey, fftw_plan>& plans();
+		static unsigned int flags;
+	};
+}
+
+#endif
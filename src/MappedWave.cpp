@@ -0,0 +1,117 @@
+#include "MappedWave.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The number of bytes that are prefetched ahead of the playback position
+#define MAPPED_WAVE_READ_AHEAD (4 << 20)
+
+using namespace std;
+
+Sound::MappedWave::MappedWave(string file): path(file) {
+	mapping = NULL;
+	mappingSize = 0;
+	samples = NULL;
+	_format = WaveFormat();
+	sampleBytes = 0;
+	samplesCount = 0;
+	readAheadFrom = 0;
+	readAheadIdx = 0;
+
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		_error = "Could not open the wave file.";
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 12) {
+		close(fd);
+		_error = "Not a wave file.";
+		return;
+	}
+
+	void* memory = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping keeps the file referenced
+	close(fd);
+	if (memory == MAP_FAILED) {
+		_error = "Could not map the wave file.";
+		return;
+	}
+
+	WaveInfo info;
+	if (parseWave((const uint8_t*)memory, st.st_size, &info, &_error) == false) {
+		munmap(memory, st.st_size);
+		return;
+	}
+
+	mapping = memory;
+	mappingSize = st.st_size;
+	// Playback walks through the file from front to back
+	madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+	_format = info.format;
+	sampleBytes = bytesPerSample(_format.format);
+	samples = (const uint8_t*)mapping + info.dataOffset;
+	samplesCount = info.dataSize / sampleBytes;
+}
+
+Sound::MappedWave::~MappedWave() {
+	if (mapping != NULL) {
+		munmap(mapping, mappingSize);
+	}
+}
+
+bool Sound::MappedWave::isOpen() const {
+	return mapping != NULL;
+}
+
+string Sound::MappedWave::error() const {
+	return _error;
+}
+
+string Sound::MappedWave::file() const {
+	return path;
+}
+
+const Sound::WaveFormat& Sound::MappedWave::format() const {
+	return _format;
+}
+
+int64_t Sound::MappedWave::size() const {
+	return samplesCount;
+}
+
+float Sound::MappedWave::sampleAt(int64_t idx) const {
+	float sample;
+	decodeSamples(samples + idx * sampleBytes, _format.format, &sample, 1);
+	return sample;
+}
+
+int64_t Sound::MappedWave::read(int64_t offset, float* dst, int64_t count) const {
+	if (offset < 0 || offset >= samplesCount) return 0;
+	if (offset + count > samplesCount) count = samplesCount - offset;
+
+	// Renew the read ahead when playback got close to its end or jumped somewhere else
+	if (offset < readAheadFrom || offset >= readAheadIdx) {
+		_readAhead(offset);
+	}
+	decodeSamples(samples + offset * sampleBytes, _format.format, dst, count);
+	return count;
+}
+
+void Sound::MappedWave::_readAhead(int64_t offset) const {
+	// madvise needs a page aligned address
+	long pageSize = sysconf(_SC_PAGESIZE);
+	int64_t start = (int64_t)(samples + offset * sampleBytes - (const uint8_t*)mapping);
+	start -= start % pageSize;
+	int64_t length = MAPPED_WAVE_READ_AHEAD;
+	if (start + length > mappingSize) length = mappingSize - start;
+	if (length > 0) {
+		madvise((char*)mapping + start, length, MADV_WILLNEED);
+	}
+	readAheadFrom = offset;
+	readAheadIdx = offset + MAPPED_WAVE_READ_AHEAD / 2 / sampleBytes;
+}
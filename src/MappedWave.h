@@ -0,0 +1,63 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_MAPPED_WAVE_H
+#define SOUND_MAPPED_WAVE_H
+
+#include <stdint.h>
+#include <string>
+
+#include "SampleSource.h"
+#include "WaveFile.h"
+
+namespace Sound {
+
+	/**
+	 * A wave file that is mapped into memory instead of being read.
+	 *
+	 * Opening is O(1) regardless of the file size. The pages are read by the kernel
+	 * when playback touches them and read ahead sequentially, so a large file never
+	 * needs a resident copy. Samples of other formats than 32bit floats are decoded
+	 * while reading.
+	 */
+	class MappedWave: public SampleSource {
+	public:
+		explicit MappedWave(std::string file);
+		~MappedWave();
+
+		/** If the file could be opened, mapped and parsed. */
+		bool isOpen() const;
+
+		/** Why the file could not be opened. */
+		std::string error() const;
+
+		/** The path of the mapped file. */
+		std::string file() const;
+
+		/** The sample layout of the file. */
+		const WaveFormat& format() const;
+
+		int64_t size() const;
+		float sampleAt(int64_t idx) const;
+		int64_t read(int64_t offset, float* dst, int64_t count) const;
+	private:
+		/** Asks the kernel to prefetch the pages after offset. */
+		void _readAhead(int64_t offset) const;
+
+		std::string path;
+		void* mapping;
+		int64_t mappingSize;
+		std::string _error;
+		WaveFormat _format;
+		/** The encoded samples inside the mapping. */
+		const uint8_t* samples;
+		int sampleBytes;
+		int64_t samplesCount;
+		/** The range of sample indices that is covered by the last read ahead. */
+		mutable int64_t readAheadFrom;
+		mutable int64_t readAheadIdx;
+	};
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include "Meter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// The passband of the oversampling filter relative to the input nyquist frequency
+#define METER_TRUE_PEAK_PASSBAND 0.9
+
+static float* allocAligned(int count) {
+	void* memory = NULL;
+	if (posix_memalign(&memory, AUDIO_BLOCK_ALIGNMENT, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+		return NULL;
+	}
+	memset(memory, 0, sizeof(float) * (count > 0 ? count : 1));
+	return (float*)memory;
+}
+
+/**
+ * Computes the biquad coefficients of the two k-weighting stages (ITU-R BS.1770) for a sample rate.
+ */
+static void kWeighting(int sampleRate, double* shelf, double* highpass) {
+	// The high shelf that models the acoustic effect of the head
+	double f0 = 1681.974450955533;
+	double gain = 3.999843853973347;
+	double q = 0.7071752369554196;
+	double k = tan(M_PI * f0 / sampleRate);
+	double vh = pow(10.0, gain / 20.0);
+	double vb = pow(vh, 0.4996667741545416);
+	double a0 = 1.0 + k / q + k * k;
+	shelf[0] = (vh + vb * k / q + k * k) / a0;
+	shelf[1] = 2.0 * (k * k - vh) / a0;
+	shelf[2] = (vh - vb * k / q + k * k) / a0;
+	shelf[3] = 2.0 * (k * k - 1.0) / a0;
+	shelf[4] = (1.0 - k / q + k * k) / a0;
+
+	// The revised low frequency b-curve highpass
+	f0 = 38.13547087602444;
+	q = 0.5003270373238773;
+	k = tan(M_PI * f0 / sampleRate);
+	a0 = 1.0 + k / q + k * k;
+	highpass[0] = 1.0;
+	highpass[1] = -2.0;
+	highpass[2] = 1.0;
+	highpass[3] = 2.0 * (k * k - 1.0) / a0;
+	highpass[4] = (1.0 - k / q + k * k) / a0;
+}
+
+/**
+ * The weight of a channel in the loudness sum. The surround channels of the
+ * 5.0 and 5.1 wave channel order count more and the lfe is ignored.
+ */
+static double channelWeight(int c, int channels) {
+	if (channels == 6) {
+		if (c == 3) return 0.0;
+		if (c >= 4) return 1.41;
+	} else if (channels == 5) {
+		if (c >= 3) return 1.41;
+	}
+	return 1.0;
+}
+
+Sound::Meter::Meter(int sampleRate, int channels, int blockFrames):
+	sampleRate(sampleRate), _channels(channels > 0 ? channels : 1), blockFrames(blockFrames > 0 ? blockFrames : 1)
+{
+	_minimum = new float[_channels];
+	_maximum = new float[_channels];
+	sumOfSquares = new double[_channels];
+	truePeaks = new float[_channels];
+
+	// A windowed sinc lowpass that interpolates three samples between every input sample
+	int length = METER_OVERSAMPLING * METER_TRUE_PEAK_TAPS;
+	double center = (length - 1) / 2.0;
+	double cutoff = METER_TRUE_PEAK_PASSBAND * 0.5 / METER_OVERSAMPLING;
+	coefficients = allocAligned(length);
+	for (int p = 0; p < METER_OVERSAMPLING; ++p) {
+		double sum = 0.0;
+		double h[METER_TRUE_PEAK_TAPS];
+		for (int k = 0; k < METER_TRUE_PEAK_TAPS; ++k) {
+			int i = k * METER_OVERSAMPLING + p;
+			double x = 2.0 * cutoff * (i - center);
+			double sinc = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+			double window = 0.42 - 0.5 * cos(2.0 * M_PI * i / (length - 1)) + 0.08 * cos(4.0 * M_PI * i / (length - 1));
+			h[k] = sinc * window;
+			sum += h[k];
+		}
+		// Every phase passes dc with unity gain
+		for (int k = 0; k < METER_TRUE_PEAK_TAPS; ++k) {
+			coefficients[k * METER_OVERSAMPLING + p] = (float)(h[k] / sum);
+		}
+	}
+	history = new float*[_channels];
+	for (int c = 0; c < _channels; ++c) {
+		history[c] = allocAligned(METER_TRUE_PEAK_TAPS - 1 + blockFrames);
+	}
+
+	kWeighting(sampleRate, shelf, highpass);
+	states = new double[_channels * 4];
+	energy = new double[_channels];
+	stepFrames = sampleRate * METER_LOUDNESS_STEP / 1000;
+	if (stepFrames < 1) stepFrames = 1;
+
+	reset();
+}
+
+Sound::Meter::~Meter() {
+	delete[] _minimum;
+	delete[] _maximum;
+	delete[] sumOfSquares;
+	delete[] truePeaks;
+	free(coefficients);
+	for (int c = 0; c < _channels; ++c) {
+		free(history[c]);
+	}
+	delete[] history;
+	delete[] states;
+	delete[] energy;
+}
+
+void Sound::Meter::restart() {
+	_frames = 0;
+	for (int c = 0; c < _channels; ++c) {
+		_minimum[c] = 1.0f;
+		_maximum[c] = -1.0f;
+		sumOfSquares[c] = 0.0;
+		truePeaks[c] = 0.0f;
+	}
+}
+
+void Sound::Meter::reset() {
+	restart();
+	for (int c = 0; c < _channels; ++c) {
+		memset(history[c], 0, sizeof(float) * (METER_TRUE_PEAK_TAPS - 1));
+		energy[c] = 0.0;
+	}
+	memset(states, 0, sizeof(double) * _channels * 4);
+	stepFilled = 0;
+	stepCount = 0;
+	stepIdx = 0;
+}
+
+int Sound::Meter::channels() const {
+	return _channels;
+}
+
+int64_t Sound::Meter::frames() const {
+	return _frames;
+}
+
+float Sound::Meter::minimum(int c) const {
+	return _minimum[c];
+}
+
+float Sound::Meter::maximum(int c) const {
+	return _maximum[c];
+}
+
+float Sound::Meter::peak(int c) const {
+	return -_minimum[c] > _maximum[c] ? -_minimum[c] : _maximum[c];
+}
+
+float Sound::Meter::rms(int c) const {
+	return _frames > 0 ? (float)sqrt(sumOfSquares[c] / _frames) : 0.0f;
+}
+
+float Sound::Meter::truePeak(int c) const {
+	// The interpolation can only miss a sample peak through the passband ripple
+	float samplePeak = peak(c);
+	return truePeaks[c] > samplePeak ? truePeaks[c] : samplePeak;
+}
+
+double Sound::Meter::momentary() const {
+	int count = stepCount < METER_MOMENTARY_STEPS ? stepCount : METER_MOMENTARY_STEPS;
+	double sum = 0.0;
+	for (int i = 0; i < count; ++i) {
+		sum += steps[(stepIdx - 1 - i + METER_SHORT_TERM_STEPS) % METER_SHORT_TERM_STEPS];
+	}
+	return count > 0 && sum > 0.0 ? -0.691 + 10.0 * log10(sum / count) : -INFINITY;
+}
+
+double Sound::Meter::shortTerm() const {
+	double sum = 0.0;
+	for (int i = 0; i < stepCount; ++i) {
+		sum += steps[i];
+	}
+	return stepCount > 0 && sum > 0.0 ? -0.691 + 10.0 * log10(sum / stepCount) : -INFINITY;
+}
+
+void Sound::Meter::process(const AudioBlock& block) {
+	int frames = block.frames();
+	int channels = block.channels() < _channels ? block.channels() : _channels;
+
+	for (int c = 0; c < channels; ++c) {
+		const float* samples = block.channel(c);
+		float lo = _minimum[c];
+		float hi = _maximum[c];
+		double squares = 0.0;
+		int i = 0;
+#if defined(__SSE__)
+		__m128 vlo = _mm_set1_ps(lo);
+		__m128 vhi = _mm_set1_ps(hi);
+		__m128 vsq0 = _mm_setzero_ps();
+		__m128 vsq1 = _mm_setzero_ps();
+		for (; i + 8 <= frames; i += 8) {
+			__m128 a = _mm_load_ps(samples + i);
+			__m128 b = _mm_load_ps(samples + i + 4);
+			vlo = _mm_min_ps(vlo, _mm_min_ps(a, b));
+			vhi = _mm_max_ps(vhi, _mm_max_ps(a, b));
+			vsq0 = _mm_add_ps(vsq0, _mm_mul_ps(a, a));
+			vsq1 = _mm_add_ps(vsq1, _mm_mul_ps(b, b));
+		}
+		float l[4], h[4], s[4];
+		_mm_storeu_ps(l, vlo);
+		_mm_storeu_ps(h, vhi);
+		_mm_storeu_ps(s, _mm_add_ps(vsq0, vsq1));
+		for (int k = 0; k < 4; ++k) {
+			if (l[k] < lo) lo = l[k];
+			if (h[k] > hi) hi = h[k];
+			squares += s[k];
+		}
+#endif
+		for (; i < frames; ++i) {
+			float sample = samples[i];
+			if (sample < lo) lo = sample;
+			if (sample > hi) hi = sample;
+			squares += sample * sample;
+		}
+		_minimum[c] = lo;
+		_maximum[c] = hi;
+		sumOfSquares[c] += squares;
+
+		_measureTruePeak(c, samples, frames);
+	}
+
+	_loudness(block);
+	_frames += frames;
+}
+
+void Sound::Meter::_measureTruePeak(int c, const float* samples, int frames) {
+	// Longer blocks than announced are measured in parts
+	while (frames > blockFrames) {
+		_measureTruePeak(c, samples, blockFrames);
+		samples += blockFrames;
+		frames -= blockFrames;
+	}
+
+	int taps = METER_TRUE_PEAK_TAPS;
+	float* x = history[c];
+	memcpy(x + taps - 1, samples, sizeof(float) * frames);
+
+	float peak = truePeaks[c];
+	int n = 0;
+#if defined(__SSE__)
+	// Every input sample produces all phases at once: one broadcast multiply add per tap
+	__m128 vpeak = _mm_set1_ps(peak);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (; n < frames; ++n) {
+		const float* newest = x + taps - 1 + n;
+		__m128 acc = _mm_mul_ps(_mm_set1_ps(newest[0]), _mm_load_ps(coefficients));
+		for (int k = 1; k < taps; ++k) {
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(newest[-k]), _mm_load_ps(coefficients + k * METER_OVERSAMPLING)));
+		}
+		vpeak = _mm_max_ps(vpeak, _mm_andnot_ps(signMask, acc));
+	}
+	float p[4];
+	_mm_storeu_ps(p, vpeak);
+	for (int k = 0; k < 4; ++k) {
+		if (p[k] > peak) peak = p[k];
+	}
+#endif
+	for (; n < frames; ++n) {
+		const float* newest = x + taps - 1 + n;
+		for (int phase = 0; phase < METER_OVERSAMPLING; ++phase) {
+			float acc = 0.0f;
+			for (int k = 0; k < taps; ++k) {
+				acc += newest[-k] * coefficients[k * METER_OVERSAMPLING + phase];
+			}
+			if (fabsf(acc) > peak) peak = fabsf(acc);
+		}
+	}
+	truePeaks[c] = peak;
+
+	// Keep the newest samples for the next block
+	memmove(x, x + frames, sizeof(float) * (taps - 1));
+}
+
+void Sound::Meter::_loudness(const AudioBlock& block) {
+	int frames = block.frames();
+	int channels = block.channels() < _channels ? block.channels() : _channels;
+
+	int offset = 0;
+	while (offset < frames) {
+		// Filter up to the end of the current gating block
+		int count = stepFrames - stepFilled;
+		if (count > frames - offset) count = frames - offset;
+
+		for (int c = 0; c < channels; ++c) {
+			const float* samples = block.channel(c) + offset;
+			double* state = states + c * 4;
+			double s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+			double sum = 0.0;
+			for (int i = 0; i < count; ++i) {
+				// Both stages in transposed direct form 2
+				double x = samples[i];
+				double y = shelf[0] * x + s0;
+				s0 = shelf[1] * x - shelf[3] * y + s1;
+				s1 = shelf[2] * x - shelf[4] * y;
+				double z = highpass[0] * y + s2;
+				s2 = highpass[1] * y - highpass[3] * z + s3;
+				s3 = highpass[2] * y - highpass[4] * z;
+				sum += z * z;
+			}
+			state[0] = s0; state[1] = s1; state[2] = s2; state[3] = s3;
+			energy[c] += sum;
+		}
+
+		stepFilled += count;
+		offset += count;
+		if (stepFilled == stepFrames) {
+			double meanSquare = 0.0;
+			for (int c = 0; c < _channels; ++c) {
+				meanSquare += channelWeight(c, _channels) * energy[c] / stepFrames;
+				energy[c] = 0.0;
+			}
+			steps[stepIdx] = meanSquare;
+			stepIdx = (stepIdx + 1) % METER_SHORT_TERM_STEPS;
+			if (stepCount < METER_SHORT_TERM_STEPS) ++stepCount;
+			stepFilled = 0;
+		}
+	}
+}
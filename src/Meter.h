@@ -0,0 +1,111 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_METER_H
+#define SOUND_METER_H
+
+#include <stdint.h>
+
+#include "AudioBlock.h"
+
+// The oversampling factor of the true peak detection
+#define METER_OVERSAMPLING 4
+// The taps of every phase of the oversampling filter
+#define METER_TRUE_PEAK_TAPS 12
+// The length of the loudness gating blocks in ms
+#define METER_LOUDNESS_STEP 100
+// The momentary (400 ms) and short term (3 s) loudness windows in gating blocks
+#define METER_MOMENTARY_STEPS 4
+#define METER_SHORT_TERM_STEPS 30
+
+namespace Sound {
+
+	/**
+	 * Measures the levels of planar blocks.
+	 *
+	 * Per channel sample peaks, rms and the 4x oversampled true peak are aggregated
+	 * until the next restart(), so a reading covers any number of blocks. The EBU R128
+	 * momentary and short term loudness is measured over all channels with k-weighting
+	 * and sliding windows that advance in 100 ms steps independent of the readings.
+	 */
+	class Meter {
+	public:
+		/**
+		 * @param sampleRate  The sample rate of the blocks.
+		 * @param channels    The number of channels.
+		 * @param blockFrames The usual number of frames per block.
+		 */
+		Meter(int sampleRate, int channels, int blockFrames);
+		~Meter();
+
+		/** Measures a block. */
+		void process(const AudioBlock& block);
+
+		/** Starts a new reading (the loudness windows continue). */
+		void restart();
+
+		/** Forgets everything including the loudness history. */
+		void reset();
+
+		int channels() const;
+
+		/** The number of frames of the current reading. */
+		int64_t frames() const;
+
+		/** The smallest sample of a channel (at most 1.0). */
+		float minimum(int c) const;
+
+		/** The largest sample of a channel (at least -1.0). */
+		float maximum(int c) const;
+
+		/** The largest absolute sample of a channel. */
+		float peak(int c) const;
+
+		/** The root mean square of a channel. */
+		float rms(int c) const;
+
+		/** The largest absolute value of the 4x oversampled signal of a channel. */
+		float truePeak(int c) const;
+
+		/** The loudness of the last 400 ms in LUFS (-Infinity for silence). */
+		double momentary() const;
+
+		/** The loudness of the last 3 s in LUFS (-Infinity for silence). */
+		double shortTerm() const;
+	private:
+		void _measureTruePeak(int c, const float* samples, int frames);
+		void _loudness(const AudioBlock& block);
+
+		int sampleRate;
+		int _channels;
+		int blockFrames;
+		int64_t _frames;
+
+		float* _minimum;
+		float* _maximum;
+		double* sumOfSquares;
+		float* truePeaks;
+
+		/** The polyphase oversampling filter as [tap][phase] (aligned). */
+		float* coefficients;
+		/** Per channel the last input samples followed by room for one block. */
+		float** history;
+
+		/** The k-weighting (high shelf and highpass) as b0 b1 b2 a1 a2. */
+		double shelf[5];
+		double highpass[5];
+		/** The filter states of every channel (two per biquad). */
+		double* states;
+		/** The k-weighted energy of every channel in the current gating block. */
+		double* energy;
+		int stepFrames;
+		int stepFilled;
+		/** The channel weighted mean square of the last gating blocks (ring). */
+		double steps[METER_SHORT_TERM_STEPS];
+		int stepCount;
+		int stepIdx;
+	};
+}
+
+#endif
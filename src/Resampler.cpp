@@ -0,0 +1,353 @@
+#include "Resampler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RESAMPLER_AVX2 1
+#endif
+
+// The number of taps per phase when the rate is increased (about 86 dB stopband attenuation)
+#define RESAMPLER_TAPS 64
+#define RESAMPLER_KAISER_BETA 8.6
+// The cutoff relative to the lower nyquist frequency, so the transition band ends at nyquist
+#define RESAMPLER_ROLLOFF 0.915
+// Odd ratios round the position down to one of this many phases
+#define RESAMPLER_MAX_PHASES 1024
+// The number of input frames that are deinterleaved at once
+#define RESAMPLER_CHUNK 4096
+// The number of outputs whose positions are computed before the kernel runs
+#define RESAMPLER_BATCH 64
+#define RESAMPLER_ALIGNMENT 32
+
+using namespace std;
+
+static int gcd(int a, int b) {
+	while (b != 0) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/**
+ * The zeroth order modified bessel function of the first kind (for the kaiser window).
+ */
+static double besselI0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+	double halfX = x / 2.0;
+	for (int k = 1; k < 50; ++k) {
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+static float* allocAligned(int64_t count) {
+	void* memory = NULL;
+	if (posix_memalign(&memory, RESAMPLER_ALIGNMENT, sizeof(float) * (count > 0 ? count : 1)) != 0) {
+		return NULL;
+	}
+	memset(memory, 0, sizeof(float) * (count > 0 ? count : 1));
+	return (float*)memory;
+}
+
+/**
+ * Computes a batch of outputs of one channel. Output i is the dot product of the
+ * history at starts[i] with the phase rows[i]; the results are written with a stride.
+ */
+typedef void (*RenderFunction)(const float* x, const int* starts, const float* const* rows, int count, int taps, float* out, int stride);
+
+static void renderScalar(const float* x, const int* starts, const float* const* rows, int count, int taps, float* out, int stride) {
+	for (int i = 0; i < count; ++i) {
+		const float* xi = x + starts[i];
+		const float* h = rows[i];
+		float sum = 0.0f;
+		for (int k = 0; k < taps; ++k) sum += xi[k] * h[k];
+		out[i * stride] = sum;
+	}
+}
+
+#if defined(__SSE__)
+static void renderSse(const float* x, const int* starts, const float* const* rows, int count, int taps, float* out, int stride) {
+	for (int i = 0; i < count; ++i) {
+		const float* xi = x + starts[i];
+		const float* h = rows[i];
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		// The taps are a multiple of 8 and the phases are aligned
+		for (int k = 0; k < taps; k += 8) {
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(xi + k), _mm_load_ps(h + k)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(xi + k + 4), _mm_load_ps(h + k + 4)));
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+		out[i * stride] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+}
+#endif
+
+#if defined(RESAMPLER_AVX2)
+/**
+ * Computes four outputs at a time, so their horizontal sums share the shuffles.
+ */
+__attribute__((target("avx2,fma")))
+static void renderAvx2(const float* x, const int* starts, const float* const* rows, int count, int taps, float* out, int stride) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const float* x0 = x + starts[i];
+		const float* x1 = x + starts[i + 1];
+		const float* x2 = x + starts[i + 2];
+		const float* x3 = x + starts[i + 3];
+		__m256 sum0 = _mm256_setzero_ps();
+		__m256 sum1 = _mm256_setzero_ps();
+		__m256 sum2 = _mm256_setzero_ps();
+		__m256 sum3 = _mm256_setzero_ps();
+		for (int k = 0; k < taps; k += 8) {
+			sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + k), _mm256_load_ps(rows[i] + k), sum0);
+			sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + k), _mm256_load_ps(rows[i + 1] + k), sum1);
+			sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + k), _mm256_load_ps(rows[i + 2] + k), sum2);
+			sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + k), _mm256_load_ps(rows[i + 3] + k), sum3);
+		}
+		// Reduce the four accumulators into one vector of four sums
+		__m256 s01 = _mm256_hadd_ps(sum0, sum1);
+		__m256 s23 = _mm256_hadd_ps(sum2, sum3);
+		__m256 s = _mm256_hadd_ps(s01, s23);
+		__m128 sums = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+		float lanes[4];
+		_mm_storeu_ps(lanes, sums);
+		out[i * stride] = lanes[0];
+		out[(i + 1) * stride] = lanes[1];
+		out[(i + 2) * stride] = lanes[2];
+		out[(i + 3) * stride] = lanes[3];
+	}
+	for (; i < count; ++i) {
+		const float* xi = x + starts[i];
+		__m256 sum = _mm256_setzero_ps();
+		for (int k = 0; k < taps; k += 8) {
+			sum = _mm256_fmadd_ps(_mm256_loadu_ps(xi + k), _mm256_load_ps(rows[i] + k), sum);
+		}
+		__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+		half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+		out[i * stride] = _mm_cvtss_f32(half);
+	}
+}
+#endif
+
+/**
+ * Picks the widest kernel the cpu supports.
+ */
+static RenderFunction selectRender() {
+#if defined(RESAMPLER_AVX2)
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return renderAvx2;
+#endif
+#if defined(__SSE__)
+	return renderSse;
+#else
+	return renderScalar;
+#endif
+}
+
+static const RenderFunction render = selectRender();
+
+Sound::ResamplerBank::ResamplerBank(int up, int down): L(up), M(down) {
+	// Lowering the rate needs a lower cutoff and more taps for the same transition width
+	double ratio = (double)L / (double)M;
+	double stretch = ratio < 1.0 ? 1.0 / ratio : 1.0;
+	_taps = (int)ceil(RESAMPLER_TAPS * stretch / 8.0) * 8;
+	phases = L < RESAMPLER_MAX_PHASES ? L : RESAMPLER_MAX_PHASES;
+	coefficients = allocAligned((int64_t)phases * _taps);
+
+	// The cutoff in cycles per input sample
+	double cutoff = 0.5 * RESAMPLER_ROLLOFF / stretch;
+	double center = _taps / 2.0;
+	double i0Beta = besselI0(RESAMPLER_KAISER_BETA);
+
+	// The coefficient of tap k in phase p sits at k + p / phases input samples from the start
+	double sum = 0.0;
+	for (int p = 0; p < phases; ++p) {
+		float* row = coefficients + (int64_t)p * _taps;
+		for (int k = 0; k < _taps; ++k) {
+			double t = k + (double)p / phases - center;
+			double x = t / center;
+			double window = fabs(x) < 1.0 ? besselI0(RESAMPLER_KAISER_BETA * sqrt(1.0 - x * x)) / i0Beta : 0.0;
+			double arg = 2.0 * cutoff * t;
+			double sinc = arg == 0.0 ? 1.0 : sin(M_PI * arg) / (M_PI * arg);
+			double h = 2.0 * cutoff * sinc * window;
+			// Store the phase reversed, so it lines up with the history from old to new
+			row[_taps - 1 - k] = (float)h;
+			sum += h;
+		}
+	}
+
+	// Every phase should pass DC with unity gain
+	double gain = phases / sum;
+	for (int64_t i = 0; i < (int64_t)phases * _taps; ++i) {
+		coefficients[i] = (float)(coefficients[i] * gain);
+	}
+}
+
+Sound::ResamplerBank::~ResamplerBank() {
+	free(coefficients);
+}
+
+const Sound::ResamplerBank* Sound::ResamplerBank::shared(int inRate, int outRate) {
+	static std::mutex mutex;
+	static std::map<std::pair<int, int>, ResamplerBank*> cache;
+
+	int divisor = gcd(outRate, inRate);
+	std::pair<int, int> key(outRate / divisor, inRate / divisor);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<std::pair<int, int>, ResamplerBank*>::iterator it = cache.find(key);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	ResamplerBank* bank = new ResamplerBank(key.first, key.second);
+	cache[key] = bank;
+	return bank;
+}
+
+int Sound::ResamplerBank::up() const {
+	return L;
+}
+
+int Sound::ResamplerBank::down() const {
+	return M;
+}
+
+int Sound::ResamplerBank::taps() const {
+	return _taps;
+}
+
+const float* Sound::ResamplerBank::phase(int64_t frac) const {
+	int p = phases == L ? (int)frac : (int)(frac * phases / L);
+	return coefficients + (int64_t)p * _taps;
+}
+
+Sound::Resampler::Resampler(int inRate, int outRate, int channels): channels(channels) {
+	bank = ResamplerBank::shared(inRate, outRate);
+	T = bank->taps();
+	history = new float*[channels];
+	// After a render up to T - 1 frames stay in the history, flush() appends T frames of silence to them
+	for (int c = 0; c < channels; ++c) {
+		history[c] = allocAligned(2 * T + RESAMPLER_CHUNK);
+	}
+	reset();
+}
+
+Sound::Resampler::~Resampler() {
+	for (int c = 0; c < channels; ++c) {
+		free(history[c]);
+	}
+	delete[] history;
+}
+
+int64_t Sound::Resampler::maxOutput(int64_t frames) const {
+	return (frames * bank->up() + bank->down() - 1) / bank->down() + 2;
+}
+
+int Sound::Resampler::taps() const {
+	return T;
+}
+
+void Sound::Resampler::reset() {
+	// The history starts with silence in front of the first sample
+	for (int c = 0; c < channels; ++c) {
+		memset(history[c], 0, sizeof(float) * (2 * T + RESAMPLER_CHUNK));
+	}
+	filled = T - 1;
+	// Center the filter on the first input sample so the output is not delayed
+	pos = (T - 1) + T / 2;
+	frac = 0;
+	framesIn = 0;
+	framesOut = 0;
+}
+
+int64_t Sound::Resampler::process(const float* in, int64_t frames, float* out) {
+	int64_t produced = 0;
+	while (frames > 0) {
+		int n = frames < RESAMPLER_CHUNK ? (int)frames : RESAMPLER_CHUNK;
+		// Deinterleave, so every channel is one contiguous history
+		for (int c = 0; c < channels; ++c) {
+			float* dst = history[c] + filled;
+			for (int i = 0; i < n; ++i) {
+				dst[i] = in[i * channels + c];
+			}
+		}
+		filled += n;
+		framesIn += n;
+		produced += _render(out + produced * channels);
+		in += (int64_t)n * channels;
+		frames -= n;
+	}
+	framesOut += produced;
+	return produced;
+}
+
+int64_t Sound::Resampler::flush(float* out) {
+	// Push silence through the filter until the last input sample reached its center
+	for (int c = 0; c < channels; ++c) {
+		memset(history[c] + filled, 0, sizeof(float) * T);
+	}
+	filled += T;
+	int64_t produced = _render(out);
+
+	// Only return what belongs to the input
+	int64_t expected = (framesIn * bank->up() + bank->down() - 1) / bank->down();
+	if (produced > expected - framesOut) produced = expected - framesOut;
+	if (produced < 0) produced = 0;
+	framesOut += produced;
+	return produced;
+}
+
+int64_t Sound::Resampler::_render(float* out) {
+	const int L = bank->up();
+	const int M = bank->down();
+	int starts[RESAMPLER_BATCH];
+	const float* rows[RESAMPLER_BATCH];
+	int64_t produced = 0;
+
+	while (pos < filled) {
+		// Collect the positions of a batch of outputs, then run the kernel for every channel
+		int count = 0;
+		while (pos < filled && count < RESAMPLER_BATCH) {
+			starts[count] = (int)(pos - T + 1);
+			rows[count] = bank->phase(frac);
+			++count;
+			frac += M;
+			pos += frac / L;
+			frac %= L;
+		}
+		for (int c = 0; c < channels; ++c) {
+			render(history[c], starts, rows, count, T, out + c, channels);
+		}
+		out += (int64_t)count * channels;
+		produced += count;
+	}
+
+	// Keep the samples the next output still needs
+	int64_t shift = pos - (T - 1);
+	if (shift > filled) shift = filled;
+	if (shift > 0) {
+		for (int c = 0; c < channels; ++c) {
+			memmove(history[c], history[c] + shift, sizeof(float) * (filled - shift));
+		}
+		filled -= (int)shift;
+		pos -= shift;
+	}
+	return produced;
+}
@@ -0,0 +1,126 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_RESAMPLER_H
+#define SOUND_RESAMPLER_H
+
+#include <stdint.h>
+
+namespace Sound {
+
+	/**
+	 * The polyphase decomposition of a kaiser windowed sinc lowpass for one
+	 * conversion ratio L/M (output rate / input rate reduced by their gcd).
+	 *
+	 * Every phase is stored reversed and 32 byte aligned, so one output sample
+	 * is a single contiguous dot product with the input history.
+	 */
+	class ResamplerBank {
+	public:
+		/**
+		 * Returns a process wide bank for the ratio. The coefficients are only
+		 * computed the first time a ratio is requested (the bank must not be deleted).
+		 *
+		 * @param  inRate  The input sample rate.
+		 * @param  outRate The output sample rate.
+		 *
+		 * @return         The shared bank.
+		 */
+		static const ResamplerBank* shared(int inRate, int outRate);
+
+		/** The interpolation factor. */
+		int up() const;
+
+		/** The decimation factor. */
+		int down() const;
+
+		/** The number of taps of every phase (a multiple of 8). */
+		int taps() const;
+
+		/**
+		 * Returns the coefficients for the position between two input samples.
+		 *
+		 * @param  frac The position in 1/up() steps (0..up()-1).
+		 */
+		const float* phase(int64_t frac) const;
+	private:
+		ResamplerBank(int up, int down);
+		~ResamplerBank();
+
+		int L;
+		int M;
+		int _taps;
+		/** The number of stored phases (less than L for very odd ratios). */
+		int phases;
+		float* coefficients;
+	};
+
+	/**
+	 * Converts interleaved samples from one sample rate into another.
+	 *
+	 * The resampler is streaming: input can be pushed in blocks of any size and
+	 * the filter history is carried over between them. The output is aligned to
+	 * the input, so the first output sample belongs to the first input sample.
+	 */
+	class Resampler {
+	public:
+		/**
+		 * @param inRate   The sample rate of the input.
+		 * @param outRate  The sample rate of the output.
+		 * @param channels The number of interleaved channels.
+		 */
+		Resampler(int inRate, int outRate, int channels);
+		~Resampler();
+
+		/** The maximum number of frames process() produces for frames input frames. */
+		int64_t maxOutput(int64_t frames) const;
+
+		/**
+		 * Converts a block of input.
+		 *
+		 * @param  in     The interleaved input samples.
+		 * @param  frames The number of input frames.
+		 * @param  out    Receives maxOutput(frames) frames at most.
+		 *
+		 * @return        The number of output frames.
+		 */
+		int64_t process(const float* in, int64_t frames, float* out);
+
+		/**
+		 * Flushes the samples that are still inside the filter at the end of the stream.
+		 *
+		 * @param  out Receives maxOutput(taps) frames at most.
+		 *
+		 * @return     The number of output frames.
+		 */
+		int64_t flush(float* out);
+
+		/** Starts a new stream. */
+		void reset();
+
+		/** The number of taps of the filter (flush() needs room for maxOutput(taps()) frames). */
+		int taps() const;
+	private:
+		/** Produces all outputs the history allows and drops the history that is no longer needed. */
+		int64_t _render(float* out);
+
+		const ResamplerBank* bank;
+		int channels;
+		int T;
+
+		/** The deinterleaved input history of every channel. */
+		float** history;
+		int filled;
+		/** The index of the newest input sample of the next output in the history. */
+		int64_t pos;
+		/** The position between pos and the next input sample in 1/L steps. */
+		int64_t frac;
+
+		/** The stream lengths that tell how many samples flush() still has to produce. */
+		int64_t framesIn;
+		int64_t framesOut;
+	};
+}
+
+#endif
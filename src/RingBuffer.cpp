@@ -0,0 +1,75 @@
+#include "RingBuffer.h"
+
+#include <string.h>
+
+Sound::RingBuffer::RingBuffer(int minCapacity) {
+	unsigned int size = 1;
+	while (size < (unsigned int)minCapacity) size <<= 1;
+	data = new float[size];
+	mask = size - 1;
+	writeIdx.store(0);
+	readIdx.store(0);
+}
+
+Sound::RingBuffer::~RingBuffer() {
+	delete[] data;
+}
+
+int Sound::RingBuffer::capacity() const {
+	return (int)(mask + 1);
+}
+
+int Sound::RingBuffer::readable() const {
+	return (int)(writeIdx.load(std::memory_order_acquire) - readIdx.load(std::memory_order_relaxed));
+}
+
+int Sound::RingBuffer::writable() const {
+	return capacity() - (int)(writeIdx.load(std::memory_order_relaxed) - readIdx.load(std::memory_order_acquire));
+}
+
+int Sound::RingBuffer::write(const float* src, int count) {
+	int free = writable();
+	if (count > free) count = free;
+	if (count <= 0) return 0;
+
+	unsigned int w = writeIdx.load(std::memory_order_relaxed);
+	unsigned int start = w & mask;
+	unsigned int first = (mask + 1) - start;
+	if (first > (unsigned int)count) first = count;
+	memcpy(data + start, src, first * sizeof(float));
+	memcpy(data, src + first, (count - first) * sizeof(float));
+
+	writeIdx.store(w + count, std::memory_order_release);
+	return count;
+}
+
+int Sound::RingBuffer::peek(float* dst, int count) const {
+	int available = readable();
+	if (count > available) count = available;
+	if (count <= 0) return 0;
+
+	unsigned int start = readIdx.load(std::memory_order_relaxed) & mask;
+	unsigned int first = (mask + 1) - start;
+	if (first > (unsigned int)count) first = count;
+	memcpy(dst, data + start, first * sizeof(float));
+	memcpy(dst + first, data, (count - first) * sizeof(float));
+	return count;
+}
+
+void Sound::RingBuffer::skip(int count) {
+	int available = readable();
+	if (count > available) count = available;
+	if (count <= 0) return;
+	readIdx.store(readIdx.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+int Sound::RingBuffer::read(float* dst, int count) {
+	count = peek(dst, count);
+	skip(count);
+	return count;
+}
+
+void Sound::RingBuffer::clear() {
+	writeIdx.store(0);
+	readIdx.store(0);
+}
@@ -0,0 +1,66 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_RING_BUFFER_H
+#define SOUND_RING_BUFFER_H
+
+#include <atomic>
+
+namespace Sound {
+
+	/**
+	 * A single producer / single consumer ring of samples.
+	 *
+	 * The producer and the consumer may live on different threads and neither side
+	 * ever blocks or allocates. The consumer can peek at more samples than it
+	 * consumes, which is what overlapping analysis windows need.
+	 */
+	class RingBuffer {
+	public:
+		/**
+		 * @param minCapacity The capacity is rounded up to the next power of two.
+		 */
+		explicit RingBuffer(int minCapacity);
+		~RingBuffer();
+
+		/** The number of samples the ring can hold. */
+		int capacity() const;
+
+		/** The number of samples the consumer can read. */
+		int readable() const;
+
+		/** The number of samples the producer can write. */
+		int writable() const;
+
+		/**
+		 * Appends samples (producer side).
+		 *
+		 * @return The number of samples that fitted into the ring.
+		 */
+		int write(const float* src, int count);
+
+		/**
+		 * Copies samples without consuming them (consumer side).
+		 *
+		 * @return The number of samples that were copied.
+		 */
+		int peek(float* dst, int count) const;
+
+		/** Consumes samples (consumer side). */
+		void skip(int count);
+
+		/** Copies and consumes samples (consumer side). */
+		int read(float* dst, int count);
+
+		/** Drops everything. Only call this while neither side is active. */
+		void clear();
+	private:
+		float* data;
+		unsigned int mask;
+		std::atomic<unsigned int> writeIdx;
+		std::atomic<unsigned int> readIdx;
+	};
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "SampleArena.h"
+
+#include <string.h>
+
+Sound::SampleArena::SampleArena(int segmentShift): shift(segmentShift) {
+	segmentSize = (int64_t)1 << shift;
+	mask = segmentSize - 1;
+	_size = 0;
+}
+
+Sound::SampleArena::~SampleArena() {
+	for (size_t i = 0; i < segments.size(); ++i) {
+		delete[] segments[i];
+	}
+}
+
+int64_t Sound::SampleArena::size() const {
+	return _size;
+}
+
+float Sound::SampleArena::sampleAt(int64_t idx) const {
+	return at(idx);
+}
+
+void Sound::SampleArena::append(const float* samples, int64_t count) {
+	while (count > 0) {
+		int64_t available;
+		float* dst = tail(&available);
+		int64_t n = count < available ? count : available;
+		memcpy(dst, samples, n * sizeof(float));
+		commit(n);
+		samples += n;
+		count -= n;
+	}
+}
+
+float* Sound::SampleArena::tail(int64_t* available) {
+	size_t segmentIdx = (size_t)(_size >> shift);
+	// Only grow when the last segment is full
+	if (segmentIdx >= segments.size()) {
+		segments.push_back(new float[segmentSize]);
+	}
+	int64_t offset = _size & mask;
+	*available = segmentSize - offset;
+	return segments[segmentIdx] + offset;
+}
+
+void Sound::SampleArena::commit(int64_t count) {
+	_size += count;
+}
+
+int64_t Sound::SampleArena::read(int64_t offset, float* dst, int64_t count) const {
+	if (offset < 0 || offset >= _size) return 0;
+	if (offset + count > _size) count = _size - offset;
+
+	int64_t copied = 0;
+	while (copied < count) {
+		int64_t pos = offset + copied;
+		int64_t inSegment = segmentSize - (pos & mask);
+		int64_t n = count - copied < inSegment ? count - copied : inSegment;
+		memcpy(dst + copied, segments[(size_t)(pos >> shift)] + (pos & mask), n * sizeof(float));
+		copied += n;
+	}
+	return copied;
+}
+
+int Sound::SampleArena::segmentCount() const {
+	return (int)((_size + segmentSize - 1) >> shift);
+}
+
+const float* Sound::SampleArena::segment(int idx, int64_t* length) const {
+	int64_t start = (int64_t)idx << shift;
+	int64_t remaining = _size - start;
+	*length = remaining < segmentSize ? remaining : segmentSize;
+	return segments[idx];
+}
+
+void Sound::SampleArena::clear() {
+	while (segments.size() > 1) {
+		delete[] segments.back();
+		segments.pop_back();
+	}
+	_size = 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_SAMPLE_ARENA_H
+#define SOUND_SAMPLE_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "SampleSource.h"
+
+// 2^20 floats (4 MB) per segment
+#define SAMPLE_ARENA_SEGMENT_SHIFT 20
+
+namespace Sound {
+
+	/**
+	 * Growable sample storage made of large fixed size segments.
+	 *
+	 * Samples are addressed by their absolute index, which maps to a segment and an
+	 * offset with a shift and a mask. Appending never moves existing samples, so
+	 * pointers into a segment stay valid until clear() is called.
+	 */
+	class SampleArena: public SampleSource {
+	public:
+		/**
+		 * @param segmentShift Every segment holds 2^segmentShift samples.
+		 */
+		explicit SampleArena(int segmentShift = SAMPLE_ARENA_SEGMENT_SHIFT);
+		~SampleArena();
+
+		/** The number of stored samples. */
+		int64_t size() const;
+
+		/** Returns the sample at an absolute index (the index must be < size()). */
+		inline float at(int64_t idx) const {
+			return segments[(size_t)(idx >> shift)][idx & mask];
+		}
+		float sampleAt(int64_t idx) const;
+
+		/** Appends samples. */
+		void append(const float* samples, int64_t count);
+
+		/**
+		 * Returns the free space at the end of the last segment, so that samples can be
+		 * written in place (e.g. directly from a file). Call commit() afterwards.
+		 *
+		 * @param available Receives the number of samples that can be written.
+		 *
+		 * @return          The position of the next sample.
+		 */
+		float* tail(int64_t* available);
+
+		/** Marks samples that were written through tail() as stored. */
+		void commit(int64_t count);
+
+		/**
+		 * Copies samples starting at an absolute index.
+		 *
+		 * @return The number of samples that were copied.
+		 */
+		int64_t read(int64_t offset, float* dst, int64_t count) const;
+
+		/** The number of segments that hold samples. */
+		int segmentCount() const;
+
+		/**
+		 * Returns a segment for streaming the stored samples without copying them.
+		 *
+		 * @param idx    The segment index.
+		 * @param length Receives the number of samples in the segment.
+		 */
+		const float* segment(int idx, int64_t* length) const;
+
+		/** Removes all samples. The first segment is kept for the next recording. */
+		void clear();
+	private:
+		int shift;
+		int64_t segmentSize;
+		int64_t mask;
+		int64_t _size;
+		std::vector<float*> segments;
+	};
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "SampleFormat.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define SAMPLE_FORMAT_SSSE3 1
+#endif
+
+using namespace std;
+
+// Scaling between the integer formats and floats (all formats are little endian like the hosts we run on)
+#define INT16_SCALE 32768.0f
+#define INT24_SCALE 8388608.0f
+#define INT32_SCALE 2147483648.0f
+// The largest float that still converts to a positive int32
+#define INT32_MAX_FLOAT 2147483520.0f
+
+int Sound::bytesPerSample(SampleFormat format) {
+	switch (format) {
+		case SampleFormatInt16: return 2;
+		case SampleFormatInt24: return 3;
+		case SampleFormatInt32: return 4;
+		case SampleFormatFloat32: return 4;
+		case SampleFormatFloat64: return 8;
+	}
+	return 4;
+}
+
+const char* Sound::sampleFormatName(SampleFormat format) {
+	switch (format) {
+		case SampleFormatInt16: return "pcm16";
+		case SampleFormatInt24: return "pcm24";
+		case SampleFormatInt32: return "pcm32";
+		case SampleFormatFloat32: return "float32";
+		case SampleFormatFloat64: return "float64";
+	}
+	return "unknown";
+}
+
+bool Sound::parseSampleFormat(string name, SampleFormat* format) {
+	if 		(name == "pcm16")	*format = SampleFormatInt16;
+	else if (name == "pcm24")	*format = SampleFormatInt24;
+	else if (name == "pcm32")	*format = SampleFormatInt32;
+	else if (name == "float32")	*format = SampleFormatFloat32;
+	else if (name == "float64")	*format = SampleFormatFloat64;
+	else return false;
+	return true;
+}
+
+#if defined(SAMPLE_FORMAT_SSSE3)
+/**
+ * Expands four packed 24bit samples per iteration with a byte shuffle.
+ */
+__attribute__((target("ssse3")))
+static int64_t decodeInt24Ssse3(const uint8_t* src, float* dst, int64_t count) {
+	// Move the three bytes of every sample into the upper bytes of a 32bit lane
+	const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	const __m128 scale = _mm_set1_ps(1.0f / INT32_SCALE);
+	int64_t i = 0;
+	// The 16 byte loads read 4 bytes past the 4 samples, so stop early enough
+	for (; i + 6 <= count; i += 4) {
+		__m128i packed = _mm_loadu_si128((const __m128i*)(src + i * 3));
+		__m128i expanded = _mm_shuffle_epi8(packed, shuffle);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(expanded), scale));
+	}
+	return i;
+}
+
+static bool hasSsse3() {
+	static bool supported = __builtin_cpu_supports("ssse3");
+	return supported;
+}
+#endif
+
+void Sound::decodeSamples(const void* src, SampleFormat format, float* dst, int64_t count) {
+	int64_t i = 0;
+	switch (format) {
+		case SampleFormatInt16: {
+			const int16_t* in = (const int16_t*)src;
+#if defined(__SSE2__)
+			const __m128 scale = _mm_set1_ps(1.0f / INT16_SCALE);
+			for (; i + 8 <= count; i += 8) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+				// Sign extend to 32bit by moving into the upper half and shifting back
+				__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+				__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+				_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+				_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+			}
+#endif
+			for (; i < count; ++i) dst[i] = in[i] / INT16_SCALE;
+			break;
+		}
+		case SampleFormatInt24: {
+			const uint8_t* in = (const uint8_t*)src;
+#if defined(SAMPLE_FORMAT_SSSE3)
+			if (hasSsse3()) i = decodeInt24Ssse3(in, dst, count);
+#endif
+			for (; i < count; ++i) {
+				const uint8_t* b = in + i * 3;
+				int32_t v = (int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24);
+				dst[i] = (v >> 8) / INT24_SCALE;
+			}
+			break;
+		}
+		case SampleFormatInt32: {
+			const int32_t* in = (const int32_t*)src;
+#if defined(__SSE2__)
+			const __m128 scale = _mm_set1_ps(1.0f / INT32_SCALE);
+			for (; i + 4 <= count; i += 4) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+				_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+			}
+#endif
+			for (; i < count; ++i) dst[i] = (float)in[i] / INT32_SCALE;
+			break;
+		}
+		case SampleFormatFloat32:
+			memcpy(dst, src, count * sizeof(float));
+			break;
+		case SampleFormatFloat64: {
+			const double* in = (const double*)src;
+#if defined(__SSE2__)
+			for (; i + 4 <= count; i += 4) {
+				__m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+				__m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+				_mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+			}
+#endif
+			for (; i < count; ++i) dst[i] = (float)in[i];
+			break;
+		}
+	}
+}
+
+void Sound::encodeSamples(const float* src, SampleFormat format, void* dst, int64_t count) {
+	int64_t i = 0;
+	switch (format) {
+		case SampleFormatInt16: {
+			int16_t* out = (int16_t*)dst;
+#if defined(__SSE2__)
+			const __m128 scale = _mm_set1_ps(INT16_SCALE);
+			for (; i + 8 <= count; i += 8) {
+				// packs saturates, so the clipping comes for free
+				__m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+				__m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+				_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+			}
+#endif
+			for (; i < count; ++i) {
+				float v = src[i] * INT16_SCALE;
+				v = v > 32767.0f ? 32767.0f : v < -32768.0f ? -32768.0f : v;
+				out[i] = (int16_t)lrintf(v);
+			}
+			break;
+		}
+		case SampleFormatInt24: {
+			uint8_t* out = (uint8_t*)dst;
+			for (; i < count; ++i) {
+				float v = src[i] * INT24_SCALE;
+				v = v > 8388607.0f ? 8388607.0f : v < -8388608.0f ? -8388608.0f : v;
+				int32_t s = (int32_t)lrintf(v);
+				out[i * 3] = (uint8_t)s;
+				out[i * 3 + 1] = (uint8_t)(s >> 8);
+				out[i * 3 + 2] = (uint8_t)(s >> 16);
+			}
+			break;
+		}
+		case SampleFormatInt32: {
+			int32_t* out = (int32_t*)dst;
+#if defined(__SSE2__)
+			const __m128 scale = _mm_set1_ps(INT32_SCALE);
+			const __m128 max = _mm_set1_ps(INT32_MAX_FLOAT);
+			const __m128 min = _mm_set1_ps(-INT32_SCALE);
+			for (; i + 4 <= count; i += 4) {
+				__m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+				v = _mm_max_ps(_mm_min_ps(v, max), min);
+				_mm_storeu_si128((__m128i*)(out + i), _mm_cvtps_epi32(v));
+			}
+#endif
+			for (; i < count; ++i) {
+				float v = src[i] * INT32_SCALE;
+				v = v > INT32_MAX_FLOAT ? INT32_MAX_FLOAT : v < -INT32_SCALE ? -INT32_SCALE : v;
+				out[i] = (int32_t)lrintf(v);
+			}
+			break;
+		}
+		case SampleFormatFloat32:
+			memcpy(dst, src, count * sizeof(float));
+			break;
+		case SampleFormatFloat64: {
+			double* out = (double*)dst;
+#if defined(__SSE2__)
+			for (; i + 4 <= count; i += 4) {
+				__m128 v = _mm_loadu_ps(src + i);
+				_mm_storeu_pd(out + i, _mm_cvtps_pd(v));
+				_mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+			}
+#endif
+			for (; i < count; ++i) out[i] = src[i];
+			break;
+		}
+	}
+}
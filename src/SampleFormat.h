@@ -0,0 +1,58 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_SAMPLE_FORMAT_H
+#define SOUND_SAMPLE_FORMAT_H
+
+#include <stdint.h>
+#include <string>
+
+namespace Sound {
+
+	/**
+	 * The sample encodings a wave file can use.
+	 */
+	enum SampleFormat {
+		SampleFormatInt16,
+		SampleFormatInt24,
+		SampleFormatInt32,
+		SampleFormatFloat32,
+		SampleFormatFloat64
+	};
+
+	/** The number of bytes one sample occupies. */
+	int bytesPerSample(SampleFormat format);
+
+	/** The name used in the js api (pcm16, pcm24, pcm32, float32 or float64). */
+	const char* sampleFormatName(SampleFormat format);
+
+	/**
+	 * Parses a format name of the js api.
+	 *
+	 * @return false if the name is unknown.
+	 */
+	bool parseSampleFormat(std::string name, SampleFormat* format);
+
+	/**
+	 * Converts little endian samples of any format to floats between -1..1.
+	 *
+	 * @param src    The encoded samples.
+	 * @param format The encoding of src.
+	 * @param dst    Receives count floats.
+	 * @param count  The number of samples.
+	 */
+	void decodeSamples(const void* src, SampleFormat format, float* dst, int64_t count);
+
+	/**
+	 * Converts floats to little endian samples of any format (integer formats are clipped).
+	 *
+	 * @param src    The floats.
+	 * @param format The encoding of dst.
+	 * @param dst    Receives count * bytesPerSample(format) bytes.
+	 * @param count  The number of samples.
+	 */
+	void encodeSamples(const float* src, SampleFormat format, void* dst, int64_t count);
+}
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_SAMPLE_SOURCE_H
+#define SOUND_SAMPLE_SOURCE_H
+
+#include <stdint.h>
+
+namespace Sound {
+
+	/**
+	 * Something playback can read samples from (a recording in memory or a file on disk).
+	 */
+	class SampleSource {
+	public:
+		virtual ~SampleSource() {}
+
+		/** The number of samples. */
+		virtual int64_t size() const = 0;
+
+		/** Returns the sample at an absolute index (the index must be < size()). */
+		virtual float sampleAt(int64_t idx) const = 0;
+
+		/**
+		 * Copies samples starting at an absolute index.
+		 *
+		 * @return The number of samples that were copied.
+		 */
+		virtual int64_t read(int64_t offset, float* dst, int64_t count) const = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,844 @@
+#include "Slac.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <uv.h>
+
+// The file starts with "SLAC", the version and the stream layout
+#define SLAC_MAGIC "SLAC"
+#define SLAC_VERSION 1
+#define SLAC_HEADER_SIZE 40
+// Readers refuse larger blocks than this
+#define SLAC_MAX_BLOCK_FRAMES 65536
+
+// The block types
+#define SLAC_BLOCK_VERBATIM 0
+#define SLAC_BLOCK_LPC 1
+
+// Integer blocks are coded as multiples of 2^-23 (24 bit resolution)
+#define SLAC_INT_SCALE 8388608.0f
+#define SLAC_MAX_ORDER 32
+// The precision of the quantized predictor coefficients
+#define SLAC_COEF_BITS 15
+#define SLAC_MAX_PARTITION_ORDER 8
+// Longer unary runs are escaped and followed by the raw value
+#define SLAC_RICE_ESCAPE 32
+
+// Every thread gets this many blocks per batch
+#define SLAC_BLOCKS_PER_THREAD 8
+
+using namespace std;
+
+static const int orders[] = { 0, 1, 2, 4, 8, 12, 16, 24, 32 };
+
+static inline void putU16(uint8_t* p, uint16_t v) {
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void putU32(uint8_t* p, uint32_t v) {
+	putU16(p, (uint16_t)v);
+	putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline void putU64(uint8_t* p, uint64_t v) {
+	putU32(p, (uint32_t)v);
+	putU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t getU32(const uint8_t* p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t getU64(const uint8_t* p) {
+	return (uint64_t)getU32(p) | (uint64_t)getU32(p + 4) << 32;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t u) {
+	return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+/**
+ * Appends bits msb first.
+ */
+class BitWriter {
+public:
+	explicit BitWriter(vector<uint8_t>* out): out(out), acc(0), bits(0) {}
+
+	void put(uint64_t value, int count) {
+		while (count > 32) {
+			count -= 32;
+			put32((uint32_t)(value >> count), 32);
+		}
+		put32((uint32_t)value, count);
+	}
+
+	void putSigned(int64_t value, int count) {
+		put((uint64_t)value & (count == 64 ? ~0ULL : ((1ULL << count) - 1)), count);
+	}
+
+	void putRice(uint64_t u, int k) {
+		uint64_t q = u >> k;
+		if (q >= SLAC_RICE_ESCAPE) {
+			// Outliers are not worth a long unary run
+			putOnes(SLAC_RICE_ESCAPE);
+			put(u, 64);
+			return;
+		}
+		putOnes((int)q);
+		put(0, 1);
+		if (k > 0) put(u & ((1ULL << k) - 1), k);
+	}
+
+	/** Pads to the next byte. */
+	void flush() {
+		if (bits > 0) {
+			out->push_back((uint8_t)(acc << (8 - bits)));
+			acc = 0;
+			bits = 0;
+		}
+	}
+private:
+	void putOnes(int count) {
+		while (count >= 32) {
+			put32(0xFFFFFFFF, 32);
+			count -= 32;
+		}
+		if (count > 0) put32((1u << count) - 1, count);
+	}
+
+	void put32(uint32_t value, int count) {
+		if (count == 0) return;
+		if (count < 32) value &= (1u << count) - 1;
+		acc = (acc << count) | value;
+		bits += count;
+		while (bits >= 8) {
+			bits -= 8;
+			out->push_back((uint8_t)(acc >> bits));
+		}
+	}
+
+	vector<uint8_t>* out;
+	uint64_t acc;
+	int bits;
+};
+
+/**
+ * Reads bits msb first and remembers if it ran past the end.
+ */
+class BitReader {
+public:
+	BitReader(const uint8_t* data, int64_t size): data(data), size(size), pos(0), acc(0), bits(0), overrun(false) {}
+
+	uint64_t get(int count) {
+		uint64_t value = 0;
+		while (count > 32) {
+			count -= 32;
+			value = (value << 32) | get32(32);
+		}
+		return (value << count) | get32(count);
+	}
+
+	int64_t getSigned(int count) {
+		uint64_t value = get(count);
+		if (count < 64 && (value >> (count - 1)) & 1) value |= ~0ULL << count;
+		return (int64_t)value;
+	}
+
+	uint64_t getRice(int k) {
+		int q = 0;
+		while (q < SLAC_RICE_ESCAPE && get32(1) == 1) ++q;
+		if (q == SLAC_RICE_ESCAPE) return get(64);
+		uint64_t low = k > 0 ? get(k) : 0;
+		return ((uint64_t)q << k) | low;
+	}
+
+	bool failed() const {
+		return overrun;
+	}
+private:
+	uint32_t get32(int count) {
+		if (count == 0) return 0;
+		while (bits < count) {
+			uint8_t byte = 0;
+			if (pos < size) {
+				byte = data[pos++];
+			} else {
+				overrun = true;
+			}
+			acc = (acc << 8) | byte;
+			bits += 8;
+		}
+		bits -= count;
+		return (uint32_t)((acc >> bits) & (count == 32 ? 0xFFFFFFFFULL : ((1ULL << count) - 1)));
+	}
+
+	const uint8_t* data;
+	int64_t size;
+	int64_t pos;
+	uint64_t acc;
+	int bits;
+	bool overrun;
+};
+
+/**
+ * Converts a block to integers if every sample is a multiple of 2^-23 within -1..1.
+ */
+static bool toIntegers(const float* samples, int64_t count, int32_t* ints) {
+	for (int64_t i = 0; i < count; ++i) {
+		float scaled = samples[i] * SLAC_INT_SCALE;
+		if (!(scaled >= -SLAC_INT_SCALE && scaled <= SLAC_INT_SCALE)) return false;
+		int32_t value = (int32_t)scaled;
+		if ((float)value != scaled) return false;
+		ints[i] = value;
+	}
+	return true;
+}
+
+/**
+ * Computes the predictor coefficients of every order up to maxOrder with levinson durbin.
+ *
+ * @param lpc Receives maxOrder * maxOrder coefficients (row o - 1 holds the predictor of order o).
+ */
+static int computeLpc(const int32_t* x, int n, int maxOrder, double* lpc) {
+	// Window the block to reduce the leakage of the autocorrelation
+	vector<double> windowed(n);
+	for (int i = 0; i < n; ++i) {
+		double w = n > 1 ? 0.5 - 0.5 * cos(2.0 * M_PI * i / (n - 1)) : 1.0;
+		windowed[i] = x[i] * w;
+	}
+	double autoc[SLAC_MAX_ORDER + 1];
+	for (int lag = 0; lag <= maxOrder; ++lag) {
+		double sum = 0.0;
+		for (int i = lag; i < n; ++i) sum += windowed[i] * windowed[i - lag];
+		autoc[lag] = sum;
+	}
+	if (autoc[0] == 0.0) return 0;
+
+	double a[SLAC_MAX_ORDER];
+	double error = autoc[0];
+	for (int o = 0; o < maxOrder; ++o) {
+		double r = -autoc[o + 1];
+		for (int j = 0; j < o; ++j) r -= a[j] * autoc[o - j];
+		r /= error;
+
+		a[o] = r;
+		for (int j = 0; j < o / 2; ++j) {
+			double tmp = a[j];
+			a[j] += r * a[o - 1 - j];
+			a[o - 1 - j] += r * tmp;
+		}
+		if (o & 1) a[o / 2] += a[o / 2] * r;
+		error *= 1.0 - r * r;
+
+		// Store the prediction coefficients (x[i] ~ sum c[j] * x[i - 1 - j])
+		for (int j = 0; j <= o; ++j) lpc[o * maxOrder + j] = -a[j];
+		if (error <= 0.0) return o + 1;
+	}
+	return maxOrder;
+}
+
+/**
+ * Quantizes coefficients to integers with a common shift.
+ */
+static int quantizeLpc(const double* lpc, int order, int32_t* qcoefs) {
+	double cmax = 0.0;
+	for (int j = 0; j < order; ++j) cmax = fmax(cmax, fabs(lpc[j]));
+	if (cmax <= 0.0) {
+		for (int j = 0; j < order; ++j) qcoefs[j] = 0;
+		return 0;
+	}
+	int log2cmax;
+	frexp(cmax, &log2cmax);
+	int shift = SLAC_COEF_BITS - 1 - log2cmax;
+	if (shift > 20) shift = 20;
+	if (shift < 0) shift = 0;
+
+	// Carry the rounding error into the next coefficient
+	double error = 0.0;
+	int32_t limit = (1 << (SLAC_COEF_BITS - 1)) - 1;
+	for (int j = 0; j < order; ++j) {
+		error += lpc[j] * (1 << shift);
+		long q = lround(error);
+		if (q > limit) q = limit;
+		if (q < -limit - 1) q = -limit - 1;
+		qcoefs[j] = (int32_t)q;
+		error -= q;
+	}
+	return shift;
+}
+
+static void computeResidual(const int32_t* x, int n, const int32_t* qcoefs, int order, int shift, int64_t* residual) {
+	for (int i = 0; i < order; ++i) residual[i] = x[i];
+	for (int i = order; i < n; ++i) {
+		int64_t sum = 0;
+		for (int j = 0; j < order; ++j) sum += (int64_t)qcoefs[j] * x[i - 1 - j];
+		residual[i] = (int64_t)x[i] - (sum >> shift);
+	}
+}
+
+/**
+ * The rice parameter for values with a given sum.
+ */
+static int riceParameter(uint64_t sum, int count) {
+	int k = 0;
+	if (count > 0) {
+		uint64_t mean = sum / count;
+		while (k < 30 && (1ULL << (k + 1)) <= mean) ++k;
+	}
+	return k;
+}
+
+static uint64_t zigzagSum(const int64_t* residual, int start, int end) {
+	uint64_t sum = 0;
+	for (int i = start; i < end; ++i) sum += zigzag(residual[i]);
+	return sum;
+}
+
+/**
+ * Finds the partition order with the fewest bits (warmup samples are not part of the residual).
+ * The sums of the finest partitions are merged for the coarser orders, so this is a single pass.
+ */
+static uint64_t partitionBits(const int64_t* residual, int n, int order, int* bestOrder) {
+	int maxOrder = 0;
+	while (maxOrder < SLAC_MAX_PARTITION_ORDER && n % (2 << maxOrder) == 0 && n / (2 << maxOrder) > order) ++maxOrder;
+
+	int partitions = 1 << maxOrder;
+	int length = n / partitions;
+	uint64_t sums[1 << SLAC_MAX_PARTITION_ORDER];
+	for (int part = 0; part < partitions; ++part) {
+		sums[part] = zigzagSum(residual, part == 0 ? order : part * length, (part + 1) * length);
+	}
+
+	uint64_t best = ~0ULL;
+	*bestOrder = 0;
+	for (int p = maxOrder; p >= 0; --p) {
+		partitions = 1 << p;
+		length = n / partitions;
+		uint64_t bits = 0;
+		for (int part = 0; part < partitions; ++part) {
+			int count = part == 0 ? length - order : length;
+			int k = riceParameter(sums[part], count);
+			// The estimate ignores escapes, which are rare with the mean based parameter
+			bits += 5 + (uint64_t)count * (k + 1) + (sums[part] >> k);
+		}
+		if (bits <= best) {
+			best = bits;
+			*bestOrder = p;
+		}
+		// Merge neighbours for the next coarser order
+		for (int part = 0; part < partitions / 2; ++part) {
+			sums[part] = sums[2 * part] + sums[2 * part + 1];
+		}
+	}
+	return best;
+}
+
+/**
+ * Codes one channel of an integer block.
+ */
+static void encodeChannel(const int32_t* samples, int n, BitWriter& writer) {
+	vector<int32_t> x(samples, samples + n);
+
+	// Samples of 16 bit sources have unused low bits
+	uint32_t any = 0;
+	for (int i = 0; i < n; ++i) any |= (uint32_t)x[i];
+	int wasted = 0;
+	if (any == 0) {
+		wasted = 0;
+	} else {
+		while (wasted < 24 && ((any >> wasted) & 1) == 0) ++wasted;
+	}
+	if (wasted > 0) {
+		for (int i = 0; i < n; ++i) x[i] >>= wasted;
+	}
+
+	int maxOrder = SLAC_MAX_ORDER < n / 2 ? SLAC_MAX_ORDER : n / 2;
+	vector<double> lpc(SLAC_MAX_ORDER * SLAC_MAX_ORDER, 0.0);
+	int available = maxOrder > 0 ? computeLpc(x.data(), n, maxOrder, lpc.data()) : 0;
+
+	// Try a couple of orders and keep the one with the smallest residual
+	vector<int64_t> residual(n);
+	vector<int64_t> bestResidual(n);
+	int32_t qcoefs[SLAC_MAX_ORDER];
+	int32_t bestCoefs[SLAC_MAX_ORDER];
+	int bestOrder = 0;
+	int bestShift = 0;
+	int bestPartitionOrder = 0;
+	uint64_t bestBits = ~0ULL;
+	for (size_t t = 0; t < sizeof(orders) / sizeof(orders[0]); ++t) {
+		int order = orders[t];
+		if (order > available) break;
+		int shift = order > 0 ? quantizeLpc(&lpc[(order - 1) * maxOrder], order, qcoefs) : 0;
+		computeResidual(x.data(), n, qcoefs, order, shift, residual.data());
+		int partitionOrder;
+		uint64_t bits = partitionBits(residual.data(), n, order, &partitionOrder) + order * (SLAC_COEF_BITS + 32);
+		if (bits < bestBits) {
+			bestBits = bits;
+			bestOrder = order;
+			bestShift = shift;
+			bestPartitionOrder = partitionOrder;
+			memcpy(bestCoefs, qcoefs, sizeof(int32_t) * order);
+			bestResidual.swap(residual);
+		}
+	}
+
+	writer.put(wasted, 5);
+	writer.put(bestOrder, 6);
+	if (bestOrder > 0) {
+		writer.put(bestShift, 5);
+		for (int j = 0; j < bestOrder; ++j) writer.putSigned(bestCoefs[j], SLAC_COEF_BITS + 1);
+		for (int j = 0; j < bestOrder; ++j) writer.putSigned(x[j], 32);
+	}
+
+	writer.put(bestPartitionOrder, 4);
+	int partitions = 1 << bestPartitionOrder;
+	int length = n / partitions;
+	for (int part = 0; part < partitions; ++part) {
+		int start = part == 0 ? bestOrder : part * length;
+		int end = (part + 1) * length;
+		int k = riceParameter(zigzagSum(bestResidual.data(), start, end), end - start);
+		writer.put(k, 5);
+		for (int i = start; i < end; ++i) writer.putRice(zigzag(bestResidual[i]), k);
+	}
+}
+
+/**
+ * Codes one block of interleaved samples.
+ */
+static void encodeBlock(const float* samples, int frames, int channels, vector<uint8_t>* out) {
+	out->clear();
+	uint8_t header[8];
+	putU32(header + 4, (uint32_t)frames);
+
+	vector<int32_t> ints((size_t)frames * channels);
+	if (toIntegers(samples, (int64_t)frames * channels, ints.data()) == false) {
+		// Processed floats have no integer grid to predict on
+		header[0] = SLAC_BLOCK_VERBATIM;
+		header[1] = header[2] = header[3] = 0;
+		out->insert(out->end(), header, header + 8);
+		size_t offset = out->size();
+		out->resize(offset + (size_t)frames * channels * sizeof(float));
+		memcpy(out->data() + offset, samples, (size_t)frames * channels * sizeof(float));
+		return;
+	}
+
+	header[0] = SLAC_BLOCK_LPC;
+	header[1] = header[2] = header[3] = 0;
+	out->insert(out->end(), header, header + 8);
+
+	BitWriter writer(out);
+	vector<int32_t> channel(frames);
+	for (int c = 0; c < channels; ++c) {
+		for (int i = 0; i < frames; ++i) channel[i] = ints[(size_t)i * channels + c];
+		encodeChannel(channel.data(), frames, writer);
+	}
+	writer.flush();
+}
+
+static bool decodeChannel(BitReader& reader, int n, int32_t* x) {
+	int wasted = (int)reader.get(5);
+	int order = (int)reader.get(6);
+	if (order > SLAC_MAX_ORDER || order > n) return false;
+
+	int shift = 0;
+	int32_t qcoefs[SLAC_MAX_ORDER];
+	if (order > 0) {
+		shift = (int)reader.get(5);
+		for (int j = 0; j < order; ++j) qcoefs[j] = (int32_t)reader.getSigned(SLAC_COEF_BITS + 1);
+		for (int j = 0; j < order; ++j) x[j] = (int32_t)reader.getSigned(32);
+	}
+
+	int partitionOrder = (int)reader.get(4);
+	int partitions = 1 << partitionOrder;
+	if (n % partitions != 0 || n / partitions < order) return false;
+	int length = n / partitions;
+	for (int part = 0; part < partitions; ++part) {
+		int start = part == 0 ? order : part * length;
+		int end = (part + 1) * length;
+		int k = (int)reader.get(5);
+		for (int i = start; i < end; ++i) {
+			int64_t residual = unzigzag(reader.getRice(k));
+			int64_t sum = 0;
+			for (int j = 0; j < order; ++j) sum += (int64_t)qcoefs[j] * x[i - 1 - j];
+			x[i] = (int32_t)(residual + (sum >> shift));
+		}
+		if (reader.failed()) return false;
+	}
+
+	if (wasted > 0) {
+		for (int i = 0; i < n; ++i) x[i] = (int32_t)((uint32_t)x[i] << wasted);
+	}
+	return reader.failed() == false;
+}
+
+/**
+ * The indices 0..count-1 that the threads of a pool take one after another.
+ */
+struct ParallelJob {
+	std::atomic<int> next;
+	int count;
+	void (*run)(void* context, int idx);
+	void* context;
+};
+
+static void parallelWorker(ParallelJob* job) {
+	int idx;
+	while ((idx = job->next.fetch_add(1)) < job->count) {
+		job->run(job->context, idx);
+	}
+}
+
+/**
+ * Threads that are started once and run every batch of a reader or writer.
+ */
+class Sound::SlacPool {
+public:
+	explicit SlacPool(int threads): stopping(false) {
+		uv_sem_init(&start, 0);
+		uv_sem_init(&done, 0);
+		// The calling thread helps as well
+		workers.resize(threads > 1 ? threads - 1 : 0);
+		for (size_t i = 0; i < workers.size(); ++i) {
+			uv_thread_create(&workers[i], _run, this);
+		}
+	}
+
+	~SlacPool() {
+		stopping = true;
+		for (size_t i = 0; i < workers.size(); ++i) uv_sem_post(&start);
+		for (size_t i = 0; i < workers.size(); ++i) uv_thread_join(&workers[i]);
+		uv_sem_destroy(&start);
+		uv_sem_destroy(&done);
+	}
+
+	/** Calls run for 0..count-1 on all threads and returns when every call finished. */
+	void parallelFor(int count, void (*run)(void* context, int idx), void* context) {
+		job.next.store(0);
+		job.count = count;
+		job.run = run;
+		job.context = context;
+		// Workers that find no index left just report back
+		for (size_t i = 0; i < workers.size(); ++i) uv_sem_post(&start);
+		parallelWorker(&job);
+		for (size_t i = 0; i < workers.size(); ++i) uv_sem_wait(&done);
+	}
+private:
+	static void _run(void* arg) {
+		SlacPool* pool = (SlacPool*)arg;
+		while (true) {
+			uv_sem_wait(&pool->start);
+			if (pool->stopping) break;
+			parallelWorker(&pool->job);
+			uv_sem_post(&pool->done);
+		}
+	}
+
+	vector<uv_thread_t> workers;
+	uv_sem_t start;
+	uv_sem_t done;
+	ParallelJob job;
+	// Only written before the workers are woken up for the last time
+	bool stopping;
+};
+
+static int threadCount() {
+	int count = (int)std::thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+bool Sound::isSlacFile(string file) {
+	return file.size() >= 5 && strcasecmp(file.c_str() + file.size() - 5, ".slac") == 0;
+}
+
+Sound::SlacWriter::SlacWriter(string file, int sampleRate, int channels): sampleRate(sampleRate), channels(channels) {
+	failed = false;
+	threads = threadCount();
+	stagingSize = (int64_t)SLAC_BLOCK_FRAMES * channels * threads * SLAC_BLOCKS_PER_THREAD;
+	staging = new float[stagingSize];
+	staged = 0;
+	totalFrames = 0;
+	fileSize = SLAC_HEADER_SIZE;
+	pool = new SlacPool(threads);
+
+	fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+Sound::SlacWriter::~SlacWriter() {
+	finish();
+	delete pool;
+	delete[] staging;
+}
+
+bool Sound::SlacWriter::isOpen() const {
+	return fd >= 0;
+}
+
+bool Sound::SlacWriter::write(const float* samples, int64_t count) {
+	if (fd < 0 || failed) return false;
+	while (count > 0) {
+		int64_t n = stagingSize - staged;
+		if (n > count) n = count;
+		memcpy(staging + staged, samples, n * sizeof(float));
+		staged += n;
+		samples += n;
+		count -= n;
+		if (staged == stagingSize && _flush() == false) return false;
+	}
+	return true;
+}
+
+struct EncodeBatch {
+	const float* samples;
+	int64_t frames;
+	int channels;
+	vector<vector<uint8_t> >* blocks;
+};
+
+static void encodeBatchBlock(void* context, int idx) {
+	EncodeBatch* batch = (EncodeBatch*)context;
+	int64_t start = (int64_t)idx * SLAC_BLOCK_FRAMES;
+	int frames = (int)(batch->frames - start < SLAC_BLOCK_FRAMES ? batch->frames - start : SLAC_BLOCK_FRAMES);
+	encodeBlock(batch->samples + start * batch->channels, frames, batch->channels, &(*batch->blocks)[idx]);
+}
+
+bool Sound::SlacWriter::_flush() {
+	int64_t frames = staged / channels;
+	if (frames == 0) return true;
+
+	int blockCount = (int)((frames + SLAC_BLOCK_FRAMES - 1) / SLAC_BLOCK_FRAMES);
+	vector<vector<uint8_t> > blocks(blockCount);
+	EncodeBatch batch = { staging, frames, channels, &blocks };
+	pool->parallelFor(blockCount, encodeBatchBlock, &batch);
+
+	for (int i = 0; i < blockCount; ++i) {
+		index.push_back((uint64_t)fileSize);
+		if (_writeAt(blocks[i].data(), blocks[i].size(), fileSize) == false) return false;
+		fileSize += blocks[i].size();
+	}
+	totalFrames += frames;
+
+	// Keep a partial frame for the next batch
+	int64_t rest = staged - frames * channels;
+	memmove(staging, staging + frames * channels, rest * sizeof(float));
+	staged = rest;
+	return true;
+}
+
+bool Sound::SlacWriter::_writeAt(const void* data, int64_t size, int64_t offset) {
+	int64_t done = 0;
+	while (done < size) {
+		ssize_t written = pwrite(fd, (const char*)data + done, (size_t)(size - done), offset + done);
+		if (written <= 0) {
+			failed = true;
+			return false;
+		}
+		done += written;
+	}
+	return true;
+}
+
+bool Sound::SlacWriter::finish() {
+	if (fd < 0) return failed == false;
+
+	if (failed == false) _flush();
+	if (failed == false) {
+		// The index of the block offsets follows the last block
+		int64_t indexOffset = fileSize;
+		vector<uint8_t> indexData(index.size() * 8);
+		for (size_t i = 0; i < index.size(); ++i) putU64(&indexData[i * 8], index[i]);
+		_writeAt(indexData.data(), indexData.size(), indexOffset);
+
+		uint8_t header[SLAC_HEADER_SIZE];
+		memset(header, 0, sizeof(header));
+		memcpy(header, SLAC_MAGIC, 4);
+		putU16(header + 4, SLAC_VERSION);
+		putU16(header + 6, (uint16_t)channels);
+		putU32(header + 8, (uint32_t)sampleRate);
+		putU32(header + 12, SLAC_BLOCK_FRAMES);
+		putU64(header + 16, (uint64_t)totalFrames);
+		putU64(header + 24, (uint64_t)indexOffset);
+		putU32(header + 32, (uint32_t)index.size());
+		_writeAt(header, sizeof(header), 0);
+	}
+
+	if (close(fd) != 0) failed = true;
+	fd = -1;
+	return failed == false;
+}
+
+Sound::SlacReader::SlacReader(string file) {
+	mapping = NULL;
+	mappingSize = 0;
+	_channels = 0;
+	_sampleRate = 0;
+	blockFrames = SLAC_BLOCK_FRAMES;
+	_frames = 0;
+	indexData = NULL;
+	indexEnd = 0;
+	_blockCount = 0;
+
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		_error = "Could not open the slac file.";
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < SLAC_HEADER_SIZE) {
+		close(fd);
+		_error = "Not a slac file.";
+		return;
+	}
+	void* memory = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		_error = "Could not map the slac file.";
+		return;
+	}
+
+	const uint8_t* header = (const uint8_t*)memory;
+	uint64_t indexOffset = getU64(header + 24);
+	uint32_t blockCount = getU32(header + 32);
+	bool valid = memcmp(header, SLAC_MAGIC, 4) == 0
+		&& (header[4] | header[5] << 8) == SLAC_VERSION
+		&& (header[6] | header[7] << 8) > 0
+		&& getU32(header + 12) > 0 && getU32(header + 12) <= SLAC_MAX_BLOCK_FRAMES
+		&& indexOffset >= SLAC_HEADER_SIZE
+		&& indexOffset + (uint64_t)blockCount * 8 <= (uint64_t)st.st_size;
+	if (valid == false) {
+		munmap(memory, st.st_size);
+		_error = "Not a slac file or the file is incomplete.";
+		return;
+	}
+
+	mapping = memory;
+	mappingSize = st.st_size;
+	_channels = header[6] | header[7] << 8;
+	_sampleRate = (int)getU32(header + 8);
+	blockFrames = (int)getU32(header + 12);
+	_frames = (int64_t)getU64(header + 16);
+	indexData = header + indexOffset;
+	_blockCount = (int)blockCount;
+	indexEnd = (int64_t)indexOffset;
+}
+
+Sound::SlacReader::~SlacReader() {
+	if (mapping != NULL) {
+		munmap(mapping, mappingSize);
+	}
+}
+
+bool Sound::SlacReader::isOpen() const {
+	return mapping != NULL;
+}
+
+string Sound::SlacReader::error() const {
+	return _error;
+}
+
+int Sound::SlacReader::channels() const {
+	return _channels;
+}
+
+int Sound::SlacReader::sampleRate() const {
+	return _sampleRate;
+}
+
+int64_t Sound::SlacReader::frames() const {
+	return _frames;
+}
+
+int Sound::SlacReader::blockCount() const {
+	return _blockCount;
+}
+
+int Sound::SlacReader::blockAt(int64_t frame) const {
+	return (int)(frame / blockFrames);
+}
+
+int64_t Sound::SlacReader::decodeBlock(int block, float* dst) const {
+	if (block < 0 || block >= _blockCount) return -1;
+	int64_t start = (int64_t)getU64(indexData + (int64_t)block * 8);
+	int64_t end = block + 1 < _blockCount ? (int64_t)getU64(indexData + (int64_t)(block + 1) * 8) : indexEnd;
+	if (start < SLAC_HEADER_SIZE || end > indexEnd || end - start < 8) return -1;
+
+	const uint8_t* data = (const uint8_t*)mapping + start;
+	int64_t size = end - start;
+	int type = data[0];
+	int frames = (int)getU32(data + 4);
+	if (frames > blockFrames) return -1;
+	int64_t count = (int64_t)frames * _channels;
+
+	if (type == SLAC_BLOCK_VERBATIM) {
+		if (size < 8 + count * (int64_t)sizeof(float)) return -1;
+		memcpy(dst, data + 8, count * sizeof(float));
+		return frames;
+	}
+	if (type != SLAC_BLOCK_LPC) return -1;
+
+	BitReader reader(data + 8, size - 8);
+	vector<int32_t> channel(frames);
+	const float scale = 1.0f / SLAC_INT_SCALE;
+	for (int c = 0; c < _channels; ++c) {
+		if (decodeChannel(reader, frames, channel.data()) == false) return -1;
+		for (int i = 0; i < frames; ++i) {
+			dst[(int64_t)i * _channels + c] = channel[i] * scale;
+		}
+	}
+	return frames;
+}
+
+struct DecodeBatch {
+	const Sound::SlacReader* reader;
+	int firstBlock;
+	int blockFrames;
+	int channels;
+	float* samples;
+	vector<int64_t>* frames;
+};
+
+static void decodeBatchBlock(void* context, int idx) {
+	DecodeBatch* batch = (DecodeBatch*)context;
+	float* dst = batch->samples + (int64_t)idx * batch->blockFrames * batch->channels;
+	(*batch->frames)[idx] = batch->reader->decodeBlock(batch->firstBlock + idx, dst);
+}
+
+bool Sound::SlacReader::decode(SampleArena* arena) {
+	if (isOpen() == false) return false;
+
+	// Decode a batch of blocks in parallel, then append them in order
+	int threads = threadCount();
+	int batchBlocks = threads * SLAC_BLOCKS_PER_THREAD;
+	float* samples = new float[(int64_t)batchBlocks * blockFrames * _channels];
+	vector<int64_t> frames(batchBlocks);
+	SlacPool pool(threads);
+
+	bool ok = true;
+	for (int first = 0; first < _blockCount && ok; first += batchBlocks) {
+		int count = _blockCount - first < batchBlocks ? _blockCount - first : batchBlocks;
+		DecodeBatch batch = { this, first, blockFrames, _channels, samples, &frames };
+		pool.parallelFor(count, decodeBatchBlock, &batch);
+
+		for (int i = 0; i < count; ++i) {
+			if (frames[i] < 0) {
+				_error = "The slac file is corrupt.";
+				ok = false;
+				break;
+			}
+			arena->append(samples + (int64_t)i * blockFrames * _channels, frames[i] * _channels);
+		}
+	}
+	delete[] samples;
+	return ok;
+}
@@ -0,0 +1,129 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_SLAC_H
+#define SOUND_SLAC_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SampleArena.h"
+
+// The number of frames (samples per channel) that are coded together
+#define SLAC_BLOCK_FRAMES 4096
+
+namespace Sound {
+
+	class SlacPool;
+
+	/**
+	 * If a file name has the extension of the lossless format (.slac).
+	 */
+	bool isSlacFile(std::string file);
+
+	/**
+	 * Writes recordings in the lossless slac format.
+	 *
+	 * Samples are cut into blocks that are coded independently. Blocks of samples
+	 * that came from an integer converter (16 or 24 bit) are predicted with a linear
+	 * predictor and the residual is rice coded, everything else is stored verbatim.
+	 * The blocks of a batch are encoded in parallel on all cores (by threads that are
+	 * started once per writer) and an index of the block offsets is written at the end
+	 * of the file, so a reader can decode the blocks in parallel as well.
+	 */
+	class SlacWriter {
+	public:
+		SlacWriter(std::string file, int sampleRate, int channels);
+
+		/** Finishes the file if that did not happen yet. */
+		~SlacWriter();
+
+		/** If the file could be opened. */
+		bool isOpen() const;
+
+		/** Appends interleaved samples. */
+		bool write(const float* samples, int64_t count);
+
+		/** Encodes the remaining samples, writes the index and the header and closes the file. */
+		bool finish();
+	private:
+		/** Encodes the staged blocks in parallel and writes them. */
+		bool _flush();
+		bool _writeAt(const void* data, int64_t size, int64_t offset);
+
+		int fd;
+		int sampleRate;
+		int channels;
+		bool failed;
+
+		/** Interleaved samples of the blocks of the next batch. */
+		float* staging;
+		int64_t stagingSize;
+		int64_t staged;
+		int threads;
+
+		SlacPool* pool;
+
+		int64_t totalFrames;
+		int64_t fileSize;
+		std::vector<uint64_t> index;
+	};
+
+	/**
+	 * Reads files in the lossless slac format.
+	 */
+	class SlacReader {
+	public:
+		explicit SlacReader(std::string file);
+		~SlacReader();
+
+		/** If the file could be opened and its header and index are valid. */
+		bool isOpen() const;
+
+		/** Why the file could not be opened or decoded. */
+		std::string error() const;
+
+		int channels() const;
+		int sampleRate() const;
+
+		/** The number of frames (samples per channel). */
+		int64_t frames() const;
+
+		/** The number of coded blocks. */
+		int blockCount() const;
+
+		/** The block that contains a frame (for seeking). */
+		int blockAt(int64_t frame) const;
+
+		/**
+		 * Decodes one block.
+		 *
+		 * @param  block The block index.
+		 * @param  dst   Receives up to SLAC_BLOCK_FRAMES * channels() interleaved samples.
+		 *
+		 * @return       The number of frames or -1 if the block is corrupt.
+		 */
+		int64_t decodeBlock(int block, float* dst) const;
+
+		/** Decodes the whole file in parallel and appends it to an arena. */
+		bool decode(SampleArena* arena);
+	private:
+		void* mapping;
+		int64_t mappingSize;
+		std::string _error;
+
+		int _channels;
+		int _sampleRate;
+		int blockFrames;
+		int64_t _frames;
+		/** The little endian block offsets at the end of the file. */
+		const uint8_t* indexData;
+		/** The end of the last block. */
+		int64_t indexEnd;
+		int _blockCount;
+	};
+}
+
+#endif
@@ -8,26 +8,20 @@ using namespace std;
 using namespace v8;
 
 Sound::Engine::Engine() {
-	listeners = map<string, vector<Listener*>*>();
-	listeners[string("data")] = new vector<Listener*>();
-	listeners[string("info")] = new vector<Listener*>();
-	listeners[string("fft")] = new vector<Listener*>();
-
-	listeners[string("playback_started")] = new vector<Listener*>();
-	listeners[string("playback_stopped")] = new vector<Listener*>();
-	listeners[string("playback_paused")] = new vector<Listener*>();
-	listeners[string("playback_progress")] = new vector<Listener*>();
-	listeners[string("playback_finished")] = new vector<Listener*>();
-
-	listeners[string("recording_loaded")] = new vector<Listener*>();
-	listeners[string("recording_started")] = new vector<Listener*>();
-	listeners[string("recording_stopped")] = new vector<Listener*>();
-	listeners[string("recording_progress")] = new vector<Listener*>();
-	listeners[string("recording_saved")] = new vector<Listener*>();
-	listeners[string("recording_deleted")] = new vector<Listener*>();
-	
-	listeners[string("beep_started")] = new vector<Listener*>();
-	listeners[string("beep_stopped")] = new vector<Listener*>();
+	for (int i = 0; i < EventTypeCount; ++i) {
+		events[i].emitting = 0;
+		events[i].active = 0;
+	}
+
+	// Progress is emitted with every block unless a throttle is set
+	processedFrames = 0;
+	recordedSamples = 0;
+	playbackProgress.interval = 0;
+	playbackProgress.blocks = 1;
+	_resetThrottle(&playbackProgress);
+	recordingProgress.interval = 0;
+	recordingProgress.blocks = 1;
+	_resetThrottle(&recordingProgress);
 
 	// Initialize PortAudio (to fetch default devices etc. ...)
 	PaError paErr = Pa_Initialize();
@@ -50,45 +44,124 @@ Sound::Engine::Engine() {
 
 	// Set default options for fft
 	fftWindowSize = 1024;
+	fftOverlapSize = 0.5;
 	fftWindowFunctionType = Square;
-	fftWindowFunction = new WindowFunction(fftWindowFunctionType, fftWindowSize);
-
-	// Init the queues with at least 100 elements
-	inBufferQueue = new moodycamel::ReaderWriterQueue<float*>(100);
-	outBufferQueue = new moodycamel::ReaderWriterQueue<float*>(100);
-
-	recordingBufferCache = vector<float*>();
+	fftWindowFunction = WindowFunction::shared(fftWindowFunctionType, fftWindowSize);
+
+	// Levels are emitted with every block by default
+	infoInterval = INFO_INTERVAL;
+	meter = NULL;
+
+	// The analysis thread signals finished spectra through this handle
+	stft = NULL;
+	fftAsync = new uv_async_t;
+	uv_async_init(uv_default_loop(), fftAsync, _onFftSignal);
+	fftAsync->data = this;
+	uv_unref((uv_handle_t*)fftAsync);
+
+	// The queues and the buffer pool are created by _configureStream
+	queueDepth = BUFFER_QUEUE_DEPTH;
+	bufferPool = NULL;
+	inBufferQueue = NULL;
+	outBufferQueue = NULL;
+	transportBlock = NULL;
+
+	recording = new SampleArena();
+	mappedWave = NULL;
+	playbackSource = recording;
+	playbackChannels = inputChannels;
+	diskRecorder = NULL;
+	playbackPosition = 0;
+
+	// No processing graph until setGraph is called
+	graph = NULL;
+	pendingGraph.store(NULL);
+	activeGraph = NULL;
+	retiredGraphs = new moodycamel::ReaderWriterQueue<DspGraph*>(8);
+	graphParams = new moodycamel::ReaderWriterQueue<DspParamChange>(GRAPH_PARAM_QUEUE_DEPTH);
+
+	// The equalizer is flat until setEq is called
+	equalizer = NULL;
+	convolver = NULL;
+
+	// The tone generator follows the sample rate of the stream
+	tones = new ToneGenerator(sampleRate);
+	clips = new ClipMixer();
+	clipRate = sampleRate;
+
+	// The stats are measured from the start, the stats event is emitted once there are listeners
+	telemetry = new Telemetry();
+	statsBaseline = telemetry->snapshot();
+	statsEventBaseline = statsBaseline;
+	statsInterval = STATS_INTERVAL;
+	statsLastEmit = 0;
+	statsIdle = true;
 
 	// Configure PortAudio
 	stream = NULL;
 	_configureStream();
 
+	// The stream callback wakes up the processing whenever new input buffers are queued
+	processingAsync = new uv_async_t;
+	uv_async_init(uv_default_loop(), processingAsync, _onProcessingSignal);
+	processingAsync->data = this;
+	// Don't keep the event loop alive while the stream is stopped
+	uv_unref((uv_handle_t*)processingAsync);
+
+	// The optional polling fallback
+	processingInterval = PROCESSING_INTERVAL;
 	uv_timer_init(uv_default_loop(), &processing_timer);
 	processing_timer.data = this;
-	uv_timer_start(&processing_timer, _processing, 0, PROCESSING_INTERVAL);
-
-	uv_timer_init(uv_default_loop(), &beep_timer);
-	beep_timer.data = this;
 }
 
 Sound::Engine::~Engine() {
-	// Remove all listeners from all eventNames
-	for (map<string, vector<Listener*>*>::iterator it = listeners.begin(); it != listeners.end(); ++it) {
-		vector<Listener*>* eventListeners = it->second;
-		for (vector<Listener*>::iterator it2 = eventListeners->begin() ; it2 != eventListeners->end(); ++it2) {
-			Listener* lsnr = *it2;
-			delete lsnr;
+	// Remove all listeners from all events
+	for (int i = 0; i < EventTypeCount; ++i) {
+		for (size_t j = 0; j < events[i].listeners.size(); ++j) {
+			delete events[i].listeners[j];
+		}
+		for (size_t j = 0; j < events[i].pending.size(); ++j) {
+			delete events[i].pending[j].first;
 		}
-		// Delete the eventListeners vector
-		delete eventListeners;
 	}
 
-	// Destroy the window function
-	delete fftWindowFunction;
-
 	// Stop the stream
 	_stopStream();
 	_destroyStream();
+
+	// The async handle must outlive the engine until libuv closed it
+	processingAsync->data = NULL;
+	uv_close((uv_handle_t*)processingAsync, _onAsyncClosed);
+
+	// Stop the analysis thread
+	delete stft;
+	delete meter;
+	fftAsync->data = NULL;
+	uv_close((uv_handle_t*)fftAsync, _onAsyncClosed);
+
+	// The stream callback is gone, so every graph can be deleted here
+	_collectGraphs();
+	delete pendingGraph.exchange(NULL);
+	delete activeGraph;
+	delete retiredGraphs;
+	delete graphParams;
+
+	delete equalizer;
+	delete convolver;
+	delete tones;
+	delete clips;
+	delete telemetry;
+
+	// Free the recording and finish a disk recording
+	delete recording;
+	delete mappedWave;
+	delete diskRecorder;
+
+	// Free the queues and the blocks they referenced
+	delete inBufferQueue;
+	delete outBufferQueue;
+	delete bufferPool;
+	free(transportBlock);
 }
 
 void Sound::Engine::Init(Handle<Object> target) {
@@ -99,7 +172,7 @@ void Sound::Engine::Init(Handle<Object> target) {
 
 	// Add the methods to the engine class
 	Nan::SetPrototypeMethod(tpl, "addListener", AddListener);
-	// -emit(eventName[, ...args])
+	Nan::SetPrototypeMethod(tpl, "emit", Emit);
 	Nan::SetPrototypeMethod(tpl, "eventNames", EventNames);
 	// -getMaxListeners()
 	Nan::SetPrototypeMethod(tpl, "listenerCount", ListenerCount);
@@ -110,9 +183,11 @@ void Sound::Engine::Init(Handle<Object> target) {
 	Nan::SetPrototypeMethod(tpl, "prependOnceListener", PrependOnceListener);
 	Nan::SetPrototypeMethod(tpl, "removeAllListeners", RemoveAllListeners);
 	Nan::SetPrototypeMethod(tpl, "removeListener", RemoveListener);
+	Nan::SetPrototypeMethod(tpl, "setEventThrottle", SetEventThrottle);
 
 
 	Nan::SetPrototypeMethod(tpl, "loadRecording", LoadRecording);
+	Nan::SetPrototypeMethod(tpl, "loadRecordingAsync", LoadRecordingAsync);
 	Nan::SetPrototypeMethod(tpl, "startPlayback", StartPlayback);
 	Nan::SetPrototypeMethod(tpl, "stopPlayback", StopPlayback);
 	Nan::SetPrototypeMethod(tpl, "pausePlayback", PausePlayback);
@@ -122,16 +197,33 @@ void Sound::Engine::Init(Handle<Object> target) {
 	Nan::SetPrototypeMethod(tpl, "stopRecording", StopRecording);
 	Nan::SetPrototypeMethod(tpl, "deleteRecording", DeleteRecording);
 	Nan::SetPrototypeMethod(tpl, "saveRecording", SaveRecording);
+	Nan::SetPrototypeMethod(tpl, "saveRecordingAsync", SaveRecordingAsync);
 	Nan::SetPrototypeMethod(tpl, "isRecording", IsRecording);
 
 	Nan::SetPrototypeMethod(tpl, "getRecordingSamples", GetRecordingSamples);
 	Nan::SetPrototypeMethod(tpl, "getRecordingSampleAt", GetRecordingSampleAt);
+	Nan::SetPrototypeMethod(tpl, "getRecordingChannels", GetRecordingChannels);
 	Nan::SetPrototypeMethod(tpl, "getPlaybackProgress", GetPlaybackProgress);
 
 	Nan::SetPrototypeMethod(tpl, "getPlaybackPosition", GetPlaybackPosition);
 	Nan::SetPrototypeMethod(tpl, "setPlaybackProgress", SetPlaybackProgress);
 
 	Nan::SetPrototypeMethod(tpl, "beep", Beep);
+	Nan::SetPrototypeMethod(tpl, "playTone", PlayTone);
+	Nan::SetPrototypeMethod(tpl, "stopTone", StopTone);
+	Nan::SetPrototypeMethod(tpl, "getCurrentFrame", GetCurrentFrame);
+
+	Nan::SetPrototypeMethod(tpl, "schedule", Schedule);
+	Nan::SetPrototypeMethod(tpl, "cancelScheduled", CancelScheduled);
+	Nan::SetPrototypeMethod(tpl, "getStreamTime", GetStreamTime);
+
+	Nan::SetPrototypeMethod(tpl, "loadClip", LoadClip);
+	Nan::SetPrototypeMethod(tpl, "unloadClip", UnloadClip);
+	Nan::SetPrototypeMethod(tpl, "playClip", PlayClip);
+	Nan::SetPrototypeMethod(tpl, "setVoice", SetVoice);
+	Nan::SetPrototypeMethod(tpl, "stopVoice", StopVoice);
+	Nan::SetPrototypeMethod(tpl, "getClipStats", GetClipStats);
+	Nan::SetPrototypeMethod(tpl, "getStats", GetStats);
 
 	Nan::SetPrototypeMethod(tpl, "getVolume", GetVolume);
 	Nan::SetPrototypeMethod(tpl, "setVolume", SetVolume);
@@ -142,6 +234,13 @@ void Sound::Engine::Init(Handle<Object> target) {
 	Nan::SetPrototypeMethod(tpl, "setOptions", SetOptions);
 
 	Nan::SetPrototypeMethod(tpl, "synchronize", Synchronize);
+	Nan::SetPrototypeMethod(tpl, "getBufferPoolInfo", GetBufferPoolInfo);
+
+	Nan::SetPrototypeMethod(tpl, "setGraph", SetGraph);
+	Nan::SetPrototypeMethod(tpl, "setGraphParam", SetGraphParam);
+	Nan::SetPrototypeMethod(tpl, "getEq", GetEq);
+	Nan::SetPrototypeMethod(tpl, "setEq", SetEq);
+	Nan::SetPrototypeMethod(tpl, "setConvolver", SetConvolver);
 
 	constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
 
@@ -179,8 +278,6 @@ void Sound::Engine::AddListener(const Nan::FunctionCallbackInfo<v8::Value>& info
 		Nan::ThrowTypeError("First argument must be an event name.");
 		return;
 	}
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
 
 	// Check and get the listener
 	if (info.Length() < 2 || info[1]->IsFunction() == false) {
@@ -188,11 +285,36 @@ void Sound::Engine::AddListener(const Nan::FunctionCallbackInfo<v8::Value>& info
 		return;
 	}
 
-	Local<Function> _cb = Local<Function>::Cast(info[1]);
-	Nan::Persistent<Function>* cb = new Nan::Persistent<Function>();
-	cb->Reset(_cb);
+	// Listeners for events that do not exist are ignored
+	EventType type;
+	if (_getEventType(info[0], &type) == false) return;
+	engine->_addListener(type, Local<Function>::Cast(info[1]));
+}
+
+void Sound::Engine::Emit(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// Check and get eventName
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be an event name.");
+		return;
+	}
+
+	// Returns if there were listeners like EventEmitter.emit
+	EventType type;
+	if (_getEventType(info[0], &type) == false || engine->_hasListeners(type) == false) {
+		info.GetReturnValue().Set(Nan::False());
+		return;
+	}
 
-	engine->_addListener(eventName, cb);
+	int argc = info.Length() - 1;
+	vector<Local<Value> > argv(argc > 0 ? argc : 1);
+	for (int i = 0; i < argc; ++i) {
+		argv[i] = info[i + 1];
+	}
+	engine->_emit(type, argc, argv.data());
+	info.GetReturnValue().Set(Nan::True());
 }
 
 void Sound::Engine::Once(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -204,8 +326,6 @@ void Sound::Engine::Once(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 		Nan::ThrowTypeError("First argument must be an event name.");
 		return;
 	}
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
 
 	// Check and get the listener
 	if (info.Length() < 2 || info[1]->IsFunction() == false) {
@@ -213,11 +333,9 @@ void Sound::Engine::Once(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 		return;
 	}
 
-	Local<Function> _cb = Local<Function>::Cast(info[1]);
-	Nan::Persistent<Function>* cb = new Nan::Persistent<Function>();
-	cb->Reset(_cb);
-
-	engine->_addListener(eventName, cb, false, true);
+	EventType type;
+	if (_getEventType(info[0], &type) == false) return;
+	engine->_addListener(type, Local<Function>::Cast(info[1]), false, true);
 }
 
 void Sound::Engine::PrependListener(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -229,8 +347,6 @@ void Sound::Engine::PrependListener(const Nan::FunctionCallbackInfo<v8::Value>&
 		Nan::ThrowTypeError("First argument must be an event name.");
 		return;
 	}
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
 
 	// Check and get the listener
 	if (info.Length() < 2 || info[1]->IsFunction() == false) {
@@ -238,11 +354,9 @@ void Sound::Engine::PrependListener(const Nan::FunctionCallbackInfo<v8::Value>&
 		return;
 	}
 
-	Local<Function> _cb = Local<Function>::Cast(info[1]);
-	Nan::Persistent<Function>* cb = new Nan::Persistent<Function>();
-	cb->Reset(_cb);
-
-	engine->_addListener(eventName, cb, true);
+	EventType type;
+	if (_getEventType(info[0], &type) == false) return;
+	engine->_addListener(type, Local<Function>::Cast(info[1]), true);
 }
 
 void Sound::Engine::PrependOnceListener(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -254,8 +368,6 @@ void Sound::Engine::PrependOnceListener(const Nan::FunctionCallbackInfo<v8::Valu
 		Nan::ThrowTypeError("First argument must be an event name.");
 		return;
 	}
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
 
 	// Check and get the listener
 	if (info.Length() < 2 || info[1]->IsFunction() == false) {
@@ -263,22 +375,17 @@ void Sound::Engine::PrependOnceListener(const Nan::FunctionCallbackInfo<v8::Valu
 		return;
 	}
 
-	Local<Function> _cb = Local<Function>::Cast(info[1]);
-	Nan::Persistent<Function>* cb = new Nan::Persistent<Function>();
-	cb->Reset(_cb);
-
-	engine->_addListener(eventName, cb, true, true);
+	EventType type;
+	if (_getEventType(info[0], &type) == false) return;
+	engine->_addListener(type, Local<Function>::Cast(info[1]), true, true);
 }
 
 void Sound::Engine::EventNames(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
-	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
 	// Create an array for the event names
-	Local<Array> eventNames = Nan::New<Array>(engine->listeners.size());
-	int i = 0;
-	for (map<string, vector<Listener*>*>::iterator it = engine->listeners.begin(); it != engine->listeners.end(); ++it, ++i) {
-		string eventName = it->first;
-		eventNames->Set(i, Nan::New<String>(eventName).ToLocalChecked());
+	Local<Array> eventNames = Nan::New<Array>(EventTypeCount);
+	for (int i = 0; i < EventTypeCount; ++i) {
+		eventNames->Set(i, Nan::New<String>(eventName((EventType)i)).ToLocalChecked());
 	}
 	info.GetReturnValue().Set(eventNames);
 }
@@ -292,16 +399,11 @@ void Sound::Engine::ListenerCount(const Nan::FunctionCallbackInfo<v8::Value>& in
 		Nan::ThrowTypeError("First argument must be an event name.");
 		return;
 	}
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
 
 	int listenerCount = 0;
-
-	// Find all listeners for the eventName
-	map<string, vector<Listener*>*>::iterator it = engine->listeners.find(eventName);
-	if (it != engine->listeners.end()) {
-		vector<Listener*>* eventListeners = it->second;
-		listenerCount = eventListeners->size();
+	EventType type;
+	if (_getEventType(info[0], &type)) {
+		listenerCount = engine->events[type].active;
 	}
 	info.GetReturnValue().Set(Nan::New<Number>(listenerCount));
 }
@@ -313,31 +415,16 @@ void Sound::Engine::RemoveAllListeners(const Nan::FunctionCallbackInfo<v8::Value
 	// Check and get eventName
 	if (info.Length() < 1 || info[0]->IsString() == false) {
 		// Remove all listeners from all eventNames
-		for (map<string, vector<Listener*>*>::iterator it = engine->listeners.begin(); it != engine->listeners.end(); ++it) {
-			vector<Listener*>* eventListeners = it->second;
-			for (vector<Listener*>::iterator it2 = eventListeners->begin() ; it2 != eventListeners->end(); ++it2) {
-				Listener* lsnr = *it2;
-				delete lsnr;
-			}
-			// Clear the vector
-			eventListeners->clear();
+		for (int i = 0; i < EventTypeCount; ++i) {
+			engine->_removeAllListeners((EventType)i);
 		}
 		return;
 	}
 
 	// Remove listeners from the specified eventName
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
-	// Find all listeners for the eventName
-	map<string, vector<Listener*>*>::iterator it = engine->listeners.find(eventName);
-	if (it != engine->listeners.end()) {
-		vector<Listener*>* eventListeners = it->second;
-		for (vector<Listener*>::iterator it2 = eventListeners->begin(); it2 != eventListeners->end(); ++it2) {
-			Listener* lsnr = *it2;
-			delete lsnr;
-		}
-		// Clear the vector
-		eventListeners->clear();
+	EventType type;
+	if (_getEventType(info[0], &type)) {
+		engine->_removeAllListeners(type);
 	}
 }
 
@@ -350,8 +437,6 @@ void Sound::Engine::RemoveListener(const Nan::FunctionCallbackInfo<v8::Value>& i
 		Nan::ThrowTypeError("First argument must be an event name.");
 		return;
 	}
-	Local<String> _eventName = Nan::To<String>(info[0]).ToLocalChecked();
-	string eventName = string((char*)(*String::Utf8Value(_eventName)));
 
 	// Check and get the listener
 	if (info.Length() < 2 || info[1]->IsFunction() == false) {
@@ -359,23 +444,40 @@ void Sound::Engine::RemoveListener(const Nan::FunctionCallbackInfo<v8::Value>& i
 		return;
 	}
 
-	Local<Function> listener = Local<Function>::Cast(info[1]);
+	EventType type;
+	if (_getEventType(info[0], &type)) {
+		engine->_removeListener(type, Local<Function>::Cast(info[1]));
+	}
+}
 
-	// Find all listeners for the eventName
-	map<string, vector<Listener*>*>::iterator it = engine->listeners.find(eventName);
-	if (it != engine->listeners.end()) {
-		vector<Listener*>* eventListeners = it->second;
-		
-		for (vector<Listener*>::iterator it2 = eventListeners->begin(); it2 != eventListeners->end(); ++it2) {
-			Listener* lsnr = *it2;
-			Nan::Persistent<Function>* _cb = lsnr->cb;
-			Local<Function> storedListener = Nan::New(*_cb);
-			if (storedListener == listener) {
-				delete lsnr;
-				// Remove it from the list
-				eventListeners->erase(it2);
-				return;
-			}
+void Sound::Engine::SetEventThrottle(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// Check and get eventName
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be an event name.");
+		return;
+	}
+	EventType type;
+	EventThrottle* throttle = _getEventType(info[0], &type) ? engine->_throttleFor(type) : NULL;
+	if (throttle == NULL) {
+		Nan::ThrowTypeError("Only playback_progress and recording_progress can be throttled.");
+		return;
+	}
+
+	// Without options every block is emitted again
+	throttle->interval = 0;
+	throttle->blocks = 1;
+	if (info.Length() >= 2 && info[1]->IsObject()) {
+		Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+		if (Nan::HasOwnProperty(options, Nan::New<String>("interval").ToLocalChecked()).FromMaybe(false)) {
+			Local<Number> _interval = Nan::To<Number>(Nan::Get(options, Nan::New<String>("interval").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			throttle->interval = _interval->NumberValue() > 0 ? _interval->NumberValue() : 0;
+		}
+		if (Nan::HasOwnProperty(options, Nan::New<String>("blocks").ToLocalChecked()).FromMaybe(false)) {
+			Local<Integer> _blocks = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("blocks").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			throttle->blocks = (int)_blocks->Int32Value() > 1 ? (int)_blocks->Int32Value() : 1;
 		}
 	}
 }
@@ -393,34 +495,45 @@ void Sound::Engine::LoadRecording(const Nan::FunctionCallbackInfo<v8::Value>& in
 	engine->_loadWave(file);
 }
 
-void Sound::Engine::StartPlayback(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+void Sound::Engine::LoadRecordingAsync(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
 
-	if (engine->isRecording) {
-		printf("Cannot start playback while recording.\n");
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be a wave filename.");
 		return;
 	}
+	Local<String> _file = Nan::To<String>(info[0]).ToLocalChecked();
+	string file = string((*String::Utf8Value(_file)));
+
+	Nan::Callback* callback = NULL;
+	if (info.Length() >= 2 && info[1]->IsFunction()) {
+		callback = new Nan::Callback(Local<Function>::Cast(info[1]));
+	}
 
-	engine->isPlaying = true;
-	engine->_emit("playback_started", 0, {});
+	LoadWorker* worker = new LoadWorker(engine, callback, info.Holder(), file, engine->sampleRate);
+	Local<Value> promise = worker->promise();
+	Nan::AsyncQueueWorker(worker);
+	info.GetReturnValue().Set(promise);
 }
 
-void Sound::Engine::StopPlayback(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+void Sound::Engine::StartPlayback(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
 
-	engine->isPlaying = false;
-	engine->playbackBufferCacheIdx = 0;
-	engine->_emit("playback_stopped", 0, {});
+	engine->_startPlayback();
 }
 
-void Sound::Engine::PausePlayback(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+void Sound::Engine::StopPlayback(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+	engine->_stopPlayback();
+}
 
-	engine->isPlaying = false;
-	engine->_emit("playback_paused", 0, {});
+void Sound::Engine::PausePlayback(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+	engine->_pausePlayback();
 }
 
 void Sound::Engine::IsPlaying(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -434,34 +547,32 @@ void Sound::Engine::StartRecording(const Nan::FunctionCallbackInfo<v8::Value>& i
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
 
-	if (engine->isPlaying) {
-		printf("Cannot start recording since playback is active...\n");
-		return;
+	// Record directly into a file if one is given
+	string file;
+	SampleFormat format = SampleFormatFloat32;
+	if (info.Length() >= 1 && info[0]->IsObject()) {
+		Local<Object> options = Nan::To<Object>(info[0]).ToLocalChecked();
+		if (Nan::HasOwnProperty(options, Nan::New<String>("file").ToLocalChecked()).FromMaybe(false)) {
+			Local<String> _file = Nan::To<String>(Nan::Get(options, Nan::New<String>("file").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			file = string((*String::Utf8Value(_file)));
+			if (_getSampleFormat(options, &format) == false) return;
+		}
 	}
 
-	if (engine->isRecording) {
-		printf("Already recording...\n");
-		return;
+	string error;
+	if (engine->_startRecording(file, format, &error) == false) {
+		Nan::ThrowError(error.c_str());
 	}
-
-	// Clear the recording buffer
-	engine->_deleteRecording();
-
-	engine->isRecording = true;
-	engine->_emit("recording_started", 0, {});
 }
 
 void Sound::Engine::StopRecording(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
 
-	if (engine->isRecording == false) {
-		printf("Recording never started...\n");
-		return;
+	string error;
+	if (engine->_stopRecording(&error) == false) {
+		Nan::ThrowError(error.c_str());
 	}
-
-	engine->isRecording = false;
-	engine->_emit("recording_stopped", 0, {});
 }
 
 void Sound::Engine::DeleteRecording(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -480,7 +591,58 @@ void Sound::Engine::SaveRecording(const Nan::FunctionCallbackInfo<v8::Value>& in
 	}
 	Local<String> _file = Nan::To<String>(info[0]).ToLocalChecked();
 	string file = string((*String::Utf8Value(_file)));
-	engine->_saveRecording(file);
+
+	SampleFormat format = SampleFormatFloat32;
+	if (info.Length() >= 2 && info[1]->IsObject()) {
+		Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+		if (_getSampleFormat(options, &format) == false) return;
+	}
+	if (engine->_isMappedFile(file)) {
+		Nan::ThrowError("The loaded file can't be overwritten while it is used for playback.");
+		return;
+	}
+	engine->_saveRecording(file, format);
+}
+
+void Sound::Engine::SaveRecordingAsync(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be a wave filename.");
+		return;
+	}
+	Local<String> _file = Nan::To<String>(info[0]).ToLocalChecked();
+	string file = string((*String::Utf8Value(_file)));
+
+	// saveRecordingAsync(file[, options][, callback])
+	SampleFormat format = SampleFormatFloat32;
+	Nan::Callback* callback = NULL;
+	for (int i = 1; i < info.Length() && i < 3; ++i) {
+		if (info[i]->IsFunction()) {
+			callback = new Nan::Callback(Local<Function>::Cast(info[i]));
+		} else if (info[i]->IsObject()) {
+			Local<Object> options = Nan::To<Object>(info[i]).ToLocalChecked();
+			if (_getSampleFormat(options, &format) == false) {
+				delete callback;
+				return;
+			}
+		}
+	}
+
+	if (engine->_isMappedFile(file)) {
+		delete callback;
+		Nan::ThrowError("The loaded file can't be overwritten while it is used for playback.");
+		return;
+	}
+
+	// The worker only gets a snapshot, recording and playback go on while it writes
+	string source = engine->playbackSource == engine->mappedWave ? engine->mappedWave->file() : string();
+	SaveWorker* worker = new SaveWorker(engine, callback, info.Holder(), file, engine->_recordingFormat(format), engine->_snapshotRecording(), source);
+	engine->pendingSaves++;
+	Local<Value> promise = worker->promise();
+	Nan::AsyncQueueWorker(worker);
+	info.GetReturnValue().Set(promise);
 }
 
 void Sound::Engine::IsRecording(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -492,7 +654,7 @@ void Sound::Engine::IsRecording(const Nan::FunctionCallbackInfo<v8::Value>& info
 void Sound::Engine::GetRecordingSamples(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
-	info.GetReturnValue().Set(Nan::New<Integer>((int)engine->recordingBufferCache.size() * engine->bufferSize));
+	info.GetReturnValue().Set(Nan::New<Number>((double)engine->playbackSource->size()));
 }
 
 void Sound::Engine::GetRecordingSampleAt(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -503,26 +665,43 @@ void Sound::Engine::GetRecordingSampleAt(const Nan::FunctionCallbackInfo<v8::Val
 		Nan::ThrowTypeError("First argument must be an index number.");
 		return;
 	}
-	Local<Integer> _idx = Nan::To<Integer>(info[0]).ToLocalChecked();
-	int idx = _idx->Int32Value();
-	
-	int inBufferIdx = idx % engine->bufferSize;
-	int bufferIdx = floor(idx / engine->bufferSize);
+	Local<Number> _idx = Nan::To<Number>(info[0]).ToLocalChecked();
+	int64_t idx = (int64_t)_idx->NumberValue();
+
+	// With a channel the index is a frame index, otherwise the index of an interleaved sample
+	if (info.Length() >= 2 && info[1]->IsUndefined() == false) {
+		if (info[1]->IsNumber() == false) {
+			Nan::ThrowTypeError("Second argument must be a channel number.");
+			return;
+		}
+		int channel = (int)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+		if (channel < 0 || channel >= engine->playbackChannels) {
+			Nan::ThrowTypeError("Second argument must be a channel of the recording.");
+			return;
+		}
+		idx = idx * engine->playbackChannels + channel;
+	}
 
-	if (bufferIdx < 0 || bufferIdx >= (int)engine->recordingBufferCache.size()) {
-		printf("Warning: Index %i out of recording range\n", idx);
+	if (idx < 0 || idx >= engine->playbackSource->size()) {
+		printf("Warning: Index %lli out of recording range\n", (long long)idx);
 		info.GetReturnValue().Set(Nan::New<Number>(0.0));
 		return;
 	}
-	float* containingBuffer = engine->recordingBufferCache.at(bufferIdx);
-	float sample = containingBuffer[inBufferIdx];
+	float sample = engine->playbackSource->sampleAt(idx);
 	info.GetReturnValue().Set(Nan::New<Number>(sample));
 }
 
+void Sound::Engine::GetRecordingChannels(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+	info.GetReturnValue().Set(Nan::New<Integer>(engine->playbackChannels));
+}
+
 void Sound::Engine::GetPlaybackProgress(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
-	double progress = (double)engine->playbackBufferCacheIdx / (double)engine->recordingBufferCache.size();
+	int64_t samplesCount = engine->playbackSource->size();
+	double progress = samplesCount > 0 ? (double)engine->playbackPosition / (double)samplesCount : 0.0;
 	info.GetReturnValue().Set(Nan::New<Number>(progress));
 }
 
@@ -540,50 +719,368 @@ void Sound::Engine::SetPlaybackProgress(const Nan::FunctionCallbackInfo<v8::Valu
 		Nan::ThrowTypeError("First argument must be a index progress number between 0 and 1.");
 		return;
 	}
-
-	int newIdx = floor(progress * (double)engine->recordingBufferCache.size());
-	newIdx = newIdx < 0 ? 0 : newIdx > (int)engine->recordingBufferCache.size() ? (int)engine->recordingBufferCache.size() : newIdx;
-	engine->playbackBufferCacheIdx = newIdx;
+	engine->_setPlaybackProgress(progress);
 }
 
 void Sound::Engine::GetPlaybackPosition(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
-	info.GetReturnValue().Set(Nan::New<Integer>(engine->playbackBufferCacheIdx * engine->bufferSize));
+	info.GetReturnValue().Set(Nan::New<Number>((double)engine->playbackPosition));
+}
+
+/**
+ * Reads a number option.
+ *
+ * @return False if the option is not set.
+ */
+static bool _getNumberOption(Local<Object> options, const char* name, double* value) {
+	Local<String> key = Nan::New<String>(name).ToLocalChecked();
+	if (Nan::HasOwnProperty(options, key).FromMaybe(false) == false) return false;
+	Local<Number> _value = Nan::To<Number>(Nan::Get(options, key).ToLocalChecked()).ToLocalChecked();
+	*value = _value->NumberValue();
+	return true;
 }
 
 void Sound::Engine::Beep(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
 
-	if (engine->isBeeping) {
-		uv_timer_stop(&(engine->beep_timer));
-		engine->isBeeping = false;
-		engine->beepIdx = -1;
-		engine->beepDuration = BEEP_DETAULT_DURATION;
-		engine->beepFrequency = BEEP_DETAULT_FREQUENCY;
-		engine->beepLevel = BEEP_DETAULT_LEVEL;
-	}
-
+	double frequency = BEEP_DETAULT_FREQUENCY;
+	double level = BEEP_DETAULT_LEVEL;
+	double duration = BEEP_DETAULT_DURATION;
 	if (info.Length() >= 1 && info[0]->IsObject()) {
 		Local<Object> options = Nan::To<Object>(info[0]).ToLocalChecked();
-		if (Nan::HasOwnProperty(options, Nan::New<String>("frequency").ToLocalChecked()).FromMaybe(false)) {
-			Local<Integer> _frequency = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("frequency").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-			engine->beepFrequency = (int)_frequency->Int32Value();
+		_getNumberOption(options, "frequency", &frequency);
+		_getNumberOption(options, "level", &level);
+		_getNumberOption(options, "duration", &duration);
+	}
+
+	// A beep without a single frame would end without ever starting
+	int64_t frames = (int64_t)(duration * engine->sampleRate / 1000.0);
+	if (frames < 1) {
+		Nan::ThrowTypeError("The duration must be positive.");
+		return;
+	}
+
+	// A new beep releases the current one and starts with the next block
+	if (engine->beepVoices.empty() == false) engine->tones->stop(engine->beepVoices.back(), engine->processedFrames);
+	int ramp = engine->sampleRate * TONE_DEFAULT_RAMP / 1000;
+	int id = engine->tones->start(frequency, (float)(0.72 * level), engine->processedFrames, frames, ramp, ramp);
+	if (id < 0) {
+		printf("Warning: All %d tone voices are busy, the beep is skipped\n", TONE_MAX_VOICES);
+		return;
+	}
+	engine->beepVoices.push_back(id);
+}
+
+void Sound::Engine::PlayTone(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsObject() == false) {
+		Nan::ThrowTypeError("First argument must be a tone options object.");
+		return;
+	}
+	Local<Object> options = Nan::To<Object>(info[0]).ToLocalChecked();
+
+	double frequency = BEEP_DETAULT_FREQUENCY;
+	double level = BEEP_DETAULT_LEVEL;
+	double duration = -1.0;
+	double at = (double)engine->processedFrames;
+	double attack = TONE_DEFAULT_RAMP;
+	double release = TONE_DEFAULT_RAMP;
+	_getNumberOption(options, "frequency", &frequency);
+	_getNumberOption(options, "level", &level);
+	_getNumberOption(options, "duration", &duration);
+	_getNumberOption(options, "at", &at);
+	_getNumberOption(options, "attack", &attack);
+	_getNumberOption(options, "release", &release);
+
+	if (frequency <= 0 || frequency >= engine->sampleRate / 2.0) {
+		Nan::ThrowTypeError("The frequency must be between 0 and half the sample rate.");
+		return;
+	}
+
+	// Frames that were already processed can't be played anymore
+	int64_t start = (int64_t)at;
+	if (start < engine->processedFrames) start = engine->processedFrames;
+	int64_t frames = duration < 0 ? -1 : (int64_t)(duration * engine->sampleRate / 1000.0);
+	if (frames == 0) {
+		Nan::ThrowTypeError("The duration must be positive (or omitted to play until stopTone).");
+		return;
+	}
+	int id = engine->tones->start(frequency, (float)level, start, frames,
+		(int)(attack * engine->sampleRate / 1000.0), (int)(release * engine->sampleRate / 1000.0));
+	if (id < 0) {
+		printf("Warning: All %d tone voices are busy, the tone is skipped\n", TONE_MAX_VOICES);
+	}
+	info.GetReturnValue().Set(Nan::New<Integer>(id));
+}
+
+void Sound::Engine::StopTone(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	int64_t at = engine->processedFrames;
+	if (info.Length() >= 2 && info[1]->IsNumber()) {
+		int64_t frame = (int64_t)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+		if (frame > at) at = frame;
+	}
+
+	// Without an id every tone (and the beep) is released
+	if (info.Length() < 1 || info[0]->IsUndefined() || info[0]->IsNull()) {
+		engine->tones->stopAll(at);
+		info.GetReturnValue().Set(Nan::New<Boolean>(true));
+		return;
+	}
+	if (info[0]->IsNumber() == false) {
+		Nan::ThrowTypeError("First argument must be the id of a tone.");
+		return;
+	}
+	int id = (int)Nan::To<Number>(info[0]).ToLocalChecked()->NumberValue();
+	info.GetReturnValue().Set(Nan::New<Boolean>(engine->tones->stop(id, at)));
+}
+
+void Sound::Engine::GetCurrentFrame(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+	info.GetReturnValue().Set(Nan::New<Number>((double)engine->processedFrames));
+}
+
+void Sound::Engine::Schedule(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be the name of a transport method.");
+		return;
+	}
+	TimelineCommand command;
+	if (parseTimelineAction(string(*String::Utf8Value(info[0])), &command.action) == false) {
+		Nan::ThrowTypeError("First argument must be one of startPlayback, stopPlayback, pausePlayback, startRecording, stopRecording, setVolume, setMute or setPlaybackProgress.");
+		return;
+	}
+
+	// Without a frame or time the command applies to the next block that is processed
+	command.frame = engine->processedFrames;
+	command.time = 0.0;
+	command.format = SampleFormatFloat32;
+	// setMute() mutes without a value like the method does
+	command.value = command.action == TimelineSetMute ? 1.0 : -1.0;
+	if (info.Length() >= 2 && info[1]->IsObject()) {
+		Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+		double frame;
+		if (_getNumberOption(options, "frame", &frame)) {
+			command.frame = frame > 0 ? (int64_t)frame : 0;
+		} else if (_getNumberOption(options, "time", &command.time)) {
+			command.frame = -1;
 		}
-		if (Nan::HasOwnProperty(options, Nan::New<String>("level").ToLocalChecked()).FromMaybe(false)) {
-			Local<Number> _level = Nan::To<Number>(Nan::Get(options, Nan::New<String>("level").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-			engine->beepLevel = _level->NumberValue();
+		_getNumberOption(options, "value", &command.value);
+		if (command.action == TimelineStartRecording && Nan::HasOwnProperty(options, Nan::New<String>("file").ToLocalChecked()).FromMaybe(false)) {
+			Local<String> _file = Nan::To<String>(Nan::Get(options, Nan::New<String>("file").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			command.file = string((*String::Utf8Value(_file)));
+			if (_getSampleFormat(options, &command.format) == false) return;
 		}
-		if (Nan::HasOwnProperty(options, Nan::New<String>("duration").ToLocalChecked()).FromMaybe(false)) {
-			Local<Number> _duration = Nan::To<Number>(Nan::Get(options, Nan::New<String>("duration").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-			engine->beepDuration = _duration->NumberValue();
+	}
+
+	if (command.action == TimelineSetVolume && command.value < 0) {
+		Nan::ThrowTypeError("setVolume needs a value between 0 and 1.");
+		return;
+	}
+	if (command.action == TimelineSetPlaybackProgress && (command.value < 0 || command.value > 1)) {
+		Nan::ThrowTypeError("setPlaybackProgress needs a value between 0 and 1.");
+		return;
+	}
+	info.GetReturnValue().Set(Nan::New<Integer>(engine->timeline.add(command)));
+}
+
+void Sound::Engine::CancelScheduled(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// Without an id every command is removed
+	if (info.Length() < 1 || info[0]->IsUndefined() || info[0]->IsNull()) {
+		engine->timeline.clear();
+		info.GetReturnValue().Set(Nan::New<Boolean>(true));
+		return;
+	}
+	if (info[0]->IsNumber() == false) {
+		Nan::ThrowTypeError("First argument must be the id of a scheduled command.");
+		return;
+	}
+	int id = (int)Nan::To<Number>(info[0]).ToLocalChecked()->NumberValue();
+	info.GetReturnValue().Set(Nan::New<Boolean>(engine->timeline.cancel(id)));
+}
+
+void Sound::Engine::GetStreamTime(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// The capture time of the next block follows from the last one (unless input blocks get dropped)
+	double frameTime = engine->processedFrames > 0 ? engine->blockTime + (double)engine->bufferSize / engine->sampleRate : 0.0;
+	Local<Object> streamTime = Nan::New<Object>();
+	Nan::Set(streamTime, Nan::New<String>("time").ToLocalChecked(), Nan::New<Number>(engine->stream != NULL ? Pa_GetStreamTime(engine->stream) : 0.0));
+	Nan::Set(streamTime, Nan::New<String>("frame").ToLocalChecked(), Nan::New<Number>((double)engine->processedFrames));
+	Nan::Set(streamTime, Nan::New<String>("frameTime").ToLocalChecked(), Nan::New<Number>(frameTime));
+	info.GetReturnValue().Set(streamTime);
+}
+
+void Sound::Engine::LoadClip(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be a wave or slac filename.");
+		return;
+	}
+	string file = string(*String::Utf8Value(info[0]));
+
+	Nan::Callback* callback = NULL;
+	if (info.Length() >= 2 && info[1]->IsFunction()) {
+		callback = new Nan::Callback(Local<Function>::Cast(info[1]));
+	}
+
+	// Decoding, resampling and deinterleaving happens on the threadpool
+	ClipWorker* worker = new ClipWorker(engine, callback, info.Holder(), file);
+	Local<Value> promise = worker->promise();
+	Nan::AsyncQueueWorker(worker);
+	info.GetReturnValue().Set(promise);
+}
+
+void Sound::Engine::UnloadClip(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsNumber() == false) {
+		Nan::ThrowTypeError("First argument must be the id of a clip.");
+		return;
+	}
+	int id = (int)Nan::To<Number>(info[0]).ToLocalChecked()->NumberValue();
+	info.GetReturnValue().Set(Nan::New<Boolean>(engine->clips->removeClip(id)));
+}
+
+void Sound::Engine::PlayClip(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsNumber() == false) {
+		Nan::ThrowTypeError("First argument must be the id of a clip.");
+		return;
+	}
+	int id = (int)Nan::To<Number>(info[0]).ToLocalChecked()->NumberValue();
+
+	double gain = 1.0;
+	double pan = 0.0;
+	double loopStart = 0.0;
+	double loopEnd = 0.0;
+	double offset = 0.0;
+	double at = (double)engine->processedFrames;
+	bool loop = false;
+	if (info.Length() >= 2 && info[1]->IsObject()) {
+		Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+		_getNumberOption(options, "gain", &gain);
+		_getNumberOption(options, "pan", &pan);
+		_getNumberOption(options, "loopStart", &loopStart);
+		_getNumberOption(options, "loopEnd", &loopEnd);
+		_getNumberOption(options, "offset", &offset);
+		_getNumberOption(options, "at", &at);
+		if (Nan::HasOwnProperty(options, Nan::New<String>("loop").ToLocalChecked()).FromMaybe(false)) {
+			loop = Nan::To<bool>(Nan::Get(options, Nan::New<String>("loop").ToLocalChecked()).ToLocalChecked()).FromJust();
 		}
 	}
-	// Calculate the last beep index
-	engine->beepEndIdx = engine->sampleRate * engine->inputChannels * engine->beepDuration;
-	uv_timer_start(&(engine->beep_timer), _stopBeep, engine->beepDuration, 1000); // The 1000 is not relevant since the timer will be stopped on the first call
-	engine->isBeeping = true;
+
+	ClipVoiceOptions voice;
+	voice.gain = (float)gain;
+	voice.pan = (float)pan;
+	voice.loop = loop;
+	voice.loopStart = (int64_t)loopStart;
+	voice.loopEnd = (int64_t)loopEnd;
+	voice.offset = (int64_t)offset;
+	// Frames that were already processed can't be played anymore
+	voice.start = (int64_t)at < engine->processedFrames ? engine->processedFrames : (int64_t)at;
+	int voiceId = engine->clips->play(id, voice);
+	if (voiceId < 0) {
+		Nan::ThrowError("There is no clip with this id.");
+		return;
+	}
+	info.GetReturnValue().Set(Nan::New<Integer>(voiceId));
+}
+
+void Sound::Engine::SetVoice(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 2 || info[0]->IsNumber() == false || info[1]->IsObject() == false) {
+		Nan::ThrowTypeError("Arguments must be the id of a voice and an options object.");
+		return;
+	}
+	int id = (int)Nan::To<Number>(info[0]).ToLocalChecked()->NumberValue();
+	Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+
+	bool found = true;
+	double value;
+	if (_getNumberOption(options, "gain", &value)) found = engine->clips->setGain(id, (float)value);
+	if (found && _getNumberOption(options, "pan", &value)) found = engine->clips->setPan(id, (float)value);
+	info.GetReturnValue().Set(Nan::New<Boolean>(found));
+}
+
+void Sound::Engine::StopVoice(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 1 || info[0]->IsNumber() == false) {
+		Nan::ThrowTypeError("First argument must be the id of a voice.");
+		return;
+	}
+	int id = (int)Nan::To<Number>(info[0]).ToLocalChecked()->NumberValue();
+
+	int64_t at = engine->processedFrames;
+	if (info.Length() >= 2 && info[1]->IsNumber()) {
+		int64_t frame = (int64_t)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+		if (frame > at) at = frame;
+	}
+	info.GetReturnValue().Set(Nan::New<Boolean>(engine->clips->stop(id, at)));
+}
+
+void Sound::Engine::GetClipStats(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	ClipMixerStats stats = engine->clips->stats();
+	vector<int> ids = engine->clips->clipIds();
+	double memory = 0.0;
+	for (size_t i = 0; i < ids.size(); ++i) {
+		memory += (double)engine->clips->clip(ids[i])->memory();
+	}
+	// The share of the real time of the rendered blocks the mixing took
+	double audioTime = (double)stats.blocks * engine->bufferSize / engine->sampleRate;
+	double renderTime = stats.renderTime / 1e9;
+
+	Local<Object> clipStats = Nan::New<Object>();
+	Nan::Set(clipStats, Nan::New<String>("clips").ToLocalChecked(), Nan::New<Integer>((int)ids.size()));
+	Nan::Set(clipStats, Nan::New<String>("memory").ToLocalChecked(), Nan::New<Number>(memory));
+	Nan::Set(clipStats, Nan::New<String>("voices").ToLocalChecked(), Nan::New<Integer>(stats.voices));
+	Nan::Set(clipStats, Nan::New<String>("peakVoices").ToLocalChecked(), Nan::New<Integer>(stats.peakVoices));
+	Nan::Set(clipStats, Nan::New<String>("blocks").ToLocalChecked(), Nan::New<Number>((double)stats.blocks));
+	Nan::Set(clipStats, Nan::New<String>("renderTime").ToLocalChecked(), Nan::New<Number>(renderTime * 1000.0));
+	Nan::Set(clipStats, Nan::New<String>("voiceCost").ToLocalChecked(), Nan::New<Number>(stats.voiceBlocks > 0 ? renderTime * 1e6 / stats.voiceBlocks : 0.0));
+	Nan::Set(clipStats, Nan::New<String>("load").ToLocalChecked(), Nan::New<Number>(audioTime > 0 ? renderTime / audioTime : 0.0));
+
+	// getClipStats(true) starts measuring from scratch
+	if (info.Length() >= 1 && info[0]->IsTrue()) engine->clips->resetStats();
+	info.GetReturnValue().Set(clipStats);
+}
+
+void Sound::Engine::GetStats(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	TelemetrySnapshot now = engine->telemetry->snapshot();
+	Local<Object> stats = engine->_statsObject(now.since(engine->statsBaseline));
+
+	// getStats(true) starts measuring from scratch
+	if (info.Length() >= 1 && info[0]->IsTrue()) engine->statsBaseline = now;
+	info.GetReturnValue().Set(stats);
 }
 
 void Sound::Engine::GetVolume(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -649,6 +1146,10 @@ void Sound::Engine::GetOptions(const Nan::FunctionCallbackInfo<v8::Value>& info)
 		_outputLatency = engine->outputLatency < 0 ? Pa_GetDeviceInfo(engine->outputDevice)->defaultHighInputLatency : engine->outputLatency;
 	Nan::Set(options, Nan::New<String>("outputLatency").ToLocalChecked(), Nan::New<Number>(_outputLatency));
 
+	Nan::Set(options, Nan::New<String>("queueDepth").ToLocalChecked(), Nan::New<Integer>(engine->queueDepth));
+	Nan::Set(options, Nan::New<String>("processingInterval").ToLocalChecked(), Nan::New<Integer>(engine->processingInterval));
+	Nan::Set(options, Nan::New<String>("infoInterval").ToLocalChecked(), Nan::New<Number>(engine->infoInterval));
+	Nan::Set(options, Nan::New<String>("statsInterval").ToLocalChecked(), Nan::New<Number>(engine->statsInterval));
 	Nan::Set(options, Nan::New<String>("fftWindowSize").ToLocalChecked(), Nan::New<Integer>(engine->fftWindowSize));
 	Nan::Set(options, Nan::New<String>("fftOverlapSize").ToLocalChecked(), Nan::New<Number>(engine->fftOverlapSize));
 
@@ -686,139 +1187,466 @@ void Sound::Engine::SetOptions(const Nan::FunctionCallbackInfo<v8::Value>& info)
 void Sound::Engine::Synchronize(const Nan::FunctionCallbackInfo<Value>& info) {
 	Nan::HandleScope scope;
 	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
-
-	while(engine->inBufferQueue->pop());
-	while(engine->outBufferQueue->pop());
+	engine->_clearQueues();
 }
 
-
-
-void Sound::Engine::_processing(uv_timer_t *handle) {
-	Engine* engine = (Engine*)(handle->data);
+void Sound::Engine::GetBufferPoolInfo(const Nan::FunctionCallbackInfo<Value>& info) {
 	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+	BufferPool* pool = engine->bufferPool;
 
-	float* inputBuffer;
+	// Create the info object that will be returned
+	Local<Object> poolInfo = Nan::New<Object>();
 
-	// Check if a inputBuffer is available
-	bool hasInputBuffer = engine->inBufferQueue->try_dequeue(inputBuffer);
-	if (hasInputBuffer == false) {
+	Nan::Set(poolInfo, Nan::New<String>("blockSize").ToLocalChecked(), Nan::New<Integer>(pool->blockSize()));
+	Nan::Set(poolInfo, Nan::New<String>("capacity").ToLocalChecked(), Nan::New<Integer>(pool->capacity()));
+	Nan::Set(poolInfo, Nan::New<String>("available").ToLocalChecked(), Nan::New<Integer>(pool->available()));
+	Nan::Set(poolInfo, Nan::New<String>("inUse").ToLocalChecked(), Nan::New<Integer>(pool->capacity() - pool->available()));
+	Nan::Set(poolInfo, Nan::New<String>("minAvailable").ToLocalChecked(), Nan::New<Integer>(pool->minAvailable()));
+	Nan::Set(poolInfo, Nan::New<String>("exhausted").ToLocalChecked(), Nan::New<Number>(pool->exhausted()));
+	Nan::Set(poolInfo, Nan::New<String>("inQueue").ToLocalChecked(), Nan::New<Integer>((int)engine->inBufferQueue->size_approx()));
+	Nan::Set(poolInfo, Nan::New<String>("outQueue").ToLocalChecked(), Nan::New<Integer>((int)engine->outBufferQueue->size_approx()));
+
+	info.GetReturnValue().Set(poolInfo);
+}
+
+void Sound::Engine::SetGraph(const Nan::FunctionCallbackInfo<Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// Without a description (or with null) the graph is removed
+	DspGraphSpec spec;
+	if (info.Length() >= 1 && info[0]->IsNull() == false && info[0]->IsUndefined() == false) {
+		if (info[0]->IsObject() == false) {
+			Nan::ThrowTypeError("First argument must be a graph description or null.");
+			return;
+		}
+		if (_getGraphSpec(Nan::To<Object>(info[0]).ToLocalChecked(), &spec) == false) return;
+	}
+
+	// Free the graphs the stream callback replaced, so there is room for the next one in the retired queue
+	engine->_collectGraphs();
+
+	// The graph is completely built here, the stream callback only swaps it in
+	string error;
+	DspGraph* graph = DspGraph::build(spec, engine->sampleRate, engine->bufferSize, engine->inputChannels, &error);
+	if (graph == NULL) {
+		Nan::ThrowError(error.c_str());
 		return;
 	}
+	engine->graphSpec = spec;
+	engine->_publishGraph(graph);
+}
 
-	// Overwrite with playback buffer when isPlaying is active
-	if (engine->isPlaying) {
-	// Playing back
-		if (engine->recordingBufferCache.size() > 0 && engine->playbackBufferCacheIdx < (int)engine->recordingBufferCache.size()) {
-			float* playbackBuffer = engine->recordingBufferCache.at(engine->playbackBufferCacheIdx);
-			memcpy(inputBuffer, playbackBuffer, engine->bufferSize * sizeof(float));
-			Local<Number> progress = Nan::New<Number>((double)engine->playbackBufferCacheIdx/(double)engine->recordingBufferCache.size());
-			Local<Value> argv[1] = {progress};
-			engine->_emit("playback_progress", 1, argv);
-			++engine->playbackBufferCacheIdx;
-		} else {
-			engine->isPlaying = false;
-			engine->playbackBufferCacheIdx = 0;
-			engine->_emit("playback_finished", 0, {});
+void Sound::Engine::SetGraphParam(const Nan::FunctionCallbackInfo<Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	if (info.Length() < 3 || info[0]->IsString() == false || info[1]->IsString() == false || info[2]->IsNumber() == false) {
+		Nan::ThrowTypeError("Arguments must be a node id, a parameter name and a number.");
+		return;
+	}
+	string id = string(*String::Utf8Value(info[0]));
+	string name = string(*String::Utf8Value(info[1]));
+	double value = Nan::To<double>(info[2]).FromJust();
+
+	DspGraph* graph = engine->graph;
+	if (graph == NULL || graph->bypass()) {
+		Nan::ThrowError("No graph is set.");
+		return;
+	}
+	int node = graph->nodeIndex(id);
+	if (node < 0) {
+		Nan::ThrowError(("Unknown graph node " + id + ".").c_str());
+		return;
+	}
+	int param = graph->paramIndex(node, name);
+	if (param < 0) {
+		Nan::ThrowError(("Node " + id + " has no parameter " + name + ".").c_str());
+		return;
+	}
+
+	// The stream callback applies the change before the next block (enqueue only allocates if it fell behind)
+	DspParamChange change;
+	change.generation = graph->generation();
+	change.node = node;
+	change.param = param;
+	change.value = (float)value;
+	engine->graphParams->enqueue(change);
+
+	// Keep the value for when the graph is rebuilt
+	for (size_t i = 0; i < engine->graphSpec.nodes.size(); ++i) {
+		if (engine->graphSpec.nodes[i].id == id) {
+			engine->graphSpec.nodes[i].params[name] = value;
 		}
-	} else if (engine->isRecording) {
-	// Recording
-		float* recordingBuffer = new float[engine->bufferSize];
-		memcpy(recordingBuffer, inputBuffer, engine->bufferSize * sizeof(float));
-		engine->recordingBufferCache.push_back(recordingBuffer);
-		// @todo: add progress info
-		engine->_emit("recording_progress", 0, {});
-	}
-
-	// Calculate peaks etc.
-	float min[engine->inputChannels];
-	float max[engine->inputChannels];
-	int channelIdx, sampleIdx;
-	for (channelIdx = 0; channelIdx < engine->inputChannels; ++channelIdx) {
-		// The maximum is 1.0
-		min[channelIdx] = 1.0;
-		// The minimum -1.0
-		max[channelIdx] = -1.0;
-		for (sampleIdx = 0; sampleIdx < engine->bufferSize; ++sampleIdx) {
-			int idx = (channelIdx+1) * sampleIdx;
-			float sample = inputBuffer[idx];
-			// Calculate min/max values
-			if (sample < min[channelIdx]) min[channelIdx] = sample;
-			if (sample > max[channelIdx]) max[channelIdx] = sample;
-		}
-	}
-
-	// Emit the info object
-	Local<Object> info = Nan::New<Object>();
-	Local<Array> minima = Nan::New<Array>(engine->inputChannels);
-	Local<Array> maxima = Nan::New<Array>(engine->inputChannels);
-	for (channelIdx = 0; channelIdx < engine->inputChannels; ++channelIdx) {
-		minima->Set(channelIdx, Nan::New<Number>(min[channelIdx]));
-		maxima->Set(channelIdx, Nan::New<Number>(max[channelIdx]));
 	}
-	Nan::Set(info, Nan::New<String>("min").ToLocalChecked(), minima);
-	Nan::Set(info, Nan::New<String>("max").ToLocalChecked(), maxima);
-	Local<Value> argv[] = {info};
-	engine->_emit("info", 1, argv);
+}
+
+/**
+ * Reads an array of eq bands ({type, frequency, q, gain}) and throws if it is malformed.
+ */
+static bool _getEqBands(Local<Value> value, vector<Sound::EqBand>* bands) {
+	if (value->IsArray() == false) {
+		Nan::ThrowTypeError("The bands must be an array.");
+		return false;
+	}
+	Local<Array> _bands = Local<Array>::Cast(value);
+	for (uint32_t i = 0; i < _bands->Length(); ++i) {
+		Local<Value> _band = _bands->Get(i);
+		if (_band->IsObject() == false) {
+			Nan::ThrowTypeError("Every band must be an object.");
+			return false;
+		}
+		Local<Object> band = Nan::To<Object>(_band).ToLocalChecked();
+
+		Sound::EqBand eqBand;
+		eqBand.type = Sound::BiquadPeak;
+		eqBand.frequency = 1000.0;
+		eqBand.q = M_SQRT1_2;
+		eqBand.gain = 0.0;
+		if (Nan::HasOwnProperty(band, Nan::New<String>("type").ToLocalChecked()).FromMaybe(false)) {
+			Local<String> _type = Nan::To<String>(Nan::Get(band, Nan::New<String>("type").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			if (Sound::parseBiquadType(string(*String::Utf8Value(_type)), &eqBand.type) == false) {
+				Nan::ThrowTypeError("type must be one of lowpass, highpass, bandpass, notch, peak, lowshelf, highshelf or allpass.");
+				return false;
+			}
+		}
+		if (Nan::HasOwnProperty(band, Nan::New<String>("frequency").ToLocalChecked()).FromMaybe(false)) {
+			Local<Number> _frequency = Nan::To<Number>(Nan::Get(band, Nan::New<String>("frequency").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			eqBand.frequency = _frequency->NumberValue();
+		}
+		if (Nan::HasOwnProperty(band, Nan::New<String>("q").ToLocalChecked()).FromMaybe(false)) {
+			Local<Number> _q = Nan::To<Number>(Nan::Get(band, Nan::New<String>("q").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			eqBand.q = _q->NumberValue();
+		}
+		if (Nan::HasOwnProperty(band, Nan::New<String>("gain").ToLocalChecked()).FromMaybe(false)) {
+			Local<Number> _gain = Nan::To<Number>(Nan::Get(band, Nan::New<String>("gain").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			eqBand.gain = _gain->NumberValue();
+		}
+		bands->push_back(eqBand);
+	}
+	return true;
+}
+
+void Sound::Engine::GetEq(const Nan::FunctionCallbackInfo<Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	Local<Array> bands = Nan::New<Array>((int)engine->eqBands.size());
+	for (size_t i = 0; i < engine->eqBands.size(); ++i) {
+		const EqBand& eqBand = engine->eqBands[i];
+		Local<Object> band = Nan::New<Object>();
+		Nan::Set(band, Nan::New<String>("type").ToLocalChecked(), Nan::New<String>(biquadTypeName(eqBand.type)).ToLocalChecked());
+		Nan::Set(band, Nan::New<String>("frequency").ToLocalChecked(), Nan::New<Number>(eqBand.frequency));
+		Nan::Set(band, Nan::New<String>("q").ToLocalChecked(), Nan::New<Number>(eqBand.q));
+		Nan::Set(band, Nan::New<String>("gain").ToLocalChecked(), Nan::New<Number>(eqBand.gain));
+		bands->Set((uint32_t)i, band);
+	}
+	info.GetReturnValue().Set(bands);
+}
+
+void Sound::Engine::SetEq(const Nan::FunctionCallbackInfo<Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// Without bands (or with null) the equalizer is flat again
+	vector<EqBand> bands;
+	if (info.Length() >= 1 && info[0]->IsNull() == false && info[0]->IsUndefined() == false) {
+		if (_getEqBands(info[0], &bands) == false) return;
+	}
+
+	// The new coefficients are faded in, so bands can be changed while audio runs
+	engine->eqBands = bands;
+	engine->equalizer->setBands(bands);
+}
+
+void Sound::Engine::SetConvolver(const Nan::FunctionCallbackInfo<Value>& info) {
+	Nan::HandleScope scope;
+	Engine* engine = Nan::ObjectWrap::Unwrap<Engine>(info.Holder());
+
+	// Without a file (or with null) the convolution is removed right away
+	if (info.Length() < 1 || info[0]->IsNull() || info[0]->IsUndefined()) {
+		delete engine->convolver;
+		engine->convolver = NULL;
+		engine->convolverFile = string();
+		engine->convolverRequest++;
+		return;
+	}
+	if (info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be the filename of an impulse response or null.");
+		return;
+	}
+	string file = string(*String::Utf8Value(info[0]));
+
+	float mix = 1.0f;
+	if (info.Length() >= 2 && info[1]->IsObject() && info[1]->IsFunction() == false) {
+		Local<Object> options = Nan::To<Object>(info[1]).ToLocalChecked();
+		if (Nan::HasOwnProperty(options, Nan::New<String>("mix").ToLocalChecked()).FromMaybe(false)) {
+			Local<Number> _mix = Nan::To<Number>(Nan::Get(options, Nan::New<String>("mix").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+			mix = (float)_mix->NumberValue();
+		}
+	}
+
+	// The callback is the last argument (the options may be omitted)
+	Nan::Callback* callback = NULL;
+	if (info.Length() >= 2 && info[info.Length() - 1]->IsFunction()) {
+		callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+	}
+
+	// Decoding, resampling and transforming the partitions happens on the threadpool
+	ConvolverWorker* worker = new ConvolverWorker(engine, callback, info.Holder(), file, mix, false);
+	Local<Value> promise = worker->promise();
+	Nan::AsyncQueueWorker(worker);
+	info.GetReturnValue().Set(promise);
+}
+
+void Sound::Engine::_onProcessingSignal(uv_async_t *handle) {
+	Engine* engine = (Engine*)(handle->data);
+	engine->_processing();
+}
+
+void Sound::Engine::_onProcessingTimer(uv_timer_t *handle) {
+	Engine* engine = (Engine*)(handle->data);
+	engine->_processing();
+}
+
+void Sound::Engine::_processing() {
+	Nan::HandleScope scope;
+
+	// Graphs the stream callback replaced since the last wakeup
+	_collectGraphs();
+
+	// Process every input buffer that arrived since the last wakeup
+	uint64_t begin = uv_hrtime();
+	int blocks = 0;
+	InputBlock inputBlock;
+	while (inBufferQueue->try_dequeue(inputBlock)) {
+		_processBuffer(inputBlock.samples, inputBlock.time);
+		++blocks;
+	}
+	if (blocks == 0) return;
+	telemetry->record(TelemetryProcessing, uv_hrtime() - begin);
+	_emitStats();
+}
 
-	// If there are data listeners, let them process the buffer
-	map<string, vector<Listener*>*>::iterator it = engine->listeners.find(string("data"));
-	if (it != engine->listeners.end()) {
+void Sound::Engine::_processBuffer(float* inputBuffer, double time) {
+	Nan::HandleScope scope;
 
-		// Create a v8 array for the processing
-		Local<Array> processingBuffer = Nan::New<Array>(engine->bufferSize);
-		for (int i = 0; i < engine->bufferSize; ++i) {
-			processingBuffer->Set(i, Nan::New<Number>(inputBuffer[i]));
+	AudioBlock block(inputBuffer, bufferSize, inputChannels);
+	int channels = block.channels();
+	blockTime = time;
+
+	// Scheduled commands split playback and recording at the frames they are due at
+	blockGain = isMuted ? 0.0f : (float)volume;
+	gainChanges.clear();
+	TimelineCommand command;
+	int offset = 0;
+	int due;
+	while (timeline.next(processedFrames, time, bufferSize, sampleRate, &command, &due)) {
+		if (due > offset) {
+			_transport(block, offset, due);
+			offset = due;
 		}
-		
-		vector<Listener*>* eventListeners = it->second;
-		vector<Listener*>::iterator it2 = eventListeners->begin();
-		while(it2 != eventListeners->end()) {
-			Listener* lsnr = *it2;
-			Nan::Persistent<Function>* _cb = lsnr->cb;
-			Local<Function> fn = Nan::New<Function>(*_cb);
-			Nan::Callback cb(fn);
-
-			int argc = 1;
-			Local<Value> argv[1] = {processingBuffer};
-			Local<Value> resultBuffer = cb.Call(argc, argv);
-			if (resultBuffer->IsArray()) {
-				processingBuffer = Local<Array>::Cast(resultBuffer);
+		_applyCommand(command, due);
+	}
+	if (offset < bufferSize) _transport(block, offset, bufferSize);
+
+	// Equalize and convolve what is measured, processed in js and played
+	equalizer->process(block);
+	if (convolver != NULL) convolver->process(block);
+
+	// Measure the levels and emit them every infoInterval
+	if (_hasListeners(EventInfo) == false) {
+		meterIdle = true;
+	} else {
+		if (meterIdle) {
+			// The loudness windows must not contain audio from before the listener was added
+			meter->reset();
+			meterIdle = false;
+		}
+		meter->process(block);
+		if (meter->frames() * 1000.0 >= infoInterval * sampleRate) {
+			_emitInfo();
+			meter->restart();
+		}
+	}
+
+	// If there are data listeners, let them process the buffer in place
+	if (_hasListeners(EventData)) {
+
+		// Expose the block memory itself to js instead of copying it into a v8 array
+		Local<ArrayBuffer> blockMemory = ArrayBuffer::New(Isolate::GetCurrent(), inputBuffer, AudioBlock::sizeFor(bufferSize, channels) * sizeof(float));
+		// One view per channel, the first one is also passed on its own
+		Local<Array> channelBuffers = Nan::New<Array>(channels);
+		for (int channelIdx = 0; channelIdx < channels; ++channelIdx) {
+			channelBuffers->Set(channelIdx, Float32Array::New(blockMemory, (size_t)channelIdx * block.stride() * sizeof(float), bufferSize));
+		}
+		Local<Value> processingBuffer = channelBuffers->Get(0);
+
+		EventSlot* slot = &events[EventData];
+		slot->emitting++;
+		size_t count = slot->listeners.size();
+		for (size_t i = 0; i < count; ++i) {
+			Listener* lsnr = slot->listeners[i];
+			if (lsnr->removed) continue;
+			if (lsnr->once) _retireListener(EventData, lsnr);
+
+			int argc = 2;
+			Local<Value> argv[2] = {processingBuffer, channelBuffers};
+			uint64_t begin = uv_hrtime();
+			Local<Value> resultBuffer = lsnr->callback->Call(argc, argv);
+			telemetry->record(TelemetryListeners, uv_hrtime() - begin);
+			float* firstChannel = block.channel(0);
+			if (resultBuffer.IsEmpty() || resultBuffer->IsUndefined() || resultBuffer == processingBuffer) {
+				// The buffer was processed in place
+			} else if (resultBuffer->IsFloat32Array()) {
+				// Another typed array was returned so take over its samples
+				Nan::TypedArrayContents<float> result(resultBuffer);
+				int length = result.length() < (size_t)bufferSize ? (int)result.length() : bufferSize;
+				memmove(firstChannel, *result, length * sizeof(float));
+			} else if (resultBuffer->IsArray()) {
+				// Plain arrays are still supported but need to be copied element by element
+				Local<Array> result = Local<Array>::Cast(resultBuffer);
+				int length = (int)result->Length() < bufferSize ? (int)result->Length() : bufferSize;
+				for (int i = 0; i < length; ++i) {
+					firstChannel[i] = Nan::To<double>(result->Get(i)).FromJust();
+				}
 			} else {
-				Nan::ThrowTypeError("Return type for data listener must be an array.");
+				Nan::ThrowTypeError("Return type for data listener must be a Float32Array, an array or undefined.");
 			}
+		}
+		slot->emitting--;
+		_settleListeners(EventData);
+
+		// The block goes back to the pool afterwards so js must not be able to access it anymore
+		blockMemory->Neuter();
+	}
+
+	// Apply outgoing stuff like tones, clips and volume (they also run while muted so they end on time)
+	tones->render(block, processedFrames);
+	_emitToneEvents();
+	clips->render(block, processedFrames);
+	const vector<int>& ended = clips->finished();
+	for (size_t i = 0; i < ended.size(); ++i) {
+		Local<Value> argv[] = {Nan::New<Integer>(ended[i])};
+		_emit(EventClipEnded, 1, argv);
+	}
+	_applyVolume(block);
+
+	processedFrames += bufferSize;
+
+	// Enqueue the processed inputBuffer to the outBufferQueue (drop it if the queue is full)
+	if (outBufferQueue->try_enqueue(inputBuffer) == false) {
+		bufferPool->release(inputBuffer);
+		telemetry->count(TelemetryDropped);
+	}
+}
 
-			if (lsnr->once) {
-				it2 = eventListeners->erase(it2);
-				delete lsnr;
+void Sound::Engine::_transport(AudioBlock& block, int from, int to) {
+	int frames = to - from;
+	int channels = block.channels();
+
+	// Overwrite with playback buffer when isPlaying is active
+	if (isPlaying) {
+	// Playing back
+		int64_t samplesCount = playbackSource->size();
+		if (playbackPosition < samplesCount) {
+			float* samples = _interleaved(frames * playbackChannels);
+			int64_t samplesRead = playbackSource->read(playbackPosition, samples, frames * playbackChannels);
+			if (frames == bufferSize) {
+				// The rest of the last block is filled with silence
+				block.deinterleave(samples, (int)(samplesRead / playbackChannels), playbackChannels);
 			} else {
-				++it2;
+				// Playback started or stops within the block, the other frames keep the input
+				AudioBlock part(transportBlock, bufferSize, channels);
+				part.deinterleave(samples, (int)(samplesRead / playbackChannels), playbackChannels);
+				for (int c = 0; c < channels; ++c) {
+					memcpy(block.channel(c) + from, part.channel(c), sizeof(float) * frames);
+				}
 			}
+			_progress(EventPlaybackProgress, &playbackProgress, (double)playbackPosition/(double)samplesCount);
+			playbackPosition += frames * playbackChannels;
+		} else {
+			isPlaying = false;
+			playbackPosition = 0;
+			_flushProgress(EventPlaybackProgress, &playbackProgress);
+			_emit(EventPlaybackFinished, 0, {});
+		}
+	} else if (isRecording) {
+	// Recording
+		float* samples = _interleaved(bufferSize * channels);
+		block.interleave(samples, bufferSize, channels);
+		if (diskRecorder != NULL) {
+			diskRecorder->write(samples + from * channels, frames * channels);
+		} else {
+			recording->append(samples + from * channels, frames * channels);
 		}
+		recordedSamples += frames * channels;
+		_progress(EventRecordingProgress, &recordingProgress, (double)recordedSamples);
+	}
+}
+
+void Sound::Engine::_applyCommand(const TimelineCommand& command, int offset) {
+	string error;
+	switch (command.action) {
+		case TimelineStartPlayback:
+			_startPlayback();
+			break;
+		case TimelineStopPlayback:
+			_stopPlayback();
+			break;
+		case TimelinePausePlayback:
+			_pausePlayback();
+			break;
+		case TimelineStartRecording:
+			_startRecording(command.file, command.format, &error);
+			break;
+		case TimelineStopRecording:
+			_stopRecording(&error);
+			break;
+		case TimelineSetVolume:
+			volume = command.value;
+			gainChanges.push_back(make_pair(offset, isMuted ? 0.0f : (float)volume));
+			break;
+		case TimelineSetMute:
+			isMuted = command.value != 0.0;
+			gainChanges.push_back(make_pair(offset, isMuted ? 0.0f : (float)volume));
+			break;
+		case TimelineSetPlaybackProgress:
+			_setPlaybackProgress(command.value);
+			break;
+	}
+	if (error.empty() == false) {
+		printf("Warning: Scheduled %s failed: %s\n", timelineActionName(command.action), error.c_str());
+	}
+}
 
-		// Copy the processed values in the buffer
-		for (int i = 0; i < engine->bufferSize; ++i) {
-			inputBuffer[i] = Nan::To<double>(processingBuffer->Get(i)).FromJust();
+void Sound::Engine::_applyVolume(AudioBlock& block) {
+	// Without scheduled changes the volume and mute that are set now apply to the whole block
+	if (gainChanges.empty()) {
+		if (isMuted) {
+			block.clear();
+		} else if (volume != 1.0) {
+			block.scale((float)volume);
 		}
+		return;
 	}
 
-	// Apply outgoing stuff like volume, beep etc.
-	for (int i = 0; i < engine->bufferSize; ++i) {
-		if (engine->isMuted) {
-			inputBuffer[i] = 0;
-		} else {
-			if (engine->isBeeping) {
-				++engine->beepIdx;
-				if (engine->beepIdx == 0) engine->_emit("beep_started", 0, {});
-				double relPos = (double)engine->beepIdx / (double)engine->beepEndIdx;
-				//Math.sin(2 * this.beepFrequency * (position * this.beepTotal * Math.PI)) * 0.72 * this.beepLevel
-				inputBuffer[i] += sin((double)2 * engine->beepFrequency * (relPos * engine->beepDuration * M_PI)) * 0.72 * engine->beepLevel;
+	float gain = blockGain;
+	int from = 0;
+	for (size_t i = 0; i <= gainChanges.size(); ++i) {
+		int to = i < gainChanges.size() ? gainChanges[i].first : bufferSize;
+		if (to > from && gain != 1.0f) {
+			for (int c = 0; c < block.channels(); ++c) {
+				float* x = block.channel(c);
+				for (int j = from; j < to; ++j) x[j] *= gain;
 			}
-			inputBuffer[i] *= engine->volume;
+		}
+		if (i < gainChanges.size()) {
+			gain = gainChanges[i].second;
+			from = to;
 		}
 	}
-
-	// Enqueue the processed inputBuffer to the outBufferQueue
-	engine->outBufferQueue->enqueue(inputBuffer);
 }
 
 int Sound::Engine::_streamCallback(
@@ -829,62 +1657,320 @@ int Sound::Engine::_streamCallback(
 			void *userData)
 {
 	Engine* engine = (Engine*)(userData);
+	// uv_hrtime reads the monotonic clock, it neither locks nor allocates
+	uint64_t begin = uv_hrtime();
+	engine->telemetry->count(TelemetryCallbacks);
+	engine->telemetry->status(statusFlags);
 
-	int samplesCount = engine->bufferSize;
+	int frames = (int)frameCount < engine->bufferSize ? (int)frameCount : engine->bufferSize;
 
-	float* inputBuffer = (float*)input;
+	const float* inputBuffer = (const float*)input;
 	float* outputBuffer = (float*)output;
 
-	// Enqueue the new inputBuffer
-	float* inCopy = new float[samplesCount];
+	// Take over a new graph and parameter changes before anything is rendered
+	engine->_pollGraph();
+	DspGraph* graph = engine->activeGraph;
+	if (graph != NULL && graph->bypass()) graph = NULL;
 
-	// input can be NULL for output only streams
-	if (input != NULL)
-		memcpy(inCopy, inputBuffer, sizeof(float) * samplesCount);
-	else
-		for (int i = 0; i < samplesCount; ++i) inCopy[i] = 0.0;
+	// Copy the new input into a planar block (the input is dropped when all blocks are in use)
+	float* inCopy = engine->bufferPool->acquire();
+	if (inCopy != NULL) {
+		// input can be NULL for output only streams (the block is silenced then)
+		AudioBlock block(inCopy, engine->bufferSize, engine->inputChannels);
+		block.deinterleave(inputBuffer, frames, engine->inputChannels);
 
-	engine->inBufferQueue->enqueue(inCopy);
+		// Feed the spectral analysis
+		if (input != NULL) engine->stft->write(block);
+	}
 
 	// Dequeue an outputBuffer from the queue if available
-	float* outCopy;
+	float* outCopy = NULL;
+	engine->telemetry->record(TelemetryOutQueue, engine->outBufferQueue->size_approx());
 	bool hasOutputBuffer = engine->outBufferQueue->try_dequeue(outCopy);
+	// A graph that does not play the engine output doesn't need the processed block
+	if (hasOutputBuffer == false && (graph == NULL || graph->usesEngine())) {
+		engine->telemetry->count(TelemetryUnderflows);
+	}
+
+	if (graph != NULL) {
+		// The graph renders the live input straight to the device, the blocks of the js thread are just another source
+		AudioBlock inBlock(inCopy, engine->bufferSize, engine->inputChannels);
+		AudioBlock outBlock(outCopy, engine->bufferSize, engine->inputChannels);
+		graph->process(inCopy != NULL ? &inBlock : NULL, hasOutputBuffer ? &outBlock : NULL, frames);
+		// output could be NULL for input only streams
+		if (output != NULL) graph->output().interleave(outputBuffer, frames, engine->outputChannels);
+	}
+
+	// The js thread owns the input block once it is queued, so this happens after the graph read it
+	if (inCopy != NULL) {
+		// Output only streams have no capture time, their blocks are stamped with the time of the callback
+		InputBlock inputBlock;
+		inputBlock.samples = inCopy;
+		inputBlock.time = input != NULL ? timeInfo->inputBufferAdcTime : timeInfo->currentTime;
+		if (engine->inBufferQueue->try_enqueue(inputBlock) == false) {
+			engine->bufferPool->release(inCopy);
+			engine->telemetry->count(TelemetryOverflows);
+		} else {
+			// Wake up the processing on the js thread
+			uv_async_send(engine->processingAsync);
+		}
+		engine->telemetry->record(TelemetryInQueue, engine->inBufferQueue->size_approx());
+	} else {
+		engine->telemetry->count(TelemetryOverflows);
+	}
+
 	if (hasOutputBuffer == false) {
-		printf("Underflow detected...\n");
+		if (graph == NULL && output != NULL) {
+			memset(outputBuffer, 0, sizeof(float) * frameCount * engine->outputChannels);
+		}
+		engine->telemetry->record(TelemetryCallback, uv_hrtime() - begin);
 		return 0;
 	}
 
 	// output could be NULL for input only streams
-	if (output != NULL)
-		for (int i = 0; i < engine->bufferSize; ++i)
-			outputBuffer[i] = outCopy[i];
+	if (graph == NULL && output != NULL) {
+		AudioBlock block(outCopy, engine->bufferSize, engine->inputChannels);
+		block.interleave(outputBuffer, frames, engine->outputChannels);
+	}
 
-	delete[] outCopy;
+	engine->bufferPool->release(outCopy);
+	engine->telemetry->record(TelemetryCallback, uv_hrtime() - begin);
 	return 0;
 }
 
-void Sound::Engine::_stopBeep(uv_timer_t *handle) {
-	// Stop the timer
-	uv_timer_stop(handle);
+void Sound::Engine::_pollGraph() {
+	// A new graph is only taken over once the replaced one has a place in the queue back to the
+	// js thread, otherwise the current graph keeps playing until a later callback (nothing allocates here)
+	if (pendingGraph.load() != NULL && (activeGraph == NULL || retiredGraphs->try_enqueue(activeGraph))) {
+		// Only the js thread publishes graphs and it never takes a pending graph back while the stream runs
+		activeGraph = pendingGraph.exchange(NULL);
+	}
+
+	// Changes for a graph that is not published yet stay queued, changes for replaced graphs are dropped
+	DspParamChange* change;
+	while ((change = graphParams->peek()) != NULL) {
+		if (activeGraph == NULL || change->generation > activeGraph->generation()) break;
+		if (change->generation == activeGraph->generation()) {
+			activeGraph->setParam(change->node, change->param, change->value);
+		}
+		graphParams->pop();
+	}
+}
+
+void Sound::Engine::_emitToneEvents() {
+	// Every beep starts on its own, beep_stopped is emitted when the last beep faded out
+	const vector<int>& started = tones->started();
+	for (size_t i = 0; i < started.size(); ++i) {
+		if (find(beepVoices.begin(), beepVoices.end(), started[i]) != beepVoices.end()) {
+			_emit(EventBeepStarted, 0, {});
+		} else {
+			Local<Value> argv[] = {Nan::New<Integer>(started[i])};
+			_emit(EventToneStarted, 1, argv);
+		}
+	}
+	const vector<int>& finished = tones->finished();
+	for (size_t i = 0; i < finished.size(); ++i) {
+		vector<int>::iterator beep = find(beepVoices.begin(), beepVoices.end(), finished[i]);
+		if (beep != beepVoices.end()) {
+			beepVoices.erase(beep);
+			if (beepVoices.empty()) _emit(EventBeepStopped, 0, {});
+		} else {
+			Local<Value> argv[] = {Nan::New<Integer>(finished[i])};
+			_emit(EventToneStopped, 1, argv);
+		}
+	}
+}
+
+void Sound::Engine::_emitInfo() {
+	int channels = meter->channels();
+	Local<Array> minima = Nan::New<Array>(channels);
+	Local<Array> maxima = Nan::New<Array>(channels);
+	Local<Array> peaks = Nan::New<Array>(channels);
+	Local<Array> rms = Nan::New<Array>(channels);
+	Local<Array> truePeaks = Nan::New<Array>(channels);
+	for (int c = 0; c < channels; ++c) {
+		minima->Set(c, Nan::New<Number>(meter->minimum(c)));
+		maxima->Set(c, Nan::New<Number>(meter->maximum(c)));
+		peaks->Set(c, Nan::New<Number>(meter->peak(c)));
+		rms->Set(c, Nan::New<Number>(meter->rms(c)));
+		truePeaks->Set(c, Nan::New<Number>(meter->truePeak(c)));
+	}
+
+	Local<Object> info = Nan::New<Object>();
+	Nan::Set(info, Nan::New<String>("min").ToLocalChecked(), minima);
+	Nan::Set(info, Nan::New<String>("max").ToLocalChecked(), maxima);
+	Nan::Set(info, Nan::New<String>("peak").ToLocalChecked(), peaks);
+	Nan::Set(info, Nan::New<String>("rms").ToLocalChecked(), rms);
+	Nan::Set(info, Nan::New<String>("truePeak").ToLocalChecked(), truePeaks);
+	Nan::Set(info, Nan::New<String>("momentary").ToLocalChecked(), Nan::New<Number>(meter->momentary()));
+	Nan::Set(info, Nan::New<String>("shortTerm").ToLocalChecked(), Nan::New<Number>(meter->shortTerm()));
+	Nan::Set(info, Nan::New<String>("frames").ToLocalChecked(), Nan::New<Number>((double)meter->frames()));
+	Local<Value> argv[] = {info};
+	_emit(EventInfo, 1, argv);
+}
+
+/**
+ * The distribution of a histogram, scaled to the unit js sees.
+ */
+static Local<Object> _histogramObject(const Sound::HistogramSnapshot& histogram, double scale) {
+	Local<Object> result = Nan::New<Object>();
+	Nan::Set(result, Nan::New<String>("count").ToLocalChecked(), Nan::New<Number>((double)histogram.count));
+	Nan::Set(result, Nan::New<String>("min").ToLocalChecked(), Nan::New<Number>(histogram.minimum() * scale));
+	Nan::Set(result, Nan::New<String>("mean").ToLocalChecked(), Nan::New<Number>(histogram.mean() * scale));
+	Nan::Set(result, Nan::New<String>("p50").ToLocalChecked(), Nan::New<Number>(histogram.percentile(0.5) * scale));
+	Nan::Set(result, Nan::New<String>("p90").ToLocalChecked(), Nan::New<Number>(histogram.percentile(0.9) * scale));
+	Nan::Set(result, Nan::New<String>("p99").ToLocalChecked(), Nan::New<Number>(histogram.percentile(0.99) * scale));
+	Nan::Set(result, Nan::New<String>("p999").ToLocalChecked(), Nan::New<Number>(histogram.percentile(0.999) * scale));
+	Nan::Set(result, Nan::New<String>("max").ToLocalChecked(), Nan::New<Number>(histogram.maximum() * scale));
+	return result;
+}
+
+Local<Object> Sound::Engine::_statsObject(const TelemetrySnapshot& stats) {
+	// The durations are in ns, js gets ms
+	const HistogramSnapshot& callback = stats.histograms[TelemetryCallback];
+	double budget = bufferSize * 1000.0 / sampleRate;
+
+	Local<Object> status = Nan::New<Object>();
+	Nan::Set(status, Nan::New<String>("inputUnderflow").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryInputUnderflow]));
+	Nan::Set(status, Nan::New<String>("inputOverflow").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryInputOverflow]));
+	Nan::Set(status, Nan::New<String>("outputUnderflow").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryOutputUnderflow]));
+	Nan::Set(status, Nan::New<String>("outputOverflow").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryOutputOverflow]));
+	Nan::Set(status, Nan::New<String>("primingOutput").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryPrimingOutput]));
+
+	Local<Object> result = Nan::New<Object>();
+	Nan::Set(result, Nan::New<String>("elapsed").ToLocalChecked(), Nan::New<Number>(stats.time / 1e6));
+	Nan::Set(result, Nan::New<String>("budget").ToLocalChecked(), Nan::New<Number>(budget));
+	Nan::Set(result, Nan::New<String>("load").ToLocalChecked(), Nan::New<Number>(callback.mean() / 1e6 / budget));
+	Nan::Set(result, Nan::New<String>("callbacks").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryCallbacks]));
+	Nan::Set(result, Nan::New<String>("underflows").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryUnderflows]));
+	Nan::Set(result, Nan::New<String>("overflows").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryOverflows]));
+	Nan::Set(result, Nan::New<String>("dropped").ToLocalChecked(), Nan::New<Number>((double)stats.counters[TelemetryDropped]));
+	Nan::Set(result, Nan::New<String>("status").ToLocalChecked(), status);
+	Nan::Set(result, Nan::New<String>("callback").ToLocalChecked(), _histogramObject(callback, 1e-6));
+	Nan::Set(result, Nan::New<String>("processing").ToLocalChecked(), _histogramObject(stats.histograms[TelemetryProcessing], 1e-6));
+	Nan::Set(result, Nan::New<String>("listeners").ToLocalChecked(), _histogramObject(stats.histograms[TelemetryListeners], 1e-6));
+	Nan::Set(result, Nan::New<String>("inQueue").ToLocalChecked(), _histogramObject(stats.histograms[TelemetryInQueue], 1.0));
+	Nan::Set(result, Nan::New<String>("outQueue").ToLocalChecked(), _histogramObject(stats.histograms[TelemetryOutQueue], 1.0));
+	return result;
+}
+
+void Sound::Engine::_emitStats() {
+	if (_hasListeners(EventStats) == false) {
+		statsIdle = true;
+		return;
+	}
+	if (statsIdle) {
+		// The first span starts when the listener was added
+		statsEventBaseline = telemetry->snapshot();
+		statsLastEmit = processedFrames;
+		statsIdle = false;
+		return;
+	}
+	if ((processedFrames - statsLastEmit) * 1000.0 < statsInterval * sampleRate) return;
+	statsLastEmit = processedFrames;
+
+	TelemetrySnapshot now = telemetry->snapshot();
+	Local<Value> argv[] = {_statsObject(now.since(statsEventBaseline))};
+	statsEventBaseline = now;
+	_emit(EventStats, 1, argv);
+}
 
+void Sound::Engine::_onFftSignal(uv_async_t *handle) {
 	Engine* engine = (Engine*)(handle->data);
+	if (engine == NULL) return;
 	Nan::HandleScope scope;
+	engine->_emitSpectra();
+}
+
+void Sound::Engine::_emitSpectra() {
+	int bins = stft->bins();
+
+	StftFrame* frame;
+	while ((frame = stft->poll()) != NULL) {
+		if (_hasListeners(EventFft) == false) {
+			// Nobody is interested anymore so stop analysing
+			stft->setEnabled(false);
+			stft->recycle(frame);
+			continue;
+		}
+
+		Local<Float32Array> magnitude = Float32Array::New(ArrayBuffer::New(Isolate::GetCurrent(), bins * sizeof(float)), 0, bins);
+		Local<Float32Array> phase = Float32Array::New(ArrayBuffer::New(Isolate::GetCurrent(), bins * sizeof(float)), 0, bins);
+		memcpy(magnitude->Buffer()->GetContents().Data(), frame->magnitude, bins * sizeof(float));
+		memcpy(phase->Buffer()->GetContents().Data(), frame->phase, bins * sizeof(float));
+		double position = (double)frame->position;
+		stft->recycle(frame);
+
+		Local<Object> spectrum = Nan::New<Object>();
+		Nan::Set(spectrum, Nan::New<String>("magnitude").ToLocalChecked(), magnitude);
+		Nan::Set(spectrum, Nan::New<String>("phase").ToLocalChecked(), phase);
+		Nan::Set(spectrum, Nan::New<String>("position").ToLocalChecked(), Nan::New<Number>(position));
+		Local<Value> argv[] = {spectrum};
+		_emit(EventFft, 1, argv);
+	}
+}
+
+void Sound::Engine::_onAsyncClosed(uv_handle_t *handle) {
+	delete (uv_async_t*)handle;
+}
+
+void Sound::Engine::_configureBuffers() {
+	// The stream is stopped at this point so no block is in flight
+	delete inBufferQueue;
+	delete outBufferQueue;
+	delete bufferPool;
+
+	inBufferQueue = new moodycamel::ReaderWriterQueue<InputBlock>(queueDepth);
+	outBufferQueue = new moodycamel::ReaderWriterQueue<float*>(queueDepth);
 
-	// Set defaults
-	engine->isBeeping = false;
-	engine->beepIdx = -1;
-	engine->beepDuration = BEEP_DETAULT_DURATION;
-	engine->beepFrequency = BEEP_DETAULT_FREQUENCY;
-	engine->beepLevel = BEEP_DETAULT_LEVEL;
+	// Every block is either waiting in one of the queues, processed in js or held by the stream callback.
+	// Blocks are planar with the input channels and get mapped to the output channels in the stream callback.
+	bufferPool = new BufferPool(AudioBlock::sizeFor(bufferSize, inputChannels), 2 * queueDepth + 2);
 
-	engine->_emit("beep_stopped", 0, {});
+	free(transportBlock);
+	void* memory = NULL;
+	if (posix_memalign(&memory, AUDIO_BLOCK_ALIGNMENT, sizeof(float) * AudioBlock::sizeFor(bufferSize, inputChannels)) != 0) {
+		memory = NULL;
+	}
+	transportBlock = (float*)memory;
+}
+
+float* Sound::Engine::_interleaved(int count) {
+	if ((int)interleaved.size() < count) {
+		interleaved.resize(count);
+	}
+	return interleaved.data();
 }
 
+void Sound::Engine::_configureAnalysis() {
+	// The stream is stopped at this point so the callback does not write into the old analysis
+	delete stft;
+	stft = new Stft(fftWindowSize, fftOverlapSize, fftWindowFunctionType, bufferSize, fftAsync);
+	stft->setEnabled(_hasListeners(EventFft));
 
+	delete meter;
+	meter = new Meter(sampleRate, inputChannels, bufferSize);
+	meterIdle = true;
+}
+
+void Sound::Engine::_clearQueues() {
+	InputBlock inputBlock;
+	while (inBufferQueue->try_dequeue(inputBlock)) bufferPool->release(inputBlock.samples);
+	float* block;
+	while (outBufferQueue->try_dequeue(block)) bufferPool->release(block);
+}
 
 void Sound::Engine::_configureStream() {
 	PaError paErr;
 
+	_configureBuffers();
+	_configureAnalysis();
+	_rebuildGraph();
+	_configureEq();
+	_configureConvolver();
+	_configureClips();
+	tones->setSampleRate(sampleRate);
+
 	PaStreamParameters* inParams = NULL;
 	if (inputDevice != -1) {
 		inputParameters.device = inputDevice;
@@ -941,8 +2027,13 @@ void Sound::Engine::_startStream() {
 		return;
 	}
 
-	// Restart the processing timer
-	uv_timer_start(&processing_timer, _processing, 0, PROCESSING_INTERVAL);
+	// Keep the event loop alive for the processing wakeups
+	uv_ref((uv_handle_t*)processingAsync);
+
+	// Restart the processing timer if polling is enabled
+	if (processingInterval > 0) {
+		uv_timer_start(&processing_timer, _onProcessingTimer, 0, processingInterval);
+	}
 }
 
 void Sound::Engine::_stopStream() {
@@ -961,10 +2052,10 @@ void Sound::Engine::_stopStream() {
 
 	// Stop processing
 	uv_timer_stop(&processing_timer);
+	uv_unref((uv_handle_t*)processingAsync);
 
 	// Clear queues
-	while(inBufferQueue->pop());
-	while(outBufferQueue->pop());
+	_clearQueues();
 }
 
 void Sound::Engine::_destroyStream() {
@@ -975,209 +2066,523 @@ void Sound::Engine::_destroyStream() {
 }
 
 void Sound::Engine::_loadWave(string file) {
-	ifstream waveFile(file.c_str(), ios::in | ios::binary);
-	if (waveFile) {
-		// Get the file size
-		waveFile.seekg(0, waveFile.end);
-		int fileSize = waveFile.tellg();
-		waveFile.seekg(0, waveFile.beg);
-
-		// Check the header first
-		char _header[44];
-		waveFile.read(_header, 44);
-		WaveHeader header = WaveHeader();
-		memcpy(&header, _header, 44);
-		// @todo: check
-		
-		// Seek to the data
-		waveFile.seekg(44, waveFile.beg);
-		char _data[fileSize - 44];
-		waveFile.read(_data, fileSize - 44);
-
-		int samplesCount = (fileSize - 44) / sizeof(float);
-		float data[samplesCount];
-		memcpy(&data, _data, fileSize - 44);
-
-		// Delete the recording buffer cache to store the loaded file into it
-		_deleteRecording();
-
-		// Fille the playback cache buffer
-		float* playbackBuffer = new float[bufferSize];
-		recordingBufferCache.push_back(playbackBuffer);
-		int nextSampleIdx = 0;
-		for (int i = 0, j = 0; i < samplesCount; ++i) {
-			float sample = data[i];
-			playbackBuffer[j] = sample;
-			++j;
-			nextSampleIdx = j;
-			if (j >= bufferSize) {
-				j = 0;
-				playbackBuffer = new float[bufferSize];
-				recordingBufferCache.push_back(playbackBuffer);
-			}
-		}
-		waveFile.close();
-
-		// When there are not enough samples to fill the last playback buffer fill it with zeros
-		while (nextSampleIdx < bufferSize) {
-			playbackBuffer[nextSampleIdx] = 0.0;
-			++nextSampleIdx;
-		}
-
-		_emit("recording_loaded", 0, {});
+	MappedWave* wave;
+	SampleArena* decoded;
+	int channels;
+	string error;
+	if (_openRecording(file, sampleRate, &wave, &decoded, &channels, &error) == false) {
+		Nan::ThrowError(error.c_str());
+		return;
 	}
+	_useLoadedWave(wave, decoded, channels);
 }
 
-void Sound::Engine::_deleteRecording() {
-	while (!recordingBufferCache.empty()) {
-		delete[] recordingBufferCache.back();
-		recordingBufferCache.pop_back();
+bool Sound::Engine::_openRecording(string file, int sampleRate, MappedWave** wave, SampleArena** decoded, int* channels, string* error) {
+	*wave = NULL;
+	*decoded = NULL;
+
+	if (isSlacFile(file)) {
+		// Compressed files are decoded into memory on all cores
+		SlacReader reader(file);
+		SampleArena* arena = new SampleArena();
+		if (reader.isOpen() == false || reader.decode(arena) == false) {
+			*error = reader.error();
+			delete arena;
+			return false;
+		}
+		*channels = reader.channels();
+		if (reader.sampleRate() != sampleRate) {
+			*decoded = new SampleArena();
+			_resampleInto(arena, reader.sampleRate(), reader.channels(), sampleRate, *decoded);
+			delete arena;
+		} else {
+			*decoded = arena;
+		}
+		return true;
+	}
+
+	// Map the file instead of reading it, playback pulls in the pages on demand
+	MappedWave* mapped = new MappedWave(file);
+	if (mapped->isOpen() == false) {
+		*error = mapped->error();
+		delete mapped;
+		return false;
+	}
+	*channels = mapped->format().channels;
+	if (mapped->format().sampleRate != sampleRate) {
+		// Playback needs the rate of the engine
+		*decoded = new SampleArena();
+		_resampleInto(mapped, mapped->format().sampleRate, *channels, sampleRate, *decoded);
+		delete mapped;
+	} else {
+		*wave = mapped;
 	}
-	_emit("recording_deleted", 0, {});
+	return true;
 }
 
-void Sound::Engine::_saveRecording(string file) {
-	// Calculate the data size for the header
-	int dataSize = bufferSize  * recordingBufferCache.size() * sizeof(float);
-	vector<string> data = vector<string>();
-
-	// Copy the recordingData into the buffer
-	for (vector<float*>::iterator it = recordingBufferCache.begin(); it != recordingBufferCache.end(); ++it) {
-		char charBuffer[bufferSize * sizeof(float)];
-		float* floatBuffer = *it;
-		memcpy(charBuffer, floatBuffer, bufferSize * sizeof(float));
-		data.push_back(string(charBuffer, bufferSize * sizeof(float)));
+void Sound::Engine::_useLoadedWave(MappedWave* wave, SampleArena* decoded, int channels) {
+	if (_deleteRecording() == false) {
+		delete wave;
+		delete decoded;
+		return;
+	}
+	if (channels != inputChannels) {
+		printf("The file has %d channels but the engine uses %d channels.\n", channels, inputChannels);
 	}
 
-	// Create the wave header
-	char header[44];
-	WaveHeader _header = WaveHeader();
+	playbackChannels = channels > 0 ? channels : 1;
+	if (wave != NULL) {
+		// Play the mapped file instead of the recording
+		mappedWave = wave;
+		playbackSource = mappedWave;
+	} else {
+		// The decoded file becomes the recording
+		delete recording;
+		recording = decoded;
+		playbackSource = recording;
+	}
 
-	int bitsPerSample = 32;
-	short int blockAlign = inputChannels * ((bitsPerSample + 7) / 8);
-	int byteRate = sampleRate * (int)blockAlign;
+	_emit(EventRecordingLoaded, 0, {});
+}
 
-	memcpy(_header.RIFF, "RIFF", 4);
-	_header.ChunkSize = dataSize - sizeof(WaveHeader);
-	memcpy(_header.WAVE, "WAVE", 4);
-	memcpy(_header.fmt, "fmt ", 4);
-	_header.Subchunk1Size = 16;
-	_header.AudioFormat = 3; // Since we have float data
-	_header.NumOfChan = inputChannels;
-	_header.SamplesPerSec = sampleRate;
-	_header.bytesPerSec = byteRate;
-	_header.blockAlign = blockAlign;
-	_header.bitsPerSample = bitsPerSample;
-	memcpy(_header.data, "data", 4);
-	_header.Subchunk2Size = dataSize;
-	memcpy(header, &_header, sizeof(_header));
+void Sound::Engine::_resampleInto(const SampleSource* source, int sourceRate, int channels, int sampleRate, SampleArena* arena) {
+	Resampler resampler(sourceRate, sampleRate, channels);
 
-	// Add the header in front of the data
-	data.insert(data.begin(), string(header, 44));
+	const int64_t chunkFrames = 1 << 16;
+	float* in = new float[chunkFrames * channels];
+	int64_t outFrames = resampler.maxOutput(chunkFrames > resampler.taps() ? chunkFrames : resampler.taps());
+	float* out = new float[outFrames * channels];
 
-	// Write all chunks of data to the file
-	FILE* fp;
-	fp = fopen(file.c_str(), "wb");
-	for (vector<string>::iterator it = data.begin(); it != data.end(); ++it) {
-		string chunk = *it;
-		int dataChunkSize = chunk.size();
-		// Create a char array without null termination
-		char* chunkData = new char[dataChunkSize];
-		for (int i = 0; i < dataChunkSize; ++i) {
-			chunkData[i] = chunk[i];
-		}
-		fwrite(chunkData, 1, dataChunkSize, fp);
-		fflush(fp);
-		delete[] chunkData;
+	int64_t position = 0;
+	int64_t samplesRead;
+	while ((samplesRead = source->read(position, in, chunkFrames * channels)) > 0) {
+		int64_t frames = resampler.process(in, samplesRead / channels, out);
+		arena->append(out, frames * channels);
+		position += samplesRead;
 	}
-	fclose(fp);
+	int64_t frames = resampler.flush(out);
+	arena->append(out, frames * channels);
 
-	_emit("recording_saved", 0, {});
+	delete[] in;
+	delete[] out;
 }
 
-void Sound::Engine::_addListener(
-	string eventName,
-	Nan::Persistent<Function>* listener,
-	bool prepend,
-	bool once)
-{
-	map<string, vector<Listener*>*>::iterator it = this->listeners.find(eventName);
-	if (it != this->listeners.end()) {
-		vector<Listener*>* eventListeners = it->second;
-		Listener* lsnr = new Listener(listener, once);
-		if (prepend == false) {
-			// Append the callback
-			eventListeners->push_back(lsnr);
-		} else {
-			// Prepend the callback
-			eventListeners->insert(eventListeners->begin(), lsnr);
-		}
+void Sound::Engine::_startPlayback() {
+	if (isRecording) {
+		printf("Cannot start playback while recording.\n");
 		return;
 	}
-	// Dispose the listener because such an eventName does not exist
-	listener->Reset();
-}
 
-void Sound::Engine::_emit(string eventName, int argc, Local<Value> argv[]) {
-	map<string, vector<Listener*>*>::iterator it = listeners.find(eventName);
-	if (it != listeners.end()) {
-		vector<Listener*>* eventListeners = it->second;
-		vector<Listener*>::iterator it2 = eventListeners->begin();
-		while(it2 != eventListeners->end()) {
-			Listener* lsnr = *it2;
-			Nan::Persistent<Function>* _cb = lsnr->cb;
-			Local<Function> fn = Nan::New<Function>(*_cb);
-			Nan::Callback cb(fn);
+	isPlaying = true;
+	_resetThrottle(&playbackProgress);
+	_emit(EventPlaybackStarted, 0, {});
+}
 
-			cb.Call(argc, argv);
+void Sound::Engine::_stopPlayback() {
+	isPlaying = false;
+	playbackPosition = 0;
+	_flushProgress(EventPlaybackProgress, &playbackProgress);
+	_emit(EventPlaybackStopped, 0, {});
+}
 
-			if (lsnr->once) {
-				it2 = eventListeners->erase(it2);
-				delete lsnr;
-			} else {
-				++it2;
-			}
-		}
-	}
+void Sound::Engine::_pausePlayback() {
+	isPlaying = false;
+	_flushProgress(EventPlaybackProgress, &playbackProgress);
+	_emit(EventPlaybackPaused, 0, {});
 }
 
-void Sound::Engine::_setOptions(Nan::Persistent<Object>* opts) {
-	// Get the options object back
-	Local<Object> options = Nan::New(*opts);
+void Sound::Engine::_setPlaybackProgress(double progress) {
+	int64_t samplesCount = playbackSource->size();
+	int64_t newPosition = (int64_t)floor(progress * (double)samplesCount);
+	newPosition = newPosition < 0 ? 0 : newPosition > samplesCount ? samplesCount : newPosition;
+	// Playback always starts at the first channel of a frame
+	playbackPosition = newPosition - newPosition % playbackChannels;
+}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("sampleRate").ToLocalChecked()).FromMaybe(false)) {
-		Local<Integer> _sampleRate = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("sampleRate").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		sampleRate = (int)_sampleRate->Int32Value();
+bool Sound::Engine::_startRecording(string file, SampleFormat format, string* error) {
+	if (isPlaying) {
+		printf("Cannot start recording since playback is active...\n");
+		return true;
 	}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("bufferSize").ToLocalChecked()).FromMaybe(false)) {
-		Local<Integer> _bufferSize = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("bufferSize").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		bufferSize = (int)_bufferSize->Int32Value();
+	if (isRecording) {
+		printf("Already recording...\n");
+		return true;
 	}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("inputChannels").ToLocalChecked()).FromMaybe(false)) {
-		Local<Integer> _inputChannels = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("inputChannels").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		inputChannels = (int)_inputChannels->Int32Value();
+	// Clear the recording buffer
+	if (pendingSaves > 0) {
+		*error = "The recording can't be deleted while it is being saved.";
+		return false;
+	}
+	_deleteRecording();
+
+	// Record directly into a file if one is given
+	if (file.empty() == false) {
+		diskRecorder = new DiskRecorder(file, sampleRate, inputChannels, format);
+		if (diskRecorder->isOpen() == false) {
+			delete diskRecorder;
+			diskRecorder = NULL;
+			*error = "Could not open the file for recording.";
+			return false;
+		}
 	}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("outputChannels").ToLocalChecked()).FromMaybe(false)) {
-		Local<Integer> _outputChannels = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("outputChannels").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		outputChannels = (int)_outputChannels->Int32Value();
+	isRecording = true;
+	recordedSamples = 0;
+	_resetThrottle(&recordingProgress);
+	_emit(EventRecordingStarted, 0, {});
+	return true;
+}
+
+bool Sound::Engine::_stopRecording(string* error) {
+	if (isRecording == false) {
+		printf("Recording never started...\n");
+		return true;
 	}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("inputDevice").ToLocalChecked()).FromMaybe(false)) {
-		Local<Integer> _inputDevice = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("inputDevice").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		inputDevice = (int)_inputDevice->Int32Value();
+	isRecording = false;
+	_flushProgress(EventRecordingProgress, &recordingProgress);
+
+	// Flush and close the file of a disk recording
+	if (diskRecorder != NULL) {
+		bool failed = diskRecorder->hasFailed();
+		delete diskRecorder;
+		diskRecorder = NULL;
+		if (failed) {
+			*error = "Writing the recording to disk failed.";
+			return false;
+		}
 	}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("outputDevice").ToLocalChecked()).FromMaybe(false)) {
-		Local<Integer> _outputDevice = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("outputDevice").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		outputDevice = (int)_outputDevice->Int32Value();
+	_emit(EventRecordingStopped, 0, {});
+	return true;
+}
+
+bool Sound::Engine::_deleteRecording() {
+	// An async save still reads the segments of the recording
+	if (pendingSaves > 0) {
+		Nan::ThrowError("The recording can't be deleted while it is being saved.");
+		return false;
+	}
+	recording->clear();
+	delete mappedWave;
+	mappedWave = NULL;
+	playbackSource = recording;
+	playbackChannels = inputChannels;
+	playbackPosition = 0;
+	_emit(EventRecordingDeleted, 0, {});
+	return true;
+}
+
+Sound::WaveFormat Sound::Engine::_recordingFormat(SampleFormat format) {
+	// Loaded files keep their layout, recordings use the layout of the input
+	WaveFormat waveFormat = { format, playbackChannels, sampleRate, 0 };
+	if (playbackSource == mappedWave) {
+		waveFormat.channels = mappedWave->format().channels;
+		waveFormat.sampleRate = mappedWave->format().sampleRate;
+		waveFormat.channelMask = mappedWave->format().channelMask;
 	}
+	return waveFormat;
+}
 
-	if (Nan::HasOwnProperty(options, Nan::New<String>("inputLatency").ToLocalChecked()).FromMaybe(false)) {
-		Local<Number> _inputLatency = Nan::To<Number>(Nan::Get(options, Nan::New<String>("inputLatency").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
-		inputLatency = (float)_inputLatency->NumberValue();
+vector<Sound::RecordingSegment> Sound::Engine::_snapshotRecording() {
+	// Segments never move while samples are appended, so the pointers stay valid until the recording is deleted
+	vector<RecordingSegment> segments;
+	if (playbackSource == recording) {
+		for (int i = 0; i < recording->segmentCount(); ++i) {
+			RecordingSegment segment;
+			segment.samples = recording->segment(i, &segment.length);
+			segments.push_back(segment);
+		}
+	}
+	return segments;
+}
+
+void Sound::Engine::_saveRecording(string file, SampleFormat format) {
+	string error;
+	const SampleSource* source = playbackSource == mappedWave ? mappedWave : NULL;
+	if (_writeRecording(file, _recordingFormat(format), _snapshotRecording(), source, &error) == false) {
+		Nan::ThrowError(error.c_str());
+		return;
+	}
+
+	_emit(EventRecordingSaved, 0, {});
+}
+
+/**
+ * Writes recording segments or a loaded file with a WaveWriter or a SlacWriter.
+ */
+template<typename Writer>
+static bool _writeSamples(Writer* writer, const vector<Sound::RecordingSegment>& segments, const Sound::SampleSource* source) {
+	if (source == NULL) {
+		// Write the arena segment by segment without copying the samples
+		for (size_t i = 0; i < segments.size(); ++i) {
+			writer->write(segments[i].samples, segments[i].length);
+		}
+	} else {
+		// Copy a loaded file through a small buffer
+		const int chunkSize = 1 << 16;
+		float* chunk = new float[chunkSize];
+		int64_t position = 0;
+		int64_t samplesRead;
+		while ((samplesRead = source->read(position, chunk, chunkSize)) > 0) {
+			writer->write(chunk, samplesRead);
+			position += samplesRead;
+		}
+		delete[] chunk;
+	}
+	return writer->finish();
+}
+
+bool Sound::Engine::_writeRecording(string file, WaveFormat format, const vector<RecordingSegment>& segments, const SampleSource* source, string* error) {
+	if (isSlacFile(file)) {
+		// The lossless format always stores the samples as they are
+		SlacWriter writer(file, format.sampleRate, format.channels);
+		if (writer.isOpen() == false) {
+			*error = "Could not open the file for writing.";
+			return false;
+		}
+		if (_writeSamples(&writer, segments, source) == false) {
+			*error = "Writing the slac file failed.";
+			return false;
+		}
+		return true;
+	}
+
+	WaveWriter writer(file, format);
+	if (writer.isOpen() == false) {
+		*error = "Could not open the file for writing.";
+		return false;
+	}
+	if (_writeSamples(&writer, segments, source) == false) {
+		*error = "Writing the wave file failed.";
+		return false;
+	}
+	return true;
+}
+
+bool Sound::Engine::_isMappedFile(const string& file) {
+	if (mappedWave == NULL) return false;
+	// Compare the inodes, so other paths to the same file (links, relative paths) are caught too
+	struct stat target, mapped;
+	if (stat(file.c_str(), &target) != 0 || stat(mappedWave->file().c_str(), &mapped) != 0) return false;
+	return target.st_dev == mapped.st_dev && target.st_ino == mapped.st_ino;
+}
+
+bool Sound::Engine::_getSampleFormat(Local<Object> options, SampleFormat* format) {
+	*format = SampleFormatFloat32;
+	Local<String> key = Nan::New<String>("format").ToLocalChecked();
+	if (Nan::HasOwnProperty(options, key).FromMaybe(false) == false) return true;
+
+	Local<String> _name = Nan::To<String>(Nan::Get(options, key).ToLocalChecked()).ToLocalChecked();
+	string name = string((*String::Utf8Value(_name)));
+	if (parseSampleFormat(name, format) == false) {
+		Nan::ThrowTypeError("format must be one of pcm16, pcm24, pcm32, float32 or float64.");
+		return false;
+	}
+	return true;
+}
+
+bool Sound::Engine::_getEventType(Local<Value> name, EventType* type) {
+	Local<String> _eventName = Nan::To<String>(name).ToLocalChecked();
+	return parseEventType(*String::Utf8Value(_eventName), type);
+}
+
+void Sound::Engine::_addListener(EventType type, Local<Function> fn, bool prepend, bool once) {
+	EventSlot* slot = &events[type];
+	Listener* lsnr = new Listener(fn, once);
+	if (slot->emitting > 0) {
+		// The listeners are being iterated, so the new one is inserted afterwards
+		slot->pending.push_back(make_pair(lsnr, prepend));
+	} else if (prepend == false) {
+		// Append the callback
+		slot->listeners.push_back(lsnr);
+	} else {
+		// Prepend the callback
+		slot->listeners.insert(slot->listeners.begin(), lsnr);
+	}
+	slot->active++;
+
+	// Only analyse the signal while someone listens to the spectra
+	if (type == EventFft) stft->setEnabled(true);
+}
+
+void Sound::Engine::_removeListener(EventType type, Local<Function> fn) {
+	EventSlot* slot = &events[type];
+	for (size_t i = 0; i < slot->listeners.size(); ++i) {
+		Listener* lsnr = slot->listeners[i];
+		if (lsnr->removed == false && lsnr->callback->GetFunction() == fn) {
+			_retireListener(type, lsnr);
+			return;
+		}
+	}
+	for (size_t i = 0; i < slot->pending.size(); ++i) {
+		Listener* lsnr = slot->pending[i].first;
+		if (lsnr->removed == false && lsnr->callback->GetFunction() == fn) {
+			_retireListener(type, lsnr);
+			return;
+		}
+	}
+}
+
+void Sound::Engine::_removeAllListeners(EventType type) {
+	EventSlot* slot = &events[type];
+	if (slot->emitting > 0) {
+		for (size_t i = 0; i < slot->listeners.size(); ++i) {
+			if (slot->listeners[i]->removed == false) _retireListener(type, slot->listeners[i]);
+		}
+		for (size_t i = 0; i < slot->pending.size(); ++i) {
+			if (slot->pending[i].first->removed == false) _retireListener(type, slot->pending[i].first);
+		}
+		return;
+	}
+	for (size_t i = 0; i < slot->listeners.size(); ++i) {
+		delete slot->listeners[i];
+	}
+	slot->listeners.clear();
+	slot->active = 0;
+}
+
+void Sound::Engine::_retireListener(EventType type, Listener* listener) {
+	EventSlot* slot = &events[type];
+	slot->active--;
+	if (slot->emitting > 0) {
+		// The listener might be running right now
+		listener->removed = true;
+		return;
+	}
+	for (vector<Listener*>::iterator it = slot->listeners.begin(); it != slot->listeners.end(); ++it) {
+		if (*it == listener) {
+			slot->listeners.erase(it);
+			break;
+		}
+	}
+	delete listener;
+}
+
+void Sound::Engine::_settleListeners(EventType type) {
+	EventSlot* slot = &events[type];
+	if (slot->emitting > 0) return;
+
+	// Drop the listeners that were removed during the emit
+	size_t kept = 0;
+	for (size_t i = 0; i < slot->listeners.size(); ++i) {
+		Listener* lsnr = slot->listeners[i];
+		if (lsnr->removed) {
+			delete lsnr;
+		} else {
+			slot->listeners[kept++] = lsnr;
+		}
+	}
+	slot->listeners.resize(kept);
+
+	// Insert the ones that were added during the emit
+	for (size_t i = 0; i < slot->pending.size(); ++i) {
+		Listener* lsnr = slot->pending[i].first;
+		if (lsnr->removed) {
+			delete lsnr;
+		} else if (slot->pending[i].second) {
+			slot->listeners.insert(slot->listeners.begin(), lsnr);
+		} else {
+			slot->listeners.push_back(lsnr);
+		}
+	}
+	slot->pending.clear();
+}
+
+void Sound::Engine::_emit(EventType type, int argc, Local<Value> argv[]) {
+	EventSlot* slot = &events[type];
+	if (slot->active == 0) return;
+
+	// Listeners that are added while emitting are called from the next emit on
+	slot->emitting++;
+	size_t count = slot->listeners.size();
+	for (size_t i = 0; i < count; ++i) {
+		Listener* lsnr = slot->listeners[i];
+		if (lsnr->removed) continue;
+		// Once listeners are removed before they are called
+		if (lsnr->once) _retireListener(type, lsnr);
+		uint64_t begin = uv_hrtime();
+		lsnr->callback->Call(argc, argv);
+		telemetry->record(TelemetryListeners, uv_hrtime() - begin);
+	}
+	slot->emitting--;
+	_settleListeners(type);
+}
+
+Sound::EventThrottle* Sound::Engine::_throttleFor(EventType type) {
+	if (type == EventPlaybackProgress) return &playbackProgress;
+	if (type == EventRecordingProgress) return &recordingProgress;
+	return NULL;
+}
+
+void Sound::Engine::_resetThrottle(EventThrottle* throttle) {
+	throttle->lastEmit = processedFrames;
+	throttle->blocksSince = 0;
+	throttle->coalesced = 0;
+	throttle->value = 0;
+}
+
+void Sound::Engine::_progress(EventType type, EventThrottle* throttle, double value) {
+	// Nobody listens so there is nothing to count either
+	if (_hasListeners(type) == false) return;
+
+	throttle->value = value;
+	throttle->coalesced++;
+	throttle->blocksSince++;
+	if (throttle->blocksSince < throttle->blocks) return;
+	if (throttle->interval > 0 && (processedFrames - throttle->lastEmit) * 1000.0 < throttle->interval * sampleRate) return;
+	throttle->lastEmit = processedFrames;
+	throttle->blocksSince = 0;
+
+	_flushProgress(type, throttle);
+}
+
+void Sound::Engine::_flushProgress(EventType type, EventThrottle* throttle) {
+	if (throttle->coalesced == 0 || _hasListeners(type) == false) return;
+	Local<Value> argv[2] = {Nan::New<Number>(throttle->value), Nan::New<Integer>(throttle->coalesced)};
+	throttle->coalesced = 0;
+	_emit(type, 2, argv);
+}
+
+void Sound::Engine::_setOptions(Nan::Persistent<Object>* opts) {
+	// Get the options object back
+	Local<Object> options = Nan::New(*opts);
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("sampleRate").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _sampleRate = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("sampleRate").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		sampleRate = (int)_sampleRate->Int32Value();
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("bufferSize").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _bufferSize = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("bufferSize").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		bufferSize = (int)_bufferSize->Int32Value();
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("inputChannels").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _inputChannels = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("inputChannels").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		inputChannels = (int)_inputChannels->Int32Value();
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("outputChannels").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _outputChannels = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("outputChannels").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		outputChannels = (int)_outputChannels->Int32Value();
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("inputDevice").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _inputDevice = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("inputDevice").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		inputDevice = (int)_inputDevice->Int32Value();
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("outputDevice").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _outputDevice = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("outputDevice").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		outputDevice = (int)_outputDevice->Int32Value();
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("inputLatency").ToLocalChecked()).FromMaybe(false)) {
+		Local<Number> _inputLatency = Nan::To<Number>(Nan::Get(options, Nan::New<String>("inputLatency").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		inputLatency = (float)_inputLatency->NumberValue();
 	}
 
 	if (Nan::HasOwnProperty(options, Nan::New<String>("outputLatency").ToLocalChecked()).FromMaybe(false)) {
@@ -1185,12 +2590,35 @@ void Sound::Engine::_setOptions(Nan::Persistent<Object>* opts) {
 		outputLatency = (float)_outputLatency->NumberValue();
 	}
 
+	if (Nan::HasOwnProperty(options, Nan::New<String>("processingInterval").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _processingInterval = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("processingInterval").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		processingInterval = (int)_processingInterval->Int32Value();
+		if (processingInterval < 0) processingInterval = 0;
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("infoInterval").ToLocalChecked()).FromMaybe(false)) {
+		Local<Number> _infoInterval = Nan::To<Number>(Nan::Get(options, Nan::New<String>("infoInterval").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		infoInterval = _infoInterval->NumberValue();
+		if (infoInterval < 0) infoInterval = 0;
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("statsInterval").ToLocalChecked()).FromMaybe(false)) {
+		Local<Number> _statsInterval = Nan::To<Number>(Nan::Get(options, Nan::New<String>("statsInterval").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		statsInterval = _statsInterval->NumberValue();
+		if (statsInterval < 0) statsInterval = 0;
+	}
+
+	if (Nan::HasOwnProperty(options, Nan::New<String>("queueDepth").ToLocalChecked()).FromMaybe(false)) {
+		Local<Integer> _queueDepth = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("queueDepth").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
+		queueDepth = (int)_queueDepth->Int32Value();
+		if (queueDepth < 2) queueDepth = 2;
+	}
+
 	if (Nan::HasOwnProperty(options, Nan::New<String>("fftWindowSize").ToLocalChecked()).FromMaybe(false)) {
 		Local<Integer> _fftWindowSize = Nan::To<Integer>(Nan::Get(options, Nan::New<String>("fftWindowSize").ToLocalChecked()).ToLocalChecked()).ToLocalChecked();
 		fftWindowSize = (int)_fftWindowSize->Int32Value();
 		// Recreate the window function
-		delete fftWindowFunction;
-		fftWindowFunction = new WindowFunction(fftWindowFunctionType, fftWindowSize);
+		fftWindowFunction = WindowFunction::shared(fftWindowFunctionType, fftWindowSize);
 	}
 
 	if (Nan::HasOwnProperty(options, Nan::New<String>("fftOverlapSize").ToLocalChecked()).FromMaybe(false)) {
@@ -1216,8 +2644,7 @@ void Sound::Engine::_setOptions(Nan::Persistent<Object>* opts) {
 		}
 
 		if (validWindowFunctionType) {
-			delete fftWindowFunction;
-			fftWindowFunction = new WindowFunction(fftWindowFunctionType, fftWindowSize);
+			fftWindowFunction = WindowFunction::shared(fftWindowFunctionType, fftWindowSize);
 		}
 	}
 
@@ -1230,6 +2657,189 @@ void Sound::Engine::_setOptions(Nan::Persistent<Object>* opts) {
 	_startStream();
 }
 
+bool Sound::Engine::_getGraphSpec(Local<Object> description, DspGraphSpec* spec) {
+	Local<Value> _nodes = Nan::Get(description, Nan::New<String>("nodes").ToLocalChecked()).ToLocalChecked();
+	Local<Value> _connections = Nan::Get(description, Nan::New<String>("connections").ToLocalChecked()).ToLocalChecked();
+	if (_nodes->IsArray() == false || _connections->IsArray() == false) {
+		Nan::ThrowTypeError("A graph needs a nodes and a connections array.");
+		return false;
+	}
+
+	Local<Array> nodes = Local<Array>::Cast(_nodes);
+	for (uint32_t i = 0; i < nodes->Length(); ++i) {
+		Local<Value> _node = nodes->Get(i);
+		if (_node->IsObject() == false) {
+			Nan::ThrowTypeError("Every graph node must be an object.");
+			return false;
+		}
+		Local<Object> node = Nan::To<Object>(_node).ToLocalChecked();
+		Local<Value> _id = Nan::Get(node, Nan::New<String>("id").ToLocalChecked()).ToLocalChecked();
+		Local<Value> _type = Nan::Get(node, Nan::New<String>("type").ToLocalChecked()).ToLocalChecked();
+		if (_id->IsString() == false || _type->IsString() == false) {
+			Nan::ThrowTypeError("Every graph node needs an id and a type.");
+			return false;
+		}
+		DspNodeSpec nodeSpec;
+		nodeSpec.id = string(*String::Utf8Value(_id));
+		nodeSpec.type = string(*String::Utf8Value(_type));
+
+		// The other properties are numeric parameters, the shape of a biquad, the channels of a splitter or the gains of a mixer
+		Local<Array> keys = Nan::GetOwnPropertyNames(node).ToLocalChecked();
+		for (uint32_t k = 0; k < keys->Length(); ++k) {
+			Local<Value> key = keys->Get(k);
+			string name = string(*String::Utf8Value(key));
+			if (name == "id" || name == "type") continue;
+
+			Local<Value> value = Nan::Get(node, key).ToLocalChecked();
+			if (name == "filter" && value->IsString()) {
+				nodeSpec.filter = string(*String::Utf8Value(value));
+			} else if ((name == "channels" || name == "gains") && value->IsArray()) {
+				Local<Array> values = Local<Array>::Cast(value);
+				for (uint32_t j = 0; j < values->Length(); ++j) {
+					Local<Value> item = values->Get(j);
+					if (item->IsNumber() == false) {
+						Nan::ThrowTypeError(("The " + name + " of graph node " + nodeSpec.id + " must be numbers.").c_str());
+						return false;
+					}
+					double number = Nan::To<double>(item).FromJust();
+					if (name == "channels") {
+						nodeSpec.channels.push_back((int)number);
+					} else {
+						nodeSpec.params["gain" + to_string(j)] = number;
+					}
+				}
+			} else if (value->IsNumber()) {
+				nodeSpec.params[name] = Nan::To<double>(value).FromJust();
+			} else {
+				Nan::ThrowTypeError(("Unsupported property " + name + " of graph node " + nodeSpec.id + ".").c_str());
+				return false;
+			}
+		}
+		spec->nodes.push_back(nodeSpec);
+	}
+
+	Local<Array> connections = Local<Array>::Cast(_connections);
+	for (uint32_t i = 0; i < connections->Length(); ++i) {
+		Local<Value> _connection = connections->Get(i);
+		if (_connection->IsArray() == false) {
+			Nan::ThrowTypeError("Every connection must be a pair of node ids.");
+			return false;
+		}
+		Local<Array> connection = Local<Array>::Cast(_connection);
+		if (connection->Length() != 2 || connection->Get(0)->IsString() == false || connection->Get(1)->IsString() == false) {
+			Nan::ThrowTypeError("Every connection must be a pair of node ids.");
+			return false;
+		}
+		spec->connections.push_back(make_pair(string(*String::Utf8Value(connection->Get(0))), string(*String::Utf8Value(connection->Get(1)))));
+	}
+	return true;
+}
+
+void Sound::Engine::_publishGraph(DspGraph* next) {
+	_collectGraphs();
+	graph = next;
+	// A graph the stream callback never took over can be deleted right away
+	delete pendingGraph.exchange(next);
+}
+
+void Sound::Engine::_configureEq() {
+	delete equalizer;
+	equalizer = new Equalizer(sampleRate, inputChannels);
+	equalizer->setBands(eqBands, false);
+}
+
+Sound::Convolver* Sound::Engine::_openConvolver(string file, int sampleRate, int bufferSize, int channels, string* error) {
+	// The response is converted to the engine rate like a recording
+	MappedWave* wave;
+	SampleArena* decoded;
+	int responseChannels;
+	if (_openRecording(file, sampleRate, &wave, &decoded, &responseChannels, error) == false) {
+		return NULL;
+	}
+	const SampleSource* response = wave != NULL ? (const SampleSource*)wave : (const SampleSource*)decoded;
+	Convolver* result = new Convolver(bufferSize, channels, response, responseChannels);
+	delete wave;
+	delete decoded;
+	return result;
+}
+
+void Sound::Engine::_configureConvolver() {
+	// The blocks pass unconvolved until the response is ready for the new configuration
+	delete convolver;
+	convolver = NULL;
+	if (convolverFile.empty()) return;
+
+	Nan::HandleScope scope;
+	Nan::AsyncQueueWorker(new ConvolverWorker(this, NULL, handle(), convolverFile, convolverMix, true));
+}
+
+Sound::Clip* Sound::Engine::_openClip(string file, int sampleRate, string* error) {
+	// Clips are converted to the engine rate like a recording and copied into memory
+	MappedWave* wave;
+	SampleArena* decoded;
+	int channels;
+	if (_openRecording(file, sampleRate, &wave, &decoded, &channels, error) == false) {
+		return NULL;
+	}
+	const SampleSource* source = wave != NULL ? (const SampleSource*)wave : (const SampleSource*)decoded;
+	Clip* result = new Clip(source, channels, file);
+	delete wave;
+	delete decoded;
+	if (result->isLoaded() == false) {
+		*error = "Not enough memory for the clip.";
+		delete result;
+		return NULL;
+	}
+	return result;
+}
+
+void Sound::Engine::_configureClips() {
+	if (clipRate == sampleRate) return;
+	clipRate = sampleRate;
+
+	// The voices can't continue at another rate
+	clips->clearVoices();
+	vector<int> ids = clips->clipIds();
+	for (size_t i = 0; i < ids.size(); ++i) {
+		string error;
+		string file = clips->clip(ids[i])->file();
+		Clip* clip = _openClip(file, sampleRate, &error);
+		if (clip == NULL) {
+			printf("The clip %s was removed: %s\n", file.c_str(), error.c_str());
+			clips->removeClip(ids[i]);
+			continue;
+		}
+		clips->replaceClip(ids[i], clip);
+	}
+}
+
+void Sound::Engine::_collectGraphs() {
+	DspGraph* retired;
+	while (retiredGraphs->try_dequeue(retired)) delete retired;
+}
+
+void Sound::Engine::_rebuildGraph() {
+	// The stream is stopped at this point, so the graphs can be replaced directly
+	_collectGraphs();
+	delete pendingGraph.exchange(NULL);
+	delete activeGraph;
+	activeGraph = NULL;
+	graph = NULL;
+	// The queued parameter values are part of graphSpec already
+	DspParamChange change;
+	while (graphParams->try_dequeue(change)) {}
+
+	if (graphSpec.nodes.empty()) return;
+	string error;
+	activeGraph = DspGraph::build(graphSpec, sampleRate, bufferSize, inputChannels, &error);
+	if (activeGraph == NULL) {
+		// E.g. a splitter picks a channel the new configuration does not have
+		printf("The processing graph was removed: %s\n", error.c_str());
+		graphSpec = DspGraphSpec();
+	}
+	graph = activeGraph;
+}
+
 
 
 void Sound::GetDevices(const Nan::FunctionCallbackInfo<v8::Value>& info) {
@@ -1273,24 +2883,59 @@ void Sound::GetDevices(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	}
 }
 
+/**
+ * The samples of a Float32Array.
+ */
+static float* _floatData(Local<Float32Array> array) {
+	return (float*)((char*)array->Buffer()->GetContents().Data() + array->ByteOffset());
+}
+
+static Local<Float32Array> _newFloat32Array(size_t length) {
+	Local<ArrayBuffer> memory = ArrayBuffer::New(Isolate::GetCurrent(), length * sizeof(float));
+	return Float32Array::New(memory, 0, length);
+}
+
+/**
+ * The optional output argument of a vector function: the given Float32Array (if it is long
+ * enough), the samples themselves (in place) or a new array if copy is set.
+ */
+static bool _getVectorOutput(const Nan::FunctionCallbackInfo<v8::Value>& info, int index, Local<Float32Array> samples, bool copy, Local<Float32Array>* out) {
+	if (info.Length() > index && info[index]->IsUndefined() == false && info[index]->IsNull() == false) {
+		if (info[index]->IsFloat32Array() == false || Local<Float32Array>::Cast(info[index])->Length() < samples->Length()) {
+			Nan::ThrowTypeError("The output must be a Float32Array at least as long as the input.");
+			return false;
+		}
+		*out = Local<Float32Array>::Cast(info[index]);
+	} else {
+		*out = copy ? _newFloat32Array(samples->Length()) : samples;
+	}
+	return true;
+}
+
 void Sound::ApplyDamping(const Nan::FunctionCallbackInfo<v8::Value>& info) {
-	// Check and get the buffer
-	if (info.Length() < 1 || info[0]->IsArray() == false) {
-		Nan::ThrowTypeError("First argument must be an array.");
+	if (info.Length() < 1 || (info[0]->IsArray() == false && info[0]->IsFloat32Array() == false)) {
+		Nan::ThrowTypeError("First argument must be an array or a Float32Array.");
 		return;
 	}
-	Local<Array> inBuffer = Local<Array>::Cast(info[0]);
-	Local<Array> outBuffer = Nan::New<Array>(inBuffer->Length());
-
-	// Check and get
 	if (info.Length() < 2 || info[1]->IsNumber() == false) {
 		Nan::ThrowTypeError("Second argument must be a damping coefficient.");
 		return;
 	}
-	Local<Number> damping = Nan::To<Number>(info[1]).ToLocalChecked();
-	double coefficient = (double)damping->NumberValue();
-	//printf("Damping factor is %f\n", coefficient);
-	
+	double coefficient = Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+	const VectorKernels& kernels = vectorKernels();
+
+	// Typed arrays are damped with the vector kernels into a new array (or the given one)
+	if (info[0]->IsFloat32Array()) {
+		Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+		Local<Float32Array> out;
+		if (_getVectorOutput(info, 2, samples, true, &out) == false) return;
+		kernels.gain(_floatData(out), _floatData(samples), (float)coefficient, samples->Length());
+		info.GetReturnValue().Set(out);
+		return;
+	}
+
+	Local<Array> inBuffer = Local<Array>::Cast(info[0]);
+	Local<Array> outBuffer = Nan::New<Array>(inBuffer->Length());
 	for (int i = 0; i < (int)(inBuffer->Length()); ++i) {
 		Local<Value> _value = inBuffer->Get(i);
 		// Check if the buffer is interleaved or not
@@ -1298,6 +2943,11 @@ void Sound::ApplyDamping(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 			// Apply coefficient to every value
 			double newVal = (double)(_value->NumberValue()) * coefficient;
 			outBuffer->Set(i, Nan::New<Number>(newVal));
+		} else if (_value->IsFloat32Array()) {
+			Local<Float32Array> inner = Local<Float32Array>::Cast(_value);
+			Local<Float32Array> outInner = _newFloat32Array(inner->Length());
+			kernels.gain(_floatData(outInner), _floatData(inner), (float)coefficient, inner->Length());
+			outBuffer->Set(i, outInner);
 		} else if (_value->IsArray()) {
 			// Apply coefficient to every value in every inner array
 			Local<Array> inInner = Local<Array>::Cast(_value);
@@ -1316,13 +2966,677 @@ void Sound::ApplyDamping(const Nan::FunctionCallbackInfo<v8::Value>& info) {
 	info.GetReturnValue().Set(outBuffer);
 }
 
+void Sound::VectorGain(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 2 || info[0]->IsFloat32Array() == false || info[1]->IsNumber() == false) {
+		Nan::ThrowTypeError("Expected a Float32Array and a gain.");
+		return;
+	}
+	Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+	Local<Float32Array> out;
+	if (_getVectorOutput(info, 2, samples, false, &out) == false) return;
+	float gain = (float)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+	vectorKernels().gain(_floatData(out), _floatData(samples), gain, samples->Length());
+	info.GetReturnValue().Set(out);
+}
+
+void Sound::VectorRamp(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 3 || info[0]->IsFloat32Array() == false || info[1]->IsNumber() == false || info[2]->IsNumber() == false) {
+		Nan::ThrowTypeError("Expected a Float32Array, a start gain and an end gain.");
+		return;
+	}
+	Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+	Local<Float32Array> out;
+	if (_getVectorOutput(info, 3, samples, false, &out) == false) return;
+	float from = (float)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+	float to = (float)Nan::To<Number>(info[2]).ToLocalChecked()->NumberValue();
+	// The end gain is reached right after the last sample
+	size_t count = samples->Length();
+	float step = count > 0 ? (to - from) / count : 0.0f;
+	vectorKernels().ramp(_floatData(out), _floatData(samples), from, step, count);
+	info.GetReturnValue().Set(out);
+}
+
+void Sound::VectorMix(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 2 || info[0]->IsFloat32Array() == false || info[1]->IsFloat32Array() == false) {
+		Nan::ThrowTypeError("Expected a target and a source Float32Array.");
+		return;
+	}
+	Local<Float32Array> target = Local<Float32Array>::Cast(info[0]);
+	Local<Float32Array> source = Local<Float32Array>::Cast(info[1]);
+	float gain = 1.0f;
+	if (info.Length() >= 3 && info[2]->IsNumber()) {
+		gain = (float)Nan::To<Number>(info[2]).ToLocalChecked()->NumberValue();
+	}
+	size_t count = std::min(target->Length(), source->Length());
+	vectorKernels().mix(_floatData(target), _floatData(source), gain, count);
+	info.GetReturnValue().Set(target);
+}
+
+void Sound::VectorClip(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 1 || info[0]->IsFloat32Array() == false) {
+		Nan::ThrowTypeError("First argument must be a Float32Array.");
+		return;
+	}
+	Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+	float limit = 1.0f;
+	if (info.Length() >= 2 && info[1]->IsNumber()) {
+		limit = fabsf((float)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue());
+	}
+	Local<Float32Array> out;
+	if (_getVectorOutput(info, 2, samples, false, &out) == false) return;
+	vectorKernels().clip(_floatData(out), _floatData(samples), limit, samples->Length());
+	info.GetReturnValue().Set(out);
+}
+
+void Sound::VectorSoftClip(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 1 || info[0]->IsFloat32Array() == false) {
+		Nan::ThrowTypeError("First argument must be a Float32Array.");
+		return;
+	}
+	Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+	Local<Float32Array> out;
+	if (_getVectorOutput(info, 1, samples, false, &out) == false) return;
+	vectorKernels().softClip(_floatData(out), _floatData(samples), samples->Length());
+	info.GetReturnValue().Set(out);
+}
+
+void Sound::VectorInterleave(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	vector<const float*> channels;
+	size_t frames = 0;
+	if (info.Length() >= 1 && info[0]->IsArray()) {
+		Local<Array> arrays = Local<Array>::Cast(info[0]);
+		for (uint32_t i = 0; i < arrays->Length(); ++i) {
+			Local<Value> channel = arrays->Get(i);
+			if (channel->IsFloat32Array() == false) {
+				channels.clear();
+				break;
+			}
+			Local<Float32Array> array = Local<Float32Array>::Cast(channel);
+			// Interleaves up to the length of the shortest channel
+			if (channels.empty() || array->Length() < frames) frames = array->Length();
+			channels.push_back(_floatData(array));
+		}
+	}
+	if (channels.empty()) {
+		Nan::ThrowTypeError("First argument must be an array of Float32Arrays.");
+		return;
+	}
+
+	size_t length = frames * channels.size();
+	Local<Float32Array> out;
+	if (info.Length() >= 2 && info[1]->IsUndefined() == false && info[1]->IsNull() == false) {
+		if (info[1]->IsFloat32Array() == false || Local<Float32Array>::Cast(info[1])->Length() < length) {
+			Nan::ThrowTypeError("The output must be a Float32Array that holds every frame of every channel.");
+			return;
+		}
+		out = Local<Float32Array>::Cast(info[1]);
+	} else {
+		out = _newFloat32Array(length);
+	}
+	interleaveChannels(_floatData(out), channels.data(), (int)channels.size(), frames);
+	info.GetReturnValue().Set(out);
+}
+
+void Sound::VectorDeinterleave(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 2 || info[0]->IsFloat32Array() == false || (info[1]->IsNumber() == false && info[1]->IsArray() == false)) {
+		Nan::ThrowTypeError("Expected a Float32Array and a channel count or an array of Float32Arrays.");
+		return;
+	}
+	Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+
+	// Either new channels or the ones that were given (filled up to the shortest one)
+	Local<Array> result;
+	vector<float*> channels;
+	size_t frames;
+	if (info[1]->IsNumber()) {
+		int count = (int)Nan::To<Number>(info[1]).ToLocalChecked()->NumberValue();
+		if (count < 1) {
+			Nan::ThrowTypeError("The channel count must be at least 1.");
+			return;
+		}
+		frames = samples->Length() / count;
+		result = Nan::New<Array>(count);
+		for (int c = 0; c < count; ++c) {
+			Local<Float32Array> channel = _newFloat32Array(frames);
+			channels.push_back(_floatData(channel));
+			Nan::Set(result, c, channel);
+		}
+	} else {
+		result = Local<Array>::Cast(info[1]);
+		for (uint32_t c = 0; c < result->Length(); ++c) {
+			Local<Value> channel = result->Get(c);
+			if (channel->IsFloat32Array() == false) {
+				Nan::ThrowTypeError("The channels must be Float32Arrays.");
+				return;
+			}
+			channels.push_back(_floatData(Local<Float32Array>::Cast(channel)));
+		}
+		if (channels.empty()) {
+			Nan::ThrowTypeError("The channels must be Float32Arrays.");
+			return;
+		}
+		frames = samples->Length() / channels.size();
+		for (uint32_t c = 0; c < result->Length(); ++c) {
+			frames = std::min(frames, Local<Float32Array>::Cast(result->Get(c))->Length());
+		}
+	}
+	deinterleaveChannels(channels.data(), _floatData(samples), (int)channels.size(), frames);
+	info.GetReturnValue().Set(result);
+}
+
+void Sound::VectorDot(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 2 || info[0]->IsFloat32Array() == false || info[1]->IsFloat32Array() == false) {
+		Nan::ThrowTypeError("Expected two Float32Arrays.");
+		return;
+	}
+	Local<Float32Array> a = Local<Float32Array>::Cast(info[0]);
+	Local<Float32Array> b = Local<Float32Array>::Cast(info[1]);
+	size_t count = std::min(a->Length(), b->Length());
+	info.GetReturnValue().Set(Nan::New<Number>(vectorKernels().dot(_floatData(a), _floatData(b), count)));
+}
+
+void Sound::VectorAbsMax(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 1 || info[0]->IsFloat32Array() == false) {
+		Nan::ThrowTypeError("First argument must be a Float32Array.");
+		return;
+	}
+	Local<Float32Array> samples = Local<Float32Array>::Cast(info[0]);
+	info.GetReturnValue().Set(Nan::New<Number>(vectorKernels().absMax(_floatData(samples), samples->Length())));
+}
+
+/**
+ * Reads one Float32Array or an array of Float32Arrays (one per channel) and throws if it is malformed.
+ * The frames are the length of the shortest channel.
+ */
+static bool _getEqChannels(Local<Value> value, vector<float*>* channels, size_t* frames) {
+	vector<Local<Float32Array> > arrays;
+	if (value->IsFloat32Array()) {
+		arrays.push_back(Local<Float32Array>::Cast(value));
+	} else if (value->IsArray()) {
+		Local<Array> _channels = Local<Array>::Cast(value);
+		for (uint32_t i = 0; i < _channels->Length(); ++i) {
+			Local<Value> channel = _channels->Get(i);
+			if (channel->IsFloat32Array() == false) {
+				arrays.clear();
+				break;
+			}
+			arrays.push_back(Local<Float32Array>::Cast(channel));
+		}
+	}
+	if (arrays.empty()) {
+		Nan::ThrowTypeError("First argument must be a Float32Array or an array of Float32Arrays.");
+		return false;
+	}
+
+	*frames = arrays[0]->Length();
+	for (size_t i = 0; i < arrays.size(); ++i) {
+		Local<Float32Array> array = arrays[i];
+		channels->push_back(_floatData(array));
+		if (array->Length() < *frames) *frames = array->Length();
+	}
+	return true;
+}
+
+void Sound::Equalize(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	vector<float*> channels;
+	size_t frames;
+	if (info.Length() < 1) {
+		Nan::ThrowTypeError("First argument must be a Float32Array or an array of Float32Arrays.");
+		return;
+	}
+	if (_getEqChannels(info[0], &channels, &frames) == false) return;
+
+	vector<EqBand> bands;
+	if (info.Length() < 2) {
+		Nan::ThrowTypeError("Second argument must be an array of bands.");
+		return;
+	}
+	if (_getEqBands(info[1], &bands) == false) return;
+
+	int sampleRate = 44100;
+	if (info.Length() >= 3 && info[2]->IsNumber()) {
+		sampleRate = (int)Nan::To<Number>(info[2]).ToLocalChecked()->NumberValue();
+	}
+
+	// One-shot: the filters start from silence and their state is dropped afterwards
+	Equalizer equalizer(sampleRate, (int)channels.size());
+	equalizer.setBands(bands, false);
+	equalizer.process(channels.data(), (int)frames);
+
+	info.GetReturnValue().Set(info[0]);
+}
+
+void Sound::SetFftPlannerEffort(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	if (info.Length() < 1 || info[0]->IsString() == false) {
+		Nan::ThrowTypeError("First argument must be one of estimate, measure, patient or exhaustive.");
+		return;
+	}
+	Local<String> _effort = Nan::To<String>(info[0]).ToLocalChecked();
+	string effort = string((*String::Utf8Value(_effort)));
+
+	unsigned int flags;
+	if 		(effort == "estimate")		flags = FFTW_ESTIMATE;
+	else if (effort == "measure")		flags = FFTW_MEASURE;
+	else if (effort == "patient")		flags = FFTW_PATIENT;
+	else if (effort == "exhaustive")	flags = FFTW_EXHAUSTIVE;
+	else {
+		Nan::ThrowTypeError("First argument must be one of estimate, measure, patient or exhaustive.");
+		return;
+	}
+	FftPlanCache::setPlannerFlags(flags);
+}
+
+Sound::RecordingWorker::RecordingWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder):
+	Nan::AsyncWorker(callback), engine(engine)
+{
+	// Keep the engine alive until the job is done
+	SaveToPersistent("engine", holder);
+	if (callback == NULL) {
+		resolver.Reset(Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked());
+	}
+}
+
+Sound::RecordingWorker::~RecordingWorker() {
+	resolver.Reset();
+}
+
+Local<Value> Sound::RecordingWorker::promise() {
+	if (resolver.IsEmpty()) return Nan::Undefined();
+	return Nan::New(resolver)->GetPromise();
+}
+
+void Sound::RecordingWorker::HandleOKCallback() {
+	string error = _completed(true);
+	if (error.empty()) {
+		_settle(Nan::Undefined(), _result());
+	} else {
+		_settle(Nan::Error(error.c_str()), Nan::Undefined());
+	}
+}
+
+void Sound::RecordingWorker::HandleErrorCallback() {
+	_completed(false);
+	_settle(Nan::Error(ErrorMessage()), Nan::Undefined());
+}
+
+Local<Value> Sound::RecordingWorker::_result() {
+	return Nan::Undefined();
+}
+
+void Sound::RecordingWorker::_settle(Local<Value> error, Local<Value> result) {
+	if (callback != NULL) {
+		Local<Value> argv[2] = { error->IsUndefined() ? Local<Value>(Nan::Null()) : error, result };
+		callback->Call(2, argv);
+		return;
+	}
+	Local<Promise::Resolver> _resolver = Nan::New(resolver);
+	if (error->IsUndefined()) {
+		_resolver->Resolve(Nan::GetCurrentContext(), result).FromMaybe(false);
+	} else {
+		_resolver->Reject(Nan::GetCurrentContext(), error).FromMaybe(false);
+	}
+}
+
+Sound::LoadWorker::LoadWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file, int sampleRate):
+	RecordingWorker(engine, callback, holder), file(file), sampleRate(sampleRate)
+{
+	wave = NULL;
+	decoded = NULL;
+	channels = 0;
+}
+
+void Sound::LoadWorker::Execute() {
+	string error;
+	if (Engine::_openRecording(file, sampleRate, &wave, &decoded, &channels, &error) == false) {
+		SetErrorMessage(error.c_str());
+	}
+}
+
+string Sound::LoadWorker::_completed(bool ok) {
+	if (ok == false || engine->pendingSaves > 0) {
+		delete wave;
+		delete decoded;
+		return ok ? "The recording can't be replaced while it is being saved." : string();
+	}
+	// Emits recording_loaded
+	engine->_useLoadedWave(wave, decoded, channels);
+	return string();
+}
+
+Sound::SaveWorker::SaveWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file, WaveFormat format, vector<RecordingSegment> segments, string source):
+	RecordingWorker(engine, callback, holder), file(file), format(format), segments(segments), source(source)
+{
+
+}
+
+void Sound::SaveWorker::Execute() {
+	// Loaded files are copied through an own mapping, the one of the engine is used by playback
+	MappedWave* wave = NULL;
+	if (source.empty() == false) {
+		wave = new MappedWave(source);
+		if (wave->isOpen() == false) {
+			SetErrorMessage(wave->error().c_str());
+			delete wave;
+			return;
+		}
+	}
+
+	string error;
+	if (Engine::_writeRecording(file, format, segments, wave, &error) == false) {
+		SetErrorMessage(error.c_str());
+	}
+	delete wave;
+}
+
+string Sound::SaveWorker::_completed(bool ok) {
+	engine->pendingSaves--;
+	if (ok) {
+		engine->_emit(EventRecordingSaved, 0, {});
+	}
+	return string();
+}
+
+Sound::ConvolverWorker::ConvolverWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file, float mix, bool reload):
+	RecordingWorker(engine, callback, holder), file(file), mix(mix), reload(reload)
+{
+	sampleRate = engine->sampleRate;
+	bufferSize = engine->bufferSize;
+	channels = engine->inputChannels;
+	// A newer change (or a new stream configuration) replaces this one
+	request = ++engine->convolverRequest;
+	convolver = NULL;
+}
+
+Sound::ConvolverWorker::~ConvolverWorker() {
+	delete convolver;
+}
+
+void Sound::ConvolverWorker::Execute() {
+	convolver = Engine::_openConvolver(file, sampleRate, bufferSize, channels, &error);
+	if (convolver == NULL && reload == false) {
+		SetErrorMessage(error.c_str());
+	}
+}
+
+string Sound::ConvolverWorker::_completed(bool ok) {
+	if (request != engine->convolverRequest) {
+		return reload ? string() : "The convolver was changed or the stream was reconfigured before the impulse response was loaded.";
+	}
+	if (ok == false) return string();
+	if (convolver == NULL) {
+		printf("The impulse response was removed: %s\n", error.c_str());
+		engine->convolverFile = string();
+		return string();
+	}
+
+	// The blocks are convolved on the js thread, so the convolver can be swapped here
+	convolver->setMix(mix);
+	delete engine->convolver;
+	engine->convolver = convolver;
+	engine->convolverFile = file;
+	engine->convolverMix = convolver->mix();
+	convolver = NULL;
+	return string();
+}
+
+Sound::ClipWorker::ClipWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file):
+	RecordingWorker(engine, callback, holder), file(file)
+{
+	sampleRate = engine->clipRate;
+	clip = NULL;
+	id = -1;
+}
+
+Sound::ClipWorker::~ClipWorker() {
+	delete clip;
+}
+
+void Sound::ClipWorker::Execute() {
+	string error;
+	clip = Engine::_openClip(file, sampleRate, &error);
+	if (clip == NULL) {
+		SetErrorMessage(error.c_str());
+	}
+}
+
+string Sound::ClipWorker::_completed(bool ok) {
+	if (ok == false) return string();
+	// The clips were converted to another samplerate in the meantime
+	if (sampleRate != engine->clipRate) {
+		return "The samplerate changed while the clip was loaded.";
+	}
+	id = engine->clips->addClip(clip);
+	clip = NULL;
+	return string();
+}
+
+Local<Value> Sound::ClipWorker::_result() {
+	return Nan::New<Integer>(id);
+}
+
+Sound::ResamplerStage::ResamplerStage(int inRate, int outRate, int channels): channels(channels) {
+	resampler = new Resampler(inRate, outRate, channels);
+}
+
+Sound::ResamplerStage::~ResamplerStage() {
+	delete resampler;
+}
+
+void Sound::ResamplerStage::Init(Handle<Object> target) {
+	Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+	tpl->SetClassName(Nan::New("Resampler").ToLocalChecked());
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+	Nan::SetPrototypeMethod(tpl, "process", Process);
+	Nan::SetPrototypeMethod(tpl, "flush", Flush);
+	Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+	constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
+
+	// module.exports.Resampler = ...
+	Nan::Set(target, Nan::New("Resampler").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+void Sound::ResamplerStage::New(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	if (info.IsConstructCall()) {
+		if (info.Length() < 2 || info[0]->IsNumber() == false || info[1]->IsNumber() == false) {
+			Nan::ThrowTypeError("The input and the output sample rate must be numbers.");
+			return;
+		}
+		int inRate = (int)Nan::To<int32_t>(info[0]).FromJust();
+		int outRate = (int)Nan::To<int32_t>(info[1]).FromJust();
+		int channels = info.Length() >= 3 && info[2]->IsNumber() ? (int)Nan::To<int32_t>(info[2]).FromJust() : 1;
+		if (inRate < 1 || outRate < 1 || channels < 1) {
+			Nan::ThrowTypeError("The sample rates and the number of channels must be positive.");
+			return;
+		}
+
+		ResamplerStage* stage = new ResamplerStage(inRate, outRate, channels);
+		stage->Wrap(info.This());
+		info.GetReturnValue().Set(info.This());
+	} else {
+		const int argc = 3;
+		Local<Value> argv[argc] = {info[0], info[1], info[2]};
+		Local<Function> cons = Nan::New(constructor());
+		info.GetReturnValue().Set(cons->NewInstance(argc, argv));
+	}
+}
+
+void Sound::ResamplerStage::Process(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	ResamplerStage* stage = Nan::ObjectWrap::Unwrap<ResamplerStage>(info.Holder());
+
+	if (info.Length() < 1 || (info[0]->IsFloat32Array() == false && info[0]->IsArray() == false)) {
+		Nan::ThrowTypeError("First argument must be a Float32Array or an array of interleaved samples.");
+		return;
+	}
+
+	// Plain arrays are copied into a temporary block first
+	float* samples;
+	int64_t count;
+	float* copy = NULL;
+	if (info[0]->IsFloat32Array()) {
+		Nan::TypedArrayContents<float> contents(info[0]);
+		samples = *contents;
+		count = contents.length();
+	} else {
+		Local<Array> array = Local<Array>::Cast(info[0]);
+		count = array->Length();
+		copy = new float[count > 0 ? count : 1];
+		for (int64_t i = 0; i < count; ++i) {
+			copy[i] = (float)Nan::To<double>(Nan::Get(array, (uint32_t)i).ToLocalChecked()).FromMaybe(0.0);
+		}
+		samples = copy;
+	}
+
+	int64_t frames = count / stage->channels;
+	int64_t capacity = stage->resampler->maxOutput(frames) * stage->channels;
+	Local<ArrayBuffer> memory = ArrayBuffer::New(Isolate::GetCurrent(), capacity * sizeof(float));
+	float* out = (float*)memory->GetContents().Data();
+	int64_t produced = stage->resampler->process(samples, frames, out);
+	delete[] copy;
+
+	info.GetReturnValue().Set(Float32Array::New(memory, 0, produced * stage->channels));
+}
+
+void Sound::ResamplerStage::Flush(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	ResamplerStage* stage = Nan::ObjectWrap::Unwrap<ResamplerStage>(info.Holder());
+
+	int64_t capacity = stage->resampler->maxOutput(stage->resampler->taps()) * stage->channels;
+	Local<ArrayBuffer> memory = ArrayBuffer::New(Isolate::GetCurrent(), capacity * sizeof(float));
+	float* out = (float*)memory->GetContents().Data();
+	int64_t produced = stage->resampler->flush(out);
+
+	info.GetReturnValue().Set(Float32Array::New(memory, 0, produced * stage->channels));
+}
+
+void Sound::ResamplerStage::Reset(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	ResamplerStage* stage = Nan::ObjectWrap::Unwrap<ResamplerStage>(info.Holder());
+	stage->resampler->reset();
+}
+
+Sound::EqualizerStage::EqualizerStage(int sampleRate, int channels) {
+	equalizer = new Equalizer(sampleRate, channels);
+}
+
+Sound::EqualizerStage::~EqualizerStage() {
+	delete equalizer;
+}
+
+void Sound::EqualizerStage::Init(Handle<Object> target) {
+	Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+	tpl->SetClassName(Nan::New("Equalizer").ToLocalChecked());
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+	Nan::SetPrototypeMethod(tpl, "setBands", SetBands);
+	Nan::SetPrototypeMethod(tpl, "process", Process);
+	Nan::SetPrototypeMethod(tpl, "reset", Reset);
+
+	constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
+
+	// module.exports.Equalizer = ...
+	Nan::Set(target, Nan::New("Equalizer").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+void Sound::EqualizerStage::New(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	if (info.IsConstructCall()) {
+		if (info.Length() < 1 || info[0]->IsNumber() == false) {
+			Nan::ThrowTypeError("The sample rate must be a number.");
+			return;
+		}
+		int sampleRate = (int)Nan::To<int32_t>(info[0]).FromJust();
+		int channels = info.Length() >= 2 && info[1]->IsNumber() ? (int)Nan::To<int32_t>(info[1]).FromJust() : 1;
+		if (sampleRate < 1 || channels < 1) {
+			Nan::ThrowTypeError("The sample rate and the number of channels must be positive.");
+			return;
+		}
+		vector<EqBand> bands;
+		if (info.Length() >= 3 && info[2]->IsUndefined() == false && _getEqBands(info[2], &bands) == false) return;
+
+		EqualizerStage* stage = new EqualizerStage(sampleRate, channels);
+		stage->equalizer->setBands(bands, false);
+		stage->Wrap(info.This());
+		info.GetReturnValue().Set(info.This());
+	} else {
+		const int argc = 3;
+		Local<Value> argv[argc] = {info[0], info[1], info[2]};
+		Local<Function> cons = Nan::New(constructor());
+		info.GetReturnValue().Set(cons->NewInstance(argc, argv));
+	}
+}
+
+void Sound::EqualizerStage::SetBands(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	EqualizerStage* stage = Nan::ObjectWrap::Unwrap<EqualizerStage>(info.Holder());
+
+	vector<EqBand> bands;
+	if (info.Length() < 1) {
+		Nan::ThrowTypeError("First argument must be an array of bands.");
+		return;
+	}
+	if (_getEqBands(info[0], &bands) == false) return;
+	// Ramped by default, so the bands can be moved between blocks without clicks
+	bool ramp = info.Length() < 2 || info[1]->IsBoolean() == false || Nan::To<bool>(info[1]).FromJust();
+	stage->equalizer->setBands(bands, ramp);
+}
+
+void Sound::EqualizerStage::Process(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	EqualizerStage* stage = Nan::ObjectWrap::Unwrap<EqualizerStage>(info.Holder());
+
+	vector<float*> channels;
+	size_t frames;
+	if (info.Length() < 1) {
+		Nan::ThrowTypeError("First argument must be a Float32Array or an array of Float32Arrays.");
+		return;
+	}
+	if (_getEqChannels(info[0], &channels, &frames) == false) return;
+	if ((int)channels.size() != stage->equalizer->channels()) {
+		Nan::ThrowTypeError("The number of arrays must match the channels of the equalizer.");
+		return;
+	}
+
+	stage->equalizer->process(channels.data(), (int)frames);
+	info.GetReturnValue().Set(info[0]);
+}
+
+void Sound::EqualizerStage::Reset(const Nan::FunctionCallbackInfo<v8::Value>& info) {
+	Nan::HandleScope scope;
+	EqualizerStage* stage = Nan::ObjectWrap::Unwrap<EqualizerStage>(info.Holder());
+	stage->equalizer->reset();
+}
+
 void Sound::InitOther(Local<Object> target) {
 	// Add device functions
 	Nan::Set(target, Nan::New("getDevices").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(GetDevices)).ToLocalChecked());
 	Nan::Set(target, Nan::New("applyDamping").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(ApplyDamping)).ToLocalChecked());
+	Nan::Set(target, Nan::New("setFftPlannerEffort").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(SetFftPlannerEffort)).ToLocalChecked());
+	Nan::Set(target, Nan::New("eq").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(Equalize)).ToLocalChecked());
+
+	// Add the vector functions
+	Local<Object> math = Nan::New<Object>();
+	Nan::Set(math, Nan::New("gain").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorGain)).ToLocalChecked());
+	Nan::Set(math, Nan::New("ramp").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorRamp)).ToLocalChecked());
+	Nan::Set(math, Nan::New("mix").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorMix)).ToLocalChecked());
+	Nan::Set(math, Nan::New("clip").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorClip)).ToLocalChecked());
+	Nan::Set(math, Nan::New("softClip").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorSoftClip)).ToLocalChecked());
+	Nan::Set(math, Nan::New("interleave").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorInterleave)).ToLocalChecked());
+	Nan::Set(math, Nan::New("deinterleave").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorDeinterleave)).ToLocalChecked());
+	Nan::Set(math, Nan::New("dot").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorDot)).ToLocalChecked());
+	Nan::Set(math, Nan::New("absMax").ToLocalChecked(), Nan::GetFunction(Nan::New<FunctionTemplate>(VectorAbsMax)).ToLocalChecked());
+	Nan::Set(math, Nan::New("isa").ToLocalChecked(), Nan::New<String>(vectorKernels().name).ToLocalChecked());
+	Nan::Set(target, Nan::New("math").ToLocalChecked(), math);
 }
 
 void Sound::InitAll(Handle<Object> target) {
+	// Reuse the fft plans that were measured in earlier runs
+	FftPlanCache::loadWisdom();
 	Engine::Init(target);
+	ResamplerStage::Init(target);
+	EqualizerStage::Init(target);
 	InitOther(target);
 }
\ No newline at end of file
@@ -5,64 +5,134 @@
 #define BEEP_DETAULT_DURATION 200
 #define BEEP_DETAULT_FREQUENCY 700
 #define BEEP_DETAULT_LEVEL 1.0
-#define PROCESSING_INTERVAL 1
+// The attack and release of beeps and tones in ms
+#define TONE_DEFAULT_RAMP 5
+// The polling interval in ms (0 means processing is only woken up by the stream callback)
+#define PROCESSING_INTERVAL 0
+#define BUFFER_QUEUE_DEPTH 100
+// The interval of the info event in ms (0 means every block)
+#define INFO_INTERVAL 0
+// The interval of the stats event in ms (0 means every time blocks were processed)
+#define STATS_INTERVAL 1000
+// The number of graph parameter changes that wait for the stream callback without allocating
+#define GRAPH_PARAM_QUEUE_DEPTH 256
 
 #include <v8.h>
 #include <nan.h>
 #include <map>
 #include <vector>
+#include <utility>
+#include <algorithm>
 #include <float.h>
 #include <sys/stat.h>
 #include <fstream>
+#include <atomic>
 
 #include <portaudio.h>
 #include <fftw3.h>
 
 #include "readerwriterqueue.h"
 #include "WindowFunction.h"
+#include "BufferPool.h"
+#include "AudioBlock.h"
+#include "Events.h"
+#include "Stft.h"
+#include "Meter.h"
+#include "SampleArena.h"
+#include "WaveFile.h"
+#include "DiskRecorder.h"
+#include "MappedWave.h"
+#include "Resampler.h"
+#include "Slac.h"
+#include "DspGraph.h"
+#include "Equalizer.h"
+#include "Convolver.h"
+#include "ToneGenerator.h"
+#include "Timeline.h"
+#include "ClipMixer.h"
+#include "VectorMath.h"
+#include "Telemetry.h"
 
 using namespace std;
 using namespace v8;
 
 namespace Sound {
 
-	/**
-	 * Struct of a wave header with the exact wave-header structure in memory.
-	 */
-	struct WaveHeader {
-		char		RIFF[4];
-		int			ChunkSize;
-		char		WAVE[4];
-		char		fmt[4];
-		int			Subchunk1Size;
-		short int	AudioFormat;
-		short int	NumOfChan;
-		int			SamplesPerSec;
-		int			bytesPerSec;
-		short int	blockAlign;
-		short int	bitsPerSample;
-		char 		data[4];
-		int			Subchunk2Size;
-	};
-
 	/**
 	 * Used to store callback functions for the event emitter stuff.
 	 */
 	struct Listener {
-		Listener(Nan::Persistent<Function>* cb, bool once): cb(cb), once(once) {
-
+		Listener(Local<Function> fn, bool once): once(once), removed(false) {
+			callback = new Nan::Callback(fn);
 		}
 		~Listener() {
-			cb->Reset();
+			delete callback;
 		}
-		Nan::Persistent<Function>* cb;
+		// Created once when the listener is added
+		Nan::Callback* callback;
 		bool once;
+		// Removed while its event was emitted (deleted when the emit finished)
+		bool removed;
+	};
+
+	/**
+	 * The listeners of one event.
+	 *
+	 * While the event is emitted the vector is not modified: removed listeners are only
+	 * marked and added ones wait in pending, both is applied when the emit finished.
+	 */
+	struct EventSlot {
+		vector<Listener*> listeners;
+		// Listeners that were added during an emit and whether they are prepended
+		vector<pair<Listener*, bool> > pending;
+		// The nesting depth of emits of this event
+		int emitting;
+		// The number of listeners that are not removed (including pending ones)
+		int active;
+	};
+
+	/**
+	 * Coalesces an event that would otherwise be emitted for every block.
+	 */
+	struct EventThrottle {
+		// The minimum time between two emits in ms (0 disables the limit)
+		double interval;
+		// Emit at most every blocks blocks
+		int blocks;
+		// The stream position of the last emit in frames
+		int64_t lastEmit;
+		int blocksSince;
+		// The number of updates since the last emit
+		int coalesced;
+		// The latest value
+		double value;
+	};
+
+	/**
+	 * An input block on its way from the stream callback to the js thread.
+	 */
+	struct InputBlock {
+		float* samples;
+		// The stream time the first frame was captured at
+		double time;
+	};
+
+	/**
+	 * A part of the recording that is saved without copying it.
+	 */
+	struct RecordingSegment {
+		const float* samples;
+		int64_t length;
 	};
 
 	/**
 	 * The actual engine that manages audio i/o etc..
 	 */
 	class Engine: public Nan::ObjectWrap {
+		friend class LoadWorker;
+		friend class SaveWorker;
+		friend class ConvolverWorker;
+		friend class ClipWorker;
 	public:
 		static NAN_MODULE_INIT(Init);
 	private:
@@ -71,6 +141,7 @@ namespace Sound {
 			
 		static NAN_METHOD(New);
 		static NAN_METHOD(AddListener);
+		static NAN_METHOD(Emit);
 		static NAN_METHOD(Once);
 		static NAN_METHOD(PrependListener);
 		static NAN_METHOD(PrependOnceListener);
@@ -78,7 +149,9 @@ namespace Sound {
 		static NAN_METHOD(ListenerCount);
 		static NAN_METHOD(RemoveAllListeners);
 		static NAN_METHOD(RemoveListener);
+		static NAN_METHOD(SetEventThrottle);
 		static NAN_METHOD(LoadRecording);
+		static NAN_METHOD(LoadRecordingAsync);
 		static NAN_METHOD(StartPlayback);
 		static NAN_METHOD(StopPlayback);
 		static NAN_METHOD(PausePlayback);
@@ -87,13 +160,28 @@ namespace Sound {
 		static NAN_METHOD(StopRecording);
 		static NAN_METHOD(DeleteRecording);
 		static NAN_METHOD(SaveRecording);
+		static NAN_METHOD(SaveRecordingAsync);
 		static NAN_METHOD(IsRecording);
 		static NAN_METHOD(GetRecordingSamples);
 		static NAN_METHOD(GetRecordingSampleAt);
+		static NAN_METHOD(GetRecordingChannels);
 		static NAN_METHOD(GetPlaybackProgress);
 		static NAN_METHOD(SetPlaybackProgress);
 		static NAN_METHOD(GetPlaybackPosition);
 		static NAN_METHOD(Beep);
+		static NAN_METHOD(PlayTone);
+		static NAN_METHOD(StopTone);
+		static NAN_METHOD(GetCurrentFrame);
+		static NAN_METHOD(Schedule);
+		static NAN_METHOD(CancelScheduled);
+		static NAN_METHOD(GetStreamTime);
+		static NAN_METHOD(LoadClip);
+		static NAN_METHOD(UnloadClip);
+		static NAN_METHOD(PlayClip);
+		static NAN_METHOD(SetVoice);
+		static NAN_METHOD(StopVoice);
+		static NAN_METHOD(GetClipStats);
+		static NAN_METHOD(GetStats);
 		static NAN_METHOD(GetVolume);
 		static NAN_METHOD(SetVolume);
 		static NAN_METHOD(GetMute);
@@ -101,35 +189,136 @@ namespace Sound {
 		static NAN_METHOD(GetOptions);
 		static NAN_METHOD(SetOptions);
 		static NAN_METHOD(Synchronize);
+		static NAN_METHOD(GetBufferPoolInfo);
+		static NAN_METHOD(SetGraph);
+		static NAN_METHOD(SetGraphParam);
+		static NAN_METHOD(GetEq);
+		static NAN_METHOD(SetEq);
+		static NAN_METHOD(SetConvolver);
 
 		static inline Nan::Persistent<Function> & constructor() {
 			static Nan::Persistent<Function> construct;
 			return construct;
 		}
-		static void _processing(uv_timer_t *handle);
+		static void _onProcessingSignal(uv_async_t *handle);
+		static void _onProcessingTimer(uv_timer_t *handle);
+		static void _onFftSignal(uv_async_t *handle);
+		static void _onAsyncClosed(uv_handle_t *handle);
 		static int _streamCallback(
 			const void* input, void* output,
 			unsigned long frameCount,
 			const PaStreamCallbackTimeInfo* timeInfo,
 			PaStreamCallbackFlags statusFlags,
 			void *userData);
-		static void _stopBeep(uv_timer_t *handle);
 		
+		void _processing();
+		void _processBuffer(float* inputBuffer, double time);
+		/** Plays back into or records the frames [from, to) of a block. */
+		void _transport(AudioBlock& block, int from, int to);
+		/** Applies a scheduled command at a frame of the block that is processed. */
+		void _applyCommand(const TimelineCommand& command, int offset);
+		/** Scales the block with the volume, from the frames scheduled changes were applied at. */
+		void _applyVolume(AudioBlock& block);
+		void _startPlayback();
+		void _stopPlayback();
+		void _pausePlayback();
+		void _setPlaybackProgress(double progress);
+		/** Starts recording into memory or into file (file is empty for memory, false with error if it failed). */
+		bool _startRecording(string file, SampleFormat format, string* error);
+		/** Stops recording (false with error if writing the file failed). */
+		bool _stopRecording(string* error);
+		void _emitSpectra();
+		void _emitInfo();
+		/** Emits the beep and tone events of the voices that started or ended in the last block. */
+		void _emitToneEvents();
+		/** The telemetry of a span of time as a js object. */
+		Local<Object> _statsObject(const TelemetrySnapshot& stats);
+		/** Emits the stats event every statsInterval ms. */
+		void _emitStats();
+		void _configureBuffers();
+		/** Scratch space for interleaving blocks at the file boundary (js thread). */
+		float* _interleaved(int count);
+		void _configureAnalysis();
+		void _clearQueues();
 		void _configureStream();
 		void _startStream();
 		void _stopStream();
 		void _destroyStream();
 		void _loadWave(string file);
-		void _deleteRecording();
-		void _saveRecording(string file);
+		/**
+		 * Opens a wave or slac file for playback at sampleRate (thread safe). Wave files at that
+		 * rate are mapped, everything else is decoded (and resampled) into an arena.
+		 */
+		static bool _openRecording(string file, int sampleRate, MappedWave** wave, SampleArena** decoded, int* channels, string* error);
+		/** Replaces the recording with a loaded file (either wave or decoded is set). */
+		void _useLoadedWave(MappedWave* wave, SampleArena* decoded, int channels);
+		/** Converts interleaved samples to another sample rate (thread safe). */
+		static void _resampleInto(const SampleSource* source, int sourceRate, int channels, int sampleRate, SampleArena* arena);
+		/** Throws and returns false while an async save still needs the recording. */
+		bool _deleteRecording();
+		void _saveRecording(string file, SampleFormat format);
+		/** The layout of the file saveRecording creates. */
+		WaveFormat _recordingFormat(SampleFormat format);
+		/** The segments of the recording (empty if a loaded file is played). */
+		vector<RecordingSegment> _snapshotRecording();
+		/** Writes recording segments or a loaded file into a wave or slac file (thread safe). */
+		static bool _writeRecording(string file, WaveFormat format, const vector<RecordingSegment>& segments, const SampleSource* source, string* error);
+		/** Reads the format option of saveRecording and startRecording (throws on unknown names). */
+		static bool _getSampleFormat(Local<Object> options, SampleFormat* format);
+		/** If a file is the loaded wave (truncating it would pull the mapping away from under playback). */
+		bool _isMappedFile(const string& file);
 		
-		void _addListener(string eventName, Nan::Persistent<Function>* listener, bool prepend = false, bool once = false);
-		void _emit(string eventName, int argc, Local<Value> argv[]);
+		/** Reads an event name argument (unknown names are no error, they never have listeners). */
+		static bool _getEventType(Local<Value> name, EventType* type);
+		void _addListener(EventType type, Local<Function> fn, bool prepend = false, bool once = false);
+		void _removeListener(EventType type, Local<Function> fn);
+		void _removeAllListeners(EventType type);
+		/** Removes a listener now or, during an emit of its event, when the emit finished. */
+		void _retireListener(EventType type, Listener* listener);
+		/** Applies the changes that were made to the listeners during an emit. */
+		void _settleListeners(EventType type);
+		inline bool _hasListeners(EventType type) const {
+			return events[type].active > 0;
+		}
+		void _emit(EventType type, int argc, Local<Value> argv[]);
+		/** The throttle of a progress event or NULL for events that can't be throttled. */
+		EventThrottle* _throttleFor(EventType type);
+		/** Starts coalescing from scratch (e.g. when playback starts). */
+		void _resetThrottle(EventThrottle* throttle);
+		/** Records a progress update and emits it with the number of coalesced updates when it is due. */
+		void _progress(EventType type, EventThrottle* throttle, double value);
+		/** Emits the latest value if updates were held back. */
+		void _flushProgress(EventType type, EventThrottle* throttle);
 		void _setOptions(Nan::Persistent<Object>* opts);
 
+		/** Reads the graph description of setGraph (throws on malformed descriptions). */
+		static bool _getGraphSpec(Local<Object> description, DspGraphSpec* spec);
+		/** Hands a graph over to the stream callback (the previous one is deleted once the callback let go of it). */
+		void _publishGraph(DspGraph* graph);
+		/** Deletes the graphs the stream callback replaced. */
+		void _collectGraphs();
+		/** Builds the graph again for a new stream configuration (the stream is stopped). */
+		void _rebuildGraph();
+		/** Takes over a published graph and the parameter changes (stream callback). */
+		void _pollGraph();
+		/** Creates the equalizer for the stream configuration with the current bands. */
+		void _configureEq();
+		/** Loads an impulse response (wave or slac) for a stream configuration (thread safe). */
+		static Convolver* _openConvolver(string file, int sampleRate, int bufferSize, int channels, string* error);
+		/** Loads the impulse response again on the threadpool for a new stream configuration. */
+		void _configureConvolver();
+		/** Loads a wave or slac file into memory at a samplerate (thread safe). */
+		static Clip* _openClip(string file, int sampleRate, string* error);
+		/** Loads the clips again when the samplerate changed. */
+		void _configureClips();
 
-		// Holds the event listeners for each eventName
-		map<string, vector<Listener*>*> listeners;
+
+		// Holds the event listeners for each event type
+		EventSlot events[EventTypeCount];
+		EventThrottle playbackProgress;
+		EventThrottle recordingProgress;
+		// The number of frames processed since the engine was created (the clock of the throttles)
+		int64_t processedFrames;
 
 		/** The PortAudio stuff **/
 		PaStream* stream;
@@ -145,49 +334,299 @@ namespace Sound {
 		double inputLatency;
 		double outputLatency;
 
+		// The number of blocks each buffer queue can hold
+		int queueDepth;
+		// Preallocated blocks that travel through the buffer queues
+		BufferPool* bufferPool;
 		// Holds the unprocessed input buffers comming from the soundcard
-		moodycamel::ReaderWriterQueue<float*>* inBufferQueue;
+		moodycamel::ReaderWriterQueue<InputBlock>* inBufferQueue;
 		// Holds the processed output buffers that go out to the soundcard
 		moodycamel::ReaderWriterQueue<float*>* outBufferQueue;
+		// Interleaved samples of the block that is recorded or played back
+		vector<float> interleaved;
+		// A planar block for playback that starts or stops within a block (aligned)
+		float* transportBlock;
 
-		// The actual processing interval timer
+		// Signalled by the stream callback when new input buffers are queued
+		uv_async_t* processingAsync;
+		// The optional polling interval in ms (0 disables the timer)
+		int processingInterval;
+		// The polling fallback timer
 		uv_timer_t processing_timer;
 		// The volume coefficient
 		double volume = 1.0;
 		bool isMuted = false;
-		// An indicator if a beep is currently being applied
-		bool isBeeping = false;
-		// The last sample that got a value applied
-		int beepIdx = -1;
-		// The last sample that will get a value applied
-		int beepEndIdx;
-		// The frequency of the beep
-		int beepFrequency = BEEP_DETAULT_FREQUENCY;
-		// The duration in milliseconds
-		double beepDuration = BEEP_DETAULT_DURATION;
-		// The volume of the beep from 0..1
-		double beepLevel = BEEP_DETAULT_LEVEL;
-		// The beep timer
-		uv_timer_t beep_timer;
-		// Get's filled while recording or playback buffers
-		vector<float*> recordingBufferCache;
+		// The scheduled transport commands
+		Timeline timeline;
+		// The stream time the last processed block was captured at
+		double blockTime = 0.0;
+		// The gain at the start of the block and the frames scheduled commands changed it at
+		float blockGain;
+		vector<pair<int, float> > gainChanges;
+		// Plays beeps and tones on the clock of processedFrames
+		ToneGenerator* tones;
+		// The loaded clips and their voices (mixed into the output like the tones)
+		ClipMixer* clips;
+		// The samplerate the clips were loaded at
+		int clipRate;
+		// The voices of the beep and of replaced beeps that still fade out (the last one is the current beep)
+		vector<int> beepVoices;
+		// Get's filled while recording or with a loaded wave
+		SampleArena* recording;
+		// A loaded wave file that is played straight from disk
+		MappedWave* mappedWave;
+		// Either the recording or the mapped wave
+		SampleSource* playbackSource;
+		// The number of interleaved channels of the playback source
+		int playbackChannels;
+		// Streams the recording into a file instead (NULL when recording into memory)
+		DiskRecorder* diskRecorder;
 		// An indicator if recording is active
 		bool isRecording = false;
 		// An indicator if playback is active
 		bool isPlaying = false;
-		// The last playback buffer that was send to the outBuffer
-		int playbackBufferCacheIdx = 0;
+		// The number of samples of the current recording
+		int64_t recordedSamples;
+		// The index of the next sample that will be played back (always the first sample of a frame)
+		int64_t playbackPosition;
+		// The number of async saves that still read the recording
+		int pendingSaves = 0;
+
+		/** The metering stuff **/
+		Meter* meter;
+		// The info event aggregates the levels over this many ms
+		double infoInterval;
+		// If nobody listened to the info event for the last block
+		bool meterIdle;
+
+		/** The telemetry stuff **/
+		// Counters and histograms of the stream callback and the processing
+		Telemetry* telemetry;
+		// Where getStats and the stats event started measuring
+		TelemetrySnapshot statsBaseline;
+		TelemetrySnapshot statsEventBaseline;
+		// The stats event covers this many ms
+		double statsInterval;
+		// The processedFrames the last stats event was emitted at
+		int64_t statsLastEmit;
+		// If nobody listened to the stats event the last time blocks were processed
+		bool statsIdle;
+
+		/** The processing graph stuff **/
+		// The description of the graph (kept to rebuild it for a new stream configuration)
+		DspGraphSpec graphSpec;
+		// The latest graph of the js thread (the parameter names are resolved with it)
+		DspGraph* graph;
+		// A graph the stream callback did not take over yet
+		std::atomic<DspGraph*> pendingGraph;
+		// The graph the stream callback renders (only touched by the callback while the stream runs)
+		DspGraph* activeGraph;
+		// Replaced graphs on their way back to the js thread
+		moodycamel::ReaderWriterQueue<DspGraph*>* retiredGraphs;
+		// Parameter changes on their way to the stream callback
+		moodycamel::ReaderWriterQueue<DspParamChange>* graphParams;
+
+		/** The equalizer stuff **/
+		// Filters the blocks on the js thread before the levels are measured and the data event is emitted
+		Equalizer* equalizer;
+		vector<EqBand> eqBands;
+
+		/** The convolution stuff **/
+		// Convolves the blocks after the equalizer (NULL without an impulse response)
+		Convolver* convolver;
+		// The impulse response file (kept to load it again for a new stream configuration)
+		string convolverFile;
+		float convolverMix = 1.0f;
+		// Counts the convolver changes, a response that was loaded for an earlier one is dropped
+		unsigned int convolverRequest = 0;
 
 		/** The FFT stuff **/
 		int fftWindowSize;
 		float fftOverlapSize;
 		WindowFunctionType fftWindowFunctionType;
-		WindowFunction* fftWindowFunction;
+		const WindowFunction* fftWindowFunction;
+		// The streaming analysis that runs on its own thread
+		Stft* stft;
+		// Signalled by the analysis thread when spectra are ready
+		uv_async_t* fftAsync;
+	};
+
+	/**
+	 * Base of the workers that load or save files on the libuv threadpool.
+	 * Settles either the node style callback or the promise that is returned to js.
+	 */
+	class RecordingWorker: public Nan::AsyncWorker {
+	public:
+		RecordingWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder);
+		~RecordingWorker();
+
+		/** The promise of the job (undefined when a callback was given). */
+		Local<Value> promise();
+	protected:
+		void HandleOKCallback();
+		void HandleErrorCallback();
+
+		/**
+		 * Applies the result on the js thread before the job is settled.
+		 *
+		 * @param  ok If Execute() succeeded.
+		 *
+		 * @return    An error message if the result could not be applied.
+		 */
+		virtual string _completed(bool ok) = 0;
+
+		/** The value the job is settled with (undefined by default). */
+		virtual Local<Value> _result();
+
+		Engine* engine;
+	private:
+		void _settle(Local<Value> error, Local<Value> result);
+
+		Nan::Persistent<Promise::Resolver> resolver;
+	};
+
+	/**
+	 * Maps a wave file or decodes a slac file and converts it to the engine rate if needed.
+	 */
+	class LoadWorker: public RecordingWorker {
+	public:
+		LoadWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file, int sampleRate);
+		void Execute();
+	protected:
+		string _completed(bool ok);
+	private:
+		string file;
+		int sampleRate;
+		MappedWave* wave;
+		SampleArena* decoded;
+		int channels;
+	};
+
+	/**
+	 * Encodes and writes a snapshot of the recording (or copies a loaded file).
+	 */
+	class SaveWorker: public RecordingWorker {
+	public:
+		SaveWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file, WaveFormat format, vector<RecordingSegment> segments, string source);
+		void Execute();
+	protected:
+		string _completed(bool ok);
+	private:
+		string file;
+		WaveFormat format;
+		vector<RecordingSegment> segments;
+		// The loaded file to copy (empty when the recording is saved)
+		string source;
+	};
+
+	/**
+	 * Loads an impulse response and partitions it for the stream configuration.
+	 */
+	class ConvolverWorker: public RecordingWorker {
+	public:
+		/**
+		 * @param reload The response is loaded again for a new stream configuration, errors are
+		 *               printed and the promise is always resolved (nobody waits for it).
+		 */
+		ConvolverWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file, float mix, bool reload);
+		~ConvolverWorker();
+		void Execute();
+	protected:
+		string _completed(bool ok);
+	private:
+		string file;
+		float mix;
+		bool reload;
+		// The configuration and the convolver change the response is loaded for
+		int sampleRate;
+		int bufferSize;
+		int channels;
+		unsigned int request;
+		Convolver* convolver;
+		string error;
+	};
+
+	/**
+	 * Loads a clip into memory and adds it to the clips of the engine.
+	 */
+	class ClipWorker: public RecordingWorker {
+	public:
+		ClipWorker(Engine* engine, Nan::Callback* callback, Local<Object> holder, string file);
+		~ClipWorker();
+		void Execute();
+	protected:
+		string _completed(bool ok);
+		Local<Value> _result();
+	private:
+		string file;
+		int sampleRate;
+		Clip* clip;
+		int id;
+	};
+
+	/**
+	 * Exposes the streaming sample rate conversion (soundengine.Resampler).
+	 */
+	class ResamplerStage: public Nan::ObjectWrap {
+	public:
+		static NAN_MODULE_INIT(Init);
+	private:
+		explicit ResamplerStage(int inRate, int outRate, int channels);
+		~ResamplerStage();
+
+		static NAN_METHOD(New);
+		static NAN_METHOD(Process);
+		static NAN_METHOD(Flush);
+		static NAN_METHOD(Reset);
+
+		static inline Nan::Persistent<Function> & constructor() {
+			static Nan::Persistent<Function> construct;
+			return construct;
+		}
+
+		Resampler* resampler;
+		int channels;
+	};
+
+	/**
+	 * Exposes the equalizer for blocks that are filtered one after another (soundengine.Equalizer).
+	 */
+	class EqualizerStage: public Nan::ObjectWrap {
+	public:
+		static NAN_MODULE_INIT(Init);
+	private:
+		explicit EqualizerStage(int sampleRate, int channels);
+		~EqualizerStage();
+
+		static NAN_METHOD(New);
+		static NAN_METHOD(SetBands);
+		static NAN_METHOD(Process);
+		static NAN_METHOD(Reset);
+
+		static inline Nan::Persistent<Function> & constructor() {
+			static Nan::Persistent<Function> construct;
+			return construct;
+		}
+
+		Equalizer* equalizer;
 	};
 
 	// The device listing method
 	NAN_METHOD(GetDevices);
 	NAN_METHOD(ApplyDamping);
+	NAN_METHOD(SetFftPlannerEffort);
+	NAN_METHOD(Equalize);
+
+	// The vector functions (soundengine.math)
+	NAN_METHOD(VectorGain);
+	NAN_METHOD(VectorRamp);
+	NAN_METHOD(VectorMix);
+	NAN_METHOD(VectorClip);
+	NAN_METHOD(VectorSoftClip);
+	NAN_METHOD(VectorInterleave);
+	NAN_METHOD(VectorDeinterleave);
+	NAN_METHOD(VectorDot);
+	NAN_METHOD(VectorAbsMax);
 
 	void InitOther(Local<Object> target);
 	NAN_MODULE_INIT(InitAll);
@@ -0,0 +1,169 @@
+#include "Stft.h"
+
+#include <cmath>
+#include <string.h>
+
+// The number of finished frames that can wait for the js thread
+#define STFT_FRAME_COUNT 32
+
+Sound::Stft::Stft(int windowSize, float overlap, WindowFunctionType w_type, int blockFrames, uv_async_t* notify):
+	windowSize(windowSize), blockFrames(blockFrames), notify(notify)
+{
+	if (overlap < 0.0f) overlap = 0.0f;
+	if (overlap > 0.99f) overlap = 0.99f;
+	hop = (int)lround(windowSize * (1.0 - overlap));
+	if (hop < 1) hop = 1;
+	_bins = windowSize / 2 + 1;
+	position = 0;
+
+	windowFunction = WindowFunction::shared(w_type, windowSize);
+
+	// Leave room for a couple of blocks in case the analysis thread falls behind
+	ring = new RingBuffer(windowSize + blockFrames * 8);
+	mixdown = new float[blockFrames];
+
+	window = new float[windowSize];
+	in = (double*)fftw_malloc(sizeof(double) * windowSize);
+	out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * _bins);
+	plan = FftPlanCache::get(windowSize, FftForward);
+
+	frameCount = STFT_FRAME_COUNT;
+	frames = new StftFrame[frameCount];
+	freeFrames = new moodycamel::ReaderWriterQueue<StftFrame*>(frameCount);
+	readyFrames = new moodycamel::ReaderWriterQueue<StftFrame*>(frameCount);
+	for (int i = 0; i < frameCount; ++i) {
+		frames[i].magnitude = new float[_bins];
+		frames[i].phase = new float[_bins];
+		frames[i].position = 0;
+		freeFrames->enqueue(&frames[i]);
+	}
+
+	enabled.store(false);
+	_dropped.store(0);
+	running.store(true);
+	uv_sem_init(&pending, 0);
+	uv_thread_create(&thread, _run, this);
+}
+
+Sound::Stft::~Stft() {
+	// Stop the analysis thread
+	running.store(false);
+	uv_sem_post(&pending);
+	uv_thread_join(&thread);
+	uv_sem_destroy(&pending);
+
+	for (int i = 0; i < frameCount; ++i) {
+		delete[] frames[i].magnitude;
+		delete[] frames[i].phase;
+	}
+	delete[] frames;
+	delete freeFrames;
+	delete readyFrames;
+
+	fftw_free(in);
+	fftw_free(out);
+	delete[] window;
+
+	delete[] mixdown;
+	delete ring;
+}
+
+int Sound::Stft::bins() const {
+	return _bins;
+}
+
+int Sound::Stft::hopSize() const {
+	return hop;
+}
+
+void Sound::Stft::setEnabled(bool enabled) {
+	this->enabled.store(enabled);
+}
+
+bool Sound::Stft::isEnabled() const {
+	return enabled.load();
+}
+
+void Sound::Stft::write(const AudioBlock& block) {
+	if (enabled.load(std::memory_order_relaxed) == false) return;
+	int frames = block.frames() < blockFrames ? block.frames() : blockFrames;
+	int channels = block.channels();
+
+	if (channels == 1) {
+		ring->write(block.channel(0), frames);
+	} else {
+		// Sum the planar channels with unit stride loops
+		memcpy(mixdown, block.channel(0), frames * sizeof(float));
+		for (int c = 1; c < channels; ++c) {
+			const float* samples = block.channel(c);
+			for (int i = 0; i < frames; ++i) mixdown[i] += samples[i];
+		}
+		float gain = 1.0f / channels;
+		for (int i = 0; i < frames; ++i) mixdown[i] *= gain;
+		ring->write(mixdown, frames);
+	}
+	uv_sem_post(&pending);
+}
+
+Sound::StftFrame* Sound::Stft::poll() {
+	StftFrame* frame;
+	if (readyFrames->try_dequeue(frame)) return frame;
+	return NULL;
+}
+
+void Sound::Stft::recycle(StftFrame* frame) {
+	freeFrames->enqueue(frame);
+}
+
+unsigned int Sound::Stft::dropped() const {
+	return _dropped.load();
+}
+
+void Sound::Stft::_run(void* arg) {
+	Stft* stft = (Stft*)arg;
+	while (true) {
+		uv_sem_wait(&stft->pending);
+		if (stft->running.load() == false) break;
+		stft->_analyse();
+	}
+}
+
+void Sound::Stft::_analyse() {
+	// Amplitude scaling of the single sided spectrum that also undoes the gain of the window
+	double scale = 2.0 / (windowSize * windowFunction->coherentGain());
+	bool produced = false;
+
+	while (ring->readable() >= windowSize) {
+		// Take the next window and only consume the hop so the rest overlaps with the next one
+		ring->peek(window, windowSize);
+		ring->skip(hop);
+
+		StftFrame* frame;
+		if (freeFrames->try_dequeue(frame) == false) {
+			// The js thread did not keep up
+			_dropped.fetch_add(1);
+			position += hop;
+			continue;
+		}
+
+		windowFunction->apply(window, windowSize);
+		for (int i = 0; i < windowSize; ++i) {
+			in[i] = window[i];
+		}
+		fftw_execute_dft_r2c(plan, in, out);
+
+		for (int k = 0; k < _bins; ++k) {
+			double re = out[k][0];
+			double im = out[k][1];
+			frame->magnitude[k] = (float)(sqrt(re * re + im * im) * scale);
+			frame->phase[k] = (float)atan2(im, re);
+		}
+		frame->position = position;
+		position += hop;
+
+		readyFrames->enqueue(frame);
+		produced = true;
+	}
+
+	if (produced) uv_async_send(notify);
+}
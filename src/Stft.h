@@ -0,0 +1,118 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_STFT_H
+#define SOUND_STFT_H
+
+#include <atomic>
+#include <stdint.h>
+#include <uv.h>
+#include <fftw3.h>
+
+#include "readerwriterqueue.h"
+#include "RingBuffer.h"
+#include "AudioBlock.h"
+#include "WindowFunction.h"
+#include "FftPlanCache.h"
+
+namespace Sound {
+
+	/**
+	 * The spectrum of one analysis window.
+	 */
+	struct StftFrame {
+		/** The magnitude for every bin (windowSize / 2 + 1 values). */
+		float* magnitude;
+		/** The phase in radians for every bin. */
+		float* phase;
+		/** The index of the first sample of the window in the analysed stream. */
+		int64_t position;
+	};
+
+	/**
+	 * A streaming short time fourier transform that runs on its own thread.
+	 *
+	 * The stream callback pushes samples with write(), the analysis thread cuts them
+	 * into overlapping windows and transforms them, and the js thread is signalled
+	 * through an uv_async_t to pick the finished frames up with poll().
+	 */
+	class Stft {
+	public:
+		/**
+		 * @param windowSize  The number of samples per analysis window.
+		 * @param overlap     The overlap of two consecutive windows (0..1).
+		 * @param w_type      The window function to apply before transforming.
+		 * @param blockFrames The maximum number of frames per write().
+		 * @param notify      Signalled whenever new frames are available.
+		 */
+		Stft(int windowSize, float overlap, WindowFunctionType w_type, int blockFrames, uv_async_t* notify);
+		~Stft();
+
+		/** The number of frequency bins per frame. */
+		int bins() const;
+
+		/** The number of samples between two windows. */
+		int hopSize() const;
+
+		/** Enables or disables the analysis (samples are ignored while disabled). */
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+
+		/**
+		 * Pushes a block into the analysis (channels are mixed down).
+		 * This is realtime safe and drops samples if the analysis falls behind.
+		 */
+		void write(const AudioBlock& block);
+
+		/**
+		 * Takes the next finished frame (js thread).
+		 *
+		 * @return The frame or NULL. Frames must be handed back with recycle().
+		 */
+		StftFrame* poll();
+
+		/** Hands a frame that was taken with poll() back to the analysis. */
+		void recycle(StftFrame* frame);
+
+		/** How many windows were skipped because no free frame was available. */
+		unsigned int dropped() const;
+	private:
+		static void _run(void* arg);
+		void _analyse();
+
+		int windowSize;
+		int hop;
+		int _bins;
+		const WindowFunction* windowFunction;
+
+		/** The samples that wait for analysis. */
+		RingBuffer* ring;
+		/** Scratch space for the mixdown in write(). */
+		float* mixdown;
+		int blockFrames;
+		/** The position of the next window in the stream. */
+		int64_t position;
+
+		/** The fftw buffers and the shared plan that is reused for every window. */
+		float* window;
+		double* in;
+		fftw_complex* out;
+		fftw_plan plan;
+
+		/** Preallocated frames travelling between the analysis and the js thread. */
+		StftFrame* frames;
+		int frameCount;
+		moodycamel::ReaderWriterQueue<StftFrame*>* freeFrames;
+		moodycamel::ReaderWriterQueue<StftFrame*>* readyFrames;
+
+		uv_async_t* notify;
+		uv_thread_t thread;
+		uv_sem_t pending;
+		std::atomic<bool> running;
+		std::atomic<bool> enabled;
+		std::atomic<unsigned int> _dropped;
+	};
+}
+
+#endif
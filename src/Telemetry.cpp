@@ -0,0 +1,131 @@
+#include "Telemetry.h"
+
+#include <uv.h>
+#include <portaudio.h>
+
+#define LINEAR_BUCKETS (1 << HISTOGRAM_LINEAR_BITS)
+#define OCTAVE_BUCKETS (1 << (HISTOGRAM_LINEAR_BITS - 1))
+
+Sound::HistogramSnapshot Sound::HistogramSnapshot::since(const HistogramSnapshot& earlier) const {
+	HistogramSnapshot result;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+		result.counts[i] = counts[i] - earlier.counts[i];
+	}
+	result.count = count - earlier.count;
+	result.sum = sum - earlier.sum;
+	return result;
+}
+
+double Sound::HistogramSnapshot::mean() const {
+	return count > 0 ? (double)sum / count : 0.0;
+}
+
+static double middle(int index) {
+	// The linear buckets hold exactly one value
+	return Sound::Histogram::bucketStart(index) + (Sound::Histogram::bucketWidth(index) - 1) / 2.0;
+}
+
+double Sound::HistogramSnapshot::minimum() const {
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+		if (counts[i] > 0) return middle(i);
+	}
+	return 0.0;
+}
+
+double Sound::HistogramSnapshot::maximum() const {
+	for (int i = HISTOGRAM_BUCKETS - 1; i >= 0; --i) {
+		if (counts[i] > 0) return middle(i);
+	}
+	return 0.0;
+}
+
+double Sound::HistogramSnapshot::percentile(double share) const {
+	// The buckets are read while they are recorded, so their sum is used instead of count
+	uint64_t total = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) total += counts[i];
+	if (total == 0) return 0.0;
+
+	double rank = share * total;
+	uint64_t seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+		seen += counts[i];
+		if (counts[i] > 0 && seen >= rank) return middle(i);
+	}
+	return maximum();
+}
+
+Sound::Histogram::Histogram() {
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) counts[i].store(0);
+	sum.store(0);
+	count.store(0);
+}
+
+Sound::HistogramSnapshot Sound::Histogram::snapshot() const {
+	HistogramSnapshot result;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+		result.counts[i] = counts[i].load(std::memory_order_relaxed);
+	}
+	result.sum = sum.load(std::memory_order_relaxed);
+	result.count = count.load(std::memory_order_relaxed);
+	return result;
+}
+
+int Sound::Histogram::bucket(uint64_t value) {
+	if (value < LINEAR_BUCKETS) return (int)value;
+	if (value >= ((uint64_t)1 << HISTOGRAM_MAX_BITS)) return HISTOGRAM_BUCKETS - 1;
+	// The octave and the top bits below the leading one
+	int octave = 63 - __builtin_clzll(value);
+	int shift = octave - (HISTOGRAM_LINEAR_BITS - 1);
+	int sub = (int)(value >> shift) - OCTAVE_BUCKETS;
+	return LINEAR_BUCKETS + (octave - HISTOGRAM_LINEAR_BITS) * OCTAVE_BUCKETS + sub;
+}
+
+uint64_t Sound::Histogram::bucketStart(int index) {
+	if (index < LINEAR_BUCKETS) return (uint64_t)index;
+	int octave = (index - LINEAR_BUCKETS) / OCTAVE_BUCKETS + HISTOGRAM_LINEAR_BITS;
+	int sub = (index - LINEAR_BUCKETS) % OCTAVE_BUCKETS;
+	return (uint64_t)(OCTAVE_BUCKETS + sub) << (octave - (HISTOGRAM_LINEAR_BITS - 1));
+}
+
+uint64_t Sound::Histogram::bucketWidth(int index) {
+	if (index < LINEAR_BUCKETS) return 1;
+	int octave = (index - LINEAR_BUCKETS) / OCTAVE_BUCKETS + HISTOGRAM_LINEAR_BITS;
+	return (uint64_t)1 << (octave - (HISTOGRAM_LINEAR_BITS - 1));
+}
+
+Sound::TelemetrySnapshot Sound::TelemetrySnapshot::since(const TelemetrySnapshot& earlier) const {
+	TelemetrySnapshot result;
+	for (int i = 0; i < TelemetryHistogramCount; ++i) {
+		result.histograms[i] = histograms[i].since(earlier.histograms[i]);
+	}
+	for (int i = 0; i < TelemetryCounterCount; ++i) {
+		result.counters[i] = counters[i] - earlier.counters[i];
+	}
+	result.time = time - earlier.time;
+	return result;
+}
+
+Sound::Telemetry::Telemetry() {
+	for (int i = 0; i < TelemetryCounterCount; ++i) counters[i].store(0);
+}
+
+void Sound::Telemetry::status(unsigned long flags) {
+	if (flags == 0) return;
+	if (flags & paInputUnderflow) count(TelemetryInputUnderflow);
+	if (flags & paInputOverflow) count(TelemetryInputOverflow);
+	if (flags & paOutputUnderflow) count(TelemetryOutputUnderflow);
+	if (flags & paOutputOverflow) count(TelemetryOutputOverflow);
+	if (flags & paPrimingOutput) count(TelemetryPrimingOutput);
+}
+
+Sound::TelemetrySnapshot Sound::Telemetry::snapshot() const {
+	TelemetrySnapshot result;
+	for (int i = 0; i < TelemetryHistogramCount; ++i) {
+		result.histograms[i] = histograms[i].snapshot();
+	}
+	for (int i = 0; i < TelemetryCounterCount; ++i) {
+		result.counters[i] = counters[i].load(std::memory_order_relaxed);
+	}
+	result.time = uv_hrtime();
+	return result;
+}
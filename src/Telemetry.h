@@ -0,0 +1,143 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_TELEMETRY_H
+#define SOUND_TELEMETRY_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Values below 2^HISTOGRAM_LINEAR_BITS get a bucket each, every octave above is split into 2^(bits - 1) buckets
+#define HISTOGRAM_LINEAR_BITS 5
+// Larger values (in ns about 18 minutes) are counted in the last bucket
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS ((1 << HISTOGRAM_LINEAR_BITS) + (HISTOGRAM_MAX_BITS - HISTOGRAM_LINEAR_BITS) * (1 << (HISTOGRAM_LINEAR_BITS - 1)))
+
+namespace Sound {
+
+	/**
+	 * The counts of a histogram at one point in time (or between two of them).
+	 */
+	struct HistogramSnapshot {
+		uint64_t counts[HISTOGRAM_BUCKETS];
+		uint64_t count;
+		uint64_t sum;
+
+		/** The difference to an earlier snapshot. */
+		HistogramSnapshot since(const HistogramSnapshot& earlier) const;
+
+		double mean() const;
+		/** The smallest and largest values (as the middle of their buckets). */
+		double minimum() const;
+		double maximum() const;
+		/** The value below which a share (0..1) of the values lie. */
+		double percentile(double share) const;
+	};
+
+	/**
+	 * A log-linear histogram (like HdrHistogram with a precision of about 3%).
+	 *
+	 * There must only be one thread that records values, so the counts are updated with
+	 * relaxed loads and stores instead of locked instructions. Any thread can read them.
+	 */
+	class Histogram {
+	public:
+		Histogram();
+
+		inline void record(uint64_t value) {
+			int index = bucket(value);
+			counts[index].store(counts[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		HistogramSnapshot snapshot() const;
+
+		/** The bucket of a value. */
+		static int bucket(uint64_t value);
+		/** The smallest value of a bucket and how many values it holds. */
+		static uint64_t bucketStart(int index);
+		static uint64_t bucketWidth(int index);
+	private:
+		std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS];
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> count;
+	};
+
+	/**
+	 * The histograms of the engine.
+	 */
+	enum TelemetryHistogram {
+		// Durations in ns
+		TelemetryCallback = 0,
+		TelemetryProcessing,
+		TelemetryListeners,
+		// Queue depths in blocks (measured by the stream callback)
+		TelemetryInQueue,
+		TelemetryOutQueue,
+
+		TelemetryHistogramCount
+	};
+
+	/**
+	 * The counters of the engine.
+	 */
+	enum TelemetryCounter {
+		TelemetryCallbacks = 0,
+		// The callback had no processed block to play
+		TelemetryUnderflows,
+		// The callback dropped the input since the pool or the input queue was full
+		TelemetryOverflows,
+		// A processed block was dropped since the output queue was full
+		TelemetryDropped,
+		// The PaStreamCallbackFlags status bits
+		TelemetryInputUnderflow,
+		TelemetryInputOverflow,
+		TelemetryOutputUnderflow,
+		TelemetryOutputOverflow,
+		TelemetryPrimingOutput,
+
+		TelemetryCounterCount
+	};
+
+	struct TelemetrySnapshot {
+		HistogramSnapshot histograms[TelemetryHistogramCount];
+		uint64_t counters[TelemetryCounterCount];
+		// uv_hrtime() when the snapshot was taken
+		uint64_t time;
+
+		TelemetrySnapshot since(const TelemetrySnapshot& earlier) const;
+	};
+
+	/**
+	 * Lock-free statistics of the stream callback and the processing.
+	 *
+	 * Nothing is ever reset: readers take snapshots and subtract an earlier one to get
+	 * the statistics of a time span, so the threads that record never wait.
+	 */
+	class Telemetry {
+	public:
+		Telemetry();
+
+		/** Records a value (every histogram must only be recorded by one thread). */
+		inline void record(TelemetryHistogram histogram, uint64_t value) {
+			histograms[histogram].record(value);
+		}
+
+		/** Counts an event (any thread). */
+		inline void count(TelemetryCounter counter) {
+			counters[counter].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/** Counts the status bits of a stream callback. */
+		void status(unsigned long flags);
+
+		TelemetrySnapshot snapshot() const;
+	private:
+		Histogram histograms[TelemetryHistogramCount];
+		std::atomic<uint64_t> counters[TelemetryCounterCount];
+	};
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include "Timeline.h"
+
+#include <math.h>
+
+static const char* names[] = {
+	"startPlayback",
+	"stopPlayback",
+	"pausePlayback",
+	"startRecording",
+	"stopRecording",
+	"setVolume",
+	"setMute",
+	"setPlaybackProgress"
+};
+
+const char* Sound::timelineActionName(TimelineAction action) {
+	return names[action];
+}
+
+bool Sound::parseTimelineAction(std::string name, TimelineAction* action) {
+	for (int i = 0; i <= TimelineSetPlaybackProgress; ++i) {
+		if (name == names[i]) {
+			*action = (TimelineAction)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+Sound::Timeline::Timeline(): nextId(0) {}
+
+int Sound::Timeline::add(TimelineCommand command) {
+	command.id = nextId++;
+	if (nextId < 0) nextId = 0;
+	commands.push_back(command);
+	return command.id;
+}
+
+bool Sound::Timeline::cancel(int id) {
+	for (size_t i = 0; i < commands.size(); ++i) {
+		if (commands[i].id == id) {
+			commands.erase(commands.begin() + i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Sound::Timeline::clear() {
+	commands.clear();
+}
+
+bool Sound::Timeline::next(int64_t position, double time, int frames, int sampleRate, TimelineCommand* command, int* offset) {
+	// Only a handful of commands wait at a time, so a scan is cheaper than keeping them sorted
+	int best = -1;
+	int bestOffset = frames;
+	for (size_t i = 0; i < commands.size(); ++i) {
+		int64_t at;
+		if (commands[i].frame >= 0) {
+			at = commands[i].frame - position;
+		} else {
+			at = (int64_t)floor((commands[i].time - time) * sampleRate + 0.5);
+		}
+		if (at >= frames) continue;
+		if (at < 0) at = 0;
+		// The commands are kept in the order they were added, so the first one wins a tie
+		if (best < 0 || at < bestOffset) {
+			best = (int)i;
+			bestOffset = (int)at;
+		}
+	}
+	if (best < 0) return false;
+
+	*command = commands[best];
+	*offset = bestOffset;
+	commands.erase(commands.begin() + best);
+	return true;
+}
+
+int Sound::Timeline::size() const {
+	return (int)commands.size();
+}
@@ -0,0 +1,109 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_TIMELINE_H
+#define SOUND_TIMELINE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SampleFormat.h"
+
+namespace Sound {
+
+	/**
+	 * The transport actions that can be scheduled.
+	 */
+	enum TimelineAction {
+		TimelineStartPlayback,
+		TimelineStopPlayback,
+		TimelinePausePlayback,
+		TimelineStartRecording,
+		TimelineStopRecording,
+		TimelineSetVolume,
+		TimelineSetMute,
+		TimelineSetPlaybackProgress
+	};
+
+	/** The name used in the js api (the name of the engine method, e.g. startPlayback). */
+	const char* timelineActionName(TimelineAction action);
+
+	/**
+	 * Parses an action name of the js api.
+	 *
+	 * @return false if the name is unknown.
+	 */
+	bool parseTimelineAction(std::string name, TimelineAction* action);
+
+	/**
+	 * A transport action that is due at a frame of the engine clock or at a stream time.
+	 */
+	struct TimelineCommand {
+		int id;
+		TimelineAction action;
+		// The frame of the engine clock (negative if the command is due at time)
+		int64_t frame;
+		// The stream time in seconds the frame was captured at
+		double time;
+		// The volume, mute flag or playback progress
+		double value;
+		// The file of a disk recording (empty records into memory)
+		std::string file;
+		SampleFormat format;
+	};
+
+	/**
+	 * The scheduled transport commands of an engine.
+	 *
+	 * The engine asks for the commands that are due in every block it processes and
+	 * splits the block at their frames, so a command takes effect on exactly the frame
+	 * it was scheduled for, no matter how late the block is processed.
+	 */
+	class Timeline {
+	public:
+		Timeline();
+
+		/**
+		 * Schedules a command.
+		 *
+		 * @return The id of the command.
+		 */
+		int add(TimelineCommand command);
+
+		/**
+		 * Removes a command that is not due yet.
+		 *
+		 * @return False if there is no such command.
+		 */
+		bool cancel(int id);
+
+		/** Removes every command. */
+		void clear();
+
+		/**
+		 * Takes the next command that is due in a block (the earliest frame first, commands
+		 * at the same frame in the order they were added).
+		 *
+		 * @param position   The engine frame of the first frame of the block.
+		 * @param time       The stream time of the first frame of the block.
+		 * @param frames     The number of frames of the block.
+		 * @param sampleRate The sample rate.
+		 * @param command    Receives the command.
+		 * @param offset     Receives the frame within the block the command applies at (commands
+		 *                   that are overdue apply at the first frame).
+		 *
+		 * @return False if no more commands are due in the block.
+		 */
+		bool next(int64_t position, double time, int frames, int sampleRate, TimelineCommand* command, int* offset);
+
+		/** The number of scheduled commands. */
+		int size() const;
+	private:
+		int nextId;
+		std::vector<TimelineCommand> commands;
+	};
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "ToneGenerator.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TONE_TABLE_SIZE (1 << TONE_TABLE_BITS)
+#define TONE_FRACTION_BITS (32 - TONE_TABLE_BITS)
+
+// One period of a sine and the first sample again as guard for the interpolation
+static float sineTable[TONE_TABLE_SIZE + 1];
+static bool sineTableReady = false;
+
+static void buildSineTable() {
+	if (sineTableReady) return;
+	for (int i = 0; i < TONE_TABLE_SIZE; ++i) {
+		sineTable[i] = (float)sin(2.0 * M_PI * i / TONE_TABLE_SIZE);
+	}
+	sineTable[TONE_TABLE_SIZE] = sineTable[0];
+	sineTableReady = true;
+}
+
+static uint32_t phaseIncrement(double frequency, int sampleRate) {
+	double cycles = frequency / sampleRate;
+	cycles -= floor(cycles);
+	return (uint32_t)(cycles * 4294967296.0);
+}
+
+Sound::ToneGenerator::ToneGenerator(int sampleRate): sampleRate(sampleRate), nextId(0) {
+	buildSineTable();
+	memset(pool, 0, sizeof(pool));
+}
+
+void Sound::ToneGenerator::setSampleRate(int sampleRate) {
+	this->sampleRate = sampleRate;
+	for (int v = 0; v < TONE_MAX_VOICES; ++v) {
+		pool[v].increment = phaseIncrement(pool[v].frequency, sampleRate);
+	}
+}
+
+int Sound::ToneGenerator::start(double frequency, float level, int64_t start, int64_t frames, int attack, int release) {
+	Voice* voice = NULL;
+	for (int v = 0; v < TONE_MAX_VOICES; ++v) {
+		if (!pool[v].active) {
+			voice = &pool[v];
+			break;
+		}
+	}
+	if (voice == NULL) return -1;
+
+	if (attack < 0) attack = 0;
+	if (release < 0) release = 0;
+	voice->id = nextId++;
+	if (nextId < 0) nextId = 0;
+	voice->active = true;
+	voice->sounding = false;
+	voice->frequency = frequency;
+	voice->level = level;
+	voice->phase = 0;
+	voice->increment = phaseIncrement(frequency, sampleRate);
+	voice->start = start;
+	voice->attackFrames = attack;
+	voice->releaseFrames = release;
+	if (frames < 0) {
+		voice->release = INT64_MAX;
+	} else {
+		// The release ends with the tone, short tones are released right after the start
+		if (release > frames) voice->releaseFrames = release = (int)frames;
+		voice->release = start + frames - release;
+	}
+	return voice->id;
+}
+
+bool Sound::ToneGenerator::stop(int id, int64_t frame) {
+	Voice* voice = _find(id);
+	if (voice == NULL) return false;
+	if (frame < voice->release) voice->release = frame;
+	return true;
+}
+
+void Sound::ToneGenerator::stopAll(int64_t frame) {
+	for (int v = 0; v < TONE_MAX_VOICES; ++v) {
+		if (pool[v].active && frame < pool[v].release) pool[v].release = frame;
+	}
+}
+
+void Sound::ToneGenerator::render(const AudioBlock& block, int64_t position) {
+	_started.clear();
+	_finished.clear();
+
+	int frames = block.frames();
+	int64_t end = position + frames;
+	bool silent = true;
+
+	for (int v = 0; v < TONE_MAX_VOICES; ++v) {
+		Voice& voice = pool[v];
+		if (!voice.active || voice.start >= end) continue;
+
+		int64_t stopped = voice.release == INT64_MAX ? INT64_MAX : voice.release + voice.releaseFrames;
+		if (stopped <= voice.start) {
+			// Stopped before it started
+			voice.active = false;
+			_finished.push_back(voice.id);
+			continue;
+		}
+		if (!voice.sounding) {
+			voice.sounding = true;
+			_started.push_back(voice.id);
+		}
+		if (silent) {
+			if ((int)mix.size() < frames) mix.resize(frames);
+			memset(mix.data(), 0, sizeof(float) * frames);
+			silent = false;
+		}
+
+		int from = voice.start > position ? (int)(voice.start - position) : 0;
+		int to = stopped < end ? (int)(stopped - position) : frames;
+		float attackStep = voice.attackFrames > 0 ? 1.0f / voice.attackFrames : 0.0f;
+		float releaseStep = voice.releaseFrames > 0 ? 1.0f / voice.releaseFrames : 0.0f;
+		uint32_t phase = voice.phase;
+		for (int i = from; i < to; ++i) {
+			int64_t frame = position + i;
+			float envelope = voice.level;
+			if (frame - voice.start < voice.attackFrames) envelope *= (frame - voice.start) * attackStep;
+			if (frame >= voice.release) envelope *= 1.0f - (frame - voice.release) * releaseStep;
+
+			uint32_t index = phase >> TONE_FRACTION_BITS;
+			float fraction = (phase & ((1u << TONE_FRACTION_BITS) - 1)) * (1.0f / (1u << TONE_FRACTION_BITS));
+			float a = sineTable[index];
+			mix[i] += (a + fraction * (sineTable[index + 1] - a)) * envelope;
+			phase += voice.increment;
+		}
+		voice.phase = phase;
+
+		if (stopped <= end) {
+			voice.active = false;
+			_finished.push_back(voice.id);
+		}
+	}
+
+	if (silent) return;
+	for (int c = 0; c < block.channels(); ++c) {
+		float* x = block.channel(c);
+		for (int i = 0; i < frames; ++i) {
+			x[i] += mix[i];
+		}
+	}
+}
+
+const std::vector<int>& Sound::ToneGenerator::started() const {
+	return _started;
+}
+
+const std::vector<int>& Sound::ToneGenerator::finished() const {
+	return _finished;
+}
+
+int Sound::ToneGenerator::voices() const {
+	int count = 0;
+	for (int v = 0; v < TONE_MAX_VOICES; ++v) {
+		if (pool[v].active) ++count;
+	}
+	return count;
+}
+
+Sound::ToneGenerator::Voice* Sound::ToneGenerator::_find(int id) {
+	if (id < 0) return NULL;
+	for (int v = 0; v < TONE_MAX_VOICES; ++v) {
+		if (pool[v].active && pool[v].id == id) return &pool[v];
+	}
+	return NULL;
+}
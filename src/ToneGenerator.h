@@ -0,0 +1,103 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_TONE_GENERATOR_H
+#define SOUND_TONE_GENERATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "AudioBlock.h"
+
+// The sine table has 2^TONE_TABLE_BITS entries (plus one guard entry for the interpolation)
+#define TONE_TABLE_BITS 11
+// The number of tones that can sound (or wait for their start) at once
+#define TONE_MAX_VOICES 32
+
+namespace Sound {
+
+	/**
+	 * A bank of sine voices that are scheduled by stream frame.
+	 *
+	 * Every voice reads a shared wavetable with a fixed point phase accumulator and linear
+	 * interpolation, and has a linear attack and release ramp so tones start and end without
+	 * clicks. Start and stop are given as frames of the stream, so a tone is exactly timed
+	 * no matter when the block that contains the frame is rendered.
+	 */
+	class ToneGenerator {
+	public:
+		ToneGenerator(int sampleRate);
+
+		/** Changes the sample rate (scheduled frames are kept, the frequencies are adjusted). */
+		void setSampleRate(int sampleRate);
+
+		/**
+		 * Schedules a tone.
+		 *
+		 * @param frequency The frequency in Hz.
+		 * @param level     The amplitude.
+		 * @param start     The stream frame the tone starts at.
+		 * @param frames    The length including the release (negative plays until stop()).
+		 * @param attack    The frames of the attack ramp.
+		 * @param release   The frames of the release ramp.
+		 *
+		 * @return          The id of the voice or -1 if all voices are busy.
+		 */
+		int start(double frequency, float level, int64_t start, int64_t frames, int attack, int release);
+
+		/**
+		 * Starts the release of a voice at a frame (or right away if the frame already passed).
+		 *
+		 * @return False if the voice does not sound anymore.
+		 */
+		bool stop(int id, int64_t frame);
+
+		/** Releases every voice at a frame. */
+		void stopAll(int64_t frame);
+
+		/**
+		 * Adds the voices to every channel of a block.
+		 *
+		 * @param block    The block.
+		 * @param position The stream frame of the first frame of the block.
+		 */
+		void render(const AudioBlock& block, int64_t position);
+
+		/** The voices that started during the last render(). */
+		const std::vector<int>& started() const;
+
+		/** The voices that ended during the last render(). */
+		const std::vector<int>& finished() const;
+
+		/** The number of voices that sound or wait for their start. */
+		int voices() const;
+	private:
+		struct Voice {
+			int id;
+			bool active;
+			bool sounding;
+			double frequency;
+			float level;
+			uint32_t phase;
+			uint32_t increment;
+			int64_t start;
+			// The frame the release starts (INT64_MAX until stop() is called)
+			int64_t release;
+			int attackFrames;
+			int releaseFrames;
+		};
+
+		Voice* _find(int id);
+
+		int sampleRate;
+		int nextId;
+		Voice pool[TONE_MAX_VOICES];
+		// The mono mix of the voices that is added to every channel
+		std::vector<float> mix;
+		std::vector<int> _started;
+		std::vector<int> _finished;
+	};
+}
+
+#endif
@@ -0,0 +1,334 @@
+#include "VectorMath.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled for their own target and only called if the cpu supports them
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define VECTOR_MATH_AVX2
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+static inline float softClipSample(float x) {
+	x = x < -3.0f ? -3.0f : (x > 3.0f ? 3.0f : x);
+	float x2 = x * x;
+	return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+/**
+ * Scalar kernels (also the tails of the vector kernels).
+ */
+
+static void gainScalar(float* dst, const float* src, float gain, size_t count) {
+	for (size_t i = 0; i < count; ++i) dst[i] = src[i] * gain;
+}
+
+static void rampScalar(float* dst, const float* src, float from, float step, size_t count) {
+	for (size_t i = 0; i < count; ++i) dst[i] = src[i] * (from + step * i);
+}
+
+static void mixScalar(float* dst, const float* src, float gain, size_t count) {
+	for (size_t i = 0; i < count; ++i) dst[i] += src[i] * gain;
+}
+
+static void clipScalar(float* dst, const float* src, float limit, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		float x = src[i];
+		dst[i] = x < -limit ? -limit : (x > limit ? limit : x);
+	}
+}
+
+static void softClipScalar(float* dst, const float* src, size_t count) {
+	for (size_t i = 0; i < count; ++i) dst[i] = softClipSample(src[i]);
+}
+
+static double dotScalar(const float* a, const float* b, size_t count) {
+	double sum = 0.0;
+	for (size_t i = 0; i < count; ++i) sum += (double)a[i] * b[i];
+	return sum;
+}
+
+static float absMaxScalar(const float* src, size_t count) {
+	float peak = 0.0f;
+	for (size_t i = 0; i < count; ++i) {
+		float x = fabsf(src[i]);
+		if (x > peak) peak = x;
+	}
+	return peak;
+}
+
+#if defined(__SSE2__)
+
+/**
+ * SSE2 kernels.
+ */
+
+static void gainSse(float* dst, const float* src, float gain, size_t count) {
+	size_t i = 0;
+	__m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+	}
+	gainScalar(dst + i, src + i, gain, count - i);
+}
+
+static void rampSse(float* dst, const float* src, float from, float step, size_t count) {
+	size_t i = 0;
+	__m128 g = _mm_setr_ps(from, from + step, from + 2 * step, from + 3 * step);
+	__m128 g4 = _mm_set1_ps(4 * step);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+		g = _mm_add_ps(g, g4);
+	}
+	rampScalar(dst + i, src + i, from + step * i, step, count - i);
+}
+
+static void mixSse(float* dst, const float* src, float gain, size_t count) {
+	size_t i = 0;
+	__m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+	}
+	mixScalar(dst + i, src + i, gain, count - i);
+}
+
+static void clipSse(float* dst, const float* src, float limit, size_t count) {
+	size_t i = 0;
+	__m128 hi = _mm_set1_ps(limit);
+	__m128 lo = _mm_set1_ps(-limit);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi));
+	}
+	clipScalar(dst + i, src + i, limit, count - i);
+}
+
+static void softClipSse(float* dst, const float* src, size_t count) {
+	size_t i = 0;
+	__m128 hi = _mm_set1_ps(3.0f);
+	__m128 lo = _mm_set1_ps(-3.0f);
+	__m128 k27 = _mm_set1_ps(27.0f);
+	__m128 k9 = _mm_set1_ps(9.0f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi);
+		__m128 x2 = _mm_mul_ps(x, x);
+		__m128 num = _mm_mul_ps(x, _mm_add_ps(k27, x2));
+		__m128 den = _mm_add_ps(k27, _mm_mul_ps(k9, x2));
+		_mm_storeu_ps(dst + i, _mm_div_ps(num, den));
+	}
+	softClipScalar(dst + i, src + i, count - i);
+}
+
+static double dotSse(const float* a, const float* b, size_t count) {
+	size_t i = 0;
+	// The products and sums are in double lanes like the scalar kernel (a float sum drifts on long arrays)
+	__m128d low = _mm_setzero_pd();
+	__m128d high = _mm_setzero_pd();
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(a + i);
+		__m128 y = _mm_loadu_ps(b + i);
+		low = _mm_add_pd(low, _mm_mul_pd(_mm_cvtps_pd(x), _mm_cvtps_pd(y)));
+		high = _mm_add_pd(high, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), _mm_cvtps_pd(_mm_movehl_ps(y, y))));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_add_pd(low, high));
+	return lanes[0] + lanes[1] + dotScalar(a + i, b + i, count - i);
+}
+
+static float absMaxSse(const float* src, size_t count) {
+	size_t i = 0;
+	// Clearing the sign bit is the absolute value
+	__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 peak = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(src + i), mask));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, peak);
+	float result = absMaxScalar(src + i, count - i);
+	for (int l = 0; l < 4; ++l) {
+		if (lanes[l] > result) result = lanes[l];
+	}
+	return result;
+}
+
+#endif
+
+#if defined(VECTOR_MATH_AVX2)
+
+/**
+ * AVX2 kernels.
+ */
+
+AVX2_TARGET static void gainAvx2(float* dst, const float* src, float gain, size_t count) {
+	size_t i = 0;
+	__m256 g = _mm256_set1_ps(gain);
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+	}
+	gainScalar(dst + i, src + i, gain, count - i);
+}
+
+AVX2_TARGET static void rampAvx2(float* dst, const float* src, float from, float step, size_t count) {
+	size_t i = 0;
+	__m256 g = _mm256_setr_ps(from, from + step, from + 2 * step, from + 3 * step, from + 4 * step, from + 5 * step, from + 6 * step, from + 7 * step);
+	__m256 g8 = _mm256_set1_ps(8 * step);
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+		g = _mm256_add_ps(g, g8);
+	}
+	rampScalar(dst + i, src + i, from + step * i, step, count - i);
+}
+
+AVX2_TARGET static void mixAvx2(float* dst, const float* src, float gain, size_t count) {
+	size_t i = 0;
+	__m256 g = _mm256_set1_ps(gain);
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+	}
+	mixScalar(dst + i, src + i, gain, count - i);
+}
+
+AVX2_TARGET static void clipAvx2(float* dst, const float* src, float limit, size_t count) {
+	size_t i = 0;
+	__m256 hi = _mm256_set1_ps(limit);
+	__m256 lo = _mm256_set1_ps(-limit);
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), lo), hi));
+	}
+	clipScalar(dst + i, src + i, limit, count - i);
+}
+
+AVX2_TARGET static void softClipAvx2(float* dst, const float* src, size_t count) {
+	size_t i = 0;
+	__m256 hi = _mm256_set1_ps(3.0f);
+	__m256 lo = _mm256_set1_ps(-3.0f);
+	__m256 k27 = _mm256_set1_ps(27.0f);
+	__m256 k9 = _mm256_set1_ps(9.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), lo), hi);
+		__m256 x2 = _mm256_mul_ps(x, x);
+		__m256 num = _mm256_mul_ps(x, _mm256_add_ps(k27, x2));
+		__m256 den = _mm256_add_ps(k27, _mm256_mul_ps(k9, x2));
+		_mm256_storeu_ps(dst + i, _mm256_div_ps(num, den));
+	}
+	softClipScalar(dst + i, src + i, count - i);
+}
+
+AVX2_TARGET static double dotAvx2(const float* a, const float* b, size_t count) {
+	size_t i = 0;
+	// Double lanes like the sse kernel
+	__m256d low = _mm256_setzero_pd();
+	__m256d high = _mm256_setzero_pd();
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(a + i);
+		__m256 y = _mm256_loadu_ps(b + i);
+		low = _mm256_add_pd(low, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(x)), _mm256_cvtps_pd(_mm256_castps256_ps128(y))));
+		high = _mm256_add_pd(high, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)), _mm256_cvtps_pd(_mm256_extractf128_ps(y, 1))));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, _mm256_add_pd(low, high));
+	double result = dotScalar(a + i, b + i, count - i);
+	for (int l = 0; l < 4; ++l) result += lanes[l];
+	return result;
+}
+
+AVX2_TARGET static float absMaxAvx2(const float* src, size_t count) {
+	size_t i = 0;
+	__m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 peak = _mm256_setzero_ps();
+	for (; i + 8 <= count; i += 8) {
+		peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(src + i), mask));
+	}
+	float lanes[8];
+	_mm256_storeu_ps(lanes, peak);
+	float result = absMaxScalar(src + i, count - i);
+	for (int l = 0; l < 8; ++l) {
+		if (lanes[l] > result) result = lanes[l];
+	}
+	return result;
+}
+
+#endif
+
+static const Sound::VectorKernels scalarKernels = {
+	"scalar", gainScalar, rampScalar, mixScalar, clipScalar, softClipScalar, dotScalar, absMaxScalar
+};
+
+#if defined(__SSE2__)
+static const Sound::VectorKernels sseKernels = {
+	"sse2", gainSse, rampSse, mixSse, clipSse, softClipSse, dotSse, absMaxSse
+};
+#endif
+
+#if defined(VECTOR_MATH_AVX2)
+static const Sound::VectorKernels avx2Kernels = {
+	"avx2", gainAvx2, rampAvx2, mixAvx2, clipAvx2, softClipAvx2, dotAvx2, absMaxAvx2
+};
+#endif
+
+static const Sound::VectorKernels* detectKernels() {
+#if defined(VECTOR_MATH_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return &avx2Kernels;
+#endif
+#if defined(__SSE2__)
+	return &sseKernels;
+#else
+	return &scalarKernels;
+#endif
+}
+
+const Sound::VectorKernels& Sound::vectorKernels() {
+	// Initialized once (thread safe since c++11)
+	static const VectorKernels* kernels = detectKernels();
+	return *kernels;
+}
+
+void Sound::interleaveChannels(float* dst, const float* const* channels, int channelCount, size_t frames) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	if (channelCount == 2) {
+		const float* left = channels[0];
+		const float* right = channels[1];
+		for (; i + 4 <= frames; i += 4) {
+			__m128 l = _mm_loadu_ps(left + i);
+			__m128 r = _mm_loadu_ps(right + i);
+			_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+		}
+	}
+#endif
+	for (int c = 0; c < channelCount; ++c) {
+		const float* src = channels[c];
+		for (size_t j = i; j < frames; ++j) {
+			dst[j * channelCount + c] = src[j];
+		}
+	}
+}
+
+void Sound::deinterleaveChannels(float* const* channels, const float* src, int channelCount, size_t frames) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	if (channelCount == 2) {
+		float* left = channels[0];
+		float* right = channels[1];
+		for (; i + 4 <= frames; i += 4) {
+			// l0 r0 l1 r1 | l2 r2 l3 r3
+			__m128 a = _mm_loadu_ps(src + 2 * i);
+			__m128 b = _mm_loadu_ps(src + 2 * i + 4);
+			_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+#endif
+	for (int c = 0; c < channelCount; ++c) {
+		float* dst = channels[c];
+		for (size_t j = i; j < frames; ++j) {
+			dst[j] = src[j * channelCount + c];
+		}
+	}
+}
@@ -0,0 +1,45 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_VECTOR_MATH_H
+#define SOUND_VECTOR_MATH_H
+
+#include <stddef.h>
+
+namespace Sound {
+
+	/**
+	 * Kernels over float arrays. dst may be the same array as src (in place) but the
+	 * arrays must not overlap otherwise.
+	 */
+	struct VectorKernels {
+		// The instruction set of the kernels (avx2, sse2 or scalar)
+		const char* name;
+		/** dst[i] = src[i] * gain */
+		void (*gain)(float* dst, const float* src, float gain, size_t count);
+		/** dst[i] = src[i] * (from + step * i) */
+		void (*ramp)(float* dst, const float* src, float from, float step, size_t count);
+		/** dst[i] += src[i] * gain */
+		void (*mix)(float* dst, const float* src, float gain, size_t count);
+		/** dst[i] = src[i] limited to -limit..limit */
+		void (*clip)(float* dst, const float* src, float limit, size_t count);
+		/** dst[i] = a rational tanh approximation of src[i] (reaches +-1 at +-3) */
+		void (*softClip)(float* dst, const float* src, size_t count);
+		/** The sum of a[i] * b[i] */
+		double (*dot)(const float* a, const float* b, size_t count);
+		/** The largest absolute value */
+		float (*absMax)(const float* src, size_t count);
+	};
+
+	/** The fastest kernels the cpu supports (detected on the first call). */
+	const VectorKernels& vectorKernels();
+
+	/** Interleaves planar channels (dst receives frames x channelCount samples). */
+	void interleaveChannels(float* dst, const float* const* channels, int channelCount, size_t frames);
+
+	/** Splits interleaved samples into planar channels. */
+	void deinterleaveChannels(float* const* channels, const float* src, int channelCount, size_t frames);
+}
+
+#endif
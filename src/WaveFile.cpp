@@ -0,0 +1,317 @@
+#include "WaveFile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The format tags of the fmt chunk
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+// The size of a ds64 chunk without a table (riff size, data size, sample count, table length)
+#define DS64_SIZE 28
+
+// Encoded samples are written in chunks of 1 MB
+#define WAVE_WRITER_STAGING_BYTES (1 << 20)
+#define WAVE_WRITER_ALIGNMENT 4096
+
+using namespace std;
+
+static inline uint16_t readU16(const uint8_t* p) {
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t readU32(const uint8_t* p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t readU64(const uint8_t* p) {
+	return (uint64_t)readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+static inline void writeU16(uint8_t* p, uint16_t v) {
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void writeU32(uint8_t* p, uint32_t v) {
+	writeU16(p, (uint16_t)v);
+	writeU16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline void writeU64(uint8_t* p, uint64_t v) {
+	writeU32(p, (uint32_t)v);
+	writeU32(p + 4, (uint32_t)(v >> 32));
+}
+
+bool Sound::parseWave(const uint8_t* data, int64_t size, WaveInfo* info, string* error) {
+	if (size < 12 || memcmp(data + 8, "WAVE", 4) != 0) {
+		*error = "Not a wave file.";
+		return false;
+	}
+	bool rf64 = memcmp(data, "RF64", 4) == 0 || memcmp(data, "BW64", 4) == 0;
+	if (rf64 == false && memcmp(data, "RIFF", 4) != 0) {
+		*error = "Not a wave file.";
+		return false;
+	}
+
+	bool hasFormat = false;
+	bool hasData = false;
+	uint64_t ds64DataSize = 0;
+	int64_t pos = 12;
+
+	while (pos + 8 <= size) {
+		const uint8_t* chunk = data + pos;
+		uint64_t chunkSize = readU32(chunk + 4);
+		const uint8_t* body = chunk + 8;
+		int64_t bodySize = size - (pos + 8);
+
+		if (memcmp(chunk, "ds64", 4) == 0 && bodySize >= DS64_SIZE) {
+			// The 64bit sizes of a RF64 file
+			ds64DataSize = readU64(body + 8);
+		} else if (memcmp(chunk, "fmt ", 4) == 0 && bodySize >= 16) {
+			uint16_t formatTag = readU16(body);
+			int channels = readU16(body + 2);
+			int sampleRate = (int)readU32(body + 4);
+			int bitsPerSample = readU16(body + 14);
+			uint32_t channelMask = 0;
+			if (formatTag == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 40 && bodySize >= 40) {
+				// The actual format is the first part of the sub format guid
+				channelMask = readU32(body + 20);
+				formatTag = readU16(body + 24);
+			}
+
+			SampleFormat format;
+			if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 16) format = SampleFormatInt16;
+			else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 24) format = SampleFormatInt24;
+			else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 32) format = SampleFormatInt32;
+			else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 32) format = SampleFormatFloat32;
+			else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 64) format = SampleFormatFloat64;
+			else {
+				*error = "Unsupported wave sample format.";
+				return false;
+			}
+			if (channels < 1 || sampleRate < 1) {
+				*error = "Invalid wave format.";
+				return false;
+			}
+
+			info->format.format = format;
+			info->format.channels = channels;
+			info->format.sampleRate = sampleRate;
+			info->format.channelMask = channelMask;
+			hasFormat = true;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			if (rf64 && chunkSize == 0xFFFFFFFF) chunkSize = ds64DataSize;
+			// A recording that was interrupted may be shorter than its header says
+			int64_t dataSize = (int64_t)chunkSize;
+			if (dataSize > bodySize) dataSize = bodySize;
+			info->dataOffset = pos + 8;
+			info->dataSize = dataSize;
+			hasData = true;
+		}
+		// fact, LIST, JUNK and everything else is skipped
+
+		if (hasFormat && hasData) break;
+		// Chunks are padded to an even size
+		pos += 8 + (int64_t)chunkSize + (int64_t)(chunkSize & 1);
+	}
+
+	if (hasFormat == false) {
+		*error = "The wave file has no fmt chunk.";
+		return false;
+	}
+	if (hasData == false) {
+		*error = "The wave file has no data chunk.";
+		return false;
+	}
+	// Only whole frames are usable
+	int64_t frameBytes = (int64_t)bytesPerSample(info->format.format) * info->format.channels;
+	info->dataSize -= info->dataSize % frameBytes;
+	return true;
+}
+
+/**
+ * WAVE_FORMAT_EXTENSIBLE is required for more than two channels or integer samples above 16 bits.
+ */
+static bool isExtensible(const Sound::WaveFormat& format) {
+	bool isFloat = format.format == Sound::SampleFormatFloat32 || format.format == Sound::SampleFormatFloat64;
+	return format.channels > 2 || (isFloat == false && format.format != Sound::SampleFormatInt16);
+}
+
+static bool isFloatFormat(const Sound::WaveFormat& format) {
+	return format.format == Sound::SampleFormatFloat32 || format.format == Sound::SampleFormatFloat64;
+}
+
+int Sound::waveHeaderSize(const WaveFormat& format) {
+	int size = 12;							// RIFF, size, WAVE
+	size += 8 + DS64_SIZE;					// JUNK or ds64
+	size += 8 + (isExtensible(format) ? 40 : 16);	// fmt
+	if (isFloatFormat(format)) size += 12;	// fact
+	// A JUNK chunk pads the header, so the samples start on an aligned offset
+	size += 8;								// JUNK
+	size += 8;								// data
+	return (size + WAVE_WRITER_ALIGNMENT - 1) / WAVE_WRITER_ALIGNMENT * WAVE_WRITER_ALIGNMENT;
+}
+
+void Sound::buildWaveHeader(const WaveFormat& format, int64_t dataBytes, uint8_t* header) {
+	int headerSize = waveHeaderSize(format);
+	int sampleBytes = bytesPerSample(format.format);
+	int blockAlign = sampleBytes * format.channels;
+	uint64_t frames = (uint64_t)(dataBytes / blockAlign);
+	// The riff size includes the pad byte of an odd data chunk
+	uint64_t riffSize = (uint64_t)headerSize - 8 + (uint64_t)dataBytes + (uint64_t)(dataBytes & 1);
+	bool rf64 = riffSize > 0xFFFFFFFF;
+
+	memset(header, 0, headerSize);
+	uint8_t* p = header;
+
+	memcpy(p, rf64 ? "RF64" : "RIFF", 4);
+	writeU32(p + 4, rf64 ? 0xFFFFFFFF : (uint32_t)riffSize);
+	memcpy(p + 8, "WAVE", 4);
+	p += 12;
+
+	// The JUNK chunk turns into ds64 once the file needs 64bit sizes
+	memcpy(p, rf64 ? "ds64" : "JUNK", 4);
+	writeU32(p + 4, DS64_SIZE);
+	if (rf64) {
+		writeU64(p + 8, riffSize);
+		writeU64(p + 16, (uint64_t)dataBytes);
+		writeU64(p + 24, frames);
+		writeU32(p + 32, 0);
+	}
+	p += 8 + DS64_SIZE;
+
+	bool extensible = isExtensible(format);
+	uint16_t formatTag = isFloatFormat(format) ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+	memcpy(p, "fmt ", 4);
+	writeU32(p + 4, extensible ? 40 : 16);
+	writeU16(p + 8, extensible ? WAVE_FORMAT_EXTENSIBLE : formatTag);
+	writeU16(p + 10, (uint16_t)format.channels);
+	writeU32(p + 12, (uint32_t)format.sampleRate);
+	writeU32(p + 16, (uint32_t)(format.sampleRate * blockAlign));
+	writeU16(p + 20, (uint16_t)blockAlign);
+	writeU16(p + 22, (uint16_t)(sampleBytes * 8));
+	if (extensible) {
+		uint32_t channelMask = format.channelMask;
+		if (channelMask == 0) {
+			channelMask = format.channels == 1 ? 0x4 : format.channels >= 32 ? 0xFFFFFFFF : (1u << format.channels) - 1;
+		}
+		writeU16(p + 24, 22);
+		writeU16(p + 26, (uint16_t)(sampleBytes * 8));
+		writeU32(p + 28, channelMask);
+		// KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT: the format tag followed by a fixed guid suffix
+		static const uint8_t guidSuffix[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+		writeU16(p + 32, formatTag);
+		memcpy(p + 34, guidSuffix, 14);
+		p += 48;
+	} else {
+		p += 24;
+	}
+
+	if (isFloatFormat(format)) {
+		memcpy(p, "fact", 4);
+		writeU32(p + 4, 4);
+		writeU32(p + 8, rf64 || frames > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)frames);
+		p += 12;
+	}
+
+	memcpy(p, "JUNK", 4);
+	writeU32(p + 4, (uint32_t)(header + headerSize - 8 - (p + 8)));
+	p = header + headerSize - 8;
+
+	memcpy(p, "data", 4);
+	writeU32(p + 4, rf64 ? 0xFFFFFFFF : (uint32_t)dataBytes);
+}
+
+Sound::WaveWriter::WaveWriter(string file, WaveFormat format): format(format) {
+	headerSize = waveHeaderSize(format);
+	_dataBytes = 0;
+	failed = false;
+
+	void* memory = NULL;
+	if (posix_memalign(&memory, WAVE_WRITER_ALIGNMENT, WAVE_WRITER_STAGING_BYTES) != 0) {
+		memory = NULL;
+	}
+	staging = (uint8_t*)memory;
+
+	fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		// Start with an empty but valid file
+		updateHeader();
+	}
+}
+
+Sound::WaveWriter::~WaveWriter() {
+	finish();
+	free(staging);
+}
+
+bool Sound::WaveWriter::isOpen() const {
+	return fd >= 0 && staging != NULL;
+}
+
+bool Sound::WaveWriter::write(const float* samples, int64_t count) {
+	if (isOpen() == false || failed) return false;
+
+	int sampleBytes = bytesPerSample(format.format);
+	while (count > 0) {
+		const uint8_t* src;
+		int64_t n;
+		if (format.format == SampleFormatFloat32) {
+			// Nothing to convert, write the floats directly
+			src = (const uint8_t*)samples;
+			n = count;
+		} else {
+			n = WAVE_WRITER_STAGING_BYTES / sampleBytes;
+			if (n > count) n = count;
+			encodeSamples(samples, format.format, staging, n);
+			src = staging;
+		}
+
+		int64_t bytes = n * sampleBytes;
+		int64_t done = 0;
+		while (done < bytes) {
+			ssize_t written = pwrite(fd, src + done, (size_t)(bytes - done), headerSize + _dataBytes + done);
+			if (written <= 0) {
+				failed = true;
+				return false;
+			}
+			done += written;
+		}
+		_dataBytes += bytes;
+		samples += n;
+		count -= n;
+	}
+	return true;
+}
+
+bool Sound::WaveWriter::updateHeader() {
+	if (fd < 0 || staging == NULL) return false;
+	// The header is one aligned block (write() is done with the staging buffer at this point)
+	buildWaveHeader(format, _dataBytes, staging);
+	if (pwrite(fd, staging, headerSize, 0) != headerSize) {
+		failed = true;
+	}
+	return failed == false;
+}
+
+bool Sound::WaveWriter::finish() {
+	if (fd < 0) return failed == false;
+
+	// Odd data chunks are followed by a pad byte
+	if (_dataBytes & 1) {
+		uint8_t pad = 0;
+		if (pwrite(fd, &pad, 1, headerSize + _dataBytes) != 1) failed = true;
+	}
+	updateHeader();
+	if (close(fd) != 0) failed = true;
+	fd = -1;
+	return failed == false;
+}
+
+int64_t Sound::WaveWriter::dataBytes() const {
+	return _dataBytes;
+}
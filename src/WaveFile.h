@@ -0,0 +1,103 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_WAVE_FILE_H
+#define SOUND_WAVE_FILE_H
+
+#include <stdint.h>
+#include <string>
+
+#include "SampleFormat.h"
+
+namespace Sound {
+
+	/**
+	 * The sample layout of a wave file.
+	 */
+	struct WaveFormat {
+		SampleFormat format;
+		int channels;
+		int sampleRate;
+		/** The speaker positions of WAVE_FORMAT_EXTENSIBLE (0 if unknown). */
+		uint32_t channelMask;
+	};
+
+	/**
+	 * What parseWave() found in a file.
+	 */
+	struct WaveInfo {
+		WaveFormat format;
+		/** The byte offset of the first sample. */
+		int64_t dataOffset;
+		/** The number of sample bytes. */
+		int64_t dataSize;
+	};
+
+	/**
+	 * Parses the chunks of a RIFF or RF64 wave file (fmt, data, ds64, fact, LIST, ...).
+	 *
+	 * Supports PCM with 16, 24 and 32 bits, 32 and 64 bit floats, any number of
+	 * channels and WAVE_FORMAT_EXTENSIBLE. Unknown chunks are skipped.
+	 *
+	 * @param  data  The beginning of the file (e.g. a mapping of it).
+	 * @param  size  The number of bytes in data.
+	 * @param  info  Receives the format and the location of the samples.
+	 * @param  error Receives a description if the file can't be used.
+	 *
+	 * @return       If the file is a usable wave file.
+	 */
+	bool parseWave(const uint8_t* data, int64_t size, WaveInfo* info, std::string* error);
+
+	/**
+	 * The size of the header that buildWaveHeader() creates (it does not depend on the data size).
+	 * It is padded to a multiple of 4096 bytes, so the samples can be written with aligned writes.
+	 */
+	int waveHeaderSize(const WaveFormat& format);
+
+	/**
+	 * Creates a wave header. A JUNK chunk reserves the space of a ds64 chunk, so a
+	 * header can be turned into RF64 in place once the data grows beyond 4 GB.
+	 *
+	 * @param format    The sample layout.
+	 * @param dataBytes The number of sample bytes that follow the header.
+	 * @param header    Receives waveHeaderSize(format) bytes.
+	 */
+	void buildWaveHeader(const WaveFormat& format, int64_t dataBytes, uint8_t* header);
+
+	/**
+	 * Writes floats into a wave file of any supported format.
+	 */
+	class WaveWriter {
+	public:
+		WaveWriter(std::string file, WaveFormat format);
+
+		/** Finishes the file if that did not happen yet. */
+		~WaveWriter();
+
+		/** If the file could be opened. */
+		bool isOpen() const;
+
+		/** Encodes and appends samples. */
+		bool write(const float* samples, int64_t count);
+
+		/** Rewrites the header for the data written so far. */
+		bool updateHeader();
+
+		/** Writes the final header and closes the file. */
+		bool finish();
+
+		/** The number of sample bytes written so far. */
+		int64_t dataBytes() const;
+	private:
+		int fd;
+		WaveFormat format;
+		int headerSize;
+		int64_t _dataBytes;
+		/** Page aligned staging buffer for the encoded samples. */
+		uint8_t* staging;
+		bool failed;
+	};
+}
+
+#endif
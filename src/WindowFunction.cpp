@@ -1,22 +1,97 @@
 #include "WindowFunction.h"
 
+#include <stdlib.h>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// Allows aligned loads of the coefficients with up to 256 bit registers
+#define WINDOW_FUNCTION_ALIGNMENT 32
+
 WindowFunction::WindowFunction(WindowFunctionType w_type, int size): w_type(w_type), size(size) {
-	coefficients = new double[size];
+	void* memory = NULL;
+	if (posix_memalign(&memory, WINDOW_FUNCTION_ALIGNMENT, sizeof(float) * (size > 0 ? size : 1)) != 0) {
+		memory = NULL;
+	}
+	coefficients = (float*)memory;
 	createCoefficients();
 }
 
 WindowFunction::~WindowFunction() {
-	delete[] coefficients;
+	free(coefficients);
 }
 
-double WindowFunction::at(int i) {
+const WindowFunction* WindowFunction::shared(WindowFunctionType w_type, int size) {
+	static std::mutex mutex;
+	static std::map<std::pair<int, int>, WindowFunction*> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::pair<int, int> key((int)w_type, size);
+	std::map<std::pair<int, int>, WindowFunction*>::iterator it = cache.find(key);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	WindowFunction* windowFunction = new WindowFunction(w_type, size);
+	cache[key] = windowFunction;
+	return windowFunction;
+}
+
+double WindowFunction::at(int i) const {
 	return coefficients[i];
 }
 
+void WindowFunction::apply(const float* in, float* out, int n) const {
+	if (n > size) n = size;
+	int i = 0;
+#if defined(__SSE__)
+	for (; i + 8 <= n; i += 8) {
+		__m128 c0 = _mm_load_ps(coefficients + i);
+		__m128 c1 = _mm_load_ps(coefficients + i + 4);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), c0));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_loadu_ps(in + i + 4), c1));
+	}
+#endif
+	for (; i < n; ++i) {
+		out[i] = in[i] * coefficients[i];
+	}
+}
+
+void WindowFunction::apply(float* inout, int n) const {
+	apply(inout, inout, n);
+}
+
+const float* WindowFunction::data() const {
+	return coefficients;
+}
+
+int WindowFunction::length() const {
+	return size;
+}
+
+double WindowFunction::coherentGain() const {
+	return _coherentGain;
+}
+
+double WindowFunction::enbw() const {
+	return _enbw;
+}
+
 void WindowFunction::createCoefficients() {
+	// Accumulate the sums for the gain figures while computing the table
+	double sum = 0.0;
+	double sumOfSquares = 0.0;
 	for (int i = 0; i < size; ++i) {
-		coefficients[i] = coeff(i);
+		double c = coeff(i);
+		coefficients[i] = (float)c;
+		sum += c;
+		sumOfSquares += c * c;
 	}
+	_coherentGain = size > 0 ? sum / size : 1.0;
+	_enbw = sum != 0.0 ? size * sumOfSquares / (sum * sum) : 1.0;
 }
 
 double WindowFunction::coeff(int n) const {
@@ -39,7 +114,7 @@ double WindowFunction::coeff(int n) const {
 		case Hamming:
 			alpha = 25.0f / 46.0f;
 			beta = 1.0 - alpha;
-			return alpha - beta * ((2.0f * M_PI * i) / (M - 1.0f));
+			return alpha - beta * cos((2.0f * M_PI * i) / (M - 1.0f));
 		case Blackman:
 			alpha = 0.16f;
 			alpha0 = (1.0f - alpha) / 2.0f;
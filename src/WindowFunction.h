@@ -2,6 +2,9 @@
  * @author Martin Mende https://github.com/mmende
  */
 
+#ifndef WINDOW_FUNCTION_H
+#define WINDOW_FUNCTION_H
+
 #include <cmath>
 
 /**
@@ -26,6 +29,18 @@ public:
 	WindowFunction(WindowFunctionType w_type, int size);
 	~WindowFunction();
 
+	/**
+	 * Returns a process wide instance for the type and size. The coefficients
+	 * are only computed the first time a combination is requested and the
+	 * instance is shared by all engines (it must not be deleted).
+	 *
+	 * @param  w_type The window function type.
+	 * @param  size   The size of the window.
+	 *
+	 * @return        The shared window function.
+	 */
+	static const WindowFunction* shared(WindowFunctionType w_type, int size);
+
 	/**
 	 * Returns the coefficient at index i.
 	 *
@@ -33,7 +48,33 @@ public:
 	 *
 	 * @return   The coefficient.
 	 */
-	double at(int i);
+	double at(int i) const;
+
+	/**
+	 * Multiplies n samples with the coefficients (n must not exceed the size).
+	 *
+	 * @param in  The samples.
+	 * @param out Receives the windowed samples (may be the same as in).
+	 * @param n   The number of samples.
+	 */
+	void apply(const float* in, float* out, int n) const;
+
+	/**
+	 * Multiplies n samples with the coefficients in place.
+	 */
+	void apply(float* inout, int n) const;
+
+	/** The 32 byte aligned coefficients. */
+	const float* data() const;
+
+	/** The size of the window. */
+	int length() const;
+
+	/** The mean of the coefficients (divide amplitudes by it to undo the window). */
+	double coherentGain() const;
+
+	/** The equivalent noise bandwidth in bins. */
+	double enbw() const;
 private:
 	/** Specifies which type of window function will be used. */
 	WindowFunctionType w_type;
@@ -42,11 +83,19 @@ private:
 	int size;
 
 	/** Stores the coefficients. */
-	double* coefficients;
+	float* coefficients;
+
+	/** The mean of the coefficients. */
+	double _coherentGain;
+
+	/** The equivalent noise bandwidth. */
+	double _enbw;
 
 	/** Computes the coefficients. */
 	void createCoefficients();
 
 	/** Returns a coefficient for a specific index. */
 	double coeff(int n) const;
-};
\ No newline at end of file
+};
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * @author Martin Mende https://github.com/mmende
+ */
+
+#ifndef SOUND_TEST_CHECK_H
+#define SOUND_TEST_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal checks for the native tests. A failed check is printed and counted,
+ * the test goes on so one run reports every failure.
+ */
+static int checkFailures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+		++checkFailures; \
+	} \
+} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) do { \
+	double _actual = (double)(actual); \
+	double _expected = (double)(expected); \
+	if (!(fabs(_actual - _expected) <= (double)(tolerance))) { \
+		printf("%s:%d: %s is %.9g, expected %.9g (+-%g)\n", __FILE__, __LINE__, #actual, _actual, _expected, (double)(tolerance)); \
+		++checkFailures; \
+	} \
+} while (0)
+
+/** Runs a test function and reports if its checks passed. */
+#define RUN_TEST(test) do { \
+	int _before = checkFailures; \
+	test(); \
+	printf("%s %s\n", checkFailures == _before ? "ok  " : "FAIL", #test); \
+} while (0)
+
+/** The exit code of a test program. */
+static inline int checkResult() {
+	if (checkFailures > 0) printf("%d check(s) failed\n", checkFailures);
+	return checkFailures == 0 ? 0 : 1;
+}
+
+/** A path for a scratch file in TMPDIR (or /tmp). */
+static inline std::string tempPath(const char* name) {
+	const char* dir = getenv("TMPDIR");
+	return std::string(dir != NULL && dir[0] != 0 ? dir : "/tmp") + "/soundengine-test-" + name;
+}
+
+/** Reads a whole file (empty if it can't be read). */
+static inline std::vector<uint8_t> readFile(const std::string& path) {
+	std::vector<uint8_t> data;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) return data;
+	uint8_t buffer[65536];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + n);
+	}
+	fclose(file);
+	return data;
+}
+
+#endif
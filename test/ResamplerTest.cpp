@@ -0,0 +1,203 @@
+#include "Check.h"
+
+#include "Resampler.h"
+
+using namespace Sound;
+
+// Written behind every output buffer to catch writes beyond maxOutput()
+#define GUARD_VALUE 12345.0f
+#define GUARD_SAMPLES 64
+
+struct Ratio {
+	int in;
+	int out;
+};
+
+// Up and down, small and large factors, and a downsampling stretch above 64 (more taps than a chunk)
+static const Ratio ratios[] = {
+	{ 44100, 48000 }, { 48000, 44100 }, { 48000, 8000 }, { 8000, 48000 }, { 32000, 44100 }, { 96000, 1000 }
+};
+static const int ratioCount = sizeof(ratios) / sizeof(ratios[0]);
+
+/** The output frames that belong to frames input frames. */
+static int64_t expectedFrames(const Ratio& ratio, int64_t frames) {
+	return (frames * ratio.out + ratio.in - 1) / ratio.in;
+}
+
+static bool guardIntact(const std::vector<float>& buffer, size_t used) {
+	for (size_t i = used; i < buffer.size(); ++i) {
+		if (buffer[i] != GUARD_VALUE) return false;
+	}
+	return true;
+}
+
+/**
+ * Converts a signal in blocks of the given sizes (used in turn) and flushes, checking that
+ * no call writes more than it announced.
+ */
+static std::vector<float> convert(const Ratio& ratio, int channels, const std::vector<float>& input, const std::vector<int>& blocks) {
+	Resampler resampler(ratio.in, ratio.out, channels);
+	std::vector<float> output;
+	int64_t frames = (int64_t)input.size() / channels;
+	int64_t done = 0;
+	for (size_t b = 0; done < frames; ++b) {
+		int64_t n = blocks[b % blocks.size()];
+		if (n > frames - done) n = frames - done;
+		std::vector<float> out((size_t)(resampler.maxOutput(n) * channels) + GUARD_SAMPLES, GUARD_VALUE);
+		int64_t produced = resampler.process(input.data() + done * channels, n, out.data());
+		CHECK(produced >= 0 && produced <= resampler.maxOutput(n));
+		CHECK(guardIntact(out, (size_t)(resampler.maxOutput(n) * channels)));
+		output.insert(output.end(), out.begin(), out.begin() + produced * channels);
+		done += n;
+	}
+	std::vector<float> out((size_t)(resampler.maxOutput(resampler.taps()) * channels) + GUARD_SAMPLES, GUARD_VALUE);
+	int64_t produced = resampler.flush(out.data());
+	CHECK(produced >= 0 && produced <= resampler.maxOutput(resampler.taps()));
+	CHECK(guardIntact(out, (size_t)(resampler.maxOutput(resampler.taps()) * channels)));
+	output.insert(output.end(), out.begin(), out.begin() + produced * channels);
+	return output;
+}
+
+static std::vector<float> sine(int rate, double frequency, int64_t frames, double amplitude) {
+	std::vector<float> samples((size_t)frames);
+	for (int64_t i = 0; i < frames; ++i) {
+		samples[i] = (float)(amplitude * sin(2.0 * M_PI * frequency * i / rate));
+	}
+	return samples;
+}
+
+static void testOutputLength() {
+	const int64_t lengths[] = { 0, 1, 2, 5, 63, 441, 4095, 4096, 4097, 10000, 48000 };
+	for (int r = 0; r < ratioCount; ++r) {
+		for (int l = 0; l < (int)(sizeof(lengths) / sizeof(lengths[0])); ++l) {
+			std::vector<float> input = sine(ratios[r].in, 440.0, lengths[l], 0.5);
+			std::vector<float> output = convert(ratios[r], 1, input, { 4096 });
+			if ((int64_t)output.size() != expectedFrames(ratios[r], lengths[l])) {
+				printf("%d -> %d with %lld frames\n", ratios[r].in, ratios[r].out, (long long)lengths[l]);
+			}
+			CHECK((int64_t)output.size() == expectedFrames(ratios[r], lengths[l]));
+		}
+	}
+}
+
+static void testFlushAfterShortInput() {
+	for (int r = 0; r < ratioCount; ++r) {
+		Resampler resampler(ratios[r].in, ratios[r].out, 2);
+		std::vector<float> out((size_t)(resampler.maxOutput(resampler.taps()) * 2) + GUARD_SAMPLES, GUARD_VALUE);
+		float in[6] = { 0.1f, -0.1f, 0.2f, -0.2f, 0.3f, -0.3f };
+
+		// A flush without input has nothing to return
+		CHECK(resampler.flush(out.data()) == 0);
+
+		// Three frames, the output stays in the filter until the flush
+		resampler.reset();
+		int64_t produced = resampler.process(in, 3, out.data());
+		CHECK(produced <= resampler.maxOutput(3));
+		produced += resampler.flush(out.data() + produced * 2);
+		CHECK(produced == expectedFrames(ratios[r], 3));
+		CHECK(guardIntact(out, (size_t)(resampler.maxOutput(resampler.taps()) * 2)));
+
+		// A second flush and a new stream after reset() start from scratch
+		CHECK(resampler.flush(out.data()) == 0);
+		resampler.reset();
+		produced = resampler.process(in, 1, out.data());
+		produced += resampler.flush(out.data() + produced * 2);
+		CHECK(produced == expectedFrames(ratios[r], 1));
+	}
+}
+
+static void testBlockSizesDoNotMatter() {
+	std::vector<float> input = sine(44100, 997.0, 20000, 0.8);
+	Ratio ratio = { 44100, 48000 };
+	std::vector<float> whole = convert(ratio, 1, input, { 20000 });
+	std::vector<float> pieces = convert(ratio, 1, input, { 1, 7, 480, 4097, 33 });
+	CHECK(whole.size() == pieces.size());
+	double worst = 0.0;
+	for (size_t i = 0; i < whole.size() && i < pieces.size(); ++i) {
+		worst = fmax(worst, fabs((double)whole[i] - pieces[i]));
+	}
+	CHECK_NEAR(worst, 0.0, 1e-6);
+}
+
+static void testChannelsAreIndependent() {
+	Ratio ratio = { 48000, 44100 };
+	std::vector<float> left = sine(48000, 1000.0, 9000, 0.5);
+	std::vector<float> right = sine(48000, 3000.0, 9000, 0.25);
+	std::vector<float> stereo(left.size() * 2);
+	for (size_t i = 0; i < left.size(); ++i) {
+		stereo[i * 2] = left[i];
+		stereo[i * 2 + 1] = right[i];
+	}
+	std::vector<float> both = convert(ratio, 2, stereo, { 512 });
+	std::vector<float> leftOnly = convert(ratio, 1, left, { 512 });
+	std::vector<float> rightOnly = convert(ratio, 1, right, { 512 });
+	CHECK(both.size() == leftOnly.size() * 2);
+	CHECK(leftOnly.size() == rightOnly.size());
+	double worst = 0.0;
+	for (size_t i = 0; i < leftOnly.size() && i * 2 + 1 < both.size(); ++i) {
+		worst = fmax(worst, fabs((double)both[i * 2] - leftOnly[i]));
+		worst = fmax(worst, fabs((double)both[i * 2 + 1] - rightOnly[i]));
+	}
+	CHECK_NEAR(worst, 0.0, 1e-6);
+}
+
+/**
+ * Converts a sine and returns its level in dB relative to the input, measured on the
+ * middle half of the output. maxError receives the largest deviation from the ideal sine
+ * at the output rate (the output is aligned to the input).
+ */
+static double sineLevel(const Ratio& ratio, double frequency, double* maxError) {
+	const double amplitude = 0.5;
+	std::vector<float> output = convert(ratio, 1, sine(ratio.in, frequency, ratio.in, amplitude), { 4096 });
+	double power = 0.0;
+	int64_t count = 0;
+	*maxError = 0.0;
+	for (size_t i = output.size() / 4; i < output.size() * 3 / 4; ++i) {
+		power += (double)output[i] * output[i];
+		++count;
+		double ideal = amplitude * sin(2.0 * M_PI * frequency * i / ratio.out);
+		*maxError = fmax(*maxError, fabs(output[i] - ideal));
+	}
+	return 20.0 * log10(sqrt(2.0 * power / count) / amplitude);
+}
+
+static void testPassband() {
+	struct { Ratio ratio; double frequency; } cases[] = {
+		{ { 44100, 48000 }, 1000.0 }, { { 44100, 48000 }, 18000.0 },
+		{ { 48000, 44100 }, 1000.0 }, { { 48000, 44100 }, 18000.0 },
+		{ { 48000, 8000 }, 1000.0 }, { { 48000, 8000 }, 3200.0 },
+		{ { 96000, 1000 }, 300.0 }
+	};
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); ++c) {
+		double error;
+		double level = sineLevel(cases[c].ratio, cases[c].frequency, &error);
+		// Flat to 80% of the lower nyquist frequency and in phase with the input
+		CHECK_NEAR(level, 0.0, 0.01);
+		CHECK_NEAR(error, 0.0, 1e-4);
+	}
+}
+
+static void testStopband() {
+	struct { Ratio ratio; double frequency; } cases[] = {
+		{ { 48000, 44100 }, 23000.0 },
+		{ { 48000, 8000 }, 4500.0 }, { { 48000, 8000 }, 6000.0 }, { { 48000, 8000 }, 12000.0 },
+		{ { 96000, 1000 }, 700.0 }
+	};
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); ++c) {
+		double error;
+		double level = sineLevel(cases[c].ratio, cases[c].frequency, &error);
+		// Above the output nyquist frequency nothing may alias back
+		if (level > -80.0) printf("%d -> %d at %g Hz: %g dB\n", cases[c].ratio.in, cases[c].ratio.out, cases[c].frequency, level);
+		CHECK(level < -80.0);
+	}
+}
+
+int main() {
+	RUN_TEST(testOutputLength);
+	RUN_TEST(testFlushAfterShortInput);
+	RUN_TEST(testBlockSizesDoNotMatter);
+	RUN_TEST(testChannelsAreIndependent);
+	RUN_TEST(testPassband);
+	RUN_TEST(testStopband);
+	return checkResult();
+}
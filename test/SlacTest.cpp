@@ -0,0 +1,152 @@
+#include "Check.h"
+
+#include "Slac.h"
+
+using namespace Sound;
+
+/** Samples on the 16 bit grid. */
+static float pcm16(int64_t i, int channel) {
+	int32_t value = (int32_t)(12000.0 * sin(i * 0.013 * (channel + 1)) + (i * 7919 % 61) - 30);
+	return value / 32768.0f;
+}
+
+/** Samples on the 24 bit grid, including both ends of the range. */
+static float pcm24(int64_t i, int channel) {
+	if (i % 1000 == 0) return channel % 2 == 0 ? 1.0f : -1.0f;
+	int32_t value = (int32_t)(3000000.0 * sin(i * 0.007 * (channel + 1)) + (i * 104729 % 2001) - 1000);
+	return value / 8388608.0f;
+}
+
+/** Processed samples that are not on an integer grid (and some out of range). */
+static float offGrid(int64_t i, int channel) {
+	if (i % 500 == 0) return 1.5f;
+	return (float)(0.3 * sin(i * 0.011 + channel) + 1e-9 * (i % 7));
+}
+
+typedef float (*Generator)(int64_t i, int channel);
+
+/**
+ * Writes samples to a slac file in pieces of the given size (in samples, so pieces may
+ * split frames) and reads it back with decode() and decodeBlock().
+ *
+ * @param maxBytes The largest expected file size per sample (4 when blocks are stored verbatim).
+ */
+static void roundTrip(const char* name, int channels, const std::vector<float>& samples, int64_t piece, double maxBytes) {
+	std::string path = tempPath(name);
+	int64_t frames = (int64_t)samples.size() / channels;
+	{
+		SlacWriter writer(path, 44100, channels);
+		CHECK(writer.isOpen());
+		for (int64_t done = 0; done < (int64_t)samples.size(); done += piece) {
+			int64_t n = (int64_t)samples.size() - done < piece ? (int64_t)samples.size() - done : piece;
+			CHECK(writer.write(samples.data() + done, n));
+		}
+		CHECK(writer.finish());
+	}
+	double bytes = (double)readFile(path).size() / (samples.size() > 0 ? samples.size() : 1);
+	if (bytes > maxBytes) printf("%s: %.2f bytes per sample\n", name, bytes);
+	CHECK(bytes <= maxBytes);
+
+	SlacReader reader(path);
+	CHECK(reader.isOpen());
+	if (reader.isOpen() == false) {
+		printf("%s: %s\n", name, reader.error().c_str());
+		return;
+	}
+	CHECK(reader.channels() == channels);
+	CHECK(reader.sampleRate() == 44100);
+	CHECK(reader.frames() == frames);
+	CHECK(reader.blockCount() == (int)((frames + SLAC_BLOCK_FRAMES - 1) / SLAC_BLOCK_FRAMES));
+
+	SampleArena arena;
+	CHECK(reader.decode(&arena));
+	CHECK(arena.size() == (int64_t)samples.size());
+	int64_t mismatches = 0;
+	for (int64_t i = 0; i < arena.size() && i < (int64_t)samples.size(); ++i) {
+		if (arena.at(i) != samples[i]) ++mismatches;
+	}
+	CHECK(mismatches == 0);
+
+	// Single blocks decode to the same samples, the last one is shorter
+	std::vector<float> block((size_t)SLAC_BLOCK_FRAMES * channels);
+	mismatches = 0;
+	for (int b = 0; b < reader.blockCount(); ++b) {
+		int64_t first = (int64_t)b * SLAC_BLOCK_FRAMES;
+		int64_t expected = frames - first < SLAC_BLOCK_FRAMES ? frames - first : SLAC_BLOCK_FRAMES;
+		int64_t decoded = reader.decodeBlock(b, block.data());
+		CHECK(decoded == expected);
+		CHECK(reader.blockAt(first) == b);
+		for (int64_t i = 0; i < decoded * channels; ++i) {
+			if (block[i] != samples[first * channels + i]) ++mismatches;
+		}
+	}
+	CHECK(mismatches == 0);
+	remove(path.c_str());
+}
+
+/** Interleaved samples where every block of every channel comes from a generator. */
+static std::vector<float> signal(int channels, int64_t frames, const std::vector<Generator>& blocks) {
+	std::vector<float> samples((size_t)(frames * channels));
+	for (int64_t i = 0; i < frames; ++i) {
+		Generator generator = blocks[(size_t)(i / SLAC_BLOCK_FRAMES) % blocks.size()];
+		for (int c = 0; c < channels; ++c) {
+			samples[(size_t)(i * channels + c)] = generator(i, c);
+		}
+	}
+	return samples;
+}
+
+static void testPcm16() {
+	roundTrip("pcm16.slac", 1, signal(1, 3 * SLAC_BLOCK_FRAMES, { pcm16 }), 4410, 1.0);
+}
+
+static void testPcm24() {
+	roundTrip("pcm24.slac", 2, signal(2, 3 * SLAC_BLOCK_FRAMES, { pcm24 }), 4410, 3.0);
+}
+
+static void testOffGridFloat() {
+	roundTrip("float.slac", 2, signal(2, 2 * SLAC_BLOCK_FRAMES, { offGrid }), 4410, 4.1);
+}
+
+static void testShortLastBlock() {
+	// 1000 frames after the last full block, and a file shorter than one block
+	roundTrip("short-pcm16.slac", 1, signal(1, 2 * SLAC_BLOCK_FRAMES + 1000, { pcm16 }), 4410, 1.0);
+	roundTrip("short-float.slac", 1, signal(1, SLAC_BLOCK_FRAMES + 1000, { pcm24, offGrid }), 4410, 4.1);
+	roundTrip("tiny.slac", 2, signal(2, 1, { pcm16 }), 1, 100.0);
+}
+
+static void testSilence() {
+	roundTrip("silence.slac", 1, std::vector<float>(SLAC_BLOCK_FRAMES + 17, 0.0f), 4410, 0.5);
+}
+
+static void testMultichannel() {
+	// 6 channels with lpc and verbatim blocks in turn, written in pieces that split frames
+	roundTrip("surround.slac", 6, signal(6, 5 * SLAC_BLOCK_FRAMES + 123, { pcm16, offGrid, pcm24 }), 1001, 3.5);
+}
+
+static void testEmpty() {
+	std::string path = tempPath("empty.slac");
+	{
+		SlacWriter writer(path, 48000, 2);
+		CHECK(writer.finish());
+	}
+	SlacReader reader(path);
+	CHECK(reader.isOpen());
+	CHECK(reader.frames() == 0);
+	CHECK(reader.blockCount() == 0);
+	SampleArena arena;
+	CHECK(reader.decode(&arena));
+	CHECK(arena.size() == 0);
+	remove(path.c_str());
+}
+
+int main() {
+	RUN_TEST(testPcm16);
+	RUN_TEST(testPcm24);
+	RUN_TEST(testOffGridFloat);
+	RUN_TEST(testShortLastBlock);
+	RUN_TEST(testSilence);
+	RUN_TEST(testMultichannel);
+	RUN_TEST(testEmpty);
+	return checkResult();
+}
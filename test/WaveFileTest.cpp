@@ -0,0 +1,362 @@
+#include "Check.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "WaveFile.h"
+#include "SampleFormat.h"
+
+using namespace Sound;
+
+// The format tags of the fmt chunk
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+/**
+ * Builds a wave file chunk by chunk (little endian, odd chunks get a pad byte).
+ */
+struct WaveBuilder {
+	std::vector<uint8_t> bytes;
+
+	explicit WaveBuilder(const char* riff) {
+		append(riff, 4);
+		u32(0);
+		append("WAVE", 4);
+	}
+
+	void append(const void* data, size_t size) {
+		bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+	}
+	void u16(uint16_t v) {
+		uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+		append(b, 2);
+	}
+	void u32(uint32_t v) {
+		u16((uint16_t)v);
+		u16((uint16_t)(v >> 16));
+	}
+	void u64(uint64_t v) {
+		u32((uint32_t)v);
+		u32((uint32_t)(v >> 32));
+	}
+
+	/** Appends a chunk, size is what the chunk header claims. */
+	void chunk(const char* id, const std::vector<uint8_t>& body, uint32_t size) {
+		append(id, 4);
+		u32(size);
+		append(body.data(), body.size());
+		if (body.size() & 1) bytes.push_back(0);
+	}
+	void chunk(const char* id, const std::vector<uint8_t>& body) {
+		chunk(id, body, (uint32_t)body.size());
+	}
+
+	/** Sets the riff size (or the RF64 placeholder). */
+	void finish(bool rf64 = false) {
+		uint32_t size = rf64 ? 0xFFFFFFFF : (uint32_t)(bytes.size() - 8);
+		for (int i = 0; i < 4; ++i) bytes[4 + i] = (uint8_t)(size >> (8 * i));
+	}
+};
+
+static std::vector<uint8_t> fmtBody(uint16_t tag, int channels, int sampleRate, int bits) {
+	WaveBuilder b("RIFF");
+	b.bytes.clear();
+	int blockAlign = channels * bits / 8;
+	b.u16(tag);
+	b.u16((uint16_t)channels);
+	b.u32((uint32_t)sampleRate);
+	b.u32((uint32_t)(sampleRate * blockAlign));
+	b.u16((uint16_t)blockAlign);
+	b.u16((uint16_t)bits);
+	return b.bytes;
+}
+
+static std::vector<uint8_t> extensibleBody(uint16_t subFormat, int channels, int sampleRate, int bits, uint32_t channelMask) {
+	std::vector<uint8_t> body = fmtBody(WAVE_FORMAT_EXTENSIBLE, channels, sampleRate, bits);
+	WaveBuilder b("RIFF");
+	b.bytes.clear();
+	b.u16(22);
+	b.u16((uint16_t)bits);
+	b.u32(channelMask);
+	b.u16(subFormat);
+	static const uint8_t guidSuffix[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+	b.append(guidSuffix, sizeof(guidSuffix));
+	body.insert(body.end(), b.bytes.begin(), b.bytes.end());
+	return body;
+}
+
+static std::vector<uint8_t> pcm16(const std::vector<int16_t>& samples) {
+	std::vector<uint8_t> body(samples.size() * 2);
+	for (size_t i = 0; i < samples.size(); ++i) {
+		body[i * 2] = (uint8_t)samples[i];
+		body[i * 2 + 1] = (uint8_t)((uint16_t)samples[i] >> 8);
+	}
+	return body;
+}
+
+static void testPlainPcm16() {
+	WaveBuilder b("RIFF");
+	b.chunk("fmt ", fmtBody(WAVE_FORMAT_PCM, 2, 44100, 16));
+	b.chunk("data", pcm16({ 1, -1, 16384, -16384 }));
+	b.finish();
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.format.format == SampleFormatInt16);
+	CHECK(info.format.channels == 2);
+	CHECK(info.format.sampleRate == 44100);
+	CHECK(info.format.channelMask == 0);
+	CHECK(info.dataOffset == 44);
+	CHECK(info.dataSize == 8);
+
+	float samples[4];
+	decodeSamples(b.bytes.data() + info.dataOffset, info.format.format, samples, 4);
+	CHECK(samples[2] == 0.5f);
+	CHECK(samples[3] == -0.5f);
+}
+
+static void testOddSizedChunks() {
+	// An odd chunk is followed by a pad byte that is not part of its size
+	WaveBuilder b("RIFF");
+	b.chunk("LIST", { 'I', 'N', 'F' });
+	b.chunk("fmt ", fmtBody(WAVE_FORMAT_PCM, 1, 48000, 24));
+	b.chunk("smpl", { 1, 2, 3, 4, 5 });
+	b.chunk("data", { 0x00, 0x00, 0x40, 0x00, 0x00, 0xC0, 0x01 });
+	b.finish();
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.format.format == SampleFormatInt24);
+	CHECK(info.format.sampleRate == 48000);
+	// 12 + LIST 8 + 3 + pad + fmt 8 + 16 + smpl 8 + 5 + pad + data header 8
+	CHECK(info.dataOffset == 12 + 12 + 24 + 14 + 8);
+	// The seventh byte is not a whole frame
+	CHECK(info.dataSize == 6);
+
+	float samples[2];
+	decodeSamples(b.bytes.data() + info.dataOffset, info.format.format, samples, 2);
+	CHECK(samples[0] == 0.5f);
+	CHECK(samples[1] == -0.5f);
+}
+
+static void testListAndFactBeforeFmt() {
+	WaveBuilder b("RIFF");
+	b.chunk("fact", { 2, 0, 0, 0 });
+	b.chunk("LIST", { 'I', 'N', 'F', 'O', 'I', 'S', 'F', 'T', 1, 0, 0, 0, 'x', 0 });
+	b.chunk("fmt ", fmtBody(WAVE_FORMAT_IEEE_FLOAT, 1, 22050, 32));
+	float values[2] = { 0.25f, -0.75f };
+	std::vector<uint8_t> data((const uint8_t*)values, (const uint8_t*)values + sizeof(values));
+	b.chunk("data", data);
+	b.finish();
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.format.format == SampleFormatFloat32);
+	CHECK(info.format.sampleRate == 22050);
+	CHECK(info.dataSize == 8);
+	CHECK(memcmp(b.bytes.data() + info.dataOffset, values, sizeof(values)) == 0);
+}
+
+static void testTruncatedData() {
+	// An interrupted recording claims more data than the file holds
+	WaveBuilder b("RIFF");
+	b.chunk("fmt ", fmtBody(WAVE_FORMAT_PCM, 2, 44100, 16));
+	b.chunk("data", pcm16({ 1, 2, 3 }), 4000);
+	b.finish();
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.dataOffset == 44);
+	// 6 bytes are there, one whole stereo frame
+	CHECK(info.dataSize == 4);
+
+	// A header without any samples is still usable
+	CHECK(parseWave(b.bytes.data(), 44, &info, &error));
+	CHECK(info.dataSize == 0);
+}
+
+static void testMalformed() {
+	WaveInfo info;
+	std::string error;
+
+	WaveBuilder noData("RIFF");
+	noData.chunk("fmt ", fmtBody(WAVE_FORMAT_PCM, 1, 44100, 16));
+	noData.finish();
+	CHECK(parseWave(noData.bytes.data(), (int64_t)noData.bytes.size(), &info, &error) == false);
+	CHECK(error == "The wave file has no data chunk.");
+
+	WaveBuilder noFormat("RIFF");
+	noFormat.chunk("data", pcm16({ 1, 2 }));
+	noFormat.finish();
+	CHECK(parseWave(noFormat.bytes.data(), (int64_t)noFormat.bytes.size(), &info, &error) == false);
+	CHECK(error == "The wave file has no fmt chunk.");
+
+	WaveBuilder alaw("RIFF");
+	alaw.chunk("fmt ", fmtBody(0x0006, 1, 8000, 8));
+	alaw.chunk("data", { 1, 2 });
+	alaw.finish();
+	CHECK(parseWave(alaw.bytes.data(), (int64_t)alaw.bytes.size(), &info, &error) == false);
+	CHECK(error == "Unsupported wave sample format.");
+
+	WaveBuilder other("RIFX");
+	other.finish();
+	CHECK(parseWave(other.bytes.data(), (int64_t)other.bytes.size(), &info, &error) == false);
+	CHECK(parseWave(other.bytes.data(), 8, &info, &error) == false);
+}
+
+static void testRf64File() {
+	// The layout of EBU Tech 3306: ds64 right after the riff header, 32bit sizes set to -1
+	std::vector<uint8_t> data = { 1, 0, 0, 2, 0, 0, 3, 0, 0, 4, 0, 0 };
+	WaveBuilder ds64("RIFF");
+	ds64.bytes.clear();
+	ds64.u64(0);
+	ds64.u64(data.size());
+	ds64.u64(2);
+	ds64.u32(0);
+
+	WaveBuilder b("RF64");
+	b.chunk("ds64", ds64.bytes);
+	b.chunk("fmt ", extensibleBody(WAVE_FORMAT_PCM, 2, 96000, 24, 0x3));
+	b.chunk("data", data, 0xFFFFFFFF);
+	b.finish(true);
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.format.format == SampleFormatInt24);
+	CHECK(info.format.channels == 2);
+	CHECK(info.format.sampleRate == 96000);
+	CHECK(info.format.channelMask == 0x3);
+	CHECK(info.dataOffset == 12 + 36 + 48 + 8);
+	CHECK(info.dataSize == 12);
+
+	// BW64 is the same layout
+	memcpy(b.bytes.data(), "BW64", 4);
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.dataSize == 12);
+}
+
+static void testExtensibleFloat() {
+	WaveBuilder b("RIFF");
+	b.chunk("fmt ", extensibleBody(WAVE_FORMAT_IEEE_FLOAT, 6, 48000, 64, 0x3F));
+	b.chunk("data", std::vector<uint8_t>(6 * 8 * 3));
+	b.finish();
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(b.bytes.data(), (int64_t)b.bytes.size(), &info, &error));
+	CHECK(info.format.format == SampleFormatFloat64);
+	CHECK(info.format.channels == 6);
+	CHECK(info.format.channelMask == 0x3F);
+	CHECK(info.dataSize == 6 * 8 * 3);
+}
+
+static void testHeaderTurnsIntoRf64() {
+	WaveFormat format = { SampleFormatFloat32, 2, 48000, 0 };
+	int headerSize = waveHeaderSize(format);
+	CHECK(headerSize % 4096 == 0);
+
+	// Below 4 GB the reserved ds64 space is a JUNK chunk
+	std::vector<uint8_t> small(headerSize + 8);
+	buildWaveHeader(format, 8, small.data());
+	CHECK(memcmp(small.data(), "RIFF", 4) == 0);
+	CHECK(memcmp(small.data() + 12, "JUNK", 4) == 0);
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(small.data(), (int64_t)small.size(), &info, &error));
+	CHECK(info.dataOffset == headerSize);
+	CHECK(info.dataSize == 8);
+
+	// A 5 GB file is mapped without backing memory, only the header is written
+	int64_t dataBytes = (int64_t)5 << 30;
+	int64_t size = headerSize + dataBytes;
+	void* memory = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	CHECK(memory != MAP_FAILED);
+	if (memory == MAP_FAILED) return;
+	uint8_t* header = (uint8_t*)memory;
+	buildWaveHeader(format, dataBytes, header);
+	CHECK(memcmp(header, "RF64", 4) == 0);
+	CHECK(memcmp(header + 12, "ds64", 4) == 0);
+	CHECK(memcmp(header + headerSize - 8, "data", 4) == 0);
+	CHECK(memcmp(header + headerSize - 4, "\xFF\xFF\xFF\xFF", 4) == 0);
+	CHECK(parseWave(header, size, &info, &error));
+	CHECK(info.format.format == SampleFormatFloat32);
+	CHECK(info.dataOffset == headerSize);
+	CHECK(info.dataSize == dataBytes);
+	munmap(memory, (size_t)size);
+}
+
+static void roundTrip(SampleFormat sampleFormat, int channels, double tolerance) {
+	const int64_t frames = 1001;
+	std::vector<float> samples((size_t)(frames * channels));
+	for (size_t i = 0; i < samples.size(); ++i) {
+		samples[i] = 0.9f * (float)sin(0.013 * i) * (i % 3 == 0 ? -1.0f : 1.0f);
+	}
+
+	WaveFormat format = { sampleFormat, channels, 44100, 0 };
+	std::string file = tempPath("roundtrip.wav");
+	{
+		WaveWriter writer(file, format);
+		CHECK(writer.isOpen());
+		// Two writes, so the second one starts in the middle of the data
+		CHECK(writer.write(samples.data(), 333 * channels));
+		CHECK(writer.write(samples.data() + 333 * channels, (frames - 333) * channels));
+		CHECK(writer.finish());
+	}
+
+	std::vector<uint8_t> data = readFile(file);
+	unlink(file.c_str());
+	int64_t dataBytes = frames * channels * bytesPerSample(sampleFormat);
+	CHECK((int64_t)data.size() == waveHeaderSize(format) + dataBytes + (dataBytes & 1));
+
+	WaveInfo info;
+	std::string error;
+	CHECK(parseWave(data.data(), (int64_t)data.size(), &info, &error));
+	CHECK(info.format.format == sampleFormat);
+	CHECK(info.format.channels == channels);
+	CHECK(info.format.sampleRate == 44100);
+	CHECK(info.dataOffset == waveHeaderSize(format));
+	CHECK(info.dataOffset % 4096 == 0);
+	CHECK(info.dataSize == dataBytes);
+	if (info.dataSize != dataBytes) return;
+
+	std::vector<float> decoded(samples.size());
+	decodeSamples(data.data() + info.dataOffset, sampleFormat, decoded.data(), (int64_t)decoded.size());
+	double worst = 0.0;
+	for (size_t i = 0; i < samples.size(); ++i) {
+		worst = fmax(worst, fabs((double)decoded[i] - samples[i]));
+	}
+	CHECK_NEAR(worst, 0.0, tolerance);
+}
+
+static void testRoundTrips() {
+	const int channelCounts[] = { 1, 2, 6 };
+	for (int c = 0; c < 3; ++c) {
+		int channels = channelCounts[c];
+		// Rounding to the nearest step is at most half a step off
+		roundTrip(SampleFormatInt16, channels, 0.5 / 32768.0);
+		roundTrip(SampleFormatInt24, channels, 0.5 / 8388608.0);
+		roundTrip(SampleFormatInt32, channels, 1e-9);
+		roundTrip(SampleFormatFloat32, channels, 0.0);
+		roundTrip(SampleFormatFloat64, channels, 0.0);
+	}
+}
+
+int main() {
+	RUN_TEST(testPlainPcm16);
+	RUN_TEST(testOddSizedChunks);
+	RUN_TEST(testListAndFactBeforeFmt);
+	RUN_TEST(testTruncatedData);
+	RUN_TEST(testMalformed);
+	RUN_TEST(testRf64File);
+	RUN_TEST(testExtensibleFloat);
+	RUN_TEST(testHeaderTurnsIntoRf64);
+	RUN_TEST(testRoundTrips);
+	return checkResult();
+}
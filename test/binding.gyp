@@ -0,0 +1,61 @@
+{
+	"target_defaults": {
+		"include_dirs": [
+			"../src"
+		],
+		'conditions' : [
+			[
+				'OS=="mac"', {
+					"xcode_settings": {
+						"OTHER_CPLUSPLUSFLAGS" : [ "-std=c++11", "-stdlib=libc++" ],
+						"OTHER_LDFLAGS": [ "-stdlib=libc++" ],
+						"MACOSX_DEPLOYMENT_TARGET": "10.7"
+					}
+				}
+			],
+			[
+				'OS=="linux"', {
+					'cflags!': [ '-fno-exceptions' ],
+					'cflags_cc!': [ '-fno-exceptions' ],
+					'cflags_cc': [ '-std=c++0x' ]
+				}
+			]
+		],
+		"cflags": [
+			"-std=c++11"
+		],
+		"cflags_cc!": [ '-fno-rtti' ]
+	},
+	"targets": [
+		{
+			"target_name": "wave_file_test",
+			"type": "executable",
+			"sources": [
+				"WaveFileTest.cpp",
+				"../src/WaveFile.cpp",
+				"../src/SampleFormat.cpp"
+			]
+		},
+		{
+			"target_name": "resampler_test",
+			"type": "executable",
+			"sources": [
+				"ResamplerTest.cpp",
+				"../src/Resampler.cpp"
+			]
+		},
+		{
+			"target_name": "slac_test",
+			"type": "executable",
+			"sources": [
+				"SlacTest.cpp",
+				"../src/Slac.cpp",
+				"../src/SampleArena.cpp"
+			],
+			# Outside of node the codec threads need libuv itself
+			"libraries": [
+				"-luv"
+			]
+		}
+	]
+}
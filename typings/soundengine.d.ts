@@ -8,21 +8,164 @@ declare namespace soundengine {
 		outputDevice?: number
 		inputLatency?: number
 		outputLatency?: number
+		queueDepth?: number
+		processingInterval?: number
+		infoInterval?: number
+		statsInterval?: number
 		fftWindowSize?: number
 		fftOverlapSize?: number
 		fftWindowFunction?: string
 	}
 
+	export interface recordingOptions {
+		file?: string
+		format?: string
+	}
+
+	export interface saveOptions {
+		format?: string
+	}
+
+	export interface throttleOptions {
+		interval?: number
+		blocks?: number
+	}
+
+	export interface levelInfo {
+		min: number[]
+		max: number[]
+		peak: number[]
+		rms: number[]
+		truePeak: number[]
+		momentary: number
+		shortTerm: number
+		frames: number
+	}
+
+	export interface bufferPoolInfo {
+		blockSize: number
+		capacity: number
+		available: number
+		inUse: number
+		minAvailable: number
+		exhausted: number
+		inQueue: number
+		outQueue: number
+	}
+
 	export interface beepOptions {
 		duration?: number
 		frequency?: number
 		level?: number
 	}
 
+	export interface toneOptions {
+		frequency?: number
+		level?: number
+		duration?: number
+		at?: number
+		attack?: number
+		release?: number
+	}
+
+	export interface clipOptions {
+		gain?: number
+		pan?: number
+		loop?: boolean
+		loopStart?: number
+		loopEnd?: number
+		offset?: number
+		at?: number
+	}
+
+	export interface clipStats {
+		clips: number
+		memory: number
+		voices: number
+		peakVoices: number
+		blocks: number
+		renderTime: number
+		voiceCost: number
+		load: number
+	}
+
+	export interface histogram {
+		count: number
+		min: number
+		mean: number
+		p50: number
+		p90: number
+		p99: number
+		p999: number
+		max: number
+	}
+
+	export interface engineStats {
+		elapsed: number
+		budget: number
+		load: number
+		callbacks: number
+		underflows: number
+		overflows: number
+		dropped: number
+		status: {
+			inputUnderflow: number
+			inputOverflow: number
+			outputUnderflow: number
+			outputOverflow: number
+			primingOutput: number
+		}
+		callback: histogram
+		processing: histogram
+		listeners: histogram
+		inQueue: histogram
+		outQueue: histogram
+	}
+
+	export interface scheduleOptions {
+		frame?: number
+		time?: number
+		value?: number | boolean
+		file?: string
+		format?: string
+	}
+
+	export interface streamTime {
+		time: number
+		frame: number
+		frameTime: number
+	}
+
+	export interface eqBand {
+		type?: 'lowpass' | 'highpass' | 'bandpass' | 'notch' | 'peak' | 'lowshelf' | 'highshelf' | 'allpass'
+		frequency?: number
+		q?: number
+		gain?: number
+	}
+
+	export interface convolverOptions {
+		mix?: number
+	}
+
+	export interface graphNode {
+		id: string
+		type: 'gain' | 'biquad' | 'delay' | 'mixer' | 'pan' | 'splitter' | 'merger'
+		filter?: 'lowpass' | 'highpass' | 'bandpass' | 'notch' | 'peak' | 'lowshelf' | 'highshelf' | 'allpass'
+		channels?: number[]
+		gains?: number[]
+		[param: string]: any
+	}
+
+	export interface graph {
+		nodes: graphNode[]
+		connections: [string, string][]
+	}
+
 	export class engine {
 		new(options?: engineOptions)
 		
 		addListener(eventName: string, listener: Function)
+		emit(eventName: string, ...args: any[]): boolean
 		eventNames(): string[]
 		listenerCount(eventName: string): number
 		on(eventName: string, listener: Function)
@@ -31,28 +174,51 @@ declare namespace soundengine {
 		prependOnceListener(eventName: string, listener: Function)
 		removeAllListeners(eventName?: string)
 		removeListener(eventName: string, listener: Function)
+		setEventThrottle(eventName: string, options?: throttleOptions)
 
 		loadRecording(file: string)
+		loadRecordingAsync(file: string): Promise<void>
+		loadRecordingAsync(file: string, callback: (err: Error | null) => void)
 		startPlayback()
 		stopPlayback()
 		pausePlayback()
 		isPlaying(): boolean
 
-		startRecording()
+		startRecording(options?: recordingOptions)
 		stopRecording()
 		deleteRecording()
-		saveRecording(file: string)
+		saveRecording(file: string, options?: saveOptions)
+		saveRecordingAsync(file: string, options?: saveOptions): Promise<void>
+		saveRecordingAsync(file: string, options: saveOptions, callback: (err: Error | null) => void)
+		saveRecordingAsync(file: string, callback: (err: Error | null) => void)
 		isRecording(): boolean
 
 		getRecordingSamples(): number
 		getPlaybackPosition(): number
 
-		getRecordingSampleAt(index: number): number
+		getRecordingSampleAt(index: number, channel?: number): number
+		getRecordingChannels(): number
 
 		getPlaybackProgress(): number
 		setPlaybackProgress(progress: number)
 
 		beep(options?: beepOptions)
+		playTone(options: toneOptions): number
+		stopTone(id?: number, frame?: number): boolean
+		getCurrentFrame(): number
+
+		loadClip(file: string): Promise<number>
+		loadClip(file: string, callback: (err: Error | null, id?: number) => void)
+		unloadClip(id: number): boolean
+		playClip(id: number, options?: clipOptions): number
+		setVoice(voice: number, options: {gain?: number, pan?: number}): boolean
+		stopVoice(voice: number, frame?: number): boolean
+		getClipStats(reset?: boolean): clipStats
+		getStats(reset?: boolean): engineStats
+
+		schedule(method: 'startPlayback' | 'stopPlayback' | 'pausePlayback' | 'startRecording' | 'stopRecording' | 'setVolume' | 'setMute' | 'setPlaybackProgress', options?: scheduleOptions): number
+		cancelScheduled(id?: number): boolean
+		getStreamTime(): streamTime
 
 		getVolume(): number
 		setVolume(volume: number)
@@ -63,6 +229,18 @@ declare namespace soundengine {
 		setOptions(options?: engineOptions)
 
 		synchronize()
+		getBufferPoolInfo(): bufferPoolInfo
+
+		setGraph(graph: graph | null)
+		setGraphParam(nodeId: string, param: string, value: number)
+
+		setEq(bands: eqBand[] | null)
+		getEq(): eqBand[]
+
+		setConvolver(file: string, options?: convolverOptions): Promise<void>
+		setConvolver(file: string, callback: (err: Error | null) => void)
+		setConvolver(file: string, options: convolverOptions, callback: (err: Error | null) => void)
+		setConvolver(file: null)
 	}
 
 	export interface Device {
@@ -78,5 +256,38 @@ declare namespace soundengine {
 		defaultHighOutputLatency: number
 	}
 
+	export class Resampler {
+		constructor(inputRate: number, outputRate: number, channels?: number)
+
+		process(samples: Float32Array | number[]): Float32Array
+		flush(): Float32Array
+		reset()
+	}
+
+	export class Equalizer {
+		constructor(sampleRate: number, channels?: number, bands?: eqBand[])
+
+		setBands(bands: eqBand[], ramp?: boolean)
+		process<T extends Float32Array | Float32Array[]>(samples: T): T
+		reset()
+	}
+
 	export function getDevices(): Device[]
+	export function eq<T extends Float32Array | Float32Array[]>(samples: T, bands: eqBand[], sampleRate?: number): T
+	export function setFftPlannerEffort(effort: 'estimate' | 'measure' | 'patient' | 'exhaustive')
+	export function applyDamping(samples: Float32Array, damping: number, out?: Float32Array): Float32Array
+	export function applyDamping(samples: (number | number[] | Float32Array)[], damping: number): (number | number[] | Float32Array)[]
+
+	export namespace math {
+		const isa: 'avx2' | 'sse2' | 'scalar'
+		function gain(samples: Float32Array, gain: number, out?: Float32Array): Float32Array
+		function ramp(samples: Float32Array, from: number, to: number, out?: Float32Array): Float32Array
+		function mix(target: Float32Array, source: Float32Array, gain?: number): Float32Array
+		function clip(samples: Float32Array, limit?: number, out?: Float32Array): Float32Array
+		function softClip(samples: Float32Array, out?: Float32Array): Float32Array
+		function interleave(channels: Float32Array[], out?: Float32Array): Float32Array
+		function deinterleave(samples: Float32Array, channels: number | Float32Array[]): Float32Array[]
+		function dot(a: Float32Array, b: Float32Array): number
+		function absMax(samples: Float32Array): number
+	}
 }
\ No newline at end of file